@@ -14,18 +14,22 @@
 #include "duart.h"
 #include "prov.h"
 
-#include <net/socket.h>
-#include <net/coap.h>
-#include <tinycbor/cbor.h>
-#include <tinycbor/cbor_buf_reader.h>
-#include <tinycbor/cbor_buf_writer.h>
+#include <string.h>
+
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
 
 #define MAX_COAP_MSG_LEN 256
 #define MAX_COAP_PAYLOAD_LEN 64
 
+// Payload formats are described in lib/cddl
+
 #define RSRC_KEY "r"
 
-static int handle_prov_post(CborValue *value,
+static int handle_prov_post(zcbor_state_t *value,
 	       	enum coap_response_code *rsp_code, void *context)
 {
     (void)context;
@@ -34,10 +38,14 @@ static int handle_prov_post(CborValue *value,
     bool updated = false;
 
     char str[PROV_LBL_MAX_LEN];
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        CBOR_MAP_FIELD_TSTR(RSRC_KEY, str),
+    };
 
     // Handle rsrc
-    r = cbor_extract_from_map_string(value, RSRC_KEY, str, sizeof(str));
-    if ((r >= 0) && (r < PROV_LBL_MAX_LEN)) {
+    r = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
+    if (!r && present) {
         r = prov_set_rsrc_label(str);
 
         if (r == 0) {
@@ -67,23 +75,18 @@ static int prov_post(struct coap_resource *resource,
 
 static int prepare_prov_payload(uint8_t *payload, size_t len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
     const char *label;
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
-
-    if (cbor_encoder_create_map(&ce, &map, 1) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 1)) return -EINVAL;
 
     label = prov_get_rsrc_label();
-    if (cbor_encode_text_string(&map, RSRC_KEY, strlen(RSRC_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_text_string(&map, label, strlen(label)) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, RSRC_KEY)) return -EINVAL;
+    if (!zcbor_tstr_put_term(ce, label, PROV_LBL_MAX_LEN)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 1)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int prov_get(struct coap_resource *resource,
@@ -130,13 +133,13 @@ static int prov_get(struct coap_resource *resource,
 #define FAN_5_VAL '5'
 
 #define TEMP_INT_KEY "i"
+#define TEMP_INT_KEY_ID 1
 #define TEMP_EXT_KEY "e"
+#define TEMP_EXT_KEY_ID 2
 
 static int prepare_default_payload(uint8_t *payload, size_t len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 2, payload, len, 1);
     struct ds21_basic_state state;
     int ret;
     char mode;
@@ -203,33 +206,28 @@ static int prepare_default_payload(uint8_t *payload, size_t len)
 		    return -EIO;
     }
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
-
-    if (cbor_encoder_create_map(&ce, &map, 4) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 4)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, ONOFF_KEY, strlen(ONOFF_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_boolean(&map, state.enabled) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, ONOFF_KEY)) return -EINVAL;
+    if (!zcbor_bool_put(ce, state.enabled)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, MODE_KEY, strlen(MODE_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, mode) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, MODE_KEY)) return -EINVAL;
+    if (!zcbor_uint32_put(ce, mode)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, TEMP_KEY, strlen(TEMP_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_dec_frac_num(&map, -1, state.target_temp) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, TEMP_KEY)) return -EINVAL;
+    if (cbor_encode_dec_frac_num(ce, -1, state.target_temp)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, FAN_KEY, strlen(FAN_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, fan) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, FAN_KEY)) return -EINVAL;
+    if (!zcbor_uint32_put(ce, fan)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 4)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int prepare_bytestream_payload(uint8_t *payload, size_t len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
     uint8_t rsp[DUART_MAX_FRAME_LEN];
     size_t rsp_len;
     int ret;
@@ -238,38 +236,35 @@ static int prepare_bytestream_payload(uint8_t *payload, size_t len)
     if (ret < 0) return ret;
     rsp_len = ret;
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
-
-    if (cbor_encoder_create_map(&ce, &map, 1) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 1)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, BIN_KEY, strlen(BIN_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_byte_string(&map, rsp, rsp_len) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, BIN_KEY)) return -EINVAL;
+    if (!zcbor_bstr_encode_ptr(ce, rsp, rsp_len)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 1)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
-static int prepare_bool_payload(uint8_t *payload, size_t len, char *key, size_t key_len, bool value)
+static int prepare_bool_payload(uint8_t *payload, size_t len, const char *key, bool value)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
+    if (!zcbor_map_start_encode(ce, 1)) return -EINVAL;
 
-    if (cbor_encoder_create_map(&ce, &map, 1) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_term(ce, key, 8)) return -EINVAL;
+    if (!zcbor_bool_put(ce, value)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, key, key_len) != CborNoError) return -EINVAL;
-    if (cbor_encode_boolean(&map, value) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 1)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
-
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
+enum {
+    GET_BIN,
+    GET_READY,
+};
+
 // TODO: Refactor after creating generic getter capable of parsing payload
 static int rsrc_get(struct coap_resource *resource,
              struct coap_packet *request,
@@ -320,68 +315,53 @@ static int rsrc_get(struct coap_resource *resource,
 		return -EINVAL;
 	    }
 
-	    CborError cbor_error;
-	    CborParser parser;
-	    CborValue value;
-	    struct cbor_buf_reader reader;
 	    uint8_t req[DUART_MAX_FRAME_LEN];
-	    size_t req_len = sizeof(req);
-
-	    cbor_buf_reader_init(&reader, req_payload, req_payload_len);
-
-	    cbor_error = cbor_parser_init(&reader.r, 0, &parser, &value);
-	    if (cbor_error != CborNoError) {
+	    struct zcbor_string bin;
+	    bool ready = false;
+	    uint32_t present;
+	    const struct cbor_map_field fields[] = {
+		[GET_BIN]   = CBOR_MAP_FIELD_BSTR_REF(BIN_KEY, &bin),
+		[GET_READY] = CBOR_MAP_FIELD_BOOL(READY_KEY, &ready),
+	    };
+	    ZCBOR_STATE_D(cd, 4, req_payload, req_payload_len, 1, 0);
+
+	    if (!zcbor_map_start_decode(cd) ||
+		    cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present)) {
 		coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
 		return -EINVAL;
 	    }
 
-	    if (!cbor_value_is_map(&value)) {
-		coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-		return -EINVAL;
-	    }
+	    // Handle binary command
+	    if (CBOR_MAP_PRESENT(present, GET_BIN) && (bin.len <= sizeof(req))) {
+		memcpy(req, bin.value, bin.len);
 
-	    CborValue map_val;
+		r = duart_tx(req, bin.len);
+		if (r < 0) {
+		    coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_INTERNAL_ERROR, token, tkl);
+		    return -EINVAL;
+		}
 
-	    // Handle binary command
-	    cbor_error = cbor_value_map_find_value(&value, BIN_KEY, &map_val);
-	    if ((cbor_error == CborNoError) && cbor_value_is_byte_string(&map_val)) {
-		cbor_error = cbor_value_copy_byte_string(&map_val, req, &req_len, NULL);
-		if (cbor_error == CborNoError) {
-		    r = duart_tx(req, req_len);
-		    if (r < 0) {
-			coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_INTERNAL_ERROR, token, tkl);
-			return -EINVAL;
-		    }
-
-		    r = prepare_bytestream_payload(payload, sizeof(payload));
-		    if (r < 0) {
-			coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_INTERNAL_ERROR, token, tkl);
-			return -EINVAL;
-		    }
-
-		    payload_len = r;
+		r = prepare_bytestream_payload(payload, sizeof(payload));
+		if (r < 0) {
+		    coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_INTERNAL_ERROR, token, tkl);
+		    return -EINVAL;
 		}
+
+		payload_len = r;
 	    }
 
 	    // Handle readiness checker
-	    if (!payload_len) {
-	        cbor_error = cbor_value_map_find_value(&value, READY_KEY, &map_val);
-	        if ((cbor_error == CborNoError) && cbor_value_is_boolean(&map_val)) {
-		    bool result = false;
-	            cbor_error = cbor_value_get_boolean(&map_val, &result);
-	            if ((cbor_error == CborNoError) && result) {
-			result = ds21_is_ready();
-
-	                r = prepare_bool_payload(payload, sizeof(payload), READY_KEY, sizeof(READY_KEY), result);
-	                if (r < 0) {
-	                    coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_INTERNAL_ERROR, token, tkl);
-	                    return -EINVAL;
-	                }
-
-	                payload_len = r;
-	            }
-	        }
-            }
+	    if (!payload_len && CBOR_MAP_PRESENT(present, GET_READY) && ready) {
+		ready = ds21_is_ready();
+
+		r = prepare_bool_payload(payload, sizeof(payload), READY_KEY, ready);
+		if (r < 0) {
+		    coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_INTERNAL_ERROR, token, tkl);
+		    return -EINVAL;
+		}
+
+		payload_len = r;
+	    }
     } else {
 	    payload_len = prepare_default_payload(payload, sizeof(payload));
     }
@@ -428,6 +408,15 @@ end:
     return r;
 }
 
+enum {
+    POST_RSP_EXP,
+    POST_BIN,
+    POST_ONOFF,
+    POST_MODE,
+    POST_TEMP,
+    POST_FAN,
+};
+
 // TODO: refactor after providing generic setter which can respond with ACK including payload
 static int rsrc_post(struct coap_resource *resource,
         struct coap_packet *request,
@@ -478,64 +467,55 @@ static int rsrc_post(struct coap_resource *resource,
         return -EINVAL;
     }
 
-    CborError cbor_error;
-    CborParser parser;
-    CborValue value;
-    struct cbor_buf_reader reader;
     uint8_t req[DUART_MAX_FRAME_LEN];
-    size_t req_len = sizeof(req);
+    struct zcbor_string bin;
     bool expect_rsp = false;
     uint8_t rsp_payload[MAX_COAP_PAYLOAD_LEN];
     size_t rsp_payload_len;
+    bool enabled;
+    uint32_t mode;
+    int temp;
+    uint32_t fan;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [POST_RSP_EXP] = CBOR_MAP_FIELD_BOOL(RSP_EXP_KEY, &expect_rsp),
+        [POST_BIN]     = CBOR_MAP_FIELD_BSTR_REF(BIN_KEY, &bin),
+        [POST_ONOFF]   = CBOR_MAP_FIELD_BOOL(ONOFF_KEY, &enabled),
+        [POST_MODE]    = CBOR_MAP_FIELD_UINT(MODE_KEY, &mode),
+        [POST_TEMP]    = CBOR_MAP_FIELD_DEC_FRAC(TEMP_KEY, &temp, -1),
+        [POST_FAN]     = CBOR_MAP_FIELD_UINT(FAN_KEY, &fan),
+    };
+    ZCBOR_STATE_D(cd, 4, payload, payload_len, 1, 0);
 
-    cbor_buf_reader_init(&reader, payload, payload_len);
-
-    cbor_error = cbor_parser_init(&reader.r, 0, &parser, &value);
-    if (cbor_error != CborNoError) {
+    if (!zcbor_map_start_decode(cd) ||
+            cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present)) {
         coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
         return -EINVAL;
     }
 
-    if (!cbor_value_is_map(&value)) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
+    // Handle binary command
+    if (CBOR_MAP_PRESENT(present, POST_BIN)) {
+        if (bin.len <= sizeof(req)) {
+            memcpy(req, bin.value, bin.len);
 
-    CborValue map_val;
+	    ret = duart_tx(req, bin.len);
+	    if (ret < 0) {
+                rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
+                goto end;
+	    }
 
-    // Handle response expectation
-    cbor_error = cbor_value_map_find_value(&value, RSP_EXP_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_boolean(&map_val)) {
-        cbor_value_get_boolean(&map_val, &expect_rsp);
-    }
+            rsp_code = COAP_RESPONSE_CODE_CHANGED;
 
-    // Handle binary command
-    cbor_error = cbor_value_map_find_value(&value, BIN_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_valid(&map_val)) {
-        if (cbor_value_is_byte_string(&map_val)) {
-            cbor_error = cbor_value_copy_byte_string(&map_val, req, &req_len, NULL);
-	    if (cbor_error == CborNoError) {
-	        ret = duart_tx(req, req_len);
+	    if (expect_rsp) {
+                ret = prepare_bytestream_payload(rsp_payload, sizeof(rsp_payload));
 	        if (ret < 0) {
                     rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
                     goto end;
 	        }
 
-                rsp_code = COAP_RESPONSE_CODE_CHANGED;;
-
-	        if (expect_rsp) {
-                    ret = prepare_bytestream_payload(rsp_payload, sizeof(rsp_payload));
-	            if (ret < 0) {
-                        expect_rsp = false;
-                        rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
-                        goto end;
-	            }
-
-                    rsp_payload_len = ret;
-                    rsp_code = COAP_RESPONSE_CODE_CHANGED;
-                    return coap_server_send_ack_with_payload(sock, addr, addr_len, id, rsp_code, token, tkl, rsp_payload, rsp_payload_len);
-                }
-	    }
+                rsp_payload_len = ret;
+                return coap_server_send_ack_with_payload(sock, addr, addr_len, id, rsp_code, token, tkl, rsp_payload, rsp_payload_len);
+            }
         }
 
 	goto end;
@@ -545,143 +525,97 @@ static int rsrc_post(struct coap_resource *resource,
     struct ds21_basic_state state;
     bool ds21_basic_state_updated = false;
 
-    // On/off
-    cbor_error = cbor_value_map_find_value(&value, ONOFF_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_boolean(&map_val)) {
-        if (!ds21_basic_state_updated) {
-            ret = ds21_get_basic_state(&state);
-            if (ret < 0) {
-                rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
-                goto end;
-            }
-        }
-
-        cbor_error = cbor_value_get_boolean(&map_val, &state.enabled);
-        if (cbor_error == CborNoError) {
-            ds21_basic_state_updated = true;
-        } else {
-            rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
-	    goto end;
-	}
+    if (!(present & ((1UL << POST_ONOFF) | (1UL << POST_MODE) | (1UL << POST_TEMP) | (1UL << POST_FAN)))) {
+        goto end;
     }
 
-    // Mode
-    cbor_error = cbor_value_map_find_value(&value, MODE_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        uint64_t val;
-        if (!ds21_basic_state_updated) {
-            ret = ds21_get_basic_state(&state);
-            if (ret < 0) {
-                rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
-                goto end;
-            }
-        }
-
-        cbor_error = cbor_value_get_uint64(&map_val, &val);
-        if (cbor_error == CborNoError) {
-            switch (val) {
-                case MODE_DISABLED_VAL:
-                    state.mode= DS21_MODE_DISABLED;
-                    break;
+    ret = ds21_get_basic_state(&state);
+    if (ret < 0) {
+        rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
+        goto end;
+    }
 
-                case MODE_AUTO_VAL:
-                    state.mode = DS21_MODE_AUTO;
-                    break;
+    // On/off
+    if (CBOR_MAP_PRESENT(present, POST_ONOFF)) {
+        state.enabled = enabled;
+        ds21_basic_state_updated = true;
+    }
 
-                case MODE_DRY_VAL:
-                    state.mode = DS21_MODE_DRY;
-                    break;
+    // Mode
+    if (CBOR_MAP_PRESENT(present, POST_MODE)) {
+        switch (mode) {
+            case MODE_DISABLED_VAL:
+                state.mode= DS21_MODE_DISABLED;
+                break;
 
-                case MODE_COOL_VAL:
-                    state.mode = DS21_MODE_COOL;
-                    break;
+            case MODE_AUTO_VAL:
+                state.mode = DS21_MODE_AUTO;
+                break;
 
-                case MODE_HEAT_VAL:
-                    state.mode = DS21_MODE_HEAT;
-                    break;
+            case MODE_DRY_VAL:
+                state.mode = DS21_MODE_DRY;
+                break;
 
-                case MODE_FAN_VAL:
-                    state.mode = DS21_MODE_FAN;
-                    break;
+            case MODE_COOL_VAL:
+                state.mode = DS21_MODE_COOL;
+                break;
 
-                default:
-                    rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
-                    goto end;
-            }
+            case MODE_HEAT_VAL:
+                state.mode = DS21_MODE_HEAT;
+                break;
 
-            ds21_basic_state_updated = true;
-        }
-    }
+            case MODE_FAN_VAL:
+                state.mode = DS21_MODE_FAN;
+                break;
 
-    // Target temperature
-    cbor_error = cbor_value_map_find_value(&value, TEMP_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_valid(&map_val)) {
-        int int_val;
-        if (!ds21_basic_state_updated) {
-            ret = ds21_get_basic_state(&state);
-            if (ret < 0) {
-                rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
+            default:
+                rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
                 goto end;
-            }
         }
 
-	ret = cbor_decode_dec_frac_num(&map_val, -1, &int_val);
-        if (ret < 0) {
-            rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
-            goto end;
-        }
+        ds21_basic_state_updated = true;
+    }
 
-	state.target_temp = int_val;
+    // Target temperature
+    if (CBOR_MAP_PRESENT(present, POST_TEMP)) {
+	state.target_temp = temp;
 
         ds21_basic_state_updated = true;
     }
 
     // Fan
-    cbor_error = cbor_value_map_find_value(&value, FAN_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        uint64_t val;
-        if (!ds21_basic_state_updated) {
-            ret = ds21_get_basic_state(&state);
-            if (ret < 0) {
-                rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
-                goto end;
-            }
-        }
+    if (CBOR_MAP_PRESENT(present, POST_FAN)) {
+        switch (fan) {
+            case FAN_AUTO_VAL:
+                state.fan = DS21_FAN_AUTO;
+                break;
 
-        cbor_error = cbor_value_get_uint64(&map_val, &val);
-        if (cbor_error == CborNoError) {
-            switch (val) {
-                case FAN_AUTO_VAL:
-                    state.fan = DS21_FAN_AUTO;
-                    break;
+            case FAN_1_VAL:
+                state.fan = DS21_FAN_1;
+                break;
 
-                case FAN_1_VAL:
-                    state.fan = DS21_FAN_1;
-                    break;
+            case FAN_2_VAL:
+                state.fan = DS21_FAN_2;
+                break;
 
-                case FAN_2_VAL:
-                    state.fan = DS21_FAN_2;
-                    break;
+            case FAN_3_VAL:
+                state.fan = DS21_FAN_3;
+                break;
 
-                case FAN_3_VAL:
-                    state.fan = DS21_FAN_3;
-                    break;
+            case FAN_4_VAL:
+                state.fan = DS21_FAN_4;
+                break;
 
-                case FAN_4_VAL:
-                    state.fan = DS21_FAN_4;
-                    break;
+            case FAN_5_VAL:
+                state.fan = DS21_FAN_5;
+                break;
 
-                case FAN_5_VAL:
-                    state.fan = DS21_FAN_5;
-                    break;
-
-                default:
-                    rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
-                    goto end;
-            }
-
-            ds21_basic_state_updated = true;
+            default:
+                rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+                goto end;
         }
+
+        ds21_basic_state_updated = true;
     }
 
     if (ds21_basic_state_updated) {
@@ -694,31 +628,26 @@ end:
     return ret;
 }
 
-static int prepare_temp_payload(uint8_t *payload, size_t len)
+static int prepare_temp_payload(uint8_t *payload, size_t len, bool compact)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 2, payload, len, 1);
     struct ds21_temperature temp;
     int ret;
 
     ret = ds21_get_temperature(&temp);
     if (ret < 0) return ret;
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
+    if (!zcbor_map_start_encode(ce, 2)) return -EINVAL;
 
-    if (cbor_encoder_create_map(&ce, &map, 2) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, TEMP_INT_KEY, TEMP_INT_KEY_ID, compact)) return -EINVAL;
+    if (cbor_encode_dec_frac_num(ce, -1, temp.internal)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, TEMP_INT_KEY, strlen(TEMP_INT_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_dec_frac_num(&map, -1, temp.internal) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, TEMP_EXT_KEY, TEMP_EXT_KEY_ID, compact)) return -EINVAL;
+    if (cbor_encode_dec_frac_num(ce, -1, temp.external)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, TEMP_EXT_KEY, strlen(TEMP_EXT_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_dec_frac_num(&map, -1, temp.external) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 2)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
-
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int temp_get(struct coap_resource *resource,
@@ -730,7 +659,7 @@ static int temp_get(struct coap_resource *resource,
     uint8_t payload[MAX_COAP_PAYLOAD_LEN];
     int16_t payload_len = 0;
 
-    r = prepare_temp_payload(payload, sizeof(payload));
+    r = prepare_temp_payload(payload, sizeof(payload), coap_server_accepts_compact(request));
     if (r < 0) {
         return r;
     }
@@ -744,6 +673,7 @@ static int temp_get(struct coap_resource *resource,
 static struct coap_resource * rsrcs_get(int sock)
 {
     static const char * const fota_path [] = {"fota_req", NULL};
+    static const char * const fota_mc_path [] = {"fota_mc", NULL};
     static const char * const sd_path [] = {"sd", NULL};
     static const char * const prov_path[] = {"prov", NULL};
     static const char * rsrc_path[] = {NULL, NULL};
@@ -754,6 +684,9 @@ static struct coap_resource * rsrcs_get(int sock)
           .post = coap_fota_post,
           .path = fota_path,
         },
+        { .post = coap_fota_mc_post,
+          .path = fota_mc_path,
+        },
         { .get = coap_sd_server,
           .path = sd_path,
         },
@@ -775,11 +708,11 @@ static struct coap_resource * rsrcs_get(int sock)
     rsrc_temp_path[0] = rsrc_path[0];
 
     if (!rsrc_path[0] || !strlen(rsrc_path[0])) {
-	    resources[3].path = NULL;
 	    resources[4].path = NULL;
+	    resources[5].path = NULL;
     } else {
-	    resources[3].path = rsrc_path;
-	    resources[4].path = rsrc_temp_path;
+	    resources[4].path = rsrc_path;
+	    resources[5].path = rsrc_temp_path;
     }
 
     // TODO: Replace it with something better
@@ -21,8 +21,11 @@ int cbor_decode_dec_frac_num(zcbor_state_t *cd, int exp, int *value)
         if (tag != ZCBOR_TAG_DECFRAC_ARR) return -EINVAL;
 
         if (!zcbor_list_start_decode(cd)) return -EINVAL;
-        if (!zcbor_int32_decode(cd, &rcv_exp)) return -EINVAL;
-        if (!zcbor_int32_decode(cd, &rcv_integer)) return -EINVAL;
+        if (!zcbor_int32_decode(cd, &rcv_exp) || !zcbor_int32_decode(cd, &rcv_integer)) {
+            // Drop the list backup so that the caller can restore its own one
+            zcbor_list_map_end_force_decode(cd);
+            return -EINVAL;
+        }
         if (!zcbor_list_end_decode(cd)) return -EINVAL;
     } else if (zcbor_int32_decode(cd, &rcv_integer)) {
         rcv_exp = 0;
@@ -47,8 +50,21 @@ int cbor_decode_dec_frac_num(zcbor_state_t *cd, int exp, int *value)
 
 int cbor_encode_dec_frac_num(zcbor_state_t *ce, int exp, int value)
 {
-    // TODO: If exp >= 0, simply encode integer
-    // TODO: If exp < 0 AND value % 10^-exp == 0, simply encode integer
+    int integer = value;
+    int i;
+
+    // Plain integer is shorter than the tagged array and decoded the same way
+    for (i = exp; (i > 0) && (integer <= INT_MAX / 10) && (integer >= INT_MIN / 10); --i) {
+        integer *= 10;
+    }
+    for (; (i < 0) && (integer % 10 == 0); ++i) {
+        integer /= 10;
+    }
+    if (i == 0) {
+        if (!zcbor_int32_put(ce, integer)) return -EINVAL;
+        return 0;
+    }
+
     if (!zcbor_tag_put(ce, ZCBOR_TAG_DECFRAC_ARR)) return -EINVAL;
     if (!zcbor_list_start_encode(ce, 2)) return -EINVAL;
     if (!zcbor_int32_put(ce, exp)) return -EINVAL;
@@ -58,33 +74,154 @@ int cbor_encode_dec_frac_num(zcbor_state_t *ce, int exp, int value)
     return 0;
 }
 
-int cbor_extract_from_map_string(zcbor_state_t *unordered_map, const char *key, char *value, size_t value_len)
+int cbor_encode_key(zcbor_state_t *ce, const char *key, uint32_t key_id, bool compact)
 {
-    struct zcbor_string str;
-    if (!zcbor_search_key_tstr_term(unordered_map, key, 32)) return -EINVAL;
-    if (!zcbor_tstr_decode(unordered_map, &str)) return -EINVAL;
-
-    if (str.len >= value_len) return -EINVAL;
-    strncpy(value, str.value, str.len);
-    if (str.len < value_len - 1) {
-        value[str.len] = '\0';
+    if (compact && key_id) {
+        if (!zcbor_uint32_put(ce, key_id)) return -EINVAL;
     } else {
-        value[value_len - 1] = '\0';
+        if (!zcbor_tstr_encode_ptr(ce, key, strlen(key))) return -EINVAL;
     }
 
-    return str.len;
+    return 0;
 }
 
-int cbor_extract_from_map_int(zcbor_state_t *unordered_map, const char *key, int *value)
+// valid is cleared if the value was consumed, but does not fit the entry
+static bool decode_field(zcbor_state_t *cd, const struct cbor_map_field *field, bool *valid)
 {
-    if (!zcbor_search_key_tstr_term(unordered_map, key, 32)) return -EINVAL;
-    if (!zcbor_int32_decode(unordered_map, value)) return -EINVAL;
-    return 0;
+    *valid = true;
+
+    switch (field->type) {
+        case CBOR_MAP_FIELD_INT:
+            return zcbor_int32_decode(cd, field->value);
+
+        case CBOR_MAP_FIELD_UINT:
+            return zcbor_uint32_decode(cd, field->value);
+
+        case CBOR_MAP_FIELD_BOOL:
+            return zcbor_bool_decode(cd, field->value);
+
+        case CBOR_MAP_FIELD_TSTR:
+        {
+            struct zcbor_string str;
+            char *buf = field->value;
+
+            if (!zcbor_tstr_decode(cd, &str)) return false;
+            if (str.len >= (size_t)field->arg) {
+                *valid = false;
+                return true;
+            }
+
+            memcpy(buf, str.value, str.len);
+            buf[str.len] = '\0';
+            return true;
+        }
+
+        case CBOR_MAP_FIELD_TSTR_REF:
+            return zcbor_tstr_decode(cd, field->value);
+
+        case CBOR_MAP_FIELD_BSTR_REF:
+            return zcbor_bstr_decode(cd, field->value);
+
+        case CBOR_MAP_FIELD_DEC_FRAC:
+            return cbor_decode_dec_frac_num(cd, field->arg, field->value) == 0;
+
+        case CBOR_MAP_FIELD_MAP:
+        {
+            struct cbor_submap *submap = field->value;
+            int r;
+
+            if (!zcbor_map_start_decode(cd)) return false;
+            r = cbor_decode_map(cd, submap->fields, submap->num_fields, &submap->present);
+            // Closing also drops the backup of a partially decoded map
+            if (!zcbor_list_map_end_force_decode(cd)) return false;
+            return r == 0;
+        }
+
+        default:
+            return false;
+    }
+}
+
+// zcbor decoders of single values consume nothing if they fail. Decimal fractions and nested maps
+// can fail after consuming a part of the value
+static bool may_consume(const struct cbor_map_field *field)
+{
+    return (field->type == CBOR_MAP_FIELD_DEC_FRAC) || (field->type == CBOR_MAP_FIELD_MAP);
 }
 
-int cbor_extract_from_map_bool(zcbor_state_t *unordered_map, const char *key, bool *value)
+static bool same_key(const struct cbor_map_field *a, const struct cbor_map_field *b)
 {
-    if (!zcbor_search_key_tstr_term(unordered_map, key, 32)) return -EINVAL;
-    if (!zcbor_bool_decode(unordered_map, value)) return -EINVAL;
+    return (a->key_id == b->key_id) && (a->key_len == b->key_len) && (a->key[0] == b->key[0]) &&
+           (memcmp(a->key, b->key, a->key_len) == 0);
+}
+
+// Keys usually come in the order of the table, so the lookup of the next key starts after the
+// entries of the last one
+static size_t next_key(const struct cbor_map_field *fields, size_t num_fields, size_t i)
+{
+    while ((i + 1 < num_fields) && same_key(&fields[i], &fields[i + 1])) {
+        ++i;
+    }
+
+    return (i + 1 < num_fields) ? i + 1 : 0;
+}
+
+int cbor_decode_map(zcbor_state_t *cd, const struct cbor_map_field *fields, size_t num_fields,
+                    uint32_t *present)
+{
+    uint32_t found = 0;
+    size_t next = 0;
+
+    if (num_fields > 32) return -EINVAL;
+
+    while (!zcbor_array_at_end(cd)) {
+        struct zcbor_string key = { 0 };
+        uint32_t key_id = 0;
+        bool decoded = false;
+
+        if (!zcbor_tstr_decode(cd, &key) && !zcbor_uint32_decode(cd, &key_id)) {
+            // Key tables contain text keys and integer aliases only
+            if (!zcbor_any_skip(cd, NULL)) return -EINVAL;
+            if (!zcbor_any_skip(cd, NULL)) return -EINVAL;
+            continue;
+        }
+
+        for (size_t n = 0, i = next; (n < num_fields) && !decoded;
+             ++n, i = (i + 1 < num_fields) ? i + 1 : 0) {
+            bool backup;
+            bool valid;
+
+            if (key_id) {
+                if (fields[i].key_id != key_id) continue;
+            } else {
+                if (fields[i].key_len != key.len) continue;
+                // Keys are short, most of them differ in the first character
+                if (key.len && (fields[i].key[0] != key.value[0])) continue;
+                if (memcmp(fields[i].key, key.value, key.len) != 0) continue;
+            }
+
+            // Backup of the value position to retry with the next matching entry
+            backup = may_consume(&fields[i]);
+            if (backup && !zcbor_union_start_code(cd)) return -EINVAL;
+
+            decoded = decode_field(cd, &fields[i], &valid);
+
+            if (backup) {
+                if (!decoded && !zcbor_union_elem_code(cd)) return -EINVAL;
+                if (!zcbor_union_end_code(cd)) return -EINVAL;
+            }
+
+            if (decoded) {
+                if (valid) found |= 1UL << i;
+                next = next_key(fields, num_fields, i);
+            }
+        }
+
+        if (!decoded) {
+            if (!zcbor_any_skip(cd, NULL)) return -EINVAL;
+        }
+    }
+
+    *present = found;
     return 0;
 }
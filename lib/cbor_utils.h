@@ -13,6 +13,8 @@
 #define CBOR_UTILS_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <zcbor_decode.h>
 #include <zcbor_encode.h>
 
@@ -20,13 +22,94 @@
 extern "C" {
 #endif
 
+/** @brief Type of a value decoded by @ref cbor_decode_map */
+enum cbor_map_field_type {
+    CBOR_MAP_FIELD_INT,      // int32_t
+    CBOR_MAP_FIELD_UINT,     // uint32_t
+    CBOR_MAP_FIELD_BOOL,     // bool
+    CBOR_MAP_FIELD_TSTR,     // char[arg], NUL terminated copy
+    CBOR_MAP_FIELD_TSTR_REF, // struct zcbor_string pointing into the payload
+    CBOR_MAP_FIELD_BSTR_REF, // struct zcbor_string pointing into the payload
+    CBOR_MAP_FIELD_DEC_FRAC, // int scaled to 10^arg
+    CBOR_MAP_FIELD_MAP,      // struct cbor_submap
+};
+
+/** @brief Entry of a key table used by @ref cbor_decode_map
+ *
+ * The same key may appear in several consecutive entries of different types.
+ * The first entry able to decode the value is used. A text longer than the
+ * buffer of a CBOR_MAP_FIELD_TSTR entry is dropped.
+ */
+struct cbor_map_field {
+    const char *key;
+    size_t key_len;
+    uint32_t key_id; // Integer alias of the key in the compact profile, 0 if none
+    enum cbor_map_field_type type;
+    void *value;
+    int arg;
+};
+
+/** @brief Key table of a nested map, with presence flags filled in by the decoder */
+struct cbor_submap {
+    const struct cbor_map_field *fields;
+    size_t num_fields;
+    uint32_t present;
+};
+
+#define CBOR_MAP_FIELD_ID(_key, _id, _type, _value, _arg) \
+    { .key = _key, .key_len = sizeof(_key) - 1, .key_id = _id, .type = _type, .value = _value, \
+      .arg = _arg }
+#define CBOR_MAP_FIELD(_key, _type, _value, _arg) CBOR_MAP_FIELD_ID(_key, 0, _type, _value, _arg)
+
+#define CBOR_MAP_FIELD_INT(_key, _value)  CBOR_MAP_FIELD(_key, CBOR_MAP_FIELD_INT, _value, 0)
+#define CBOR_MAP_FIELD_UINT(_key, _value) CBOR_MAP_FIELD(_key, CBOR_MAP_FIELD_UINT, _value, 0)
+#define CBOR_MAP_FIELD_BOOL(_key, _value) CBOR_MAP_FIELD(_key, CBOR_MAP_FIELD_BOOL, _value, 0)
+#define CBOR_MAP_FIELD_TSTR(_key, _buf) \
+    CBOR_MAP_FIELD(_key, CBOR_MAP_FIELD_TSTR, _buf, sizeof(_buf))
+#define CBOR_MAP_FIELD_TSTR_REF(_key, _value) CBOR_MAP_FIELD(_key, CBOR_MAP_FIELD_TSTR_REF, _value, 0)
+#define CBOR_MAP_FIELD_BSTR_REF(_key, _value) CBOR_MAP_FIELD(_key, CBOR_MAP_FIELD_BSTR_REF, _value, 0)
+#define CBOR_MAP_FIELD_DEC_FRAC(_key, _value, _exp) \
+    CBOR_MAP_FIELD(_key, CBOR_MAP_FIELD_DEC_FRAC, _value, _exp)
+#define CBOR_MAP_FIELD_MAP(_key, _submap) CBOR_MAP_FIELD(_key, CBOR_MAP_FIELD_MAP, _submap, 0)
+
+#define CBOR_MAP_PRESENT(_present, _idx) (((_present) & (1UL << (_idx))) != 0)
+
+/** @brief Decode all entries of an opened map in a single pass
+ *
+ * Each key found in the map is looked up in @p fields and its value is decoded
+ * to the slot of the matching entry. Integer keys are matched against key_id
+ * aliases. Keys missing from the table and values of unexpected type are
+ * skipped. Lookup of a key starts after the entry of the previous one, so keys
+ * in the order of the table are matched with a single comparison. Must be
+ * called right after the map is opened.
+ *
+ * @param cd         Decoder state positioned at the first key of the map
+ * @param fields     Key table, at most 32 entries
+ * @param num_fields Number of entries in @p fields
+ * @param present    Bit n is set if @p fields[n] was decoded
+ *
+ * @retval 0       Map decoded
+ * @retval -EINVAL Malformed map
+ */
+int cbor_decode_map(zcbor_state_t *cd, const struct cbor_map_field *fields, size_t num_fields,
+                    uint32_t *present);
+
+/** @brief Encode a map key
+ *
+ * @param ce      Encoder state
+ * @param key     Text key
+ * @param key_id  Integer alias of the key, 0 if none
+ * @param compact Use the alias instead of the text key if there is one
+ *
+ * @retval 0       Key encoded
+ * @retval -EINVAL No space in the payload
+ */
+int cbor_encode_key(zcbor_state_t *ce, const char *key, uint32_t key_id, bool compact);
+
 int cbor_decode_dec_frac_num(zcbor_state_t *cd, int exp, int *value);
+/** @brief Encode @p value * 10^@p exp, as a plain integer if it is one */
 int cbor_encode_dec_frac_num(zcbor_state_t *ce, int exp, int value);
 
-int cbor_extract_from_map_string(zcbor_state_t *unordered_map, const char *key, char *value, size_t value_len);
-int cbor_extract_from_map_int(zcbor_state_t *unordered_map, const char *key, int *value);
-int cbor_extract_from_map_bool(zcbor_state_t *unordered_map, const char *key, bool *value);
-
 #ifdef __cplusplus
 }   
 #endif
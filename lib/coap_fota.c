@@ -6,42 +6,1472 @@
 
 #include "coap_fota.h"
 
+#include <cbor_utils.h>
 #include <coap_server.h>
+#include <fota_delta.h>
 #include <ot_sed.h>
 
-#include <net/fota_download.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dfu/dfu_target.h>
+#include <dfu/dfu_target_mcuboot.h>
+#include <pm_config.h>
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+#include <zephyr/dfu/mcuboot.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/net_if.h>
 #include <zephyr/net/socket.h>
 #include <zephyr/net/coap.h>
+#include <zephyr/random/random.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/reboot.h>
 
-#define MAX_COAP_MSG_LEN 256
-#define MAX_COAP_PAYLOAD_LEN 64
-#define MAX_FOTA_PAYLOAD_LEN 64
-#define MAX_FOTA_PATH_LEN 16
+#define COAP_PORT 5683
+#define MAX_COAP_MSG_LEN 256
+#define MAX_COAP_PAYLOAD_LEN 64
+#define MAX_FOTA_PAYLOAD_LEN 64
+#define MAX_FOTA_ETAG_LEN 8
+
+#define SETT_NAME "fota"
+#define URL_NAME "url"
+#define PRG_NAME "prg"
+#define CACHE_NAME "cache"
+
+#define STATE_KEY "s"
+#define VERSION_KEY "v"
+#define OFFSET_KEY "o"
+#define SIZE_KEY "t"
+
+#ifdef CONFIG_COAP_FOTA_WINDOW
+#define FOTA_WINDOW CONFIG_COAP_FOTA_WINDOW
+#else
+#define FOTA_WINDOW 4
+#endif
+
+#ifdef CONFIG_COAP_FOTA_SAVE_INTERVAL
+#define FOTA_SAVE_INTERVAL CONFIG_COAP_FOTA_SAVE_INTERVAL
+#else
+#define FOTA_SAVE_INTERVAL 32
+#endif
+
+#define FOTA_ACK_TIMEOUT_MS 3000
+#define FOTA_MAX_RETRANSMIT 4
+#define FOTA_RESUME_DELAY K_SECONDS(60)
+#define FOTA_MAX_RESUMES 5
+
+#define FOTA_THREAD_STACK_SIZE 2048
+#define FOTA_THREAD_PRIO       5
+
+/* Block size is chosen to fit a Block2 response in a single 802.15.4 frame, so that the transfer
+ * is never fragmented by 6LoWPAN:
+ *  127 B frame
+ *  - 21 B MAC header with PAN ID compression and short addresses, auxiliary security header,
+ *         MIC-32 and FCS
+ *  -  5 B mesh header
+ *  -  3 B IPHC with both addresses compressed by context
+ *  -  7 B UDP NHC
+ *  - 17 B CoAP header, token, ETag, Block2 option and payload marker
+ *  = 74 B  -> 64 B block
+ * If the server address cannot be compressed, it takes additional 16 B inline -> 32 B block.
+ */
+#define FRAME_MAX_LEN 127
+#define FRAME_OVERHEAD (21 + 5 + 3 + 7)
+#define COAP_BLOCK_OVERHEAD 17
+#define INLINE_ADDR_LEN 16
+
+#define BLOCK_SZX_MIN 0 // 16 B
+#define BLOCK_SZX_MAX 2 // 64 B
+#define BLOCK_SIZE(szx) (16U << (szx))
+#define FOTA_BLOCK_MAX_LEN BLOCK_SIZE(BLOCK_SZX_MAX)
+
+#define BLOCK2_NUM(opt) ((uint32_t)(opt) >> 4)
+#define BLOCK2_MORE_BIT 0x08
+#define BLOCK2_MORE(opt) (((opt) & BLOCK2_MORE_BIT) != 0)
+#define BLOCK2_SZX(opt) ((opt) & 0x07)
+#define BLOCK2_OPT(num, szx) (((num) << 4) | (szx))
+
+#define TOKEN_LEN 4
+#define LAST_BLOCK_UNKNOWN UINT32_MAX
+
+enum fota_state {
+    FOTA_STATE_IDLE,
+    FOTA_STATE_DOWNLOADING,
+    FOTA_STATE_FAILED,
+    FOTA_STATE_FINISHED,
+    FOTA_STATE_MULTICAST,
+    FOTA_STATE_REPAIRING,
+    FOTA_STATE_CACHING,
+};
+
+enum slot_state {
+    SLOT_FREE,
+    SLOT_PENDING,
+    SLOT_RECEIVED,
+};
+
+/* Stored in settings and updated every FOTA_SAVE_INTERVAL blocks */
+struct fota_progress {
+    uint32_t img_size;
+    uint32_t offset;
+    bool delta;
+    uint8_t etag_len;
+    uint8_t etag[MAX_FOTA_ETAG_LEN];
+};
+
+/* Image cached for other nodes. Zero size means the cache is empty */
+struct fota_cache {
+    char url[MAX_FOTA_PAYLOAD_LEN];
+    uint32_t img_size;
+    uint8_t etag_len;
+    uint8_t etag[MAX_FOTA_ETAG_LEN];
+};
+
+struct fota_slot {
+    enum slot_state state;
+    uint32_t num;
+    uint16_t msg_id;
+    uint8_t retries;
+    int64_t deadline;
+    bool more;
+    uint16_t len;
+    uint8_t data[FOTA_BLOCK_MAX_LEN];
+};
+
+static coap_fota_cb_t callback;
+
+K_MUTEX_DEFINE(fota_mutex);
+K_SEM_DEFINE(fota_start_sem, 0, 1);
+
+static enum fota_state state;
+static char url[MAX_FOTA_PAYLOAD_LEN];
+static struct fota_progress progress;
+#ifdef CONFIG_COAP_FOTA_CACHE
+static struct fota_cache cache;
+#endif
+
+static struct {
+    int sock;
+    struct sockaddr_in6 addr;
+    const char *path;
+    uint8_t szx;
+    uint32_t nonce;
+    uint32_t next_write;
+    uint32_t next_req;
+    uint32_t last;
+    size_t skip;
+    uint32_t unsaved;
+    bool delta;
+} dl;
+
+static struct fota_slot window[FOTA_WINDOW];
+static uint8_t dfu_buf[512] __aligned(4);
+
+static void notify(int evt_id)
+{
+    if (callback) {
+        struct coap_fota_evt evt = {
+            .evt = evt_id,
+        };
+
+        callback(&evt);
+    }
+}
+
+static void progress_store(void)
+{
+    settings_save_one(SETT_NAME "/" URL_NAME, url, strlen(url));
+    settings_save_one(SETT_NAME "/" PRG_NAME, &progress, sizeof(progress));
+}
+
+static void progress_clear(void)
+{
+    url[0] = '\0';
+    memset(&progress, 0, sizeof(progress));
+
+    settings_delete(SETT_NAME "/" URL_NAME);
+    settings_delete(SETT_NAME "/" PRG_NAME);
+}
+
+/* Caller must hold fota_mutex before the secondary slot is overwritten */
+static void cache_invalidate(void)
+{
+#ifdef CONFIG_COAP_FOTA_CACHE
+    if (cache.img_size) {
+        memset(&cache, 0, sizeof(cache));
+        settings_delete(SETT_NAME "/" CACHE_NAME);
+    }
+#endif
+}
+
+static int fota_set_from_nvm(const char *name, size_t len,
+                             settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+    int rc;
+
+    if (settings_name_steq(name, URL_NAME, &next) && !next) {
+        if (len >= sizeof(url)) {
+            return -EINVAL;
+        }
+
+        rc = read_cb(cb_arg, url, sizeof(url) - 1);
+        if (rc < 0) {
+            url[0] = '\0';
+            return rc;
+        }
+
+        url[rc] = '\0';
+        return 0;
+    }
+
+    if (settings_name_steq(name, PRG_NAME, &next) && !next) {
+        if (len != sizeof(progress)) {
+            return -EINVAL;
+        }
+
+        rc = read_cb(cb_arg, &progress, sizeof(progress));
+        if (rc < 0) {
+            return rc;
+        }
+
+        return 0;
+    }
+
+#ifdef CONFIG_COAP_FOTA_CACHE
+    if (settings_name_steq(name, CACHE_NAME, &next) && !next) {
+        if (len != sizeof(cache)) {
+            return -EINVAL;
+        }
+
+        rc = read_cb(cb_arg, &cache, sizeof(cache));
+        if (rc < 0) {
+            memset(&cache, 0, sizeof(cache));
+            return rc;
+        }
+
+        return 0;
+    }
+#endif
+
+    return -ENOENT;
+}
+
+static struct settings_handler sett_conf = {
+    .name = SETT_NAME,
+    .h_set = fota_set_from_nvm,
+};
+
+// URL handling
+
+static int parse_url(char *url_buf, struct sockaddr_in6 *addr, const char **path)
+{
+    static const char scheme[] = "coap://";
+    char *host;
+    char *host_end;
+    char *port_str = NULL;
+
+    if (strncmp(url_buf, scheme, strlen(scheme)) != 0) {
+        return -EPROTONOSUPPORT;
+    }
+
+    host = url_buf + strlen(scheme);
+    if (*host != '[') {
+        // Only literal IPv6 addresses are supported. There is no DNS in the mesh
+        return -EINVAL;
+    }
+    host++;
+
+    host_end = strchr(host, ']');
+    if (!host_end) {
+        return -EINVAL;
+    }
+    *host_end = '\0';
+
+    if (host_end[1] == ':') {
+        port_str = host_end + 2;
+    }
+
+    *path = strchr(host_end + 1, '/');
+    if (!*path) {
+        return -EINVAL;
+    }
+    (*path)++;
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin6_family = AF_INET6;
+    addr->sin6_port = htons(port_str ? strtoul(port_str, NULL, 10) : COAP_PORT);
+
+    if (inet_pton(AF_INET6, host, &addr->sin6_addr) != 1) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static uint8_t block_szx_for_addr(const struct in6_addr *addr)
+{
+    // Mesh-local and link-local addresses are compressed by IPHC
+    bool compressed = (addr->s6_addr[0] == 0xfd) ||
+                      ((addr->s6_addr[0] == 0xfe) && ((addr->s6_addr[1] & 0xc0) == 0x80));
+    int budget = FRAME_MAX_LEN - FRAME_OVERHEAD - COAP_BLOCK_OVERHEAD;
+
+    if (!compressed) {
+        budget -= INLINE_ADDR_LEN;
+    }
+
+    for (int szx = BLOCK_SZX_MAX; szx > BLOCK_SZX_MIN; --szx) {
+        if ((int)BLOCK_SIZE(szx) <= budget) {
+            return szx;
+        }
+    }
+
+    return BLOCK_SZX_MIN;
+}
+
+// Block transfer
+
+static struct fota_slot *slot_find(uint32_t num)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(window); ++i) {
+        if ((window[i].state != SLOT_FREE) && (window[i].num == num)) {
+            return &window[i];
+        }
+    }
+
+    return NULL;
+}
+
+static struct fota_slot *slot_find_msg_id(uint16_t msg_id)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(window); ++i) {
+        if ((window[i].state == SLOT_PENDING) && (window[i].msg_id == msg_id)) {
+            return &window[i];
+        }
+    }
+
+    return NULL;
+}
+
+static struct fota_slot *slot_alloc(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(window); ++i) {
+        if (window[i].state == SLOT_FREE) {
+            return &window[i];
+        }
+    }
+
+    return NULL;
+}
+
+static int send_block_req(struct fota_slot *slot)
+{
+    struct coap_packet cpkt;
+    uint8_t data[MAX_COAP_MSG_LEN];
+    uint8_t token[TOKEN_LEN];
+    const char *seg = dl.path;
+    int r;
+
+    sys_put_be32(dl.nonce ^ slot->num, token);
+
+    r = coap_packet_init(&cpkt, data, sizeof(data),
+                 1, COAP_TYPE_CON, sizeof(token), token,
+                 COAP_METHOD_GET, slot->msg_id);
+    if (r < 0) {
+        return r;
+    }
+
+    while (*seg) {
+        const char *seg_end = strchr(seg, '/');
+        size_t seg_len = seg_end ? (size_t)(seg_end - seg) : strlen(seg);
+
+        r = coap_packet_append_option(&cpkt, COAP_OPTION_URI_PATH, seg, seg_len);
+        if (r < 0) {
+            return r;
+        }
+
+        seg += seg_len;
+        if (*seg == '/') {
+            seg++;
+        }
+    }
+
+    r = coap_append_option_int(&cpkt, COAP_OPTION_BLOCK2, BLOCK2_OPT(slot->num, dl.szx));
+    if (r < 0) {
+        return r;
+    }
+
+    if (slot->num == 0) {
+        // Ask server for the total size of the image
+        r = coap_append_option_int(&cpkt, COAP_OPTION_SIZE2, 0);
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    r = sendto(dl.sock, cpkt.data, cpkt.offset, 0, (struct sockaddr *)&dl.addr, sizeof(dl.addr));
+    if (r < 0) {
+        return -errno;
+    }
+
+    slot->deadline = k_uptime_get() + (FOTA_ACK_TIMEOUT_MS << slot->retries);
+    return 0;
+}
+
+static int request_block(uint32_t num)
+{
+    struct fota_slot *slot = slot_alloc();
+
+    if (!slot) {
+        return -ENOBUFS;
+    }
+
+    slot->state = SLOT_PENDING;
+    slot->num = num;
+    slot->msg_id = coap_next_id();
+    slot->retries = 0;
+    slot->len = 0;
+
+    return send_block_req(slot);
+}
+
+static int fill_window(void)
+{
+    int r;
+
+    while ((dl.next_req < dl.next_write + FOTA_WINDOW) &&
+           ((dl.last == LAST_BLOCK_UNKNOWN) || (dl.next_req <= dl.last))) {
+        r = request_block(dl.next_req);
+        if (r < 0) {
+            return r;
+        }
+
+        dl.next_req++;
+    }
+
+    return 0;
+}
+
+static int retransmit_expired(int64_t *next_deadline)
+{
+    int64_t now = k_uptime_get();
+    int r;
+
+    *next_deadline = INT64_MAX;
+
+    for (size_t i = 0; i < ARRAY_SIZE(window); ++i) {
+        struct fota_slot *slot = &window[i];
+
+        if (slot->state != SLOT_PENDING) {
+            continue;
+        }
+
+        if (slot->deadline <= now) {
+            if (slot->retries >= FOTA_MAX_RETRANSMIT) {
+                return -ETIMEDOUT;
+            }
+
+            slot->retries++;
+            r = send_block_req(slot);
+            if (r < 0) {
+                return r;
+            }
+        }
+
+        if (slot->deadline < *next_deadline) {
+            *next_deadline = slot->deadline;
+        }
+    }
+
+    return 0;
+}
+
+static int process_block_rsp(const uint8_t *data, size_t data_len)
+{
+    struct coap_packet rsp;
+    struct coap_option etag;
+    struct fota_slot *slot;
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    const uint8_t *payload;
+    uint16_t payload_len;
+    uint32_t num;
+    int block2;
+    int size2;
+    int r;
+
+    r = coap_packet_parse(&rsp, (uint8_t *)data, data_len, NULL, 0);
+    if (r < 0) {
+        return 0;
+    }
+
+    if (coap_header_get_code(&rsp) == COAP_CODE_EMPTY) {
+        // Empty ACK has no token. Separate response will follow
+        if (coap_header_get_type(&rsp) == COAP_TYPE_ACK) {
+            slot = slot_find_msg_id(coap_header_get_id(&rsp));
+            if (slot) {
+                slot->deadline = k_uptime_get() + (FOTA_ACK_TIMEOUT_MS << FOTA_MAX_RETRANSMIT);
+            }
+        }
+
+        return 0;
+    }
+
+    if (coap_header_get_type(&rsp) == COAP_TYPE_CON) {
+        // Separate response. Duplicates are acknowledged too, or the server keeps sending them
+        coap_server_send_ack(dl.sock, (struct sockaddr *)&dl.addr, sizeof(dl.addr),
+                     coap_header_get_id(&rsp), COAP_CODE_EMPTY, NULL, 0);
+    }
+
+    if (coap_header_get_token(&rsp, token) != TOKEN_LEN) {
+        return 0;
+    }
+
+    num = sys_get_be32(token) ^ dl.nonce;
+    slot = slot_find(num);
+    if (!slot || (slot->state != SLOT_PENDING)) {
+        // Duplicate or stale response
+        return 0;
+    }
+
+    if (coap_header_get_code(&rsp) != COAP_RESPONSE_CODE_CONTENT) {
+        return -EBADMSG;
+    }
+
+    block2 = coap_get_option_int(&rsp, COAP_OPTION_BLOCK2);
+    if ((block2 < 0) || (BLOCK2_NUM(block2) != num) || (BLOCK2_SZX(block2) != dl.szx)) {
+        return -EBADMSG;
+    }
+
+    payload = coap_packet_get_payload(&rsp, &payload_len);
+    if (!payload || (payload_len > BLOCK_SIZE(dl.szx)) ||
+        (BLOCK2_MORE(block2) && (payload_len != BLOCK_SIZE(dl.szx)))) {
+        return -EBADMSG;
+    }
+
+    r = coap_find_options(&rsp, COAP_OPTION_ETAG, &etag, 1);
+    if ((r == 1) && (etag.len <= MAX_FOTA_ETAG_LEN)) {
+        k_mutex_lock(&fota_mutex, K_FOREVER);
+        if (!progress.etag_len) {
+            progress.etag_len = etag.len;
+            memcpy(progress.etag, etag.value, etag.len);
+        } else if ((progress.etag_len != etag.len) ||
+               memcmp(progress.etag, etag.value, etag.len)) {
+            // Image changed on the server. Downloaded blocks are useless
+            k_mutex_unlock(&fota_mutex);
+            return -ESTALE;
+        }
+        k_mutex_unlock(&fota_mutex);
+    }
+
+    size2 = coap_get_option_int(&rsp, COAP_OPTION_SIZE2);
+    if (size2 > 0) {
+        k_mutex_lock(&fota_mutex, K_FOREVER);
+        progress.img_size = size2;
+        k_mutex_unlock(&fota_mutex);
+    }
+
+    if (!BLOCK2_MORE(block2)) {
+        dl.last = num;
+    }
+
+    slot->state = SLOT_RECEIVED;
+    slot->more = BLOCK2_MORE(block2);
+    slot->len = payload_len;
+    memcpy(slot->data, payload, payload_len);
+
+    return 0;
+}
+
+static void dfu_target_cb(enum dfu_target_evt_id evt_id)
+{
+    (void)evt_id;
+}
+
+static int dfu_start(bool fresh, size_t img_size)
+{
+    int r;
+
+    r = dfu_target_mcuboot_set_buf(dfu_buf, sizeof(dfu_buf));
+    if (r < 0) {
+        return r;
+    }
+
+    r = dfu_target_init(DFU_TARGET_IMAGE_TYPE_MCUBOOT, 0, img_size, dfu_target_cb);
+    if (r < 0) {
+        return r;
+    }
+
+    if (fresh) {
+        // Drop any progress left by an abandoned download
+        r = dfu_target_reset();
+        if (r < 0) {
+            return r;
+        }
+
+        r = dfu_target_init(DFU_TARGET_IMAGE_TYPE_MCUBOOT, 0, img_size, dfu_target_cb);
+    }
+
+    return r;
+}
+
+/* Start writing the downloaded image
+ *
+ * The image is either a full MCUboot image or a delta against the running image. Delta is patched
+ * while it is streamed and the new image is written to the secondary slot.
+ *
+ * @returns Number of bytes of @p first_block consumed as the delta header or negative error code.
+ */
+static int image_start(const uint8_t *first_block, size_t first_block_len)
+{
+    uint32_t img_size;
+    int consumed;
+    int r;
+
+    dl.delta = fota_delta_is_delta(first_block, first_block_len);
+
+    if (!dl.delta) {
+        if (dfu_target_img_type(first_block, first_block_len) != DFU_TARGET_IMAGE_TYPE_MCUBOOT) {
+            return -EBADMSG;
+        }
+
+        return dfu_start(true, progress.img_size);
+    }
+
+    consumed = fota_delta_start(first_block, first_block_len, dfu_target_write, &img_size);
+    if (consumed < 0) {
+        return consumed;
+    }
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    progress.delta = true;
+    k_mutex_unlock(&fota_mutex);
+
+    r = dfu_start(true, img_size);
+
+    return (r < 0) ? r : consumed;
+}
+
+static int image_write(const uint8_t *data, size_t len)
+{
+    return dl.delta ? fota_delta_write(data, len) : dfu_target_write(data, len);
+}
+
+static int write_received_blocks(void)
+{
+    struct fota_slot *slot = slot_find(dl.next_write);
+    size_t data_start;
+    int r;
+
+    while (slot && (slot->state == SLOT_RECEIVED)) {
+        data_start = dl.skip;
+
+        if ((dl.next_write == 0) && (dl.skip == 0)) {
+            r = image_start(slot->data, slot->len);
+            if (r < 0) {
+                return r;
+            }
+
+            data_start = r;
+        }
+
+        if (slot->len > data_start) {
+            r = image_write(slot->data + data_start, slot->len - data_start);
+            if (r < 0) {
+                return r;
+            }
+        }
+
+        k_mutex_lock(&fota_mutex, K_FOREVER);
+        progress.offset += slot->len - dl.skip;
+        k_mutex_unlock(&fota_mutex);
+
+        dl.skip = 0;
+        slot->state = SLOT_FREE;
+
+        if (!slot->more) {
+            if (dl.delta) {
+                r = fota_delta_finish();
+                if (r < 0) {
+                    return r;
+                }
+            }
+
+            return 1;
+        }
+
+        // Progress is stored as soon as the first block is written, so that a download
+        // interrupted by a reset is resumed with the size and ETag of the image
+        if ((++dl.unsaved >= FOTA_SAVE_INTERVAL) || (dl.next_write == 0)) {
+            dl.unsaved = 0;
+            k_mutex_lock(&fota_mutex, K_FOREVER);
+            progress_store();
+            k_mutex_unlock(&fota_mutex);
+        }
+
+        dl.next_write++;
+        slot = slot_find(dl.next_write);
+    }
+
+    return 0;
+}
+
+/* Run Block2 transfer until @p drain reports completion
+ *
+ * @p fill requests blocks while there are free slots in the window.
+ * @p drain consumes received blocks and returns positive value when transfer is finished.
+ */
+static int block_transfer(int (*fill)(void), int (*drain)(void))
+{
+    struct pollfd fds;
+    uint8_t rsp[MAX_COAP_MSG_LEN];
+    int64_t next_deadline;
+    int r;
+
+    dl.sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    if (dl.sock < 0) {
+        return -errno;
+    }
+
+    fds.fd = dl.sock;
+    fds.events = POLLIN;
+
+    r = fill();
+
+    while (r == 0) {
+        r = retransmit_expired(&next_deadline);
+        if (r < 0) {
+            break;
+        }
+
+        int timeout = (int)CLAMP(next_deadline - k_uptime_get(), 0,
+                (FOTA_ACK_TIMEOUT_MS << FOTA_MAX_RETRANSMIT));
+
+        r = poll(&fds, 1, timeout);
+        if (r < 0) {
+            r = -errno;
+            break;
+        }
+
+        if (r == 0) {
+            // Timeout. Retransmissions handled in the next iteration
+            continue;
+        }
+
+        r = recvfrom(dl.sock, rsp, sizeof(rsp), 0, NULL, NULL);
+        if (r < 0) {
+            r = -errno;
+            break;
+        }
+
+        r = process_block_rsp(rsp, r);
+        if (r < 0) {
+            break;
+        }
+
+        r = drain();
+        if (r != 0) {
+            break;
+        }
+
+        r = fill();
+    }
+
+    close(dl.sock);
+
+    return (r > 0) ? 0 : r;
+}
+
+static int transfer_prepare(int szx)
+{
+    static char url_buf[MAX_FOTA_PAYLOAD_LEN];
+    int r;
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    strncpy(url_buf, url, sizeof(url_buf));
+    k_mutex_unlock(&fota_mutex);
+
+    r = parse_url(url_buf, &dl.addr, &dl.path);
+    if (r < 0) {
+        return r;
+    }
+
+    memset(window, 0, sizeof(window));
+    dl.szx = (szx >= 0) ? szx : block_szx_for_addr(&dl.addr.sin6_addr);
+    dl.nonce = sys_rand32_get();
+    dl.last = LAST_BLOCK_UNKNOWN;
+    dl.unsaved = 0;
+    dl.skip = 0;
+    dl.next_write = 0;
+    dl.next_req = 0;
+    dl.delta = false;
+
+    return 0;
+}
+
+static int download(void)
+{
+    int r;
+
+    r = transfer_prepare(-1);
+    if (r < 0) {
+        return r;
+    }
+
+    if (progress.delta) {
+        /* Patcher state is not stored and flash offset of the new image does not map to delta
+         * offset. Delta is small, so start over.
+         */
+        k_mutex_lock(&fota_mutex, K_FOREVER);
+        memset(&progress, 0, sizeof(progress));
+        k_mutex_unlock(&fota_mutex);
+    }
+
+    if (progress.offset) {
+        size_t offset;
+
+        // Flash contents are authoritative. Stored offset might be behind them
+        r = dfu_start(false, progress.img_size);
+        if (r == 0) {
+            r = dfu_target_offset_get(&offset);
+        }
+
+        if ((r < 0) || (offset == 0)) {
+            k_mutex_lock(&fota_mutex, K_FOREVER);
+            memset(&progress, 0, sizeof(progress));
+            k_mutex_unlock(&fota_mutex);
+        } else {
+            k_mutex_lock(&fota_mutex, K_FOREVER);
+            progress.offset = offset;
+            k_mutex_unlock(&fota_mutex);
+
+            dl.next_write = offset / BLOCK_SIZE(dl.szx);
+            dl.skip = offset % BLOCK_SIZE(dl.szx);
+        }
+    }
+
+    dl.next_req = dl.next_write;
+
+    return block_transfer(fill_window, write_received_blocks);
+}
+
+// Multicast distribution
+
+/* The distributor announces the image with POST /fota_mc to every receiver. Then it pushes the
+ * image once to the group address as NON POST /fota_mc requests carrying the Block1 option.
+ * Receivers write pushed blocks directly to the secondary slot and track them in a bitmap. When
+ * the push ends, blocks which were lost are fetched from the repair URL with unicast Block2
+ * requests. The image is validated by MCUboot like any other update. Delta images are not
+ * supported in this mode, because the patcher needs blocks in order.
+ *
+ * Sequential unicast updates of N nodes take about 2 * N * S/B frames for an image of S bytes
+ * sent in B byte blocks (request and response per block). The multicast push takes S/B frames
+ * per forwarding router, and repairs take 2 * N * p * S/B frames for block loss rate p.
+ * scripts/fota_mc_sim.py estimates both for a mesh, scripts/coap_fota_mc.py is the distributor.
+ */
+
+#define MC_GROUP_KEY "g"
+#define MC_URL_KEY "u"
+#define MC_SIZE_KEY "s"
+#define MC_SZX_KEY "z"
+#define MC_VERSION_KEY "v"
+#define MC_ETAG_KEY "e"
+
+#define MC_VERSION_MAX_LEN 16
+#define MC_SZX_MIN 1 // Limits size of the bitmap
+#define MC_MAX_BLOCKS (PM_MCUBOOT_SECONDARY_SIZE / BLOCK_SIZE(MC_SZX_MIN))
+#define MC_PAGE_SIZE 4096
+#define MC_MAX_PAGES (PM_MCUBOOT_SECONDARY_SIZE / MC_PAGE_SIZE)
+#define MC_WRITE_ALIGN 4
+
+#define MC_IDLE_TIMEOUT K_SECONDS(30)
+#define MC_LAST_BLOCK_TIMEOUT K_SECONDS(2)
+
+static struct {
+    struct in6_addr group;
+    const struct flash_area *fa;
+    uint32_t num_blocks;
+    uint32_t received;
+    uint8_t szx;
+} mc;
+
+static ATOMIC_DEFINE(mc_blocks, MC_MAX_BLOCKS);
+static ATOMIC_DEFINE(mc_pages, MC_MAX_PAGES);
+
+static void mc_timeout_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(mc_timeout_work, mc_timeout_handler);
+
+/* Caller must hold fota_mutex */
+static int mc_write_block(uint32_t num, const uint8_t *data, size_t len)
+{
+    uint8_t buf[FOTA_BLOCK_MAX_LEN];
+    off_t offset = (off_t)num * BLOCK_SIZE(mc.szx);
+    size_t page = offset / MC_PAGE_SIZE;
+    size_t aligned_len = ROUND_UP(len, MC_WRITE_ALIGN);
+    int r;
+
+    // Blocks never cross pages, because page size is a multiple of block size
+    if (!atomic_test_and_set_bit(mc_pages, page)) {
+        r = flash_area_erase(mc.fa, page * MC_PAGE_SIZE, MC_PAGE_SIZE);
+        if (r < 0) {
+            atomic_clear_bit(mc_pages, page);
+            return r;
+        }
+    }
+
+    memcpy(buf, data, len);
+    memset(buf + len, 0xff, aligned_len - len);
+
+    r = flash_area_write(mc.fa, offset, buf, aligned_len);
+    if (r < 0) {
+        return r;
+    }
+
+    if (!atomic_test_and_set_bit(mc_blocks, num)) {
+        mc.received++;
+        progress.offset += len;
+    }
+
+    return 0;
+}
+
+/* Prepare the secondary slot for blocks written in any order by @ref mc_write_block
+ *
+ * Caller must hold fota_mutex.
+ */
+static int raw_slot_open(uint8_t szx)
+{
+    int r;
+
+    r = flash_area_open(PM_MCUBOOT_SECONDARY_ID, &mc.fa);
+    if (r < 0) {
+        return r;
+    }
+
+    mc.szx = szx;
+    mc.received = 0;
+    memset(mc_blocks, 0, sizeof(mc_blocks));
+    memset(mc_pages, 0, sizeof(mc_pages));
+
+    // Stale image trailer would confuse MCUboot
+    r = flash_area_erase(mc.fa, mc.fa->fa_size - MC_PAGE_SIZE, MC_PAGE_SIZE);
+    if (r < 0) {
+        flash_area_close(mc.fa);
+        return r;
+    }
+    atomic_set_bit(mc_pages, (mc.fa->fa_size - MC_PAGE_SIZE) / MC_PAGE_SIZE);
+
+    return 0;
+}
+
+/* Caller must hold fota_mutex */
+static int mc_start(const struct in6_addr *group, const char *new_url, uint32_t img_size,
+        uint8_t szx, const struct zcbor_string *etag)
+{
+    struct net_if *iface = net_if_get_default();
+    struct net_if_mcast_addr *maddr;
+    int r;
+
+    r = raw_slot_open(szx);
+    if (r < 0) {
+        return r;
+    }
+
+    // Unicast progress and cached image refer to the slot contents overwritten now
+    progress_clear();
+    cache_invalidate();
+    strncpy(url, new_url, sizeof(url));
+    progress.img_size = img_size;
+    progress.etag_len = etag->len;
+    memcpy(progress.etag, etag->value, etag->len);
+
+    memcpy(&mc.group, group, sizeof(mc.group));
+    mc.num_blocks = DIV_ROUND_UP(img_size, BLOCK_SIZE(szx));
+
+    maddr = net_if_ipv6_maddr_add(iface, &mc.group);
+    if (maddr) {
+        net_if_ipv6_maddr_join(iface, maddr);
+    }
+
+    state = FOTA_STATE_MULTICAST;
+    ot_sed_to_med();
+    notify(COAP_FOTA_EVT_STARTED);
+
+    k_work_reschedule(&mc_timeout_work, MC_IDLE_TIMEOUT);
+
+    return 0;
+}
+
+static void mc_leave(void)
+{
+    net_if_ipv6_maddr_rm(net_if_get_default(), &mc.group);
+    flash_area_close(mc.fa);
+}
+
+static void mc_timeout_handler(struct k_work *work)
+{
+    (void)work;
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    if (state == FOTA_STATE_MULTICAST) {
+        // Push is over. Fetch what is missing
+        state = FOTA_STATE_REPAIRING;
+        k_sem_give(&fota_start_sem);
+    }
+    k_mutex_unlock(&fota_mutex);
+}
+
+static int mc_block_received(struct coap_packet *request, int block1)
+{
+    uint32_t num = BLOCK2_NUM(block1);
+    bool more = BLOCK2_MORE(block1);
+    const uint8_t *payload;
+    uint16_t payload_len;
+    int r = 0;
+
+    payload = coap_packet_get_payload(request, &payload_len);
+    if (!payload) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+
+    if ((state != FOTA_STATE_MULTICAST) || (BLOCK2_SZX(block1) != mc.szx) ||
+        (num >= mc.num_blocks) || (payload_len > BLOCK_SIZE(mc.szx)) ||
+        (more && (payload_len != BLOCK_SIZE(mc.szx)))) {
+        r = -EINVAL;
+        goto exit;
+    }
+
+    if (!atomic_test_bit(mc_blocks, num)) {
+        r = mc_write_block(num, payload, payload_len);
+    }
+
+    k_work_reschedule(&mc_timeout_work, more ? MC_IDLE_TIMEOUT : MC_LAST_BLOCK_TIMEOUT);
+
+exit:
+    k_mutex_unlock(&fota_mutex);
+    return r;
+}
+
+enum {
+    MC_VERSION,
+    MC_GROUP,
+    MC_URL,
+    MC_SIZE,
+    MC_SZX,
+    MC_ETAG,
+};
+
+static int handle_mc_announce(zcbor_state_t *cd, enum coap_response_code *rsp_code, void *context)
+{
+    (void)context;
+
+    struct zcbor_string group;
+    struct zcbor_string etag = { 0 };
+    char new_url[MAX_FOTA_PAYLOAD_LEN];
+    char url_check[MAX_FOTA_PAYLOAD_LEN];
+    char version[MC_VERSION_MAX_LEN];
+    struct sockaddr_in6 img_addr;
+    const char *img_path;
+    int img_size;
+    int szx;
+    uint32_t present;
+    int r;
+    const struct cbor_map_field fields[] = {
+        [MC_VERSION] = CBOR_MAP_FIELD_TSTR(MC_VERSION_KEY, version),
+        [MC_GROUP]   = CBOR_MAP_FIELD_BSTR_REF(MC_GROUP_KEY, &group),
+        [MC_URL]     = CBOR_MAP_FIELD_TSTR(MC_URL_KEY, new_url),
+        [MC_SIZE]    = CBOR_MAP_FIELD_INT(MC_SIZE_KEY, &img_size),
+        [MC_SZX]     = CBOR_MAP_FIELD_INT(MC_SZX_KEY, &szx),
+        [MC_ETAG]    = CBOR_MAP_FIELD_BSTR_REF(MC_ETAG_KEY, &etag),
+    };
+
+    *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+
+    r = cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present);
+    if (r) return r;
+
+    if (CBOR_MAP_PRESENT(present, MC_VERSION) &&
+            (strcmp(version, CONFIG_MCUBOOT_IMGTOOL_SIGN_VERSION) == 0)) {
+        // Already running announced image
+        *rsp_code = COAP_RESPONSE_CODE_VALID;
+        return 0;
+    }
+
+    if (!CBOR_MAP_PRESENT(present, MC_GROUP)) return -EINVAL;
+    if (group.len != sizeof(struct in6_addr)) return -EINVAL;
+    if (!net_ipv6_is_addr_mcast((const struct in6_addr *)group.value)) return -EINVAL;
+
+    if (!CBOR_MAP_PRESENT(present, MC_URL)) return -EINVAL;
+    memcpy(url_check, new_url, sizeof(url_check));
+    if (parse_url(url_check, &img_addr, &img_path) < 0) return -EINVAL;
+
+    if (!CBOR_MAP_PRESENT(present, MC_SIZE)) return -EINVAL;
+    if ((img_size <= 0) || (img_size > PM_MCUBOOT_SECONDARY_SIZE - MC_PAGE_SIZE)) return -EINVAL;
+
+    if (!CBOR_MAP_PRESENT(present, MC_SZX)) return -EINVAL;
+    if ((szx < MC_SZX_MIN) || (szx > BLOCK_SZX_MAX)) return -EINVAL;
+
+    if (etag.len > MAX_FOTA_ETAG_LEN) return -EINVAL;
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    if (state == FOTA_STATE_MULTICAST) {
+        // Repeated announcement
+        r = memcmp(&mc.group, group.value, sizeof(mc.group)) ? -EBUSY : 0;
+    } else if ((state == FOTA_STATE_DOWNLOADING) || (state == FOTA_STATE_REPAIRING)) {
+        r = -EBUSY;
+    } else {
+        r = mc_start((const struct in6_addr *)group.value, new_url, img_size, szx, &etag);
+    }
+    k_mutex_unlock(&fota_mutex);
+
+    if (r == -EBUSY) {
+        *rsp_code = COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE;
+    } else if (r < 0) {
+        *rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
+    } else {
+        *rsp_code = COAP_RESPONSE_CODE_CHANGED;
+    }
+
+    return r;
+}
+
+static int fill_repair_window(void)
+{
+    int r;
+
+    while (dl.next_req < mc.num_blocks) {
+        if (atomic_test_bit(mc_blocks, dl.next_req)) {
+            dl.next_req++;
+            continue;
+        }
+
+        if (!slot_alloc()) {
+            // Window is full
+            break;
+        }
+
+        r = request_block(dl.next_req);
+        if (r < 0) {
+            return r;
+        }
+
+        dl.next_req++;
+    }
+
+    return 0;
+}
+
+static int write_repaired_blocks(void)
+{
+    bool pending = false;
+    int r;
+
+    for (size_t i = 0; i < ARRAY_SIZE(window); ++i) {
+        struct fota_slot *slot = &window[i];
+
+        if (slot->state == SLOT_PENDING) {
+            pending = true;
+        }
+
+        if (slot->state != SLOT_RECEIVED) {
+            continue;
+        }
 
-static coap_fota_cb_t callback;
+        k_mutex_lock(&fota_mutex, K_FOREVER);
+        r = mc_write_block(slot->num, slot->data, slot->len);
+        k_mutex_unlock(&fota_mutex);
+
+        slot->state = SLOT_FREE;
+
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    return (!pending && (dl.next_req >= mc.num_blocks)) ? 1 : 0;
+}
+
+static int mc_repair(void)
+{
+    int r;
+
+    if (mc.received == mc.num_blocks) {
+        return 0;
+    }
 
-void coap_fota_callback(const struct fota_download_evt *evt)
+    r = transfer_prepare(mc.szx);
+    if (r < 0) {
+        return r;
+    }
+
+    return block_transfer(fill_repair_window, write_repaired_blocks);
+}
+
+static int mc_finish(void)
+{
+    struct mcuboot_img_header header;
+
+    if (mc.received != mc.num_blocks) {
+        return -EIO;
+    }
+
+    if (boot_read_bank_header(PM_MCUBOOT_SECONDARY_ID, &header, sizeof(header))) {
+        return -EBADMSG;
+    }
+
+    // Signature is validated by MCUboot before the image is swapped
+    return boot_request_upgrade(BOOT_UPGRADE_TEST);
+}
+
+static void run_repair(void)
 {
-    if (evt->id == FOTA_DOWNLOAD_EVT_FINISHED) {
+    int r;
+
+    r = mc_repair();
+    if (r == 0) {
+        r = mc_finish();
+    }
+
+    mc_leave();
+    ot_sed_from_med();
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    state = (r == 0) ? FOTA_STATE_FINISHED : FOTA_STATE_FAILED;
+    progress_clear();
+    k_mutex_unlock(&fota_mutex);
+
+    notify(COAP_FOTA_EVT_FINISHED);
+
+    if (r == 0) {
         sys_reboot(SYS_REBOOT_COLD);
     }
+}
+
+#ifdef CONFIG_COAP_FOTA_CACHE
+
+// Firmware cache
+
+/* A mains-powered node downloads an image once with POST /fota_cache and serves it with Block2
+ * from GET /fota_cache to other nodes, which are then requested to update from
+ * coap://[<cache address>]/fota_cache. The image is kept in the secondary slot, because there is
+ * no spare flash for a dedicated partition. It is stored without the image trailer, so MCUboot
+ * never takes it as an update of this node. An update of this node drops the cached image.
+ */
+
+#define CACHE_MAX_IMG_SIZE (PM_MCUBOOT_SECONDARY_SIZE - MC_PAGE_SIZE)
+#define CACHE_ETAG_LEN 4
+
+static int cache_write_blocks(void)
+{
+    struct fota_slot *slot = slot_find(dl.next_write);
+    int r;
+
+    while (slot && (slot->state == SLOT_RECEIVED)) {
+        k_mutex_lock(&fota_mutex, K_FOREVER);
+        if ((progress.img_size > CACHE_MAX_IMG_SIZE) ||
+            ((slot->num + 1) * BLOCK_SIZE(mc.szx) > CACHE_MAX_IMG_SIZE)) {
+            r = -EFBIG;
+        } else {
+            r = mc_write_block(slot->num, slot->data, slot->len);
+        }
+        k_mutex_unlock(&fota_mutex);
+
+        slot->state = SLOT_FREE;
+
+        if (r < 0) {
+            return r;
+        }
+
+        if (!slot->more) {
+            return 1;
+        }
+
+        dl.next_write++;
+        slot = slot_find(dl.next_write);
+    }
+
+    return 0;
+}
+
+static int cache_fill(void)
+{
+    struct mcuboot_img_header header;
+    int r;
+
+    r = transfer_prepare(-1);
+    if (r < 0) {
+        return r;
+    }
+
+    dl.szx = MAX(dl.szx, MC_SZX_MIN);
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    r = raw_slot_open(dl.szx);
+    k_mutex_unlock(&fota_mutex);
+    if (r < 0) {
+        return r;
+    }
+
+    r = block_transfer(fill_window, cache_write_blocks);
+
+    if ((r == 0) && boot_read_bank_header(PM_MCUBOOT_SECONDARY_ID, &header, sizeof(header))) {
+        r = -EBADMSG;
+    }
+
+    flash_area_close(mc.fa);
+
+    return r;
+}
+
+static void run_cache_fill(void)
+{
+    int r;
+
+    ot_sed_to_med();
+    r = cache_fill();
+    ot_sed_from_med();
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    if (r == 0) {
+        strncpy(cache.url, url, sizeof(cache.url));
+        // Blocks were written in order, so the offset is the image size
+        cache.img_size = progress.offset;
+
+        if (progress.etag_len) {
+            cache.etag_len = progress.etag_len;
+            memcpy(cache.etag, progress.etag, progress.etag_len);
+        } else {
+            cache.etag_len = CACHE_ETAG_LEN;
+            sys_put_be32(sys_rand32_get(), cache.etag);
+        }
+
+        settings_save_one(SETT_NAME "/" CACHE_NAME, &cache, sizeof(cache));
+    }
+
+    state = (r == 0) ? FOTA_STATE_IDLE : FOTA_STATE_FAILED;
+    progress_clear();
+    k_mutex_unlock(&fota_mutex);
+}
+
+#endif // CONFIG_COAP_FOTA_CACHE
+
+static void fota_thread_process(void *a1, void *a2, void *a3)
+{
+    (void)a1;
+    (void)a2;
+    (void)a3;
+
+    int resumes = 0;
+    enum fota_state job;
+    int r;
+
+    while (1) {
+        k_sem_take(&fota_start_sem, K_FOREVER);
+
+        k_mutex_lock(&fota_mutex, K_FOREVER);
+        job = state;
+        if ((job != FOTA_STATE_REPAIRING) && (job != FOTA_STATE_CACHING)) {
+            state = FOTA_STATE_DOWNLOADING;
+        }
+        k_mutex_unlock(&fota_mutex);
+
+        if (job == FOTA_STATE_REPAIRING) {
+            run_repair();
+            continue;
+        }
+
+#ifdef CONFIG_COAP_FOTA_CACHE
+        if (job == FOTA_STATE_CACHING) {
+            run_cache_fill();
+            continue;
+        }
+#endif
+
+        notify(COAP_FOTA_EVT_STARTED);
+        ot_sed_to_med();
+
+        r = download();
 
-    if (evt->id == FOTA_DOWNLOAD_EVT_FINISHED ||
-        evt->id == FOTA_DOWNLOAD_EVT_ERROR ||
-        evt->id == FOTA_DOWNLOAD_EVT_CANCELLED) {
         ot_sed_from_med();
 
-	if (callback) {
-            struct coap_fota_evt evt = {
-		    .evt = COAP_FOTA_EVT_FINISHED,
-	    };
+        if (r == 0) {
+            r = dfu_target_done(true);
+        }
+
+        if (r == 0) {
+            r = dfu_target_schedule_update(0);
+        }
+
+        k_mutex_lock(&fota_mutex, K_FOREVER);
+        if (r == 0) {
+            state = FOTA_STATE_FINISHED;
+            progress_clear();
+        } else if ((r == -ETIMEDOUT) && (resumes < FOTA_MAX_RESUMES)) {
+            // Probably lost connectivity. Keep progress and try again later
+            state = FOTA_STATE_FAILED;
+            progress_store();
+        } else {
+            state = FOTA_STATE_FAILED;
+            progress_clear();
+            dfu_target_reset();
+        }
+        k_mutex_unlock(&fota_mutex);
+
+        notify(COAP_FOTA_EVT_FINISHED);
 
-            callback(&evt);
-	}
+        if (r == 0) {
+            sys_reboot(SYS_REBOOT_COLD);
+        } else if ((r == -ETIMEDOUT) && (resumes < FOTA_MAX_RESUMES)) {
+            resumes++;
+            k_sleep(FOTA_RESUME_DELAY);
+            k_sem_give(&fota_start_sem);
+        } else {
+            resumes = 0;
+        }
     }
 }
 
+K_THREAD_DEFINE(fota_thread_id, FOTA_THREAD_STACK_SIZE,
+        fota_thread_process, NULL, NULL, NULL,
+        FOTA_THREAD_PRIO, 0, 0);
+
+// CoAP resource
+
+static int prepare_fota_status_payload(uint8_t *payload, size_t len)
+{
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    enum fota_state curr_state = state;
+    uint32_t offset = progress.offset;
+    uint32_t img_size = progress.img_size;
+    k_mutex_unlock(&fota_mutex);
+
+    if (!zcbor_map_start_encode(ce, 4)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, VERSION_KEY)) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, CONFIG_MCUBOOT_IMGTOOL_SIGN_VERSION)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, STATE_KEY)) return -EINVAL;
+    if (!zcbor_int32_put(ce, curr_state)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, OFFSET_KEY)) return -EINVAL;
+    if (!zcbor_uint32_put(ce, offset)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, SIZE_KEY)) return -EINVAL;
+    if (!zcbor_uint32_put(ce, img_size)) return -EINVAL;
+
+    if (!zcbor_map_end_encode(ce, 4)) return -EINVAL;
+
+    return (size_t)(ce->payload - payload);
+}
+
 int coap_fota_get(struct coap_resource *resource,
              struct coap_packet *request,
              struct sockaddr *addr, socklen_t addr_len)
@@ -73,6 +1503,18 @@ int coap_fota_get(struct coap_resource *resource,
     }
 #endif
 
+    if (coap_get_option_int(request, COAP_OPTION_ACCEPT) == COAP_CONTENT_FORMAT_APP_CBOR) {
+        uint8_t status[MAX_COAP_PAYLOAD_LEN];
+
+        r = prepare_fota_status_payload(status, sizeof(status));
+        if (r < 0) {
+            return r;
+        }
+
+        return coap_server_handle_simple_getter(sock, resource, request,
+                        addr, addr_len, status, r);
+    }
+
     data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
     if (!data) {
         return -ENOMEM;
@@ -109,6 +1551,39 @@ end:
     return r;
 }
 
+/* Extract and validate image URL from the request payload
+ *
+ * @returns 0 on success, response code to send otherwise.
+ */
+static enum coap_response_code url_from_request(struct coap_packet *request, char *new_url)
+{
+    const uint8_t *payload;
+    uint16_t payload_len;
+    char url_check[MAX_FOTA_PAYLOAD_LEN];
+    struct sockaddr_in6 img_addr;
+    const char *img_path;
+
+    payload = coap_packet_get_payload(request, &payload_len);
+    if (!payload) {
+        return COAP_RESPONSE_CODE_BAD_REQUEST;
+    }
+
+    if (payload_len >= MAX_FOTA_PAYLOAD_LEN) {
+        return COAP_RESPONSE_CODE_REQUEST_TOO_LARGE;
+    }
+
+    memcpy(new_url, payload, payload_len);
+    new_url[payload_len] = '\0';
+
+    // Validate URL before it is accepted. Parsing modifies the buffer
+    memcpy(url_check, new_url, sizeof(url_check));
+    if (parse_url(url_check, &img_addr, &img_path) < 0) {
+        return COAP_RESPONSE_CODE_BAD_REQUEST;
+    }
+
+    return 0;
+}
+
 int coap_fota_post(struct coap_resource *resource,
              struct coap_packet *request,
              struct sockaddr *addr, socklen_t addr_len)
@@ -119,11 +1594,8 @@ int coap_fota_post(struct coap_resource *resource,
     uint8_t type;
     uint8_t tkl;
     uint8_t token[COAP_TOKEN_MAX_LEN];
-    const uint8_t *payload;
-    uint16_t payload_len;
-    static char url[MAX_FOTA_PAYLOAD_LEN];
-    char *path = NULL;
-    static char fota_path[MAX_FOTA_PATH_LEN];
+    char new_url[MAX_FOTA_PAYLOAD_LEN];
+    enum coap_response_code rsp_code = COAP_RESPONSE_CODE_CHANGED;
 
     code = coap_header_get_code(request);
     type = coap_header_get_type(request);
@@ -143,54 +1615,227 @@ int coap_fota_post(struct coap_resource *resource,
     // allow FOTA request through unecrtypted CoAP connection regardless
     // destination address.
 
-    payload = coap_packet_get_payload(request, &payload_len);
-    if (!payload) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
+    rsp_code = url_from_request(request, new_url);
+    if (rsp_code) {
+        coap_server_send_ack(sock, addr, addr_len, id, rsp_code, token, tkl);
         return -EINVAL;
     }
 
-    if (payload_len >= sizeof(url)) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_REQUEST_TOO_LARGE, token, tkl);
+    rsp_code = COAP_RESPONSE_CODE_CHANGED;
+
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    if ((state == FOTA_STATE_MULTICAST) || (state == FOTA_STATE_REPAIRING) ||
+        (state == FOTA_STATE_CACHING)) {
+        rsp_code = COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE;
+    } else if (state == FOTA_STATE_DOWNLOADING) {
+        if (strcmp(url, new_url) != 0) {
+            rsp_code = COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE;
+        }
+    } else {
+        if (strcmp(url, new_url) != 0) {
+            // Different image. Progress of the previous one cannot be reused
+            memset(&progress, 0, sizeof(progress));
+            strncpy(url, new_url, sizeof(url));
+            progress_store();
+        }
+
+        cache_invalidate();
+        k_sem_give(&fota_start_sem);
+    }
+    k_mutex_unlock(&fota_mutex);
+
+    coap_server_send_ack(sock, addr, addr_len, id, rsp_code, token, tkl);
+    return (rsp_code == COAP_RESPONSE_CODE_CHANGED) ? 0 : -EBUSY;
+}
+
+int coap_fota_mc_post(struct coap_resource *resource,
+             struct coap_packet *request,
+             struct sockaddr *addr, socklen_t addr_len)
+{
+    int sock = *(int*)resource->user_data;
+    int block1 = coap_get_option_int(request, COAP_OPTION_BLOCK1);
+
+    if (block1 < 0) {
+        return coap_server_handle_non_con_setter(sock, resource, request, addr, addr_len,
+                handle_mc_announce, NULL);
+    }
+
+    // Blocks are pushed to the group. Nobody expects responses
+    if (coap_header_get_type(request) != COAP_TYPE_NON_CON) {
         return -EINVAL;
     }
 
-    ot_sed_to_med();
+    return mc_block_received(request, block1);
+}
+
+#ifdef CONFIG_COAP_FOTA_CACHE
+int coap_fota_cache_get(struct coap_resource *resource,
+             struct coap_packet *request,
+             struct sockaddr *addr, socklen_t addr_len)
+{
+    int sock = *(int*)resource->user_data;
+    uint16_t id;
+    uint8_t type;
+    uint8_t tkl;
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    uint8_t block[FOTA_BLOCK_MAX_LEN];
+    uint8_t etag[MAX_FOTA_ETAG_LEN];
+    uint8_t etag_len;
+    const struct flash_area *fa;
+    struct coap_packet response;
+    uint8_t *data;
+    uint32_t img_size;
+    uint32_t num = 0;
+    uint32_t offset;
+    uint8_t szx = BLOCK_SZX_MAX;
+    size_t len = 0;
+    bool more;
+    int block2;
+    int r;
+
+    type = coap_header_get_type(request);
+    id = coap_header_get_id(request);
+    tkl = coap_header_get_token(request, token);
 
-    // Start fota using sent URL
-    memcpy(url, payload, payload_len);
-    url[payload_len] = '\0';
+    if (type != COAP_TYPE_CON) {
+        return -EINVAL;
+    }
+
+    block2 = coap_get_option_int(request, COAP_OPTION_BLOCK2);
+    if (block2 >= 0) {
+        num = BLOCK2_NUM(block2);
+        // Larger blocks would be fragmented
+        szx = MIN(BLOCK2_SZX(block2), BLOCK_SZX_MAX);
+    }
+
+    offset = num * BLOCK_SIZE(szx);
 
-    char *scheme_end = strstr(url, "://");
-    if (scheme_end) {
-        char *host = scheme_end + 3;
+    // Hold the mutex while reading, so the slot is not overwritten in the meantime
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    img_size = cache.img_size;
+    etag_len = cache.etag_len;
+    memcpy(etag, cache.etag, sizeof(etag));
 
-        char *host_end = strchr(host, '/');
-        if (host_end) {
-            *host_end = '\0';
-            strncpy(fota_path, host_end + 1, sizeof(fota_path));
-            path = fota_path;
+    if (!img_size) {
+        r = -ENOENT;
+    } else if (offset >= img_size) {
+        r = -EINVAL;
+    } else {
+        len = MIN(BLOCK_SIZE(szx), img_size - offset);
+        r = flash_area_open(PM_MCUBOOT_SECONDARY_ID, &fa);
+        if (r == 0) {
+            r = flash_area_read(fa, offset, block, len);
+            flash_area_close(fa);
         }
     }
+    k_mutex_unlock(&fota_mutex);
+
+    if (r == -ENOENT) {
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_NOT_FOUND, token, tkl);
+        return r;
+    } else if (r == -EINVAL) {
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_OPTION, token, tkl);
+        return r;
+    } else if (r < 0) {
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_INTERNAL_ERROR, token, tkl);
+        return r;
+    }
+
+    more = (offset + len) < img_size;
+
+    data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
+    if (!data) {
+        return -ENOMEM;
+    }
+
+    r = coap_packet_init(&response, data, MAX_COAP_MSG_LEN,
+                 1, COAP_TYPE_ACK, tkl, token,
+                 COAP_RESPONSE_CODE_CONTENT, id);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_packet_append_option(&response, COAP_OPTION_ETAG, etag, etag_len);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_append_option_int(&response, COAP_OPTION_BLOCK2,
+            BLOCK2_OPT(num, szx) | (more ? BLOCK2_MORE_BIT : 0));
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_append_option_int(&response, COAP_OPTION_SIZE2, img_size);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_packet_append_payload_marker(&response);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_packet_append_payload(&response, block, len);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_server_send_coap_reply(sock, &response, addr, addr_len);
+
+end:
+    k_free(data);
+
+    return r;
+}
+
+int coap_fota_cache_post(struct coap_resource *resource,
+             struct coap_packet *request,
+             struct sockaddr *addr, socklen_t addr_len)
+{
+    int sock = *(int*)resource->user_data;
+    uint16_t id;
+    uint8_t type;
+    uint8_t tkl;
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    char new_url[MAX_FOTA_PAYLOAD_LEN];
+    enum coap_response_code rsp_code;
 
-    int fota_result = fota_download_start(url, path, -1, 0, 0);
+    type = coap_header_get_type(request);
+    id = coap_header_get_id(request);
+    tkl = coap_header_get_token(request, token);
 
-    if (fota_result) {
+    if (type != COAP_TYPE_CON) {
         coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        ot_sed_from_med();
         return -EINVAL;
     }
 
-    if (callback) {
-        struct coap_fota_evt evt = {
-    	    .evt = COAP_FOTA_EVT_STARTED,
-        };
+    rsp_code = url_from_request(request, new_url);
+    if (rsp_code) {
+        coap_server_send_ack(sock, addr, addr_len, id, rsp_code, token, tkl);
+        return -EINVAL;
+    }
 
-        callback(&evt);
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    if ((state == FOTA_STATE_DOWNLOADING) || (state == FOTA_STATE_MULTICAST) ||
+        (state == FOTA_STATE_REPAIRING) || (state == FOTA_STATE_CACHING) || strlen(url)) {
+        // Secondary slot is used by an update of this node
+        rsp_code = COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE;
+    } else if (cache.img_size && (strcmp(cache.url, new_url) == 0)) {
+        rsp_code = COAP_RESPONSE_CODE_VALID;
+    } else {
+        cache_invalidate();
+        strncpy(url, new_url, sizeof(url));
+        state = FOTA_STATE_CACHING;
+        k_sem_give(&fota_start_sem);
+        rsp_code = COAP_RESPONSE_CODE_CHANGED;
     }
+    k_mutex_unlock(&fota_mutex);
 
-    coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_CHANGED, token, tkl);
-    return 0;
+    coap_server_send_ack(sock, addr, addr_len, id, rsp_code, token, tkl);
+    return (rsp_code == COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE) ? -EBUSY : 0;
 }
+#endif // CONFIG_COAP_FOTA_CACHE
 
 int coap_fota_register_cb(coap_fota_cb_t cb)
 {
@@ -198,3 +1843,21 @@ int coap_fota_register_cb(coap_fota_cb_t cb)
 
 	return 0;
 }
+
+struct settings_handler *coap_fota_get_settings_handler(void)
+{
+    return &sett_conf;
+}
+
+int coap_fota_init(void)
+{
+    k_mutex_lock(&fota_mutex, K_FOREVER);
+    if (strlen(url)) {
+        // Download interrupted by reset. URL is stored until the download ends, so continue
+        // where it stopped or start over if no block was written yet
+        k_sem_give(&fota_start_sem);
+    }
+    k_mutex_unlock(&fota_mutex);
+
+    return 0;
+}
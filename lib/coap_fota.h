@@ -12,7 +12,6 @@
 #ifndef COAP_FOTA_H_
 #define COAP_FOTA_H_
 
-#include <net/fota_download.h>
 #include <zephyr/net/coap.h>
 #include <zephyr/net/socket.h>
     
@@ -31,16 +30,61 @@ struct coap_fota_evt {
 
 typedef void (*coap_fota_cb_t)(const struct coap_fota_evt *evt);
 
-void coap_fota_callback(const struct fota_download_evt *evt);
+/** @brief Resume an interrupted download, if there is any
+ *
+ * Must be called after settings are loaded with the handler from
+ * @ref coap_fota_get_settings_handler.
+ */
+int coap_fota_init(void);
+
+/** @brief Get settings handler storing the download progress
+ */
+struct settings_handler *coap_fota_get_settings_handler(void);
 
+/** @brief Process FOTA status request
+ *
+ * Responds with the image version as plain text. If the request has the Accept option set to
+ * CBOR, responds with a map containing the version and the download progress.
+ */
 int coap_fota_get(struct coap_resource *resource,
 		struct coap_packet *request,
 		struct sockaddr *addr, socklen_t addr_len);
 
+/** @brief Process FOTA request
+ *
+ * Payload is the coap:// URL of the image. The image is fetched with CoAP Block2 transfer.
+ */
 int coap_fota_post(struct coap_resource *resource,
 		struct coap_packet *request,
 		struct sockaddr *addr, socklen_t addr_len);
 
+/** @brief Process multicast FOTA request
+ *
+ * Request without the Block1 option announces multicast distribution of an image. Its payload is
+ * a CBOR map with the group address, the repair coap:// URL, the image size and the block size.
+ * Requests with the Block1 option carry image blocks pushed to the group.
+ */
+int coap_fota_mc_post(struct coap_resource *resource,
+		struct coap_packet *request,
+		struct sockaddr *addr, socklen_t addr_len);
+
+/** @brief Serve cached firmware image
+ *
+ * Responds with the requested Block2 block of the cached image, its ETag and Size2.
+ * Available with CONFIG_COAP_FOTA_CACHE.
+ */
+int coap_fota_cache_get(struct coap_resource *resource,
+		struct coap_packet *request,
+		struct sockaddr *addr, socklen_t addr_len);
+
+/** @brief Request caching of firmware image for other nodes
+ *
+ * Payload is the coap:// URL of the image. Available with CONFIG_COAP_FOTA_CACHE.
+ */
+int coap_fota_cache_post(struct coap_resource *resource,
+		struct coap_packet *request,
+		struct sockaddr *addr, socklen_t addr_len);
+
 int coap_fota_register_cb(coap_fota_cb_t cb);
 
 #ifdef __cplusplus
@@ -48,4 +92,3 @@ int coap_fota_register_cb(coap_fota_cb_t cb);
 #endif
 
 #endif // COAP_FOTA_H_
-
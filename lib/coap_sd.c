@@ -24,7 +24,9 @@
 #define MAX_COAP_PAYLOAD_LEN 64
 
 #define SD_FLT_NAME "name"
+#define SD_FLT_NAME_ID 1
 #define SD_FLT_TYPE "type"
+#define SD_FLT_TYPE_ID 2
 #define SD_RSRC "sd"
 #define SD_NAME_MAX_LEN 8
 #define SD_TYPE_MAX_LEN 8
@@ -42,6 +44,11 @@ static struct {
     const char *type;
 } rsrcs[NUM_RSRCS];
 
+enum {
+    FLT_NAME,
+    FLT_TYPE,
+};
+
 static bool filter_sd_req(const uint8_t *payload, uint16_t payload_len)
 {
     bool found = true;
@@ -50,13 +57,23 @@ static bool filter_sd_req(const uint8_t *payload, uint16_t payload_len)
     int r;
     char str_name[SD_NAME_MAX_LEN];
     char str_type[SD_TYPE_MAX_LEN];
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [FLT_NAME] = CBOR_MAP_FIELD_ID(SD_FLT_NAME, SD_FLT_NAME_ID, CBOR_MAP_FIELD_TSTR,
+                                       str_name, sizeof(str_name)),
+        [FLT_TYPE] = CBOR_MAP_FIELD_ID(SD_FLT_TYPE, SD_FLT_TYPE_ID, CBOR_MAP_FIELD_TSTR,
+                                       str_type, sizeof(str_type)),
+    };
     ZCBOR_STATE_D(cd, 2, payload, payload_len, 1, 0);
 
     if (!zcbor_unordered_map_start_decode(cd)) return false;
 
+    r = cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present);
+    zcbor_list_map_end_force_decode(cd);
+    if (r) return found;
+
     // Handle name
-    r = cbor_extract_from_map_string(cd, SD_FLT_NAME, str_name, sizeof(str_name));
-    if (r > 0) {
+    if (CBOR_MAP_PRESENT(present, FLT_NAME) && (str_name[0] != '\0')) {
         found = false;
 
         for (int i = 0; i < ARRAY_SIZE(rsrcs); ++i) {
@@ -73,8 +90,7 @@ static bool filter_sd_req(const uint8_t *payload, uint16_t payload_len)
 
     // Handle type
     if (found) {
-        r = cbor_extract_from_map_string(cd, SD_FLT_TYPE, str_type, sizeof(str_type));
-        if (r > 0) {
+        if (CBOR_MAP_PRESENT(present, FLT_TYPE) && (str_type[0] != '\0')) {
             bool found = false;
 
             if (expected_type) {
@@ -95,12 +111,10 @@ static bool filter_sd_req(const uint8_t *payload, uint16_t payload_len)
         }
     }
 
-    zcbor_list_map_end_force_decode(cd);
-
     return found;
 }
 
-static int prepare_sd_rsp_payload(uint8_t *payload, size_t len)
+static int prepare_sd_rsp_payload(uint8_t *payload, size_t len, bool compact)
 {
     ZCBOR_STATE_E(ce, 3, payload, len, 1);
     int num_rsrcs = 0;
@@ -119,7 +133,7 @@ static int prepare_sd_rsp_payload(uint8_t *payload, size_t len)
             if (!zcbor_tstr_put_term(ce, rsrcs[i].name, SD_NAME_MAX_LEN)) return -EINVAL;
             if (!zcbor_map_start_encode(ce, 1)) return -EINVAL;
 
-            if (!zcbor_tstr_put_lit(ce, SD_FLT_TYPE)) return -EINVAL;
+            if (cbor_encode_key(ce, SD_FLT_TYPE, SD_FLT_TYPE_ID, compact)) return -EINVAL;
             if (!zcbor_tstr_put_term(ce, rsrcs[i].type, SD_TYPE_MAX_LEN)) return -EINVAL;
 
 	    if (!zcbor_map_end_encode(ce, 1)) return -EINVAL;
@@ -133,7 +147,7 @@ static int prepare_sd_rsp_payload(uint8_t *payload, size_t len)
 
 static int send_sd_rsp(int sock,
                        const struct sockaddr *addr, socklen_t addr_len,
-                       uint8_t *token, uint8_t tkl)
+                       uint8_t *token, uint8_t tkl, bool compact)
 {
     uint8_t *data;
     int r = 0;
@@ -153,7 +167,7 @@ static int send_sd_rsp(int sock,
     }
 
     r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_APP_CBOR);
+            compact ? COAP_CONTENT_FORMAT_APP_CBOR_COMPACT : COAP_CONTENT_FORMAT_APP_CBOR);
     if (r < 0) {
         goto end;
     }
@@ -163,7 +177,7 @@ static int send_sd_rsp(int sock,
         goto end;
     }
 
-    r = prepare_sd_rsp_payload(payload, MAX_COAP_PAYLOAD_LEN);
+    r = prepare_sd_rsp_payload(payload, MAX_COAP_PAYLOAD_LEN, compact);
     if (r < 0) {
         goto end;
     }
@@ -221,8 +235,10 @@ int coap_sd_server(struct coap_resource *resource,
         opt_cf_present = true;
     }
 
-    if (opt_cf_present && (coap_option_value_to_int(&option) == COAP_CONTENT_FORMAT_APP_CBOR)) {
-        opt_cf_correct = true;
+    if (opt_cf_present) {
+        r = coap_option_value_to_int(&option);
+        opt_cf_correct = (r == COAP_CONTENT_FORMAT_APP_CBOR) ||
+                         (r == COAP_CONTENT_FORMAT_APP_CBOR_COMPACT);
     }
 
     payload = coap_packet_get_payload(request, &payload_len);
@@ -240,7 +256,7 @@ int coap_sd_server(struct coap_resource *resource,
 
     if (filter_passed) {
         k_sleep(K_MSEC(sys_rand32_get() % 512));
-        r = send_sd_rsp(sock, addr, addr_len, token, tkl);
+        r = send_sd_rsp(sock, addr, addr_len, token, tkl, coap_server_accepts_compact(request));
     } else {
         r = 0;
     }
@@ -292,15 +308,15 @@ static int prepare_sd_req_payload(uint8_t *payload, size_t len, const char *name
     }
 
 
-    if (!zcbor_list_start_encode(ce, num_filters)) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, num_filters)) return -EINVAL;
 
     if (name_known) {
-        if (!zcbor_tstr_put_lit(ce, SD_FLT_NAME)) return -EINVAL;
+        if (cbor_encode_key(ce, SD_FLT_NAME, SD_FLT_NAME_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
         if (!zcbor_tstr_put_term(ce, name, SD_NAME_MAX_LEN)) return -EINVAL;
     }
 
     if (type_known) {
-        if (!zcbor_tstr_put_lit(ce, SD_FLT_TYPE)) return -EINVAL;
+        if (cbor_encode_key(ce, SD_FLT_TYPE, SD_FLT_TYPE_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
         if (!zcbor_tstr_put_term(ce, type, SD_TYPE_MAX_LEN)) return -EINVAL;
     }
 
@@ -345,11 +361,17 @@ static int coap_sd_send_req(const char *name, const char *type, int sock, bool m
         goto end;
     }
 
-    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_APP_CBOR);
+    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT, COAP_CONTENT_FORMAT_REQ);
+    if (r < 0) {
+        goto end;
+    }
+
+#ifdef COAP_COMPACT
+    r = coap_append_option_int(&cpkt, COAP_OPTION_ACCEPT, COAP_CONTENT_FORMAT_APP_CBOR_COMPACT);
     if (r < 0) {
         goto end;
     }
+#endif
 
     r = coap_packet_append_payload_marker(&cpkt);
     if (r < 0) {
@@ -414,7 +436,8 @@ static int coap_sd_process_rsp(int sock,
         return -EINVAL;
     }
 
-    if (coap_option_value_to_int(&option) != COAP_CONTENT_FORMAT_APP_CBOR) {
+    r = coap_option_value_to_int(&option);
+    if ((r != COAP_CONTENT_FORMAT_APP_CBOR) && (r != COAP_CONTENT_FORMAT_APP_CBOR_COMPACT)) {
         return -EINVAL;
     }
 
@@ -430,6 +453,10 @@ static int coap_sd_process_rsp(int sock,
     while (!zcbor_array_at_end(cd)) {
         struct zcbor_string rcvd_name;
         struct zcbor_string rcvd_type;
+        const struct cbor_map_field type_fields[] = {
+            CBOR_MAP_FIELD_ID(SD_FLT_TYPE, SD_FLT_TYPE_ID, CBOR_MAP_FIELD_TSTR_REF, &rcvd_type, 0),
+        };
+        uint32_t present;
         size_t name_len = SD_NAME_MAX_LEN;
         size_t type_len = SD_TYPE_MAX_LEN;
 
@@ -464,20 +491,13 @@ static int coap_sd_process_rsp(int sock,
             continue;
         }
 
-        if (!zcbor_search_key_tstr_lit(cd, SD_FLT_TYPE)) {
+        if (cbor_decode_map(cd, type_fields, ARRAY_SIZE(type_fields), &present) || !present) {
             // Close unordered map
             if (!zcbor_list_map_end_force_decode(cd)) return -EINVAL;
             // And check next key
             continue;
         }
 
-        if (!zcbor_tstr_decode(cd, &rcvd_type)) {
-            // Close unordered map
-			if (!zcbor_list_map_end_force_decode(cd)) return -EINVAL;
-            // And check next key
-            continue;
-        }
-
         if (rcvd_type.len < type_len) {
             type_len = rcvd_type.len;
         }
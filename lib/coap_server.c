@@ -13,6 +13,7 @@
 #include <zephyr/net/socket.h>
 #include <zephyr/net/coap.h>
 #include <zephyr/net/tls_credentials.h>
+#include <zephyr/sys/atomic.h>
 
 #define COAP_PORT 5683
 #define COAPS_PORT 5684
@@ -24,6 +25,7 @@
 #define COAPS_PSK_ID "def"
 
 static coap_rsrcs_getter_t rsrcs_get;
+static atomic_t running;
 
 #define COAP_THREAD_STACK_SIZE 4096
 #define COAP_THREAD_PRIO       2
@@ -183,15 +185,28 @@ int coap_server_send_coap_reply(int sock,
     return r;
 }
 
+bool coap_server_accepts_compact(const struct coap_packet *request)
+{
+    struct coap_option option;
+    int r;
+
+    r = coap_find_options(request, COAP_OPTION_ACCEPT, &option, 1);
+    if (r != 1) {
+        return false;
+    }
+
+    return coap_option_value_to_int(&option) == COAP_CONTENT_FORMAT_APP_CBOR_COMPACT;
+}
+
 int coap_server_send_ack(int sock, const struct sockaddr *addr, socklen_t addr_len,
                     uint16_t id, enum coap_response_code code, uint8_t *token, uint8_t tkl)
 {
     return coap_server_send_ack_with_payload(sock, addr, addr_len, id, code, token, tkl, NULL, 0);
 }
 
-int coap_server_send_ack_with_payload(int sock, const struct sockaddr *addr, socklen_t addr_len,
+static int send_ack_with_payload(int sock, const struct sockaddr *addr, socklen_t addr_len,
                     uint16_t id, enum coap_response_code code, uint8_t *token, uint8_t tkl,
-		    const uint8_t *payload, size_t payload_len)
+		    uint16_t content_format, const uint8_t *payload, size_t payload_len)
 {
     uint8_t *data;
     int r = 0;
@@ -209,8 +224,7 @@ int coap_server_send_ack_with_payload(int sock, const struct sockaddr *addr, soc
     }
 
     if (payload_len > 0) {
-        r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT,
-                COAP_CONTENT_FORMAT_APP_CBOR);
+        r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT, content_format);
         if (r < 0) {
             goto end;
         }
@@ -234,6 +248,14 @@ end:
     return r;
 }
 
+int coap_server_send_ack_with_payload(int sock, const struct sockaddr *addr, socklen_t addr_len,
+                    uint16_t id, enum coap_response_code code, uint8_t *token, uint8_t tkl,
+		    const uint8_t *payload, size_t payload_len)
+{
+    return send_ack_with_payload(sock, addr, addr_len, id, code, token, tkl,
+            COAP_CONTENT_FORMAT_APP_CBOR, payload, payload_len);
+}
+
 int coap_server_send_non_response(int sock, const struct sockaddr *addr, socklen_t addr_len,
                     enum coap_response_code code, uint8_t *token, uint8_t tkl)
 {
@@ -287,8 +309,11 @@ int coap_server_handle_simple_getter(int sock, const struct coap_resource *resou
     }
 #endif
 
-    return coap_server_send_ack_with_payload(sock, addr, addr_len, id,
-            COAP_RESPONSE_CODE_CONTENT, token, tkl, payload, payload_len);
+    // Payload keys without integer aliases are valid in the compact profile as well
+    return send_ack_with_payload(sock, addr, addr_len, id, COAP_RESPONSE_CODE_CONTENT, token, tkl,
+            coap_server_accepts_compact(request) ?
+                COAP_CONTENT_FORMAT_APP_CBOR_COMPACT : COAP_CONTENT_FORMAT_APP_CBOR,
+            payload, payload_len);
 }
 
 int coap_server_handle_simple_setter(int sock, const struct coap_resource *resource,
@@ -355,7 +380,8 @@ int coap_server_handle_non_con_setter(int sock, const struct coap_resource *reso
         return -EINVAL;
     }
 
-    if (coap_option_value_to_int(&option) != COAP_CONTENT_FORMAT_APP_CBOR) {
+    r = coap_option_value_to_int(&option);
+    if ((r != COAP_CONTENT_FORMAT_APP_CBOR) && (r != COAP_CONTENT_FORMAT_APP_CBOR_COMPACT)) {
         if (type == COAP_TYPE_CON) {
             coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_UNSUPPORTED_CONTENT_FORMAT, token, tkl);
 	}
@@ -370,7 +396,8 @@ int coap_server_handle_non_con_setter(int sock, const struct coap_resource *reso
         return -EINVAL;
     }
 
-    ZCBOR_STATE_D(cd, 2, payload, payload_len, 1, 0);
+    // Map, value backup and one nested map with its value backup
+    ZCBOR_STATE_D(cd, 4, payload, payload_len, 1, 0);
     if (!zcbor_unordered_map_start_decode(cd)) {
         if (type == COAP_TYPE_CON) {
             coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
@@ -471,6 +498,8 @@ static void coap_thread_process(void *a1, void *a2, void *a3)
         return;
     }
 
+    atomic_set(&running, 1);
+
     while (1) {
         process_client_request(sock);
     }
@@ -500,3 +529,8 @@ void coap_server_init(coap_rsrcs_getter_t rsrcs_getter)
     k_thread_start(coap_thread_id);
     k_thread_start(coaps_thread_id);
 }
+
+bool coap_server_is_running(void)
+{
+    return atomic_get(&running);
+}
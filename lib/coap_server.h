@@ -19,12 +19,36 @@
 extern "C" {
 #endif
 
+/* CBOR payload in the compact profile: map keys may be replaced by the integer
+ * aliases listed in lib/cddl. Requested by clients with the Accept option.
+ * The value is taken from the experimental range.
+ */
+#define COAP_CONTENT_FORMAT_APP_CBOR_COMPACT 65060
+
+/* Content-Format of requests sent by this node. Applications built with
+ * -DCOAP_COMPACT=1 send compact requests, which are understood by nodes
+ * running the same firmware only.
+ */
+#ifdef COAP_COMPACT
+#define COAP_CONTENT_FORMAT_REQ COAP_CONTENT_FORMAT_APP_CBOR_COMPACT
+#else
+#define COAP_CONTENT_FORMAT_REQ COAP_CONTENT_FORMAT_APP_CBOR
+#endif
+
 typedef struct coap_resource * (*coap_rsrcs_getter_t)(int sock);
 typedef int (*coap_server_cbor_map_handler_t)(zcbor_state_t *cbor_dec,
 	       	enum coap_response_code *rsp_code, void *context);
 
 void coap_server_init(coap_rsrcs_getter_t rsrcs_getter);
 
+/** @brief Check if the CoAP server is bound to its port and processes requests
+ */
+bool coap_server_is_running(void);
+
+/** @brief Check if the client requested a response in the compact profile
+ */
+bool coap_server_accepts_compact(const struct coap_packet *request);
+
 int coap_server_send_coap_reply(int sock,
                struct coap_packet *cpkt,
                const struct sockaddr *addr,
@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2020 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "data_dispatcher.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/zbus/zbus.h>
+
+#define DEFAULT_TEMP 200
+#define DEFAULT_HYST 5
+#define DEFAULT_P    3584
+#define DEFAULT_I    255
+
+struct stats {
+    uint32_t published;
+    uint32_t delivered;
+    uint32_t coalesced;
+    uint32_t filtered;
+    uint32_t publish_max_cyc;
+    uint32_t delivery_max_cyc;
+    uint64_t delivery_sum_cyc;
+};
+
+struct chan_info {
+    data_t     type;
+    data_loc_t loc;
+};
+
+static data_dispatcher_subscribe_t *subscribers[DATA_NUM];
+static uint8_t                     inline_num[DATA_NUM];
+static struct stats                stats[DATA_NUM];
+
+// Protects subscribers lists, pending publications of subscribers and stats. It is never held
+// while a callback runs, so callbacks can publish to other channels without lock ordering issues
+// with the channel locks of zbus
+static struct k_spinlock data_lock;
+
+struct k_work_q data_dispatcher_work_q;
+static K_KERNEL_STACK_DEFINE(work_q_stack, CONFIG_DATA_DISPATCHER_WORKQ_STACK_SIZE);
+
+static void chan_changed(const struct zbus_channel *chan);
+
+ZBUS_LISTENER_DEFINE(data_dispatcher_lis, chan_changed);
+
+// Variadic arguments are the initial value of the message
+#define DATA_CHAN_DEFINE(_name, _msg_type, _type, _loc, ...)                          \
+    static const struct chan_info _name##_info = { .type = _type, .loc = _loc };      \
+    ZBUS_CHAN_DEFINE(_name, _msg_type, NULL, (void *)&_name##_info,                   \
+                     ZBUS_OBSERVERS(data_dispatcher_lis), ZBUS_MSG_INIT(__VA_ARGS__))
+
+// Channels of data kept per zone are named <name>_<zone>_chan
+#define DATA_ZONE_CHAN_DEFINE(_zone, _name, _msg_type, _type, ...) \
+    DATA_CHAN_DEFINE(_name##_##_zone##_chan, _msg_type, _type, _zone, __VA_ARGS__)
+#define DATA_ZONE_CHAN_REF(_zone, _name) &_name##_##_zone##_chan
+#define DATA_SHARED_CHAN_REF(_zone, _chan) &_chan
+
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DEFINE, (;), data_temp_meas, int16_t, DATA_TEMP_MEASUREMENT,
+        DEFAULT_TEMP);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DEFINE, (;), data_temp_sett, int16_t, DATA_TEMP_SETTING,
+        DEFAULT_TEMP);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DEFINE, (;), data_output, uint16_t, DATA_OUTPUT, 0);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DEFINE, (;), data_ctlr, data_controller_t, DATA_CONTROLLER,
+        .mode = DATA_CTLR_PID, .p = DEFAULT_P, .i = DEFAULT_I);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DEFINE, (;), data_prj, uint32_t, DATA_PRJ_ENABLED, 0);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DEFINE, (;), data_frc_sw, uint16_t, DATA_FORCED_SWITCHING, 0);
+
+// Ventilation, light and shades are shared by all zones
+DATA_CHAN_DEFINE(data_vent_req_chan, data_vent_sm_t, DATA_VENT_REQ, 0, VENT_SM_UNAVAILABLE);
+DATA_CHAN_DEFINE(data_vent_curr_chan, data_vent_sm_t, DATA_VENT_CURR, 0, VENT_SM_UNAVAILABLE);
+DATA_CHAN_DEFINE(data_light_req_chan, data_light_t, DATA_LIGHT_REQ, 0, 0);
+DATA_CHAN_DEFINE(data_light_curr_chan, data_light_t, DATA_LIGHT_CURR, 0, 0);
+DATA_CHAN_DEFINE(data_shades_req_chan, data_shades_req_t, DATA_SHADES_REQ, 0, 0);
+DATA_CHAN_DEFINE(data_shades_curr_chan, data_shades_curr_t, DATA_SHADES_CURR, 0,
+                 .values = { [0 ... DATA_SHADE_ID_NUM - 1] = DATA_SHADES_VAL_UNKNOWN });
+
+BUILD_ASSERT(DATA_LOC_NUM <= 32, "Zone masks of subscriptions are 32 bit");
+
+static const struct zbus_channel *const channels[DATA_NUM][DATA_LOC_NUM] = {
+    [DATA_TEMP_MEASUREMENT] = { LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_REF, (,), data_temp_meas) },
+    [DATA_TEMP_SETTING]     = { LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_REF, (,), data_temp_sett) },
+    [DATA_OUTPUT]           = { LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_REF, (,), data_output) },
+    [DATA_CONTROLLER]       = { LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_REF, (,), data_ctlr) },
+    [DATA_PRJ_ENABLED]      = { LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_REF, (,), data_prj) },
+    [DATA_FORCED_SWITCHING] = { LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_REF, (,), data_frc_sw) },
+    [DATA_VENT_REQ]    = { LISTIFY(DATA_LOC_NUM, DATA_SHARED_CHAN_REF, (,), data_vent_req_chan) },
+    [DATA_VENT_CURR]   = { LISTIFY(DATA_LOC_NUM, DATA_SHARED_CHAN_REF, (,), data_vent_curr_chan) },
+    [DATA_LIGHT_REQ]   = { LISTIFY(DATA_LOC_NUM, DATA_SHARED_CHAN_REF, (,), data_light_req_chan) },
+    [DATA_LIGHT_CURR]  = { LISTIFY(DATA_LOC_NUM, DATA_SHARED_CHAN_REF, (,), data_light_curr_chan) },
+    [DATA_SHADES_REQ]  = { LISTIFY(DATA_LOC_NUM, DATA_SHARED_CHAN_REF, (,), data_shades_req_chan) },
+    [DATA_SHADES_CURR] = { LISTIFY(DATA_LOC_NUM, DATA_SHARED_CHAN_REF, (,), data_shades_curr_chan) },
+};
+
+// Channel message is stored in the union of data_dispatcher_publish_t. All members of the union
+// start at its beginning
+static void *msg_of(const data_dispatcher_publish_t *data)
+{
+    return (void *)&data->controller;
+}
+
+// Data shared by all zones is published only to zone 0
+static bool is_shared(data_t type)
+{
+    return (DATA_LOC_NUM == 1) || (channels[type][0] == channels[type][1]);
+}
+
+static uint8_t zones_of(data_t type, uint32_t loc_mask)
+{
+    if (loc_mask) {
+        return __builtin_popcount(loc_mask);
+    }
+
+    return is_shared(type) ? 1 : DATA_LOC_NUM;
+}
+
+// Buffer slot of a delivered zone. Queued messages are followed by the last delivered ones
+static void *pending_msg(data_dispatcher_subscribe_t *subscribe, data_loc_t loc)
+{
+    uint32_t slot = subscribe->loc_mask ? __builtin_popcount(subscribe->loc_mask & BIT_MASK(loc)) :
+                                          loc;
+
+    return (uint8_t *)subscribe->buf + slot * subscribe->msg_size;
+}
+
+static void *last_msg(data_dispatcher_subscribe_t *subscribe, data_loc_t loc)
+{
+    uint8_t *msg = pending_msg(subscribe, loc);
+
+    return subscribe->work_q ? msg + subscribe->zones * subscribe->msg_size : msg;
+}
+
+static void record_delivery(data_t type, uint32_t publish_ts)
+{
+    uint32_t latency = k_cycle_get_32() - publish_ts;
+    k_spinlock_key_t key = k_spin_lock(&data_lock);
+
+    stats[type].delivered++;
+    stats[type].delivery_sum_cyc += latency;
+    if (latency > stats[type].delivery_max_cyc) {
+        stats[type].delivery_max_cyc = latency;
+    }
+
+    k_spin_unlock(&data_lock, key);
+}
+
+static void deliver_work(struct k_work *work)
+{
+    data_dispatcher_subscribe_t *subscribe = CONTAINER_OF(work, data_dispatcher_subscribe_t, work);
+    data_dispatcher_publish_t data = {
+        .type = subscribe->type,
+    };
+    uint32_t publish_ts;
+
+    for (int loc = 0; loc < DATA_LOC_NUM; loc++)
+    {
+        k_spinlock_key_t key = k_spin_lock(&data_lock);
+
+        if (!(subscribe->pending_mask & BIT(loc))) {
+            k_spin_unlock(&data_lock, key);
+            continue;
+        }
+
+        subscribe->pending_mask &= ~BIT(loc);
+        data.loc   = loc;
+        memcpy(msg_of(&data), pending_msg(subscribe, loc), subscribe->msg_size);
+        publish_ts = subscribe->pending_ts[loc];
+
+        k_spin_unlock(&data_lock, key);
+
+        record_delivery(data.type, publish_ts);
+        subscribe->callback(&data);
+    }
+}
+
+static bool data_changed(const data_dispatcher_publish_t *prev, const data_dispatcher_publish_t *data,
+                         uint16_t deadband)
+{
+    int32_t diff;
+
+    switch (data->type) {
+        case DATA_TEMP_MEASUREMENT:
+            diff = (int32_t)data->temp_measurement - prev->temp_measurement;
+            break;
+
+        case DATA_TEMP_SETTING:
+            diff = (int32_t)data->temp_setting - prev->temp_setting;
+            break;
+
+        case DATA_OUTPUT:
+            diff = (int32_t)data->output - prev->output;
+            break;
+
+        case DATA_PRJ_ENABLED:
+            diff = (int32_t)(data->prj_validity - prev->prj_validity);
+            break;
+
+        case DATA_FORCED_SWITCHING:
+            diff = (int32_t)data->forced_switches - prev->forced_switches;
+            break;
+
+        case DATA_CONTROLLER:
+            if (data->controller.mode != prev->controller.mode) return true;
+            if (data->controller.mode == DATA_CTLR_ONOFF) {
+                return data->controller.hysteresis != prev->controller.hysteresis;
+            }
+            return (data->controller.p != prev->controller.p) ||
+                   (data->controller.i != prev->controller.i);
+
+        case DATA_VENT_REQ:
+        case DATA_VENT_CURR:
+            return data->vent_mode != prev->vent_mode;
+
+        case DATA_LIGHT_REQ:
+        case DATA_LIGHT_CURR:
+            return memcmp(&data->light, &prev->light, sizeof(data->light)) != 0;
+
+        case DATA_SHADES_REQ:
+            return (data->shades_req.id != prev->shades_req.id) ||
+                   (data->shades_req.value != prev->shades_req.value);
+
+        case DATA_SHADES_CURR:
+            return memcmp(&data->shades_curr, &prev->shades_curr, sizeof(data->shades_curr)) != 0;
+
+        default:
+            return true;
+    }
+
+    if (diff < 0) diff = -diff;
+    return diff > deadband;
+}
+
+// Called with data_lock held
+static bool filter_accepts(data_dispatcher_subscribe_t *subscribe,
+                           const data_dispatcher_publish_t *data)
+{
+    data_loc_t loc = data->loc;
+    data_dispatcher_publish_t last = {
+        .type = data->type,
+        .loc  = loc,
+    };
+    void *last_buf;
+
+    if (subscribe->loc_mask && !(subscribe->loc_mask & BIT(loc))) {
+        return false;
+    }
+
+    if (!subscribe->on_change) {
+        return true;
+    }
+
+    last_buf = last_msg(subscribe, loc);
+
+    if (subscribe->last_mask & BIT(loc)) {
+        memcpy(msg_of(&last), last_buf, subscribe->msg_size);
+
+        if (!data_changed(&last, data, subscribe->deadband)) {
+            stats[data->type].filtered++;
+            return false;
+        }
+    }
+
+    memcpy(last_buf, msg_of(data), subscribe->msg_size);
+    subscribe->last_mask |= BIT(loc);
+    return true;
+}
+
+// Called with data_lock held
+static void enqueue(data_dispatcher_subscribe_t *subscribe, const data_dispatcher_publish_t *data,
+                    uint32_t publish_ts)
+{
+    data_loc_t loc = data->loc;
+
+    if (subscribe->pending_mask & BIT(loc)) {
+        stats[data->type].coalesced++;
+    }
+
+    memcpy(pending_msg(subscribe, loc), msg_of(data),
+           subscribe->msg_size);
+    subscribe->pending_ts[loc] = publish_ts;
+    subscribe->pending_mask   |= BIT(loc);
+
+    k_work_submit_to_queue(subscribe->work_q, &subscribe->work);
+}
+
+void data_dispatcher_init(void)
+{
+    const struct k_work_queue_config work_q_cfg = {
+        .name = "data_dispatcher",
+    };
+
+    for (int i = 0; i < DATA_NUM; i++)
+    {
+        subscribers[i] = NULL;
+        inline_num[i]  = 0;
+    }
+
+    memset(stats, 0, sizeof(stats));
+
+    k_work_queue_start(&data_dispatcher_work_q, work_q_stack,
+                       K_KERNEL_STACK_SIZEOF(work_q_stack),
+                       CONFIG_DATA_DISPATCHER_WORKQ_PRIO, &work_q_cfg);
+}
+
+void data_dispatcher_subscribe(data_t type, data_dispatcher_subscribe_t *subscribe)
+{
+    assert(type < DATA_NUM);
+    assert(subscribe != NULL);
+
+    k_spinlock_key_t key;
+
+    subscribe->type         = type;
+    subscribe->msg_size     = zbus_chan_msg_size(channels[type][0]);
+    subscribe->zones        = zones_of(type, subscribe->loc_mask);
+    subscribe->pending_mask = 0;
+    subscribe->last_mask    = 0;
+    k_work_init(&subscribe->work, deliver_work);
+
+    __ASSERT(subscribe->buf_size >= (size_t)subscribe->zones * subscribe->msg_size *
+                                    ((subscribe->work_q != NULL) + subscribe->on_change),
+             "Too small buffer of a subscription");
+
+    key = k_spin_lock(&data_lock);
+
+    if (subscribe->work_q == NULL) {
+        __ASSERT(inline_num[type] < CONFIG_DATA_DISPATCHER_INLINE_MAX,
+                 "Too many subscribers called by publishers");
+        inline_num[type]++;
+    }
+
+    subscribe->next   = subscribers[type];
+    subscribers[type] = subscribe;
+
+    k_spin_unlock(&data_lock, key);
+}
+
+void data_dispatcher_unsubscribe(data_t type, data_dispatcher_subscribe_t *subscribe)
+{
+    assert(type < DATA_NUM);
+    assert(subscribe != NULL);
+
+    bool found = false;
+    k_spinlock_key_t key = k_spin_lock(&data_lock);
+
+    for (data_dispatcher_subscribe_t *item = subscribers[type]; item != NULL; item = item->next)
+    {
+        if (item->next == subscribe)
+        {
+            item->next = subscribe->next;
+            found      = true;
+        }
+    }
+
+    if (subscribers[type] == subscribe)
+    {
+        subscribers[type] = subscribe->next;
+        found             = true;
+    }
+
+    if (found && (subscribe->work_q == NULL)) {
+        inline_num[type]--;
+    }
+
+    subscribe->pending_mask = 0;
+
+    k_spin_unlock(&data_lock, key);
+
+    if (subscribe->work_q != NULL) {
+        k_work_cancel(&subscribe->work);
+    }
+}
+
+static void chan_changed(const struct zbus_channel *chan)
+{
+    const struct chan_info *info = zbus_chan_user_data(chan);
+    data_t type = info->type;
+    uint32_t publish_ts = k_cycle_get_32();
+    data_dispatcher_subscribe_t *accepted[CONFIG_DATA_DISPATCHER_INLINE_MAX];
+    int accepted_num = 0;
+    k_spinlock_key_t key;
+
+    data_dispatcher_publish_t data = {
+        .type = type,
+        .loc  = info->loc,
+    };
+
+    memcpy(msg_of(&data), zbus_chan_const_msg(chan), zbus_chan_msg_size(chan));
+
+    key = k_spin_lock(&data_lock);
+
+    stats[type].published++;
+
+    // Queued subscribers are not delayed by callbacks. Callbacks of accepting subscribers are
+    // collected to be called without data_lock
+    for (data_dispatcher_subscribe_t *item = subscribers[type]; item != NULL; item = item->next)
+    {
+        if (!filter_accepts(item, &data)) continue;
+
+        if (item->work_q != NULL) {
+            enqueue(item, &data, publish_ts);
+        } else {
+            __ASSERT_NO_MSG(accepted_num < CONFIG_DATA_DISPATCHER_INLINE_MAX);
+            accepted[accepted_num++] = item;
+        }
+    }
+
+    k_spin_unlock(&data_lock, key);
+
+    for (int i = 0; i < accepted_num; i++)
+    {
+        record_delivery(type, publish_ts);
+        accepted[i]->callback(&data);
+    }
+}
+
+const struct zbus_channel *data_dispatcher_chan(data_t type, data_loc_t loc)
+{
+    assert(type < DATA_NUM);
+    assert(loc < DATA_LOC_NUM);
+
+    return channels[type][loc];
+}
+
+void data_dispatcher_publish(data_dispatcher_publish_t *data)
+{
+    assert(data != NULL);
+
+    data_t   type = data->type;
+    uint32_t publish_ts = k_cycle_get_32();
+    uint32_t duration;
+    k_spinlock_key_t key;
+    int r;
+
+    r = zbus_chan_pub(data_dispatcher_chan(type, data->loc), msg_of(data), K_FOREVER);
+    assert(r == 0);
+    (void)r;
+
+    duration = k_cycle_get_32() - publish_ts;
+
+    key = k_spin_lock(&data_lock);
+    if (duration > stats[type].publish_max_cyc) {
+        stats[type].publish_max_cyc = duration;
+    }
+    k_spin_unlock(&data_lock, key);
+}
+
+void data_dispatcher_get(data_t type, data_loc_t loc, data_dispatcher_publish_t *data)
+{
+    const struct zbus_channel *chan = data_dispatcher_chan(type, loc);
+    int r;
+
+    assert(data != NULL);
+
+    data->type = type;
+    data->loc  = loc;
+
+    r = zbus_chan_read(chan, msg_of(data), K_FOREVER);
+    assert(r == 0);
+    (void)r;
+}
+
+void data_dispatcher_stats_get(data_t type, data_dispatcher_stats_t *stats_out)
+{
+    assert(type < DATA_NUM);
+    assert(stats_out != NULL);
+
+    struct stats s;
+    k_spinlock_key_t key = k_spin_lock(&data_lock);
+    s = stats[type];
+    k_spin_unlock(&data_lock, key);
+
+    stats_out->published       = s.published;
+    stats_out->delivered       = s.delivered;
+    stats_out->coalesced       = s.coalesced;
+    stats_out->filtered        = s.filtered;
+    stats_out->publish_max_us  = k_cyc_to_us_ceil32(s.publish_max_cyc);
+    stats_out->delivery_max_us = k_cyc_to_us_ceil32(s.delivery_max_cyc);
+    stats_out->delivery_avg_us = s.delivered ?
+        (uint32_t)k_cyc_to_us_ceil64(s.delivery_sum_cyc / s.delivered) : 0;
+}
+
+void data_dispatcher_stats_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&data_lock);
+    memset(stats, 0, sizeof(stats));
+    k_spin_unlock(&data_lock, key);
+}
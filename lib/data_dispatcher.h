@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2020 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Application data dispatcher
+ *
+ * Every data type is a zbus channel carrying its own message type. Types which are kept
+ * separately for each heating zone have a channel per zone. zbus observers
+ * can be attached to the channels directly. The data_dispatcher_* functions are a compatibility
+ * layer exchanging the data as data_dispatcher_publish_t.
+ */
+
+#ifndef DATA_DISPATCHER_H_
+#define DATA_DISPATCHER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/zbus/zbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEMP_MIN (-500)
+#define DATA_SHADES_VAL_UNKNOWN UINT16_MAX
+
+typedef enum {
+    DATA_TEMP_MEASUREMENT,
+    DATA_TEMP_SETTING,
+    DATA_OUTPUT,
+    DATA_CONTROLLER,
+    DATA_PRJ_ENABLED,
+    DATA_FORCED_SWITCHING,
+
+    DATA_VENT_REQ,
+    DATA_VENT_CURR,
+
+    DATA_LIGHT_REQ,
+    DATA_LIGHT_CURR,
+
+    DATA_SHADES_REQ,
+    DATA_SHADES_CURR,
+
+    DATA_NUM
+} data_t;
+
+#ifdef CONFIG_DATA_ZONES
+#define DATA_LOC_NUM CONFIG_DATA_ZONES
+#else
+#define DATA_LOC_NUM 2
+#endif
+
+// Zone of the data, from 0 to DATA_LOC_NUM - 1. Data shared by all zones use zone 0
+typedef uint8_t data_loc_t;
+
+typedef enum {
+    DATA_CTLR_ONOFF,
+    DATA_CTLR_PID,
+} data_ctlr_mode_t;
+
+typedef enum {
+    VENT_SM_UNAVAILABLE,
+    VENT_SM_NONE,
+    VENT_SM_AIRING,
+} data_vent_sm_t;
+
+typedef enum data_shade_id {
+    DATA_SHADE_ID_DR_L,
+    DATA_SHADE_ID_DR_C,
+    DATA_SHADE_ID_DR_R,
+    DATA_SHADE_ID_K,
+    DATA_SHADE_ID_LR,
+    DATA_SHADE_ID_BR,
+
+    DATA_SHADE_ID_NUM
+} data_shade_id_t;
+
+typedef struct data_light {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t w;
+} data_light_t;
+
+typedef struct {
+    uint16_t        value;
+    data_shade_id_t id;
+} data_shades_req_t;
+
+typedef struct {
+    uint16_t values[DATA_SHADE_ID_NUM];
+} data_shades_curr_t;
+
+typedef struct {
+    data_ctlr_mode_t mode;
+
+    union {
+        struct {
+            uint16_t p;
+            uint16_t i;
+        };
+
+        uint16_t hysteresis;
+    };
+} data_controller_t;
+
+// Message of a channel is the matching member of the union
+typedef struct {
+    data_loc_t loc;
+    data_t     type;
+    union {
+        int16_t temp_measurement;
+        int16_t temp_setting;
+        uint16_t output;
+        uint32_t prj_validity;
+        uint16_t forced_switches;
+
+        data_controller_t  controller;
+        data_vent_sm_t     vent_mode;
+        data_light_t       light;
+        data_shades_req_t  shades_req;
+        data_shades_curr_t shades_curr;
+    };
+} data_dispatcher_publish_t;
+
+typedef void (*data_dispatcher_callback_t)(const data_dispatcher_publish_t *data);
+
+/**
+ * @brief Subscription to a single data type
+ *
+ * If @p work_q is NULL the callback is called in the context of the publisher. Otherwise
+ * publications are queued and the callback is called from @p work_q. If the subscriber lags,
+ * publications of the same type and zone are coalesced and only the latest one is delivered.
+ * Callbacks called in the context of the publisher run from a zbus listener, with the channel they
+ * were notified about locked. They must not publish to nor read that channel, nor wait for threads
+ * publishing to it. They can publish to and read other channels if callbacks of these channels do
+ * not lead back to the notifying one. The dispatcher holds no lock of its own while calling them.
+ * At most CONFIG_DATA_DISPATCHER_INLINE_MAX such subscriptions are allowed per data type. A
+ * publication in progress can still call the callback once after data_dispatcher_unsubscribe()
+ * returns.
+ *
+ * Publications can be filtered before delivery by zone (@p loc_mask) and by value. With
+ * @p on_change only publications differing from the last delivered one are delivered. For numeric
+ * data (temperatures, output, projector validity, forced switches) @p deadband additionally
+ * drops changes not larger than it, in units of the data.
+ *
+ * Queued publications and the last delivered ones are kept in @p buf, a message of the channel
+ * for each delivered zone. Its size is given by DATA_DISPATCHER_BUF_SIZE(). Subscriptions called
+ * in the context of the publisher without @p on_change need no buffer.
+ */
+typedef struct data_dispatcher_subscribe {
+    data_dispatcher_callback_t        callback;
+    struct k_work_q                  *work_q;
+    uint32_t                          loc_mask; // Bitmask of zones to deliver, all if 0
+    bool                              on_change;
+    uint16_t                          deadband;
+    void                             *buf;
+    size_t                            buf_size;
+    struct data_dispatcher_subscribe *next;
+
+    // Internal state of queued delivery
+    data_t        type;
+    uint8_t       msg_size;
+    uint8_t       zones;
+    struct k_work work;
+    uint32_t      pending_mask;
+    uint32_t      pending_ts[DATA_LOC_NUM];
+
+    // Internal state of change filter
+    uint32_t      last_mask;
+} data_dispatcher_subscribe_t;
+
+/**
+ * @brief Size of the buffer of a subscription
+ *
+ * @param _msg_type   Message type of the channels of the data, e.g. int16_t for temperatures
+ * @param _zones      Number of delivered zones: bits set in loc_mask, 1 for data shared by all
+ *                    zones, DATA_LOC_NUM for data kept per zone and loc_mask of 0
+ * @param _queued     1 if the subscription has a work queue, 0 otherwise
+ * @param _on_change  1 if the subscription has on_change set, 0 otherwise
+ */
+#define DATA_DISPATCHER_BUF_SIZE(_msg_type, _zones, _queued, _on_change) \
+    ((_zones) * ((_queued) + (_on_change)) * sizeof(_msg_type))
+
+typedef struct {
+    uint32_t published;       // Number of publications
+    uint32_t delivered;       // Number of callbacks called
+    uint32_t coalesced;       // Number of queued publications replaced by newer ones
+    uint32_t filtered;        // Number of publications dropped by subscription filters
+    uint32_t publish_max_us;  // Longest data_dispatcher_publish() call
+    uint32_t delivery_max_us; // Longest time from publication to callback
+    uint32_t delivery_avg_us; // Average time from publication to callback
+} data_dispatcher_stats_t;
+
+#define DATA_ZONE_CHAN_DECLARE(_zone, _name) ZBUS_CHAN_DECLARE(_name##_##_zone##_chan)
+
+// Channels of data kept per zone, named <name>_<zone>_chan
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DECLARE, (;), data_temp_meas);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DECLARE, (;), data_temp_sett);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DECLARE, (;), data_output);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DECLARE, (;), data_ctlr);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DECLARE, (;), data_prj);
+LISTIFY(DATA_LOC_NUM, DATA_ZONE_CHAN_DECLARE, (;), data_frc_sw);
+
+// Channels shared by all zones
+ZBUS_CHAN_DECLARE(data_vent_req_chan, data_vent_curr_chan,
+                  data_light_req_chan, data_light_curr_chan,
+                  data_shades_req_chan, data_shades_curr_chan);
+
+/**
+ * @brief Get channel carrying data of given type and zone
+ */
+const struct zbus_channel *data_dispatcher_chan(data_t type, data_loc_t loc);
+
+/**
+ * @brief Work queue of the dispatcher for subscribers which must not run in publisher threads
+ */
+extern struct k_work_q data_dispatcher_work_q;
+
+void data_dispatcher_init(void);
+
+/**
+ * @brief Subscribe to data of given type
+ *
+ * A subscription structure can be subscribed to one type at a time.
+ */
+void data_dispatcher_subscribe(data_t type, data_dispatcher_subscribe_t *subscribe);
+void data_dispatcher_unsubscribe(data_t type, data_dispatcher_subscribe_t *subscribe);
+void data_dispatcher_publish(data_dispatcher_publish_t *data);
+
+/**
+ * @brief Get a copy of the last published data of given type and zone
+ *
+ * Only the channel of the requested data is locked during the copy.
+ */
+void data_dispatcher_get(data_t type, data_loc_t loc, data_dispatcher_publish_t *data);
+
+void data_dispatcher_stats_get(data_t type, data_dispatcher_stats_t *stats);
+void data_dispatcher_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DATA_DISPATCHER_H_
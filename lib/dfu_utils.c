@@ -6,70 +6,83 @@
 
 #include "dfu_utils.h"
 
-#include "continuous_sd.h"
+#include <errno.h>
 
+#include <openthread/thread.h>
+#include <zephyr/dfu/mcuboot.h>
 #include <zephyr/kernel.h>
-#include <zephyr/net/icmp.h>
-
-static const struct sockaddr_in6 global_addr = {
-    .sin6_family = AF_INET6,
-    .sin6_addr = {
-        .s6_addr = {0x20, 0x01, 0x48, 0x60, 0x48, 0x60, 0x00, 0x00,
-                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x88, 0x88},
-    },
+#include <zephyr/net/openthread.h>
+#include <zephyr/sys/reboot.h>
+
+#define MAX_CHECKS 8
+#define POLL_INTERVAL K_MSEC(100)
+
+struct check {
+    dfu_utils_check_t check;
+    uint32_t timeout_ms;
 };
 
-static volatile bool rsp_received;
+static struct check checks[MAX_CHECKS];
+static size_t num_checks;
 
-static int icmp_handler(struct net_icmp_ctx *ctx,
-			struct net_pkt *pkt,
-			struct net_icmp_ip_hdr *hdr,
-			struct net_icmp_hdr *icmp_hdr,
-			void *user_data)
+int dfu_utils_register_check(dfu_utils_check_t check, uint32_t timeout_ms)
 {
-    (void)ctx;
-    (void)pkt;
-    (void)hdr;
-    (void)icmp_hdr;
-    (void)user_data;
+    if (!check) {
+        return -EINVAL;
+    }
 
-	rsp_received = true;
+    if (num_checks >= MAX_CHECKS) {
+        return -ENOMEM;
+    }
 
-	return 0;
+    checks[num_checks].check = check;
+    checks[num_checks].timeout_ms = timeout_ms;
+    num_checks++;
+
+    return 0;
 }
 
-bool dfu_utils_keep_checking_conectivity_until(int64_t uptime)
+int dfu_utils_confirm_when_healthy(void)
 {
-    unsigned int successes = 0;
-    unsigned int failures = 0;
-    int ret;
-
-    do {
-        struct net_icmp_ctx ctx;
-        struct net_icmp_ping_params params = {
-            .identifier = 0x0132,
-            .sequence = successes + failures,
-            .tc_tos = 1,
-            .priority = 2,
-            .data_size = 0,
-        };
-
-        rsp_received = false;
-        ret  = net_icmp_init_ctx(&ctx, NET_ICMPV6_ECHO_REPLY, 0, icmp_handler);
-
-        if (ret == 0) {
-            ret = net_icmp_send_echo_request(&ctx, NULL,
-    					 (struct sockaddr *)&global_addr,
-    					 &params, NULL);
-        }
+    int64_t start = k_uptime_get();
+    uint32_t pending = BIT_MASK(num_checks);
+
+    if (boot_is_img_confirmed()) {
+        return 0;
+    }
+
+    while (pending) {
+        int64_t elapsed;
+
+        k_sleep(POLL_INTERVAL);
+        elapsed = k_uptime_get() - start;
 
-        k_sleep(K_MSEC(10000));
-        if (rsp_received) {
-            successes++;
-        } else {
-            failures++;
+        for (size_t i = 0; i < num_checks; ++i) {
+            if (!(pending & BIT(i))) {
+                continue;
+            }
+
+            if (checks[i].check()) {
+                pending &= ~BIT(i);
+            } else if (elapsed >= checks[i].timeout_ms) {
+                // Image is not confirmed, so MCUboot reverts it during the next boot
+                sys_reboot(SYS_REBOOT_COLD);
+                return -ETIMEDOUT;
+            }
         }
-    } while (k_uptime_get() < uptime);
+    }
+
+    return boot_write_img_confirmed();
+}
+
+bool dfu_utils_check_thread_attached(void)
+{
+    struct openthread_context *ot_context = openthread_get_default_context();
+    otDeviceRole role;
+
+    openthread_api_mutex_lock(ot_context);
+    role = otThreadGetDeviceRole(openthread_get_default_instance());
+    openthread_api_mutex_unlock(ot_context);
 
-    return (successes > failures);
+    return role >= OT_DEVICE_ROLE_CHILD;
 }
@@ -19,7 +19,31 @@
 extern "C" {
 #endif
 
-bool dfu_utils_keep_checking_conectivity_until(int64_t uptime);
+/** @brief Self-test check of the running image
+ *
+ * Must not block. Returns true when the checked function works.
+ */
+typedef bool (*dfu_utils_check_t)(void);
+
+/** @brief Register self-test check
+ *
+ * The check is polled until it passes or @p timeout_ms since the start of the self-test expires.
+ */
+int dfu_utils_register_check(dfu_utils_check_t check, uint32_t timeout_ms);
+
+/** @brief Run self-test of the running image
+ *
+ * All registered checks are polled concurrently. The image is confirmed as soon as all of them
+ * pass. If any check times out, the device reboots and MCUboot reverts the image. Returns
+ * immediately if the image is already confirmed.
+ *
+ * @returns 0 if the image is confirmed, negative error code otherwise.
+ */
+int dfu_utils_confirm_when_healthy(void);
+
+/** @brief Check if the device is attached to a Thread network
+ */
+bool dfu_utils_check_thread_attached(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "fota_delta.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <pm_config.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+#define DELTA_MAGIC "ZDLT"
+#define DELTA_MAGIC_LEN 4
+
+#define OP_COPY   0
+#define OP_INSERT 1
+#define OP_ADD    2
+
+#define VARINT_MAX_SHIFT 28
+#define COPY_CHUNK_LEN 64
+
+enum delta_state {
+    DELTA_STATE_OP,
+    DELTA_STATE_ARG,
+    DELTA_STATE_INSERT,
+    DELTA_STATE_ADD,
+    DELTA_STATE_ADD_RUN,
+};
+
+static struct {
+    const struct flash_area *old;
+    fota_delta_out_t out;
+    uint32_t old_size;
+    uint32_t new_size;
+    uint32_t produced;
+    enum delta_state state;
+    uint8_t op;
+    uint8_t arg_idx;
+    uint8_t arg_shift;
+    uint32_t args[2];
+    uint32_t run;
+} delta;
+
+static int old_image_crc(uint32_t size, uint32_t *crc)
+{
+    uint8_t buf[COPY_CHUNK_LEN];
+    uint32_t offset = 0;
+    int r;
+
+    *crc = 0;
+
+    while (offset < size) {
+        size_t len = MIN(sizeof(buf), size - offset);
+
+        r = flash_area_read(delta.old, offset, buf, len);
+        if (r < 0) {
+            return r;
+        }
+
+        *crc = crc32_ieee_update(*crc, buf, len);
+        offset += len;
+    }
+
+    return 0;
+}
+
+static int output(const uint8_t *data, size_t len)
+{
+    if (len > delta.new_size - delta.produced) {
+        return -EBADMSG;
+    }
+
+    delta.produced += len;
+    return delta.out(data, len);
+}
+
+static int copy_old(uint32_t offset, uint32_t len)
+{
+    uint8_t buf[COPY_CHUNK_LEN];
+    int r;
+
+    if ((offset > delta.old_size) || (len > delta.old_size - offset)) {
+        return -EBADMSG;
+    }
+
+    while (len) {
+        size_t chunk = MIN(sizeof(buf), len);
+
+        r = flash_area_read(delta.old, offset, buf, chunk);
+        if (r < 0) {
+            return r;
+        }
+
+        r = output(buf, chunk);
+        if (r < 0) {
+            return r;
+        }
+
+        offset += chunk;
+        len -= chunk;
+    }
+
+    return 0;
+}
+
+static int add_changed(const uint8_t *diff, size_t len)
+{
+    uint8_t buf[COPY_CHUNK_LEN];
+    int r;
+
+    r = flash_area_read(delta.old, delta.args[0], buf, len);
+    if (r < 0) {
+        return r;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        buf[i] += diff[i];
+    }
+
+    return output(buf, len);
+}
+
+static void add_advance(uint32_t len)
+{
+    delta.args[0] += len;
+    delta.args[1] -= len;
+    delta.state = delta.args[1] ? DELTA_STATE_ADD : DELTA_STATE_OP;
+}
+
+static int op_args_num(uint8_t op)
+{
+    switch (op) {
+        case OP_COPY:
+        case OP_ADD:
+            return 2;
+
+        case OP_INSERT:
+            return 1;
+
+        default:
+            return -EBADMSG;
+    }
+}
+
+static int op_execute(void)
+{
+    switch (delta.op) {
+        case OP_COPY:
+            delta.state = DELTA_STATE_OP;
+            return copy_old(delta.args[0], delta.args[1]);
+
+        case OP_INSERT:
+            delta.state = delta.args[0] ? DELTA_STATE_INSERT : DELTA_STATE_OP;
+            return 0;
+
+        case OP_ADD:
+            if ((delta.args[0] > delta.old_size) ||
+                (delta.args[1] > delta.old_size - delta.args[0])) {
+                return -EBADMSG;
+            }
+
+            delta.state = delta.args[1] ? DELTA_STATE_ADD : DELTA_STATE_OP;
+            return 0;
+
+        default:
+            return -EBADMSG;
+    }
+}
+
+// Returns 1 when the varint is complete, 0 when more bytes follow
+static int varint_byte(uint32_t *value, uint8_t byte)
+{
+    if (delta.arg_shift > VARINT_MAX_SHIFT) {
+        return -EBADMSG;
+    }
+
+    *value |= (uint32_t)(byte & 0x7f) << delta.arg_shift;
+    delta.arg_shift += 7;
+
+    if (byte & 0x80) {
+        return 0;
+    }
+
+    delta.arg_shift = 0;
+    return 1;
+}
+
+static int arg_byte(uint8_t byte)
+{
+    int r = varint_byte(&delta.args[delta.arg_idx], byte);
+
+    if (r <= 0) {
+        return r;
+    }
+
+    delta.arg_idx++;
+
+    if (delta.arg_idx < op_args_num(delta.op)) {
+        return 0;
+    }
+
+    return op_execute();
+}
+
+bool fota_delta_is_delta(const uint8_t *data, size_t len)
+{
+    return (len >= DELTA_MAGIC_LEN) && !memcmp(data, DELTA_MAGIC, DELTA_MAGIC_LEN);
+}
+
+int fota_delta_start(const uint8_t *data, size_t len, fota_delta_out_t out, uint32_t *new_size)
+{
+    uint32_t expected_crc;
+    uint32_t crc;
+    int r;
+
+    if ((len < FOTA_DELTA_HEADER_LEN) || !fota_delta_is_delta(data, len)) {
+        return -EBADMSG;
+    }
+
+    if (delta.old) {
+        flash_area_close(delta.old);
+    }
+
+    memset(&delta, 0, sizeof(delta));
+
+    delta.old_size = sys_get_le32(data + 4);
+    expected_crc = sys_get_le32(data + 8);
+    delta.new_size = sys_get_le32(data + 12);
+    delta.out = out;
+    delta.state = DELTA_STATE_OP;
+
+    r = flash_area_open(PM_MCUBOOT_PRIMARY_ID, &delta.old);
+    if (r < 0) {
+        delta.old = NULL;
+        return r;
+    }
+
+    if (delta.old_size > delta.old->fa_size) {
+        r = -EBADMSG;
+        goto end;
+    }
+
+    r = old_image_crc(delta.old_size, &crc);
+    if (r < 0) {
+        goto end;
+    }
+
+    if (crc != expected_crc) {
+        // Delta was generated for a different image than the running one
+        r = -EBADMSG;
+        goto end;
+    }
+
+    *new_size = delta.new_size;
+    r = FOTA_DELTA_HEADER_LEN;
+
+end:
+    if (r < 0) {
+        flash_area_close(delta.old);
+        delta.old = NULL;
+    }
+
+    return r;
+}
+
+int fota_delta_write(const uint8_t *data, size_t len)
+{
+    int r;
+
+    if (!delta.old) {
+        return -EINVAL;
+    }
+
+    while (len) {
+        switch (delta.state) {
+            case DELTA_STATE_OP:
+                delta.op = *data;
+                delta.arg_idx = 0;
+                delta.arg_shift = 0;
+                memset(delta.args, 0, sizeof(delta.args));
+
+                r = op_args_num(delta.op);
+                if (r < 0) {
+                    return r;
+                }
+
+                delta.state = DELTA_STATE_ARG;
+                data++;
+                len--;
+                break;
+
+            case DELTA_STATE_ARG:
+                r = arg_byte(*data);
+                if (r < 0) {
+                    return r;
+                }
+
+                data++;
+                len--;
+                break;
+
+            case DELTA_STATE_INSERT:
+            {
+                // Literal bytes are passed directly from the received block
+                size_t chunk = MIN(len, delta.args[0]);
+
+                r = output(data, chunk);
+                if (r < 0) {
+                    return r;
+                }
+
+                delta.args[0] -= chunk;
+                if (!delta.args[0]) {
+                    delta.state = DELTA_STATE_OP;
+                }
+
+                data += chunk;
+                len -= chunk;
+                break;
+            }
+
+            case DELTA_STATE_ADD:
+            {
+                // Run of changed bytes is patched with a single flash read
+                size_t max = MIN(MIN(len, delta.args[1]), COPY_CHUNK_LEN);
+                size_t chunk = 0;
+
+                if (!*data) {
+                    delta.run = 0;
+                    delta.state = DELTA_STATE_ADD_RUN;
+                    data++;
+                    len--;
+                    break;
+                }
+
+                while ((chunk < max) && data[chunk]) {
+                    chunk++;
+                }
+
+                r = add_changed(data, chunk);
+                if (r < 0) {
+                    return r;
+                }
+
+                add_advance(chunk);
+                data += chunk;
+                len -= chunk;
+                break;
+            }
+
+            case DELTA_STATE_ADD_RUN:
+                r = varint_byte(&delta.run, *data);
+                if (r < 0) {
+                    return r;
+                }
+
+                data++;
+                len--;
+
+                if (!r) {
+                    break;
+                }
+
+                if (!delta.run || (delta.run > delta.args[1])) {
+                    return -EBADMSG;
+                }
+
+                r = copy_old(delta.args[0], delta.run);
+                if (r < 0) {
+                    return r;
+                }
+
+                add_advance(delta.run);
+                break;
+        }
+    }
+
+    return 0;
+}
+
+int fota_delta_finish(void)
+{
+    int r = 0;
+
+    if (!delta.old) {
+        return -EINVAL;
+    }
+
+    if ((delta.state != DELTA_STATE_OP) || (delta.produced != delta.new_size)) {
+        r = -EBADMSG;
+    }
+
+    flash_area_close(delta.old);
+    delta.old = NULL;
+
+    return r;
+}
@@ -0,0 +1,27 @@
+# Delta FOTA image generated next to the signed image by scripts/fota_delta.py.
+#
+# Enabled by the signed image running on the devices:
+#   west build ... -- -DFOTA_DELTA_BASE=<old build>/zephyr/zephyr.signed.bin
+# FOTA_DELTA_IMAGE selects another signed image than zephyr.signed.bin, e.g. app_update.bin.
+
+zephyr_get(FOTA_DELTA_BASE SYSBUILD GLOBAL)
+zephyr_get(FOTA_DELTA_IMAGE SYSBUILD GLOBAL)
+
+if(FOTA_DELTA_BASE)
+    if(NOT FOTA_DELTA_IMAGE)
+        set(FOTA_DELTA_IMAGE ${CMAKE_BINARY_DIR}/zephyr/${CONFIG_KERNEL_BIN_NAME}.signed.bin)
+    endif()
+
+    get_filename_component(FOTA_DELTA_DIR ${FOTA_DELTA_IMAGE} DIRECTORY)
+    get_filename_component(FOTA_DELTA_NAME ${FOTA_DELTA_IMAGE} NAME_WLE)
+    set(FOTA_DELTA ${FOTA_DELTA_DIR}/${FOTA_DELTA_NAME}.delta)
+
+    add_custom_command(
+        OUTPUT ${FOTA_DELTA}
+        COMMAND ${PYTHON_EXECUTABLE} ${CMAKE_CURRENT_LIST_DIR}/../scripts/fota_delta.py
+            ${FOTA_DELTA_BASE} ${FOTA_DELTA_IMAGE} ${FOTA_DELTA}
+        DEPENDS ${FOTA_DELTA_BASE} ${FOTA_DELTA_IMAGE}
+            ${CMAKE_CURRENT_LIST_DIR}/../scripts/fota_delta.py
+        )
+    add_custom_target(fota_delta ALL DEPENDS ${FOTA_DELTA})
+endif()
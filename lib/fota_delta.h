@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Delta FOTA image patcher
+ *
+ * Reconstructs the new image from the image in the primary slot and a delta generated by
+ * scripts/fota_delta.py. The delta is consumed as a stream in chunks of any size and the new
+ * image is passed to the output function in order, so RAM usage does not depend on image size.
+ */
+
+#ifndef FOTA_DELTA_H_
+#define FOTA_DELTA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FOTA_DELTA_HEADER_LEN 16
+
+typedef int (*fota_delta_out_t)(const void *buf, size_t len);
+
+/** @brief Check if the stream starts with a delta header
+ */
+bool fota_delta_is_delta(const uint8_t *data, size_t len);
+
+/** @brief Start patching
+ *
+ * Verifies that the delta was generated for the image in the primary slot.
+ *
+ * @param data     Beginning of the delta containing the whole header.
+ * @param len      Length of @p data.
+ * @param out      Function receiving the new image.
+ * @param new_size Size of the new image.
+ *
+ * @returns Number of header bytes consumed from @p data or negative error code.
+ */
+int fota_delta_start(const uint8_t *data, size_t len, fota_delta_out_t out, uint32_t *new_size);
+
+/** @brief Feed next chunk of the delta
+ */
+int fota_delta_write(const uint8_t *data, size_t len);
+
+/** @brief Finish patching
+ *
+ * @returns 0 if the whole new image was produced, negative error code otherwise.
+ */
+int fota_delta_finish(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FOTA_DELTA_H_
@@ -17,7 +17,6 @@
 #include <coap_server.h>
 #include "prov.h"
 
-#include <net/fota_download.h>
 #include <zcbor_decode.h>
 #include <zcbor_encode.h>
 #include <zephyr/net/socket.h>
@@ -46,10 +45,38 @@ static int handle_prov_post(zcbor_state_t *cd,
     bool updated = false;
     int r;
     char str[PROV_LBL_MAX_LEN];
+    char keys[CONFIG_PRJCNT_NUM_NTF_SINKS][OUT_KEY_MAX_LEN];
+    char outs[CONFIG_PRJCNT_NUM_NTF_SINKS][PROV_LBL_MAX_LEN];
+    struct cbor_map_field fields[1 + CONFIG_PRJCNT_NUM_NTF_SINKS] = {
+        CBOR_MAP_FIELD_TSTR(RSRC_KEY, str),
+    };
+    uint32_t present;
+
+    BUILD_ASSERT(ARRAY_SIZE(fields) <= 32, "Too many keys for a single map decoding pass");
+
+    for (int i = 0; i < CONFIG_PRJCNT_NUM_NTF_SINKS; i++) {
+        r = get_out_key(keys[i], sizeof(keys[i]), i);
+        if ((r < 0) || (r >= sizeof(keys[i]))) {
+            *rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
+            return -EINVAL;
+        }
+
+        fields[1 + i] = (struct cbor_map_field){
+            .key = keys[i],
+            .key_len = r,
+            .type = CBOR_MAP_FIELD_TSTR,
+            .value = outs[i],
+            .arg = sizeof(outs[i]),
+        };
+    }
+
+    *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+
+    r = cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present);
+    if (r) return r;
 
     // Handle rsrc
-    r = cbor_extract_from_map_string(cd, RSRC_KEY, str, sizeof(str));
-    if ((r >= 0) && (r < PROV_LBL_MAX_LEN)) {
+    if (CBOR_MAP_PRESENT(present, 0)) {
         r = prov_set_rsrc_label(str);
 
         if (r == 0) {
@@ -59,16 +86,8 @@ static int handle_prov_post(zcbor_state_t *cd,
 
     // Handle outs
     for (int i = 0; i < CONFIG_PRJCNT_NUM_NTF_SINKS; i++) {
-        char key[OUT_KEY_MAX_LEN];
-        r = get_out_key(key, sizeof(key), i);
-        if ((r < 0) || (r >= sizeof(key))) {
-            *rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
-            return -EINVAL;
-        }
-
-        r = cbor_extract_from_map_string(cd, key, str, sizeof(str));
-        if ((r >= 0) && (r < PROV_LBL_MAX_LEN)) {
-            r = prov_set_out_label(i, str);
+        if (CBOR_MAP_PRESENT(present, 1 + i)) {
+            r = prov_set_out_label(i, outs[i]);
 
             if (r == 0) {
                 updated = true;
@@ -158,31 +177,45 @@ static int prov_get(struct coap_resource *resource,
 #define PRESET_KEY "p"
 #define RESET_KEY "res"
 
-static int handle_color(zcbor_state_t *cd, const char *key, unsigned *color_val)
+static int set_color(int new_color, unsigned *color_val)
 {
-    int new_color;
-    int ret = cbor_extract_from_map_int(cd, key, &new_color);
-
-    if (!ret) {
-        if ((new_color <= MAX_BRIGHTNESS) && (new_color >= 0)) {
-            *color_val = new_color;
-            return 0;
-        } else {
-            return -EINVAL;
-        }
+    if ((new_color <= MAX_BRIGHTNESS) && (new_color >= 0)) {
+        *color_val = new_color;
+        return 0;
     }
 
-    return ret;
+    return -EINVAL;
 }
 
+enum {
+    RSRC_R,
+    RSRC_G,
+    RSRC_B,
+    RSRC_W,
+    RSRC_DUR,
+    RSRC_PRESET,
+    RSRC_RESET,
+};
+
 static int handle_rsrc_post(zcbor_state_t *cd, enum coap_response_code *rsp_code, void *context)
 {
     bool updated = false;
     int ret;
     struct leds_brightness leds;
+    int r, g, b, w;
     unsigned dur = 0;
     int new_dur, p;
     bool reset = false;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [RSRC_R]      = CBOR_MAP_FIELD_INT(RED_KEY, &r),
+        [RSRC_G]      = CBOR_MAP_FIELD_INT(GREEN_KEY, &g),
+        [RSRC_B]      = CBOR_MAP_FIELD_INT(BLUE_KEY, &b),
+        [RSRC_W]      = CBOR_MAP_FIELD_INT(WHITE_KEY, &w),
+        [RSRC_DUR]    = CBOR_MAP_FIELD_INT(DUR_KEY, &new_dur),
+        [RSRC_PRESET] = CBOR_MAP_FIELD_INT(PRESET_KEY, &p),
+        [RSRC_RESET]  = CBOR_MAP_FIELD_BOOL(RESET_KEY, &reset),
+    };
 
     if (led_get(&leds) != 0) {
         *rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
@@ -191,39 +224,30 @@ static int handle_rsrc_post(zcbor_state_t *cd, enum coap_response_code *rsp_code
 
     *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
-    // Handle red
-    ret = handle_color(cd, RED_KEY, &leds.r);
-    if (!ret) {
+    ret = cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present);
+    if (ret) return ret;
+
+    // Handle colors
+    if (CBOR_MAP_PRESENT(present, RSRC_R) && !set_color(r, &leds.r)) {
         updated = true;
     }
-
-    // Handle green
-    ret = handle_color(cd, GREEN_KEY, &leds.g);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RSRC_G) && !set_color(g, &leds.g)) {
         updated = true;
     }
-
-    // Handle blue
-    ret = handle_color(cd, BLUE_KEY, &leds.b);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RSRC_B) && !set_color(b, &leds.b)) {
         updated = true;
     }
-
-    // Handle white
-    ret = handle_color(cd, WHITE_KEY, &leds.w);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RSRC_W) && !set_color(w, &leds.w)) {
         updated = true;
     }
 
     // Handle duration
-    ret = cbor_extract_from_map_int(cd, DUR_KEY, &new_dur);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RSRC_DUR)) {
         dur = new_dur;
     }
 
     // Handle preset
-    ret = cbor_extract_from_map_int(cd, PRESET_KEY, &p);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RSRC_PRESET)) {
         ret = preset_get(p, &leds, &dur);
         if (!ret) {
             updated = true;
@@ -231,8 +255,7 @@ static int handle_rsrc_post(zcbor_state_t *cd, enum coap_response_code *rsp_code
     }
 
     // Handle reset
-    ret = cbor_extract_from_map_bool(cd, RESET_KEY, &reset);
-    if (!ret && reset) {
+    if (CBOR_MAP_PRESENT(present, RSRC_RESET) && reset) {
         *rsp_code = COAP_RESPONSE_CODE_CHANGED;
         led_ctlr_reset_manual();
         updated = false;
@@ -306,6 +329,7 @@ static int rsrc_get(struct coap_resource *resource,
 static struct coap_resource * rsrcs_get(int sock)
 {
     static const char * const fota_path [] = {"fota_req", NULL};
+    static const char * const fota_mc_path [] = {"fota_mc", NULL};
     static const char * const sd_path [] = {"sd", NULL};
     static const char * const prov_path[] = {"prov", NULL};
     //static const char * rsrc_path[] = {NULL, NULL};
@@ -315,6 +339,9 @@ static struct coap_resource * rsrcs_get(int sock)
           .post = coap_fota_post,
           .path = fota_path,
         },
+        { .post = coap_fota_mc_post,
+          .path = fota_mc_path,
+        },
         { .get = coap_sd_server,
           .path = sd_path,
         },
@@ -9,13 +9,14 @@
 
 #include <zephyr/kernel.h> // Needed by k_sleep
 
-#include <net/fota_download.h>
 #include <openthread/thread.h>
 #include <zephyr/dfu/mcuboot.h>
 #include <zephyr/net/openthread.h>
 #include <zephyr/settings/settings.h>
 
 #include <coap_fota.h>
+#include <coap_server.h>
+#include <dfu_utils.h>
 #include <ot_sed.h>
 
 #include "coap.h"
@@ -25,6 +26,9 @@
 
 #define TX_POWER 8
 
+#define CHECK_THREAD_TIMEOUT_MS (30UL * 1000UL)
+#define CHECK_COAP_TIMEOUT_MS   (5UL * 1000UL)
+
 
 void fota_cb(const struct coap_fota_evt *evt)
 {
@@ -46,6 +50,7 @@ int main(void)
 
     settings_subsys_init();
     settings_register(prov_get_settings_handler());
+    settings_register(coap_fota_get_settings_handler());
     settings_load();
 
     otError error;
@@ -62,12 +67,14 @@ int main(void)
     assert(error == OT_ERROR_NONE);
 
     ot_sed_init(ot_instance);
-    fota_download_init(coap_fota_callback);
     coap_fota_register_cb(fota_cb);
+    coap_fota_init();
     coap_init();
     pwr_det_init();
 
-    boot_write_img_confirmed();
+    dfu_utils_register_check(dfu_utils_check_thread_attached, CHECK_THREAD_TIMEOUT_MS);
+    dfu_utils_register_check(coap_server_is_running, CHECK_COAP_TIMEOUT_MS);
+    dfu_utils_confirm_when_healthy();
 
     return 0;
 }
@@ -11,14 +11,21 @@
 #include <zephyr/net/coap.h>
 #include <zephyr/net/socket.h>
 
+#include <cbor_utils.h>
+#include <coap_server.h>
 #include <continuous_sd.h>
 
 #define COAP_PORT 5683
 #define MAX_COAP_MSG_LEN 256
 #define MAX_COAP_PAYLOAD_LEN 64
 
+#ifdef COAP_COMPACT
+#define PRJ_ENABLED_URI_PATH "p"
+#else
 #define PRJ_ENABLED_URI_PATH "prj"
+#endif
 #define PRJ_ENABLED_KEY "p"
+#define PRJ_ENABLED_KEY_ID 1
 
 #define NTF_INTERVAL (15 * 1000)
 #define NTF_TARGETS_NUM CONFIG_PRJCNT_NUM_NTF_SINKS
@@ -42,7 +49,9 @@ static int prepare_req_payload(uint8_t *payload, size_t len, bool enabled)
     ZCBOR_STATE_E(state, 2, payload, len, 1);
 
     if (!zcbor_map_start_encode(state, 1)) return -EINVAL;
-    if (!zcbor_tstr_put_lit(state, PRJ_ENABLED_KEY)) return -EINVAL;
+    if (cbor_encode_key(state, PRJ_ENABLED_KEY, PRJ_ENABLED_KEY_ID, IS_ENABLED(COAP_COMPACT))) {
+        return -EINVAL;
+    }
     if (!zcbor_bool_put(state, enabled)) return -EINVAL;
     if (!zcbor_map_end_encode(state, 1)) return -EINVAL;
 
@@ -78,8 +87,7 @@ static int send_req(int sock, struct sockaddr_in6 *addr, const char *rsrc, bool
         goto end;
     }
 
-    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_APP_CBOR);
+    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT, COAP_CONTENT_FORMAT_REQ);
     if (r < 0) {
         goto end;
     }
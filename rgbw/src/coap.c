@@ -15,37 +15,59 @@
 #include <coap_reboot.h>
 #include <coap_sd.h>
 #include <coap_server.h>
-#include "data_dispatcher.h"
 #include "led.h"
 #include "led_ctlr.h"
 #include "preset.h"
 #include "prov.h"
 
-#include <net/socket.h>
-#include <net/coap.h>
-#include <net/fota_download.h>
-#include <net/tls_credentials.h>
-#include <tinycbor/cbor.h>
-#include <tinycbor/cbor_buf_reader.h>
-#include <tinycbor/cbor_buf_writer.h>
-#include <zephyr.h>
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/tls_credentials.h>
 
 #define MAX_COAP_MSG_LEN 256
 #define MAX_COAP_PAYLOAD_LEN 64
 
+// Payload formats are described in lib/cddl
+
 #define MANUAL_VALIDITY_MS (10UL * 3600UL * 1000UL)
 
 #define RED_KEY "r"
+#define RED_KEY_ID 1
 #define GREEN_KEY "g"
+#define GREEN_KEY_ID 2
 #define BLUE_KEY "b"
+#define BLUE_KEY_ID 3
 #define WHITE_KEY "w"
+#define WHITE_KEY_ID 4
 #define PRESET_KEY "p"
+#define PRESET_KEY_ID 6
 
 #define RSRC_KEY "r"
 #define PRESET_FMT PRESET_KEY "%d"
 #define PRESET_MAX_KEY_SIZE (sizeof(PRESET_KEY) + 2)
 
-static int handle_prov_post(CborValue *value, 
+static int set_color(int new_color, unsigned *color_val)
+{
+    if ((new_color <= MAX_BRIGHTNESS) && (new_color >= 0)) {
+        *color_val = new_color;
+        return 0;
+    }
+
+    return -EINVAL;
+}
+
+enum {
+    COLOR_R,
+    COLOR_G,
+    COLOR_B,
+    COLOR_W,
+    COLOR_NUM,
+};
+
+static int handle_prov_post(zcbor_state_t *value, 
 	       	enum coap_response_code *rsp_code, void *context)
 {
     (void)context;
@@ -53,10 +75,44 @@ static int handle_prov_post(CborValue *value,
     bool updated = false;
     int r;
     char str[PROV_LBL_MAX_LEN];
+    char keys[PROV_NUM_PRESETS][PRESET_MAX_KEY_SIZE];
+    int colors[PROV_NUM_PRESETS][COLOR_NUM];
+    struct cbor_map_field color_fields[PROV_NUM_PRESETS][COLOR_NUM];
+    struct cbor_submap presets[PROV_NUM_PRESETS];
+    struct cbor_map_field fields[1 + PROV_NUM_PRESETS] = {
+        CBOR_MAP_FIELD_TSTR(RSRC_KEY, str),
+    };
+    uint32_t present;
+
+    for (int i = 0; i < PROV_NUM_PRESETS; i++) {
+        int key_len = snprintf(keys[i], sizeof(keys[i]), PRESET_FMT, i);
+        if (key_len < 0 || key_len >= sizeof(keys[i])) {
+            return -EINVAL;
+        }
+
+        color_fields[i][COLOR_R] = (struct cbor_map_field)CBOR_MAP_FIELD_INT(RED_KEY, &colors[i][COLOR_R]);
+        color_fields[i][COLOR_G] = (struct cbor_map_field)CBOR_MAP_FIELD_INT(GREEN_KEY, &colors[i][COLOR_G]);
+        color_fields[i][COLOR_B] = (struct cbor_map_field)CBOR_MAP_FIELD_INT(BLUE_KEY, &colors[i][COLOR_B]);
+        color_fields[i][COLOR_W] = (struct cbor_map_field)CBOR_MAP_FIELD_INT(WHITE_KEY, &colors[i][COLOR_W]);
+
+        presets[i] = (struct cbor_submap){
+            .fields = color_fields[i],
+            .num_fields = COLOR_NUM,
+        };
+
+        fields[1 + i] = (struct cbor_map_field){
+            .key = keys[i],
+            .key_len = key_len,
+            .type = CBOR_MAP_FIELD_MAP,
+            .value = &presets[i],
+        };
+    }
+
+    r = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
+    if (r) return r;
 
     // Handle rsrc
-    r = cbor_extract_from_map_string(value, RSRC_KEY, str, sizeof(str));
-    if ((r >= 0) && (r < PROV_LBL_MAX_LEN)) {
+    if (CBOR_MAP_PRESENT(present, 0)) {
         r = prov_set_rsrc_label(str);
 
         if (r == 0) {
@@ -66,30 +122,17 @@ static int handle_prov_post(CborValue *value,
 
     // Handle preset
     for (int i = 0; i < PROV_NUM_PRESETS; i++) {
-        CborValue map_value;
-        CborError cbor_error;
-        char key[PRESET_MAX_KEY_SIZE];
-        int key_len;
-
         struct prov_leds_brightness leds_value;
 
-        key_len = snprintf(key, sizeof(key), PRESET_FMT, i);
-        if (key_len < 0 || key_len >= sizeof(key)) {
-            continue;
-        }
+        if (!CBOR_MAP_PRESENT(present, 1 + i)) continue;
+        if (presets[i].present != (1UL << COLOR_NUM) - 1) continue;
 
-        cbor_error = cbor_value_map_find_value(value, key, &map_value);
-        if ((cbor_error == CborNoError) && cbor_value_is_map(&map_value)) {
-            // TODO: extract r, g, b, w
-            r = cbor_extract_from_map_int(&map_value, RED_KEY, &leds_value.r);
-            if (r != 0) continue;
-            r = cbor_extract_from_map_int(&map_value, GREEN_KEY, &leds_value.g);
-            if (r != 0) continue;
-            r = cbor_extract_from_map_int(&map_value, BLUE_KEY, &leds_value.b);
-            if (r != 0) continue;
-            r = cbor_extract_from_map_int(&map_value, WHITE_KEY, &leds_value.w);
-            if (r != 0) continue;
+        r = set_color(colors[i][COLOR_R], &leds_value.r);
+        if (!r) r = set_color(colors[i][COLOR_G], &leds_value.g);
+        if (!r) r = set_color(colors[i][COLOR_B], &leds_value.b);
+        if (!r) r = set_color(colors[i][COLOR_W], &leds_value.w);
 
+        if (!r) {
             r = prov_set_preset(i, &leds_value);
 
             if (r == 0) {
@@ -118,23 +161,17 @@ static int prov_post(struct coap_resource *resource,
 
 static int prepare_prov_payload(uint8_t *payload, size_t len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 2, payload, len, 1);
     const char *label;
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
-
-    if (cbor_encoder_create_map(&ce, &map, CborIndefiniteLength) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 1 + PROV_NUM_PRESETS)) return -EINVAL;
 
     label = prov_get_rsrc_label();
-    if (cbor_encode_text_string(&map, RSRC_KEY, strlen(RSRC_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_text_string(&map, label, strlen(label)) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, RSRC_KEY)) return -EINVAL;
+    if (!zcbor_tstr_put_term(ce, label, PROV_LBL_MAX_LEN)) return -EINVAL;
 
     // Handle presets
     for (int i = 0; i < PROV_NUM_PRESETS; i++) {
-        CborEncoder preset_map;
         char key[PRESET_MAX_KEY_SIZE];
         int key_len;
         int r;
@@ -149,27 +186,27 @@ static int prepare_prov_payload(uint8_t *payload, size_t len)
             continue;
         }
 
-        if (cbor_encode_text_string(&map, key, key_len) != CborNoError) return -EINVAL;
-        if (cbor_encoder_create_map(&map, &preset_map, 4) != CborNoError) return -EINVAL;
+        if (!zcbor_tstr_encode_ptr(ce, key, key_len)) return -EINVAL;
+        if (!zcbor_map_start_encode(ce, 4)) return -EINVAL;
 
-        if (cbor_encode_text_string(&preset_map, RED_KEY, strlen(RED_KEY)) != CborNoError) return -EINVAL;
-        if (cbor_encode_uint(&preset_map, value.r) != CborNoError) return -EINVAL;
+        if (!zcbor_tstr_put_lit(ce, RED_KEY)) return -EINVAL;
+        if (!zcbor_uint32_put(ce, value.r)) return -EINVAL;
 
-        if (cbor_encode_text_string(&preset_map, GREEN_KEY, strlen(GREEN_KEY)) != CborNoError) return -EINVAL;
-        if (cbor_encode_uint(&preset_map, value.g) != CborNoError) return -EINVAL;
+        if (!zcbor_tstr_put_lit(ce, GREEN_KEY)) return -EINVAL;
+        if (!zcbor_uint32_put(ce, value.g)) return -EINVAL;
 
-        if (cbor_encode_text_string(&preset_map, BLUE_KEY, strlen(BLUE_KEY)) != CborNoError) return -EINVAL;
-        if (cbor_encode_uint(&preset_map, value.b) != CborNoError) return -EINVAL;
+        if (!zcbor_tstr_put_lit(ce, BLUE_KEY)) return -EINVAL;
+        if (!zcbor_uint32_put(ce, value.b)) return -EINVAL;
 
-        if (cbor_encode_text_string(&preset_map, WHITE_KEY, strlen(WHITE_KEY)) != CborNoError) return -EINVAL;
-        if (cbor_encode_uint(&preset_map, value.w) != CborNoError) return -EINVAL;
+        if (!zcbor_tstr_put_lit(ce, WHITE_KEY)) return -EINVAL;
+        if (!zcbor_uint32_put(ce, value.w)) return -EINVAL;
 
-        if (cbor_encoder_close_container(&map, &preset_map) != CborNoError) return -EINVAL;
+        if (!zcbor_map_end_encode(ce, 4)) return -EINVAL;
     }
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 1 + PROV_NUM_PRESETS)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int prov_get(struct coap_resource *resource,
@@ -194,33 +231,43 @@ static int prov_get(struct coap_resource *resource,
 }
 
 #define DUR_KEY "d"
+#define DUR_KEY_ID 5
 #define RESET_KEY "res"
-
-static int handle_color(CborValue *value, const char *key, unsigned *color_val)
-{
-    int new_color;
-    int ret = cbor_extract_from_map_int(value, key, &new_color);
-
-    if (!ret) {
-        if ((new_color <= MAX_BRIGHTNESS) && (new_color >= 0)) {
-            *color_val = new_color;
-	    return 0;
-	} else {
-	    return -EINVAL;
-	}
-    }
-
-    return ret;
-}
-
-static int handle_rgbw_post(CborValue *value, enum coap_response_code *rsp_code, void *context)
+#define RESET_KEY_ID 7
+
+enum {
+    RGBW_R,
+    RGBW_G,
+    RGBW_B,
+    RGBW_W,
+    RGBW_DUR,
+    RGBW_PRESET,
+    RGBW_RESET,
+};
+
+static int handle_rgbw_post(zcbor_state_t *value, enum coap_response_code *rsp_code, void *context)
 {
     bool updated = false;
     int ret;
     leds_brightness leds;
-    unsigned dur = 0;
+    int colors[COLOR_NUM];
     int new_dur, p;
+    unsigned dur = 0;
     bool reset = false;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [RGBW_R]      = CBOR_MAP_FIELD_ID(RED_KEY, RED_KEY_ID, CBOR_MAP_FIELD_INT,
+                                          &colors[COLOR_R], 0),
+        [RGBW_G]      = CBOR_MAP_FIELD_ID(GREEN_KEY, GREEN_KEY_ID, CBOR_MAP_FIELD_INT,
+                                          &colors[COLOR_G], 0),
+        [RGBW_B]      = CBOR_MAP_FIELD_ID(BLUE_KEY, BLUE_KEY_ID, CBOR_MAP_FIELD_INT,
+                                          &colors[COLOR_B], 0),
+        [RGBW_W]      = CBOR_MAP_FIELD_ID(WHITE_KEY, WHITE_KEY_ID, CBOR_MAP_FIELD_INT,
+                                          &colors[COLOR_W], 0),
+        [RGBW_DUR]    = CBOR_MAP_FIELD_ID(DUR_KEY, DUR_KEY_ID, CBOR_MAP_FIELD_INT, &new_dur, 0),
+        [RGBW_PRESET] = CBOR_MAP_FIELD_ID(PRESET_KEY, PRESET_KEY_ID, CBOR_MAP_FIELD_INT, &p, 0),
+        [RGBW_RESET]  = CBOR_MAP_FIELD_ID(RESET_KEY, RESET_KEY_ID, CBOR_MAP_FIELD_BOOL, &reset, 0),
+    };
 
     if (led_get(&leds) != 0) {
         *rsp_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
@@ -229,39 +276,30 @@ static int handle_rgbw_post(CborValue *value, enum coap_response_code *rsp_code,
 
     *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
-    // Handle red
-    ret = handle_color(value, RED_KEY, &leds.r);
-    if (!ret) {
+    ret = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
+    if (ret) return ret;
+
+    // Handle colors
+    if (CBOR_MAP_PRESENT(present, RGBW_R) && !set_color(colors[COLOR_R], &leds.r)) {
         updated = true;
     }
-
-    // Handle green
-    ret = handle_color(value, GREEN_KEY, &leds.g);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RGBW_G) && !set_color(colors[COLOR_G], &leds.g)) {
         updated = true;
     }
-
-    // Handle blue
-    ret = handle_color(value, BLUE_KEY, &leds.b);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RGBW_B) && !set_color(colors[COLOR_B], &leds.b)) {
         updated = true;
     }
-
-    // Handle white
-    ret = handle_color(value, WHITE_KEY, &leds.w);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RGBW_W) && !set_color(colors[COLOR_W], &leds.w)) {
         updated = true;
     }
 
     // Handle duration
-    ret = cbor_extract_from_map_int(value, DUR_KEY, &new_dur);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RGBW_DUR)) {
         dur = new_dur;
     }
 
     // Handle preset
-    ret = cbor_extract_from_map_int(value, PRESET_KEY, &p);
-    if (!ret) {
+    if (CBOR_MAP_PRESENT(present, RGBW_PRESET)) {
         ret = preset_get(p, &leds, &dur);
         if (!ret) {
             updated = true;
@@ -269,8 +307,7 @@ static int handle_rgbw_post(CborValue *value, enum coap_response_code *rsp_code,
     }
 
     // Handle reset
-    ret = cbor_extract_from_map_bool(value, RESET_KEY, &reset);
-    if (!ret && reset) {
+    if (CBOR_MAP_PRESENT(present, RGBW_RESET) && reset) {
         *rsp_code = COAP_RESPONSE_CODE_CHANGED;
 	led_ctlr_reset_manual();
 	updated = false;
@@ -295,35 +332,30 @@ static int rgb_post(struct coap_resource *resource,
 }
 
 
-static int prepare_rgb_payload(uint8_t *payload, size_t len)
+static int prepare_rgb_payload(uint8_t *payload, size_t len, bool compact)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
     leds_brightness leds;
 
     if (led_get(&leds) != 0) return -EINVAL;
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
-
-    if (cbor_encoder_create_map(&ce, &map, 4) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 4)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, RED_KEY, strlen(RED_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_uint(&map, leds.r) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, RED_KEY, RED_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_uint32_put(ce, leds.r)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, GREEN_KEY, strlen(GREEN_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_uint(&map, leds.g) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, GREEN_KEY, GREEN_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_uint32_put(ce, leds.g)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, BLUE_KEY, strlen(BLUE_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_uint(&map, leds.b) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, BLUE_KEY, BLUE_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_uint32_put(ce, leds.b)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, WHITE_KEY, strlen(WHITE_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_uint(&map, leds.w) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, WHITE_KEY, WHITE_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_uint32_put(ce, leds.w)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 4)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int rgb_get(struct coap_resource *resource,
@@ -335,7 +367,7 @@ static int rgb_get(struct coap_resource *resource,
     uint8_t payload[MAX_COAP_PAYLOAD_LEN];
     size_t payload_len;
 
-    r = prepare_rgb_payload(payload, MAX_COAP_PAYLOAD_LEN);
+    r = prepare_rgb_payload(payload, MAX_COAP_PAYLOAD_LEN, coap_server_accepts_compact(request));
     if (r < 0) {
         return r;
     }
@@ -345,44 +377,35 @@ static int rgb_get(struct coap_resource *resource,
                     payload, payload_len);
 }
 
-static int handle_auto_post(CborValue *value, enum coap_response_code *rsp_code, void *context)
+static int handle_auto_post(zcbor_state_t *value, enum coap_response_code *rsp_code, void *context)
 {
-    bool r_valid = false;
-    bool g_valid = false;
-    bool b_valid = false;
-    bool w_valid = false;
     int ret;
     leds_brightness leds;
+    int colors[COLOR_NUM];
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [COLOR_R] = CBOR_MAP_FIELD_INT(RED_KEY, &colors[COLOR_R]),
+        [COLOR_G] = CBOR_MAP_FIELD_INT(GREEN_KEY, &colors[COLOR_G]),
+        [COLOR_B] = CBOR_MAP_FIELD_INT(BLUE_KEY, &colors[COLOR_B]),
+        [COLOR_W] = CBOR_MAP_FIELD_INT(WHITE_KEY, &colors[COLOR_W]),
+    };
 
-    // Handle red
-    ret = handle_color(value, RED_KEY, &leds.r);
-    if (!ret) {
-        r_valid = true;
-    }
+    *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
-    // Handle green
-    ret = handle_color(value, GREEN_KEY, &leds.g);
-    if (!ret) {
-        g_valid = true;
-    }
+    ret = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
+    if (ret) return ret;
 
-    // Handle blue
-    ret = handle_color(value, BLUE_KEY, &leds.b);
-    if (!ret) {
-        b_valid = true;
-    }
+    // All colors are required
+    if (present != (1UL << COLOR_NUM) - 1) return -EINVAL;
 
-    // Handle white
-    ret = handle_color(value, WHITE_KEY, &leds.w);
-    if (!ret) {
-        w_valid = true;
-    }
+    ret = set_color(colors[COLOR_R], &leds.r);
+    if (!ret) ret = set_color(colors[COLOR_G], &leds.g);
+    if (!ret) ret = set_color(colors[COLOR_B], &leds.b);
+    if (!ret) ret = set_color(colors[COLOR_W], &leds.w);
 
-    if (r_valid && g_valid && b_valid && w_valid) {
+    if (!ret) {
         *rsp_code = COAP_RESPONSE_CODE_CHANGED;
         led_ctlr_set_auto(&leds);
-    } else {
-        *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
     }
 
     return ret;
@@ -399,19 +422,18 @@ static int auto_post(struct coap_resource *resource,
 }
 
 #if 0
-static int handle_dim_post(CborValue *value, enum coap_response_code *rsp_code, void *context)
+static int handle_dim_post(zcbor_state_t *value, enum coap_response_code *rsp_code, void *context)
 {
     int ret;
     int duration_ms = 0;
-    bool duration_valid = false;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        CBOR_MAP_FIELD_INT(DUR_KEY, &duration_ms),
+    };
 
-    // Handle duration
-    ret = cbor_extract_from_map_int(value, DUR_KEY, &duration_ms);
-    if (!ret) {
-	    duration_valid = true;
-    }
+    ret = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
 
-    if (duration_valid && (duration_ms >= 0)) {
+    if (!ret && present && (duration_ms >= 0)) {
         *rsp_code = COAP_RESPONSE_CODE_CHANGED;
 
         if (duration_ms > 0) {
@@ -438,24 +460,38 @@ static int dim_post(struct coap_resource *resource,
 #endif
 
 #define PRJ_KEY "p"
+#define PRJ_KEY_ID 1
+#define PRJ_DUR_KEY_ID 2
+
+enum {
+    PRJ_DUR,
+    PRJ_ACTIVE,
+};
 
-static int handle_prj_post(CborValue *value, enum coap_response_code *rsp_code, void *context)
+static int handle_prj_post(zcbor_state_t *value, enum coap_response_code *rsp_code, void *context)
 {
     int ret;
     int duration_ms = 2 * 60 * 1000;
     bool prj_active = false;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [PRJ_DUR]    = CBOR_MAP_FIELD_ID(DUR_KEY, PRJ_DUR_KEY_ID, CBOR_MAP_FIELD_INT,
+                                         &duration_ms, 0),
+        [PRJ_ACTIVE] = CBOR_MAP_FIELD_ID(PRJ_KEY, PRJ_KEY_ID, CBOR_MAP_FIELD_BOOL, &prj_active, 0),
+    };
+
+    *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+
+    ret = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
+    if (ret) return ret;
 
     // Handle duration
-    ret = cbor_extract_from_map_int(value, DUR_KEY, &duration_ms);
     if (duration_ms <= 0) {
-        *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
         return -EINVAL;
     }
 
     // Handle projector being enabled
-    ret = cbor_extract_from_map_bool(value, PRJ_KEY, &prj_active);
-    if (ret) {
-        *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+    if (!CBOR_MAP_PRESENT(present, PRJ_ACTIVE)) {
         return -EINVAL;
     }
 
@@ -482,6 +518,7 @@ static int prj_post(struct coap_resource *resource,
 static struct coap_resource * rsrcs_get(int sock)
 {
     static const char * const fota_path [] = {"fota_req", NULL};
+    static const char * const fota_mc_path [] = {"fota_mc", NULL};
     static const char * const sd_path [] = {"sd", NULL};
     static const char * const prov_path[] = {"prov", NULL};
     static const char * const reboot_path[] = {"reboot", NULL};
@@ -489,12 +526,16 @@ static struct coap_resource * rsrcs_get(int sock)
     static const char * rsrc_path[] = {NULL, NULL};
     static const char * auto_path[] = {NULL, "auto", NULL};
     static const char * prj_path[] = {NULL, "prj", NULL};
+    static const char * prj_short_path[] = {NULL, "p", NULL};
 
     static struct coap_resource resources[] = {
         { .get = coap_fota_get,
           .post = coap_fota_post,
           .path = fota_path,
         },
+        { .post = coap_fota_mc_post,
+          .path = fota_mc_path,
+        },
         { .get = coap_sd_server,
           .path = sd_path,
         },
@@ -519,17 +560,21 @@ static struct coap_resource * rsrcs_get(int sock)
 	{ .post = prj_post,
 	  .path = prj_path,
 	},
+	{ .post = prj_post,
+	  .path = prj_short_path,
+	},
         { .path = NULL } // Array terminator
     };
 
     rsrc_path[0] = prov_get_rsrc_label();
     auto_path[0] = rsrc_path[0];
     prj_path[0] = rsrc_path[0];
+    prj_short_path[0] = rsrc_path[0];
 
     if (!rsrc_path[0] || !strlen(rsrc_path[0])) {
-	    resources[ARRAY_SIZE(resources)-4].path = NULL;
+	    resources[ARRAY_SIZE(resources)-5].path = NULL;
     } else {
-	    resources[ARRAY_SIZE(resources)-4].path = rsrc_path;
+	    resources[ARRAY_SIZE(resources)-5].path = rsrc_path;
     }
 
     // TODO: Replace it with something better
@@ -10,7 +10,6 @@
 #include <kernel.h> // Needed by k_sleep
 
 #include <dfu/mcuboot.h>
-#include <net/fota_download.h>
 #include <net/openthread.h>
 #include <openthread/thread.h>
 #include <power/reboot.h>
@@ -20,8 +19,15 @@
 #include "led_ctlr.h"
 #include "prov.h"
 
+#include <coap_fota.h>
+#include <coap_server.h>
+#include <dfu_utils.h>
+
 #define TX_POWER 8
 
+#define CHECK_THREAD_TIMEOUT_MS (30UL * 1000UL)
+#define CHECK_COAP_TIMEOUT_MS   (5UL * 1000UL)
+
 #include <settings/settings.h>
 
 static void set_leds(unsigned r, unsigned g, unsigned b, unsigned w)
@@ -35,13 +41,6 @@ static void set_leds(unsigned r, unsigned g, unsigned b, unsigned w)
 	led_set(&leds);
 }
 
-void fota_callback(const struct fota_download_evt *evt)
-{
-    if (evt->id == FOTA_DOWNLOAD_EVT_FINISHED) {
-        sys_reboot(SYS_REBOOT_COLD);
-    }
-}
-
 void main(void)
 {
     prov_init();
@@ -49,6 +48,7 @@ void main(void)
 
     settings_subsys_init();
     settings_register(prov_get_settings_handler());
+    settings_register(coap_fota_get_settings_handler());
     settings_load();
 
     otError error;
@@ -64,13 +64,11 @@ void main(void)
     error = otIp6SubscribeMulticastAddress(ot_instance, &site_local_all_nodes_addr);
     assert(error == OT_ERROR_NONE);
 
-    fota_download_init(fota_callback);
+    coap_fota_init();
     //data_dispatcher_init();
     coap_init();
     led_ctlr_init();
 
-    boot_write_img_confirmed();
-
 	set_leds(100, 0, 0, 0);
 	k_sleep(K_MSEC(50));
 	set_leds(0, 100, 0, 0);
@@ -92,5 +90,10 @@ void main(void)
 		.w = 50,
 	};
 	led_ctlr_set_auto(&leds);
+
+    // The application runs while the self-test of a new image is in progress
+    dfu_utils_register_check(dfu_utils_check_thread_attached, CHECK_THREAD_TIMEOUT_MS);
+    dfu_utils_register_check(coap_server_is_running, CHECK_COAP_TIMEOUT_MS);
+    dfu_utils_confirm_when_healthy();
 }
 
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Replay analog switch traces through the switch detection logic
+
+Raw samples around a detection are captured by the switch firmware built with
+CONFIG_ANALOG_SWITCH_TRACE=y. The capture is frozen CONFIG_ANALOG_SWITCH_TRACE_POST samples after
+a detected press, or after a manual trigger, and downloaded with CoAP Block2 transfer:
+
+$ coap-client -m post -e '<CBOR {"d": 0, "trg": true}>' "coap://[fd00::1]/adc/trace"
+$ coap-client -m get -B 60 -o press.bin "coap://[fd00::1]/adc/trace?d=0"
+$ coap-client -m post -e '<CBOR {"d": 0}>' "coap://[fd00::1]/adc/trace"
+
+The last request rearms the capture. The traces are fed to switch/src/analog_switch.c compiled
+unchanged for the host, with every combination of the detection parameters:
+
+$ ./scripts/as_replay.py --iters 20,40 --threshold 16,24,32 --debounce 2,3 press*.bin
+
+Presses are taken from a labels CSV with a row per trace: file name followed by sample indexes of
+the presses. Without a label, the trigger of a trace frozen by a detection is used as the press.
+Detections within --window samples of a press are matched to it, others are false triggers.
+
+Trace format (little-endian):
+ - header: version u8, source u8 (0 detection, 1 manual), sampling interval in ms u16,
+           number of samples u16, index of the trigger sample u16,
+           detection iterations u16, detection threshold u16, debounce count u8, padding u8
+ - samples: u16 raw ADC values, the oldest first
+"""
+
+import argparse
+import csv
+import itertools
+import os
+import statistics
+import struct
+import subprocess
+import sys
+import tempfile
+
+VERSION = 1
+HDR_FMT = '<BBHHHHHBx'
+SOURCE_DETECTION = 0
+SOURCES = ('detection', 'manual')
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SCRIPT_DIR)
+HARNESS_DIR = os.path.join(SCRIPT_DIR, 'as_replay')
+
+
+class Trace:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+
+        (version, source, self.interval, num, self.trigger,
+         self.iters, self.threshold, self.debounce) = struct.unpack_from(HDR_FMT, data)
+        if version != VERSION:
+            raise ValueError(f'{path}: unsupported trace version {version}')
+
+        pos = struct.calcsize(HDR_FMT)
+        if len(data) < pos + num * 2:
+            raise ValueError(f'{path}: truncated trace')
+
+        self.path = path
+        self.source = source
+        self.samples = struct.unpack_from(f'<{num}H', data, pos)
+
+
+def build(out_dir, cc):
+    exe = os.path.join(out_dir, 'replay')
+    subprocess.run([cc, '-O2', '-w',
+                    '-DCONFIG_SENSOR_INIT_PRIORITY=90', '-DCONFIG_SENSOR_LOG_LEVEL=0',
+                    '-I', os.path.join(SCRIPT_DIR, 'host', 'include'),
+                    '-I', os.path.join(REPO_DIR, 'switch', 'src'),
+                    os.path.join(HARNESS_DIR, 'replay.c'),
+                    '-o', exe], check=True)
+    return exe
+
+
+def replay(exe, trace, iters, threshold, debounce):
+    """Sample indexes of detected transitions"""
+    samples = '\n'.join(str(s) for s in trace.samples) + '\n'
+    result = subprocess.run([exe, str(iters), str(threshold), str(debounce)],
+                            input=samples, capture_output=True, text=True, check=True)
+    return [int(line.split()[0]) for line in result.stdout.splitlines()]
+
+
+def read_labels(path):
+    labels = {}
+    if path:
+        with open(path, newline='') as f:
+            for row in csv.reader(f):
+                if row and not row[0].startswith('#'):
+                    labels[os.path.basename(row[0])] = [int(i) for i in row[1:] if i.strip()]
+    return labels
+
+
+def presses(trace, labels):
+    name = os.path.basename(trace.path)
+    if name in labels:
+        return labels[name]
+    if trace.source == SOURCE_DETECTION:
+        return [trace.trigger]
+    raise ValueError(f'{trace.path}: manual trace without a label')
+
+
+def score(detections, truth, window, warmup):
+    """Latencies of matched presses, number of missed presses and of false triggers"""
+    detections = [d for d in detections if d >= warmup]
+    latencies = []
+    missed = 0
+
+    for press in truth:
+        match = next((d for d in detections if abs(d - press) <= window), None)
+        if match is None:
+            missed += 1
+        else:
+            latencies.append(match - press)
+            detections.remove(match)
+
+    return latencies, missed, len(detections)
+
+
+def int_list(value):
+    return [int(v) for v in value.split(',')]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('traces', nargs='+', help='traces downloaded from the adc/trace resource')
+    parser.add_argument('--labels', help='CSV with file name and press sample indexes per row')
+    parser.add_argument('--iters', type=int_list, help='detection iterations, comma separated')
+    parser.add_argument('--threshold', type=int_list, help='detection thresholds, comma separated')
+    parser.add_argument('--debounce', type=int_list, help='debounce counts, comma separated')
+    parser.add_argument('--window', type=int, default=200,
+                        help='max distance in samples between press and detection')
+    parser.add_argument('--warmup', type=int, default=256,
+                        help='initial samples in which detections are ignored')
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'), help='host C compiler')
+    parser.add_argument('--info', action='store_true', help='print trace headers and exit')
+    args = parser.parse_args()
+
+    traces = [Trace(path) for path in args.traces]
+
+    if args.info:
+        for t in traces:
+            print(f'{t.path}: {SOURCES[t.source]}, {len(t.samples)} samples every '
+                  f'{t.interval} ms, trigger {t.trigger}, iters {t.iters}, '
+                  f'threshold {t.threshold}, debounce {t.debounce}')
+        return 0
+
+    labels = read_labels(args.labels)
+    truth = [presses(t, labels) for t in traces]
+
+    # Parameters the traces were captured with are replayed by default
+    iters = args.iters or sorted({t.iters for t in traces})
+    thresholds = args.threshold or sorted({t.threshold for t in traces})
+    debounces = args.debounce or sorted({t.debounce for t in traces})
+
+    results = []
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(tmp, args.cc)
+
+        for params in itertools.product(iters, thresholds, debounces):
+            latencies = []
+            missed = 0
+            false = 0
+            for trace, t_truth in zip(traces, truth):
+                detections = replay(exe, trace, *params)
+                t_lat, t_missed, t_false = score(detections, t_truth, args.window, args.warmup)
+                latencies += [lat * trace.interval for lat in t_lat]
+                missed += t_missed
+                false += t_false
+            results.append((params, latencies, missed, false))
+
+    results.sort(key=lambda r: (r[2] + r[3],
+                                statistics.mean(abs(l) for l in r[1]) if r[1] else 0))
+
+    total = sum(len(t) for t in truth)
+    print(f'{len(traces)} traces, {total} presses')
+    print(f'{"iters":>5} {"thr":>5} {"deb":>5} {"missed":>7} {"false":>6} '
+          f'{"lat mean":>9} {"lat max":>8}  [ms]')
+    for (p_iters, p_thr, p_deb), latencies, missed, false in results:
+        mean = f'{statistics.mean(latencies):.1f}' if latencies else '-'
+        worst = f'{max(latencies)}' if latencies else '-'
+        print(f'{p_iters:>5} {p_thr:>5} {p_deb:>5} {missed:>7} {false:>6} {mean:>9} {worst:>8}')
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
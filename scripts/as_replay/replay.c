@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Replay of raw analog switch samples through the detection logic of switch/src/analog_switch.c,
+ * built on the host by scripts/as_replay.py.
+ *
+ * Usage: replay <det_iters> <det_threshold> <debounce_cnt> < samples
+ *
+ * Samples are read from stdin, one per line. Every detected transition is printed as
+ * "<sample index> <1 if on, 0 if off>".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "analog_switch.c"
+
+const struct device __device_adc = {
+	.name = "adc",
+};
+
+// Threads are not started, samples are fed to process_sample() directly
+k_tid_t k_thread_create(struct k_thread *thread, char *stack, size_t stack_size,
+			k_thread_entry_t entry, void *p1, void *p2, void *p3, int prio,
+			uint32_t options, k_timeout_t delay)
+{
+	return thread;
+}
+
+void k_thread_start(k_tid_t thread)
+{
+}
+
+int32_t k_sleep(k_timeout_t timeout)
+{
+	return 0;
+}
+
+void led_analog_toggle(void)
+{
+}
+
+void led_take_analog_control(void)
+{
+}
+
+void led_release_analog_control(void)
+{
+}
+
+static unsigned long sample_idx;
+
+static void detected(bool on, void *ctx)
+{
+	(void)ctx;
+
+	printf("%lu %d\n", sample_idx, on ? 1 : 0);
+}
+
+int main(int argc, char **argv)
+{
+	const struct device *dev = DEVICE_DT_INST_GET(0);
+	const struct analog_switch_driver_api *api = dev->api;
+	unsigned int sample;
+
+	if (argc != 4) {
+		fprintf(stderr, "Usage: %s <det_iters> <det_threshold> <debounce_cnt>\n", argv[0]);
+		return 1;
+	}
+
+	as_init(dev);
+	api->set_config(dev, atoi(argv[1]), atoi(argv[2]), atoi(argv[3]), false, false);
+	api->register_callback(dev, detected, NULL);
+
+	while (scanf("%u", &sample) == 1) {
+		process_sample(dev, (uint16_t)sample);
+		sample_idx++;
+	}
+
+	return 0;
+}
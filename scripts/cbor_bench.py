@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Benchmark decoding of CoAP request maps on the host
+
+lib/cbor_utils.c is compiled unchanged for the host with scripts/cbor_bench/bench.c, together with
+the cbor_extract_from_map_*() lookups it replaced, taken from git revision --ref. The provisioning
+map of the switch is decoded by both from payloads with keys in the order of the handler, in other
+orders, with missing keys and with unknown keys:
+
+$ ./scripts/cbor_bench.py --zcbor ../modules/lib/zcbor
+
+Both decoders are built against the sources of the zcbor module, found next to $ZEPHYR_BASE if
+--zcbor is not given. The subset of scripts/host/zcbor is not used, its unordered map searches
+cost differently. Times are host times, useful only for comparison. The exit code is non-zero if
+the decoders return different values.
+
+The table is not faster when the keys come in its order and no other keys are present: every key
+is decoded and compared with the table entry, while zcbor_search_key_tstr_term() compares the
+payload with the expected key in place. Each unknown key is compared with the whole table before
+it is skipped, where the per-key lookup skips it while searching the next key. The table pays off
+for the other orders and for missing keys, which make the per-key lookups scan the whole map.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SCRIPT_DIR)
+HARNESS_DIR = os.path.join(SCRIPT_DIR, 'cbor_bench')
+
+# Last revision with the per-key lookups
+PER_KEY_REF = '60180a8^'
+
+# Renamed in the old sources, they are defined by the current cbor_utils.c too
+OLD_RENAMES = ('cbor_decode_dec_frac_num', 'cbor_encode_dec_frac_num')
+
+
+def checkout(ref, out_dir):
+    for name in ('cbor_utils.c', 'cbor_utils.h'):
+        data = subprocess.run(['git', '-C', REPO_DIR, 'show', f'{ref}:lib/{name}'],
+                              capture_output=True, check=True).stdout
+        with open(os.path.join(out_dir, name), 'wb') as f:
+            f.write(data)
+
+
+def default_zcbor():
+    zephyr_base = os.environ.get('ZEPHYR_BASE')
+    return os.path.join(zephyr_base, '..', 'modules', 'lib', 'zcbor') if zephyr_base else None
+
+
+def build(out_dir, cc, ref, zcbor):
+    old_dir = os.path.join(out_dir, 'old')
+    os.mkdir(old_dir)
+    checkout(ref, old_dir)
+
+    zcbor_inc = os.path.join(zcbor, 'include')
+    zcbor_srcs = [os.path.join(zcbor, 'src', f'zcbor_{n}.c') for n in ('common', 'decode', 'encode')]
+
+    cflags = ['-O2', '-w', '-I', zcbor_inc]
+    lib = ['-I', os.path.join(REPO_DIR, 'lib')]
+    units = [(os.path.join(REPO_DIR, 'lib', 'cbor_utils.c'), lib),
+             (os.path.join(old_dir, 'cbor_utils.c'),
+              ['-I', old_dir] + [f'-D{n}=old_{n}' for n in OLD_RENAMES]),
+             (os.path.join(HARNESS_DIR, 'bench.c'), lib)]
+    units += [(src, []) for src in zcbor_srcs]
+
+    objs = []
+    for src, flags in units:
+        obj = os.path.join(out_dir, f'{len(objs)}_{os.path.basename(src)}.o')
+        subprocess.run([cc] + cflags + flags + ['-c', src, '-o', obj], check=True)
+        objs.append(obj)
+
+    exe = os.path.join(out_dir, 'bench')
+    subprocess.run([cc] + objs + ['-o', exe], check=True)
+    return exe
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'), help='host C compiler')
+    parser.add_argument('--zcbor', default=default_zcbor(),
+                        help='zcbor module directory (default: %(default)s)')
+    parser.add_argument('--ref', default=PER_KEY_REF,
+                        help='git revision with cbor_extract_from_map_*()')
+    parser.add_argument('--iters', type=int, default=100000, help='decoded maps per run')
+    args = parser.parse_args()
+
+    if not args.zcbor or not os.path.isfile(os.path.join(args.zcbor, 'src', 'zcbor_decode.c')):
+        parser.error('zcbor module not found, give its directory with --zcbor')
+
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(tmp, args.cc, args.ref, args.zcbor)
+        return subprocess.run([exe, str(args.iters)]).returncode
+
+
+if __name__ == '__main__':
+    sys.exit(main())
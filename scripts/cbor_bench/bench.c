@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Benchmark of cbor_decode_map() of lib/cbor_utils.c against the per-key lookups with
+ * cbor_extract_from_map_*() it replaced, built on the host by scripts/cbor_bench.py.
+ *
+ * The provisioning map of the switch is decoded the way coap_server.c opens request payloads.
+ * The per-key lookup calls zcbor_search_key_tstr_term() for every key of the handler, which scans
+ * the unordered map from the current position and wraps around. Payloads differ in the order of
+ * their keys, missing keys, unknown keys and a label too long for its buffer. Both decoders must
+ * return the same values.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cbor_utils.h"
+
+int cbor_extract_from_map_string(zcbor_state_t *unordered_map, const char *key, char *value,
+				 size_t value_len);
+int cbor_extract_from_map_int(zcbor_state_t *unordered_map, const char *key, int *value);
+int cbor_extract_from_map_bool(zcbor_state_t *unordered_map, const char *key, bool *value);
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define BIT(n)        (1UL << (n))
+
+#define LBL_LEN  32
+#define NUM_KEYS 9
+#define RUNS     11
+
+enum key_idx {
+	PROV_RSRC0,
+	PROV_RSRC1,
+	PROV_OUT0,
+	PROV_OUT1,
+	PROV_ANALOG0,
+	PROV_ANALOG1,
+	PROV_THRESHOLD0,
+	PROV_THRESHOLD1,
+	PROV_MONOSTABLE,
+	PROV_UNKNOWN,
+	PROV_RSRC0_LONG,
+};
+
+static const char *const keys[] = {
+	"r0", "r1", "o0", "o1", "a0", "a1", "t0", "t1", "m",
+};
+
+struct prov {
+	char rsrc[2][LBL_LEN];
+	char out[2][LBL_LEN];
+	bool analog[2];
+	int threshold[2];
+	bool monostable;
+	uint32_t present;
+};
+
+struct payload_case {
+	const char *name;
+	const enum key_idx *order;
+	size_t num;
+};
+
+static const enum key_idx ordered[] = {
+	PROV_RSRC0, PROV_RSRC1, PROV_OUT0, PROV_OUT1, PROV_ANALOG0, PROV_ANALOG1,
+	PROV_THRESHOLD0, PROV_THRESHOLD1, PROV_MONOSTABLE,
+};
+static const enum key_idx reversed[] = {
+	PROV_MONOSTABLE, PROV_THRESHOLD1, PROV_THRESHOLD0, PROV_ANALOG1, PROV_ANALOG0,
+	PROV_OUT1, PROV_OUT0, PROV_RSRC1, PROV_RSRC0,
+};
+static const enum key_idx shuffled[] = {
+	PROV_MONOSTABLE, PROV_THRESHOLD1, PROV_RSRC0, PROV_ANALOG1, PROV_OUT1,
+	PROV_THRESHOLD0, PROV_RSRC1, PROV_ANALOG0, PROV_OUT0,
+};
+static const enum key_idx partial[] = {
+	PROV_THRESHOLD0, PROV_ANALOG0, PROV_MONOSTABLE,
+};
+static const enum key_idx unknown[] = {
+	PROV_UNKNOWN, PROV_RSRC0, PROV_UNKNOWN, PROV_RSRC1, PROV_UNKNOWN, PROV_OUT0,
+	PROV_UNKNOWN, PROV_OUT1, PROV_ANALOG0, PROV_ANALOG1, PROV_THRESHOLD0, PROV_THRESHOLD1,
+	PROV_MONOSTABLE, PROV_UNKNOWN, PROV_UNKNOWN,
+};
+
+static const enum key_idx long_label[] = {
+	PROV_RSRC0_LONG, PROV_RSRC1, PROV_OUT0, PROV_OUT1, PROV_ANALOG0, PROV_ANALOG1,
+	PROV_THRESHOLD0, PROV_THRESHOLD1, PROV_MONOSTABLE,
+};
+
+static const struct payload_case cases[] = {
+	{ "ordered", ordered, ARRAY_SIZE(ordered) },
+	{ "reversed", reversed, ARRAY_SIZE(reversed) },
+	{ "shuffled", shuffled, ARRAY_SIZE(shuffled) },
+	{ "partial", partial, ARRAY_SIZE(partial) },
+	{ "unknown", unknown, ARRAY_SIZE(unknown) },
+	{ "long", long_label, ARRAY_SIZE(long_label) },
+};
+
+static const char *const labels[] = {
+	"living_room/light", "living_room/lamp", "hall/light", "hall/night_light",
+};
+
+static size_t encode(const struct payload_case *c, uint8_t *buf, size_t buf_len)
+{
+	ZCBOR_STATE_E(ce, 1, buf, buf_len, 1);
+	int unknown_cnt = 0;
+	bool ok = zcbor_map_start_encode(ce, c->num);
+
+	for (size_t i = 0; ok && (i < c->num); i++) {
+		enum key_idx k = c->order[i];
+
+		if (k == PROV_UNKNOWN) {
+			char key[4] = { 'x', (char)('0' + unknown_cnt++), '\0' };
+
+			ok = zcbor_tstr_put_term(ce, key, sizeof(key)) &&
+			     zcbor_tstr_put_term(ce, "unused label", LBL_LEN);
+			continue;
+		}
+
+		if (k == PROV_RSRC0_LONG) {
+			// Longer than the label buffer, dropped by both decoders
+			ok = zcbor_tstr_put_term(ce, keys[PROV_RSRC0], LBL_LEN) &&
+			     zcbor_tstr_put_term(ce, "living_room/ceiling/light/dimmer/0",
+						 2 * LBL_LEN);
+			continue;
+		}
+
+		ok = zcbor_tstr_put_term(ce, keys[k], LBL_LEN);
+		switch (k) {
+		case PROV_RSRC0:
+		case PROV_RSRC1:
+		case PROV_OUT0:
+		case PROV_OUT1:
+			ok = ok && zcbor_tstr_put_term(ce, labels[k - PROV_RSRC0], LBL_LEN);
+			break;
+		case PROV_ANALOG0:
+		case PROV_ANALOG1:
+		case PROV_MONOSTABLE:
+			ok = ok && zcbor_bool_put(ce, true);
+			break;
+		default:
+			ok = ok && zcbor_int32_put(ce, 1000 + (int)k);
+			break;
+		}
+	}
+
+	if (!ok || !zcbor_map_end_encode(ce, c->num)) {
+		fprintf(stderr, "Cannot encode %s payload\n", c->name);
+		exit(1);
+	}
+
+	return ce->payload - buf;
+}
+
+static int decode_table(zcbor_state_t *cd, struct prov *prov)
+{
+	const struct cbor_map_field fields[] = {
+		[PROV_RSRC0]      = CBOR_MAP_FIELD_TSTR("r0", prov->rsrc[0]),
+		[PROV_RSRC1]      = CBOR_MAP_FIELD_TSTR("r1", prov->rsrc[1]),
+		[PROV_OUT0]       = CBOR_MAP_FIELD_TSTR("o0", prov->out[0]),
+		[PROV_OUT1]       = CBOR_MAP_FIELD_TSTR("o1", prov->out[1]),
+		[PROV_ANALOG0]    = CBOR_MAP_FIELD_BOOL("a0", &prov->analog[0]),
+		[PROV_ANALOG1]    = CBOR_MAP_FIELD_BOOL("a1", &prov->analog[1]),
+		[PROV_THRESHOLD0] = CBOR_MAP_FIELD_INT("t0", &prov->threshold[0]),
+		[PROV_THRESHOLD1] = CBOR_MAP_FIELD_INT("t1", &prov->threshold[1]),
+		[PROV_MONOSTABLE] = CBOR_MAP_FIELD_BOOL("m", &prov->monostable),
+	};
+
+	return cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &prov->present);
+}
+
+// Lookups of the switch provisioning handler before the table-driven decoder
+static int decode_per_key(zcbor_state_t *cd, struct prov *prov)
+{
+	prov->present = 0;
+
+	for (int i = 0; i < 2; i++) {
+		if (cbor_extract_from_map_string(cd, keys[PROV_RSRC0 + i], prov->rsrc[i],
+						 LBL_LEN) >= 0) {
+			prov->present |= BIT(PROV_RSRC0 + i);
+		}
+	}
+	for (int i = 0; i < 2; i++) {
+		if (cbor_extract_from_map_string(cd, keys[PROV_OUT0 + i], prov->out[i],
+						 LBL_LEN) >= 0) {
+			prov->present |= BIT(PROV_OUT0 + i);
+		}
+	}
+	for (int i = 0; i < 2; i++) {
+		if (cbor_extract_from_map_bool(cd, keys[PROV_ANALOG0 + i], &prov->analog[i]) == 0) {
+			prov->present |= BIT(PROV_ANALOG0 + i);
+		}
+	}
+	for (int i = 0; i < 2; i++) {
+		if (cbor_extract_from_map_int(cd, keys[PROV_THRESHOLD0 + i],
+					      &prov->threshold[i]) == 0) {
+			prov->present |= BIT(PROV_THRESHOLD0 + i);
+		}
+	}
+	if (cbor_extract_from_map_bool(cd, keys[PROV_MONOSTABLE], &prov->monostable) == 0) {
+		prov->present |= BIT(PROV_MONOSTABLE);
+	}
+
+	return 0;
+}
+
+typedef int (*decoder_t)(zcbor_state_t *cd, struct prov *prov);
+
+// Opened and closed like request payloads in coap_server.c
+static int decode(decoder_t decoder, const uint8_t *payload, size_t len, struct prov *prov)
+{
+	ZCBOR_STATE_D(cd, 4, payload, len, 1, 0);
+	int r;
+
+	if (!zcbor_unordered_map_start_decode(cd)) {
+		return -EINVAL;
+	}
+
+	r = decoder(cd, prov);
+	zcbor_unordered_map_end_decode(cd);
+
+	return r;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// In ns per decoded map
+static double measure(decoder_t decoder, const uint8_t *payload, size_t len, long iters)
+{
+	struct prov prov;
+	uint64_t start = now_ns();
+
+	for (long i = 0; i < iters; i++) {
+		decode(decoder, payload, len, &prov);
+		__asm__ volatile("" : : "r"(&prov) : "memory");
+	}
+
+	return (double)(now_ns() - start) / iters;
+}
+
+static bool same(const struct prov *a, const struct prov *b)
+{
+	if (a->present != b->present) {
+		return false;
+	}
+
+	for (int k = 0; k < NUM_KEYS; k++) {
+		if (!(a->present & BIT(k))) {
+			continue;
+		}
+
+		switch (k) {
+		case PROV_RSRC0:
+		case PROV_RSRC1:
+			if (strcmp(a->rsrc[k - PROV_RSRC0], b->rsrc[k - PROV_RSRC0])) return false;
+			break;
+		case PROV_OUT0:
+		case PROV_OUT1:
+			if (strcmp(a->out[k - PROV_OUT0], b->out[k - PROV_OUT0])) return false;
+			break;
+		case PROV_ANALOG0:
+		case PROV_ANALOG1:
+			if (a->analog[k - PROV_ANALOG0] != b->analog[k - PROV_ANALOG0]) return false;
+			break;
+		case PROV_THRESHOLD0:
+		case PROV_THRESHOLD1:
+			if (a->threshold[k - PROV_THRESHOLD0] != b->threshold[k - PROV_THRESHOLD0]) {
+				return false;
+			}
+			break;
+		default:
+			if (a->monostable != b->monostable) return false;
+			break;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	long iters = (argc > 1) ? atol(argv[1]) : 100000;
+	int failed = 0;
+
+	printf("%10s %8s %6s %14s %12s %8s\n", "payload", "bytes", "keys", "per_key_ns", "table_ns",
+	       "speedup");
+
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		const struct payload_case *c = &cases[i];
+		struct prov per_key = { 0 };
+		struct prov table = { 0 };
+		uint8_t payload[256];
+		size_t len = encode(c, payload, sizeof(payload));
+		double per_key_ns = 0;
+		double table_ns = 0;
+
+		if ((decode(decode_per_key, payload, len, &per_key) != 0) ||
+		    (decode(decode_table, payload, len, &table) != 0) || !same(&per_key, &table)) {
+			printf("%10s: decoders differ\n", c->name);
+			failed++;
+			continue;
+		}
+
+		// Best of interleaved runs, to reduce the influence of other load of the host
+		for (int run = 0; run < RUNS; run++) {
+			double ns = measure(decode_per_key, payload, len, iters);
+
+			if ((run == 0) || (ns < per_key_ns)) {
+				per_key_ns = ns;
+			}
+
+			ns = measure(decode_table, payload, len, iters);
+			if ((run == 0) || (ns < table_ns)) {
+				table_ns = ns;
+			}
+		}
+
+		printf("%10s %8zu %6zu %14.1f %12.1f %7.2fx\n", c->name, len, c->num, per_key_ns,
+		       table_ns, per_key_ns / table_ns);
+	}
+
+	return failed;
+}
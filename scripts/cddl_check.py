@@ -0,0 +1,523 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Check CoAP payloads of the apps against the CDDL schemas in lib/cddl
+
+Payloads are encoded by the prepare_*_payload() functions of the app sources with the host harness
+of scripts/coap_frame_size.py, with text keys and in the compact profile. Each of them is validated
+against its rule from lib/cddl, listed in ENCODER_RULES. Payload files of a directory like
+coap-commands are checked against the rules in COMMAND_RULES too:
+
+$ ./scripts/cddl_check.py
+$ ./scripts/cddl_check.py --commands coap-commands
+
+Only the part of CDDL used by lib/cddl is supported: maps and arrays with ?, * and + occurrences,
+choices, literals, ranges, tags, .size of strings and the int, uint, nint, tstr, bstr and bool
+types. The exit code is non-zero if any payload does not match its rule.
+"""
+
+import argparse
+import glob
+import os
+import re
+import struct
+import sys
+import tempfile
+
+import coap_frame_size
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SCRIPT_DIR)
+CDDL_DIR = os.path.join(REPO_DIR, 'lib', 'cddl')
+
+# Rule of every encoder of the harness. The ventilation unit is not ours and has no schema.
+ENCODER_RULES = {
+    'sd_req': 'sd_req',
+    'sd_rsp': 'sd_rsp',
+    'prjcnt_prj': 'prj_post',
+    'prjcnt_prov': 'prov_prjcnt',
+    'temp_tscrn_temp': 'temp_get',
+    'temp_tscrn_prj': 'prj_get',
+    'temp_tscrn_light': 'rgbw_post',
+    'temp_tscrn_shades': 'shcnt_val_post',
+    'temp_tscrn_rmt_out': 'shcnt_val_post',
+    'temp_tscrn_vent': None,
+    'temp_tscrn_prov': 'prov_temp_tscrn',
+    'shcnt_val': 'shcnt_val_get',
+    'shcnt_prov': 'prov_shcnt',
+    'rgbw_colors': 'rgbw_get',
+    'rgbw_prov': 'prov_rgbw',
+    'switch_preset': 'rgbw_preset_req',
+    'switch_prov': 'prov_switch',
+    'accnt_temp': 'accnt_temp_get',
+    'accnt_prov': 'prov_accnt',
+}
+
+# (file name prefix, rules any of which the file must match), the first matching prefix is used.
+# fota_post carries the image URL as plain text.
+COMMAND_RULES = [
+    ('fota_post', []),
+    ('rgbw_prov_', ['prov_rgbw']),
+    ('rgbw_auto_', ['rgbw_auto_post']),
+    ('rgbw_', ['rgbw_post']),
+    ('shcnt_val_', ['shcnt_val_post']),
+    ('tmptscrn_set_', ['temp_post']),
+    ('prov', ['prov_shcnt', 'prov_switch', 'prov_temp_tscrn']),
+]
+
+PRIMITIVES = ('any', 'uint', 'nint', 'int', 'tstr', 'text', 'bstr', 'bytes', 'bool')
+
+
+class CddlError(Exception):
+    pass
+
+
+class CborError(Exception):
+    pass
+
+
+class Tag:
+    def __init__(self, tag, value):
+        self.tag = tag
+        self.value = value
+
+    def __repr__(self):
+        return f'{self.tag}({self.value!r})'
+
+
+class Map(list):
+    """Items of a CBOR map as (key, value) pairs, keys may repeat"""
+
+    def __repr__(self):
+        return '{' + ', '.join(f'{k!r}: {v!r}' for k, v in self) + '}'
+
+
+# CBOR decoder
+
+def cbor_decode(data):
+    value, pos = cbor_item(data, 0)
+    if pos != len(data):
+        raise CborError(f'{len(data) - pos} B after the end of the item')
+    return value
+
+
+def cbor_item(data, pos):
+    if pos >= len(data):
+        raise CborError('truncated')
+
+    major, info = data[pos] >> 5, data[pos] & 0x1f
+    pos += 1
+
+    if major == 7:
+        if info == 20:
+            return False, pos
+        if info == 21:
+            return True, pos
+        if info == 22:
+            return None, pos
+        formats = {25: ('>e', 2), 26: ('>f', 4), 27: ('>d', 8)}
+        if info not in formats:
+            raise CborError(f'unsupported simple value {info}')
+        fmt, size = formats[info]
+        if pos + size > len(data):
+            raise CborError('truncated')
+        return struct.unpack(fmt, data[pos:pos + size])[0], pos + size
+
+    if info < 24:
+        arg = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        if pos + size > len(data):
+            raise CborError('truncated')
+        arg = int.from_bytes(data[pos:pos + size], 'big')
+        pos += size
+    else:
+        # Canonical zcbor does not encode indefinite lengths
+        raise CborError(f'unsupported additional information {info}')
+
+    if major == 0:
+        return arg, pos
+    if major == 1:
+        return -1 - arg, pos
+    if major in (2, 3):
+        if pos + arg > len(data):
+            raise CborError('truncated')
+        raw = bytes(data[pos:pos + arg])
+        if major == 2:
+            return raw, pos + arg
+        try:
+            return raw.decode(), pos + arg
+        except UnicodeDecodeError as e:
+            raise CborError(f'text string is not UTF-8: {e}')
+    if major == 4:
+        items = []
+        for _ in range(arg):
+            item, pos = cbor_item(data, pos)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        items = Map()
+        for _ in range(arg):
+            key, pos = cbor_item(data, pos)
+            value, pos = cbor_item(data, pos)
+            items.append((key, value))
+        return items, pos
+
+    value, pos = cbor_item(data, pos)
+    return Tag(arg, value), pos
+
+
+# CDDL parser
+
+TOKEN_RE = re.compile(r'''
+    (?P<space>\s+|;[^\n]*)
+  | (?P<tag>\#6\.(?P<tag_num>\d+))
+  | (?P<num>-?\d+)
+  | (?P<str>"[^"]*")
+  | (?P<ctl>\.size\b)
+  | (?P<punct>=>|\.\.|[=/{}\[\](),?*+:])
+  | (?P<id>[A-Za-z_][A-Za-z0-9_-]*)
+''', re.VERBOSE)
+
+
+def tokenize(text, name):
+    tokens = []
+    pos = 0
+    while pos < len(text):
+        m = TOKEN_RE.match(text, pos)
+        if not m:
+            line = text.count('\n', 0, pos) + 1
+            raise CddlError(f'{name}:{line}: unexpected {text[pos:pos + 10]!r}')
+        pos = m.end()
+        kind = m.lastgroup
+        if kind == 'space':
+            continue
+        if kind == 'tag':
+            tokens.append(('tag', int(m.group('tag_num'))))
+        elif kind == 'num':
+            tokens.append(('lit', int(m.group())))
+        elif kind == 'str':
+            tokens.append(('lit', m.group()[1:-1]))
+        elif kind == 'id' and m.group() in ('true', 'false'):
+            tokens.append(('lit', m.group() == 'true'))
+        else:
+            tokens.append((kind, m.group()))
+    return tokens
+
+
+class Parser:
+    def __init__(self, tokens, name):
+        self.tokens = tokens
+        self.pos = 0
+        self.name = name
+
+    def peek(self, offset=0):
+        pos = self.pos + offset
+        return self.tokens[pos] if pos < len(self.tokens) else (None, None)
+
+    def take(self, value=None):
+        token = self.peek()
+        if value is not None and token[1] != value:
+            raise CddlError(f'{self.name}: expected {value!r}, got {token[1]!r}')
+        self.pos += 1
+        return token
+
+    def rules(self):
+        rules = {}
+        while self.peek()[0] is not None:
+            kind, name = self.take()
+            if kind != 'id':
+                raise CddlError(f'{self.name}: expected rule name, got {name!r}')
+            self.take('=')
+            rules[name] = self.type()
+        return rules
+
+    def type(self):
+        choices = [self.type1()]
+        while self.peek()[1] == '/':
+            self.take()
+            choices.append(self.type1())
+        return choices[0] if len(choices) == 1 else ('choice', choices)
+
+    def type1(self):
+        t = self.type2()
+        if self.peek()[1] == '..':
+            self.take()
+            t = ('range', t, self.type2())
+        if self.peek()[0] == 'ctl':
+            self.take()
+            t = ('size', t, self.type2())
+        return t
+
+    def type2(self):
+        kind, value = self.take()
+        if kind == 'lit':
+            return ('lit', value)
+        if kind == 'id':
+            return ('prim', value) if value in PRIMITIVES else ('ref', value)
+        if kind == 'tag':
+            self.take('(')
+            t = self.type()
+            self.take(')')
+            return ('tag', value, t)
+        if value == '(':
+            t = self.type()
+            self.take(')')
+            return t
+        if value in ('{', '['):
+            entries = self.group('}' if value == '{' else ']')
+            return ('map' if value == '{' else 'array', entries)
+        raise CddlError(f'{self.name}: unexpected {value!r}')
+
+    def group(self, end):
+        entries = []
+        while self.peek()[1] != end:
+            occur = '1'
+            if self.peek()[1] in ('?', '*', '+'):
+                occur = self.take()[1]
+
+            key = None
+            if self.peek()[0] == 'id' and self.peek(1)[1] == ':':
+                # Bareword member key is a text string
+                key = ('lit', self.take()[1])
+                self.take(':')
+                value = self.type()
+            else:
+                value = self.type()
+                if self.peek()[1] == '=>':
+                    self.take()
+                    key, value = value, self.type()
+
+            entries.append((occur, key, value))
+            if self.peek()[1] == ',':
+                self.take()
+        self.take(end)
+        return entries
+
+
+def load_rules(cddl_dir):
+    rules = {}
+    for path in sorted(glob.glob(os.path.join(cddl_dir, '*.cddl'))):
+        name = os.path.relpath(path, REPO_DIR)
+        with open(path) as f:
+            for rule, t in Parser(tokenize(f.read(), name), name).rules().items():
+                # Files are standalone, so they may share a rule with the same definition
+                if rule in rules and rules[rule] != t:
+                    raise CddlError(f'{name}: rule {rule} defined differently')
+                rules[rule] = t
+    return rules
+
+
+# Validation
+
+def is_int(value):
+    return isinstance(value, int) and not isinstance(value, bool)
+
+
+def matches(rules, t, value):
+    kind = t[0]
+
+    if kind == 'ref':
+        if t[1] not in rules:
+            raise CddlError(f'undefined rule {t[1]}')
+        return matches(rules, rules[t[1]], value)
+    if kind == 'choice':
+        return any(matches(rules, c, value) for c in t[1])
+    if kind == 'lit':
+        return type(value) is type(t[1]) and value == t[1]
+    if kind == 'prim':
+        return {
+            'any': lambda v: True,
+            'uint': lambda v: is_int(v) and v >= 0,
+            'nint': lambda v: is_int(v) and v < 0,
+            'int': is_int,
+            'tstr': lambda v: isinstance(v, str),
+            'text': lambda v: isinstance(v, str),
+            'bstr': lambda v: isinstance(v, bytes),
+            'bytes': lambda v: isinstance(v, bytes),
+            'bool': lambda v: isinstance(v, bool),
+        }[t[1]](value)
+    if kind == 'range':
+        return is_int(value) and (t[1][1] <= value <= t[2][1])
+    if kind == 'size':
+        if not matches(rules, t[1], value):
+            return False
+        size = len(value.encode() if isinstance(value, str) else value)
+        return matches(rules, t[2], size)
+    if kind == 'tag':
+        return isinstance(value, Tag) and value.tag == t[1] and matches(rules, t[2], value.value)
+    if kind == 'array':
+        return isinstance(value, list) and not isinstance(value, Map) and \
+            array_matches(rules, t[1], value)
+    if kind == 'map':
+        return isinstance(value, Map) and not map_errors(rules, t[1], value)
+    raise CddlError(f'unsupported type {t}')
+
+
+def array_matches(rules, entries, items, start=0):
+    if not entries:
+        return start == len(items)
+
+    occur, _, t = entries[0]
+    min_num, max_num = {'1': (1, 1), '?': (0, 1), '*': (0, None), '+': (1, None)}[occur]
+    num = 0
+    pos = start
+    while True:
+        if num >= min_num and array_matches(rules, entries[1:], items, pos):
+            return True
+        if (max_num is not None and num >= max_num) or pos >= len(items) or \
+                not matches(rules, t, items[pos]):
+            return False
+        num += 1
+        pos += 1
+
+
+def map_errors(rules, entries, items):
+    errors = []
+    counts = [0] * len(entries)
+    keys = []
+
+    for key, value in items:
+        if key in keys:
+            errors.append(f'key {key!r} repeated')
+        keys.append(key)
+
+        for i, (_, k, v) in enumerate(entries):
+            if matches(rules, k, key) and matches(rules, v, value):
+                counts[i] += 1
+                break
+        else:
+            errors.append(f'{key!r}: {value!r} not allowed')
+
+    for (occur, key, _), count in zip(entries, counts):
+        if occur in ('1', '+') and count == 0:
+            errors.append(f'{describe(key)} missing')
+        if occur in ('1', '?') and count > 1:
+            errors.append(f'{describe(key)} present {count} times')
+
+    return errors
+
+
+def describe(t):
+    if t[0] == 'lit':
+        return repr(t[1])
+    if t[0] == 'choice':
+        return ' / '.join(describe(c) for c in t[1])
+    return t[1] if t[0] in ('ref', 'prim') else t[0]
+
+
+def check(rules, rule, data):
+    """Return the list of problems of a payload, empty if it matches the rule"""
+    try:
+        value = cbor_decode(data)
+    except CborError as e:
+        return [f'invalid CBOR: {e}']
+
+    t = rules[rule]
+    while t[0] == 'ref':
+        t = rules[t[1]]
+    if matches(rules, t, value):
+        return []
+    if t[0] == 'map' and isinstance(value, Map):
+        return map_errors(rules, t[1], value)
+    return [f'{value!r} does not match']
+
+
+def report(name, rule_names, errors):
+    status = 'ok' if not errors else 'FAIL'
+    print(f'{name:32} {" / ".join(rule_names):32} {status}')
+    for error in errors:
+        print(f'    {error}')
+    return bool(errors)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--commands', metavar='DIR',
+                        help='also check payload files from a directory like coap-commands')
+    parser.add_argument('--zcbor', metavar='DIR', help='sources of the zcbor module')
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'), help='host C compiler')
+    args = parser.parse_args()
+
+    rules = load_rules(CDDL_DIR)
+    for rule in set(ENCODER_RULES.values()) | {r for _, rs in COMMAND_RULES for r in rs}:
+        if rule is not None and rule not in rules:
+            raise CddlError(f'rule {rule} not found in {CDDL_DIR}')
+
+    with tempfile.TemporaryDirectory() as tmp:
+        profiles = [
+            ('', coap_frame_size.payloads(coap_frame_size.build(tmp, args.cc, args.zcbor, False))),
+            (' compact',
+             coap_frame_size.payloads(coap_frame_size.build(tmp, args.cc, args.zcbor, True))),
+        ]
+
+    failed = 0
+    checked = set()
+
+    for profile, payloads in profiles:
+        for encoder, data in payloads.items():
+            if encoder not in ENCODER_RULES:
+                failed += report(encoder + profile, ['?'], ['no rule in ENCODER_RULES'])
+                continue
+            rule = ENCODER_RULES[encoder]
+            if rule is None:
+                continue
+            checked.add(rule)
+            failed += report(encoder + profile, [rule], check(rules, rule, data))
+
+    if args.commands:
+        for name in sorted(os.listdir(args.commands)):
+            path = os.path.join(args.commands, name)
+            if not os.path.isfile(path):
+                continue
+            rule_names = next((rs for prefix, rs in COMMAND_RULES if name.startswith(prefix)),
+                              None)
+            if rule_names is None:
+                failed += report(name, ['?'], ['no rule in COMMAND_RULES'])
+                continue
+            if not rule_names:
+                continue
+            with open(path, 'rb') as f:
+                data = f.read()
+            results = [check(rules, rule, data) for rule in rule_names]
+            if any(not errors for errors in results):
+                checked.update(r for r, errors in zip(rule_names, results) if not errors)
+                results = [[]]
+            failed += report(name, rule_names, [e for errors in results for e in errors])
+
+    # Message rules are the ones not referenced by other rules
+    referenced = set()
+
+    def refs(t):
+        if t[0] == 'ref':
+            referenced.add(t[1])
+        for item in t[1:]:
+            if isinstance(item, tuple):
+                refs(item)
+            elif isinstance(item, list):
+                for sub in item:
+                    if isinstance(sub, tuple) and sub and isinstance(sub[0], str) and \
+                            sub[0] in ('1', '?', '*', '+'):
+                        for part in sub[1:]:
+                            if part is not None:
+                                refs(part)
+                    elif isinstance(sub, tuple):
+                        refs(sub)
+
+    for t in rules.values():
+        refs(t)
+    unchecked = sorted(set(rules) - referenced - checked)
+    if unchecked:
+        print(f'not checked: {", ".join(unchecked)}')
+
+    if failed:
+        print(f'{failed} payload(s) do not match the schema', file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
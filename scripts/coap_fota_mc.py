@@ -0,0 +1,404 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Distribute a firmware image to the multicast FOTA receivers of lib/coap_fota.c
+
+The image is announced with a CON POST /fota_mc to each receiver, and then pushed once to the
+group as NON POST /fota_mc requests with the Block1 option. Receivers fetch the blocks they missed
+from the repair URL with Block2 requests. The image can be served there by any CoAP server, or by
+this script with --serve when the URL points to this host, e.g.:
+
+$ ./scripts/coap_fota_mc.py build/temp_tscrn/zephyr/zephyr.signed.bin \\
+        --group ff03::f07a --url coap://[fd00:db8::1]/fota/temp_tscrn --serve \\
+        fd00:db8::1:2 fd00:db8::1:3
+
+The announced version is read from the MCUboot header of the image, receivers already running it
+respond 2.03 and do not join. Delta images cannot be distributed this way, because they are
+patched in order. Blocks of 32 B fit a single 802.15.4 frame when this host is not in the mesh
+(source address inline), 64 B blocks need a mesh-local source address.
+"""
+
+import argparse
+import os
+import random
+import select
+import socket
+import struct
+import sys
+import time
+import urllib.parse
+
+COAP_PORT = 5683
+COAP_VERSION = 1
+
+TYPE_CON = 0
+TYPE_NON = 1
+TYPE_ACK = 2
+TYPE_RST = 3
+
+CODE_POST = 0x02
+CODE_GET = 0x01
+CODE_CONTENT = 0x45
+CODE_NOT_FOUND = 0x84
+CODE_BAD_OPTION = 0x82
+
+OPT_ETAG = 4
+OPT_URI_PATH = 11
+OPT_CONTENT_FORMAT = 12
+OPT_BLOCK2 = 23
+OPT_BLOCK1 = 27
+OPT_SIZE2 = 28
+
+CF_CBOR = 60
+
+# Announcement keys of lib/coap_fota.c
+MC_VERSION_KEY = 'v'
+MC_GROUP_KEY = 'g'
+MC_URL_KEY = 'u'
+MC_SIZE_KEY = 's'
+MC_SZX_KEY = 'z'
+MC_ETAG_KEY = 'e'
+
+MC_PATH = 'fota_mc'
+MC_SZX_MIN = 1
+BLOCK_SZX_MAX = 2
+MAX_FOTA_ETAG_LEN = 8
+
+# RFC 7252 transmission parameters
+ACK_TIMEOUT = 2.0
+ACK_RANDOM_FACTOR = 1.5
+MAX_RETRANSMIT = 4
+
+# The last block starts the repair 2 s after it is received, instead of after 30 s without blocks
+LAST_BLOCK_REPEATS = 3
+
+MCUBOOT_MAGIC = 0x96f3b83d
+DELTA_MAGIC = b'ZDLT'
+
+
+def block_size(szx):
+    return 16 << szx
+
+
+def coap_uint(value):
+    return value.to_bytes((value.bit_length() + 7) // 8, 'big')
+
+
+def coap_option_nibble(value):
+    if value < 13:
+        return value, b''
+    if value < 269:
+        return 13, bytes([value - 13])
+    return 14, struct.pack('>H', value - 269)
+
+
+def coap_encode(msg_type, code, msg_id, token, options, payload=b''):
+    out = bytearray([COAP_VERSION << 6 | msg_type << 4 | len(token), code])
+    out += struct.pack('>H', msg_id) + token
+    last = 0
+    for number, value in sorted(options, key=lambda opt: opt[0]):
+        delta, delta_ext = coap_option_nibble(number - last)
+        length, length_ext = coap_option_nibble(len(value))
+        out += bytes([delta << 4 | length]) + delta_ext + length_ext + value
+        last = number
+    if payload:
+        out += b'\xff' + payload
+    return bytes(out)
+
+
+def coap_decode(data):
+    if len(data) < 4 or data[0] >> 6 != COAP_VERSION:
+        raise ValueError('Not a CoAP message')
+    msg_type = (data[0] >> 4) & 0x3
+    tkl = data[0] & 0xf
+    code = data[1]
+    msg_id = struct.unpack('>H', data[2:4])[0]
+    token = data[4:4 + tkl]
+    pos = 4 + tkl
+    options = []
+    number = 0
+    while pos < len(data) and data[pos] != 0xff:
+        delta, length = data[pos] >> 4, data[pos] & 0xf
+        pos += 1
+        values = []
+        for nibble in (delta, length):
+            if nibble == 13:
+                values.append(data[pos] + 13)
+                pos += 1
+            elif nibble == 14:
+                values.append(struct.unpack('>H', data[pos:pos + 2])[0] + 269)
+                pos += 2
+            elif nibble == 15:
+                raise ValueError('Invalid option')
+            else:
+                values.append(nibble)
+        number += values[0]
+        options.append((number, data[pos:pos + values[1]]))
+        pos += values[1]
+    payload = data[pos + 1:] if pos < len(data) else b''
+    return msg_type, code, msg_id, token, options, payload
+
+
+def code_str(code):
+    return f'{code >> 5}.{code & 0x1f:02d}'
+
+
+def cbor_head(major, value):
+    if value < 24:
+        return bytes([major << 5 | value])
+    for info, size in ((24, 1), (25, 2), (26, 4), (27, 8)):
+        if value < 1 << (8 * size):
+            return bytes([major << 5 | info]) + value.to_bytes(size, 'big')
+    raise ValueError('CBOR value too large')
+
+
+def cbor_encode(value):
+    if isinstance(value, int):
+        return cbor_head(0, value) if value >= 0 else cbor_head(1, -1 - value)
+    if isinstance(value, bytes):
+        return cbor_head(2, len(value)) + value
+    if isinstance(value, str):
+        return cbor_head(3, len(value.encode())) + value.encode()
+    if isinstance(value, dict):
+        return cbor_head(5, len(value)) + b''.join(cbor_encode(k) + cbor_encode(v)
+                                                   for k, v in value.items())
+    raise TypeError(f'Cannot encode {type(value)}')
+
+
+def image_version(image):
+    # struct image_header of MCUboot, the version matches CONFIG_MCUBOOT_IMGTOOL_SIGN_VERSION
+    if len(image) < 28 or struct.unpack('<I', image[:4])[0] != MCUBOOT_MAGIC:
+        return None
+    major, minor, revision, build = struct.unpack('<BBHI', image[20:28])
+    return f'{major}.{minor}.{revision}+{build}'
+
+
+def parse_url(url):
+    parsed = urllib.parse.urlsplit(url)
+    if parsed.scheme != 'coap' or not parsed.hostname or not parsed.path.strip('/'):
+        raise ValueError(f'Expected coap://[address]/path, got {url}')
+    return parsed.hostname, parsed.port or COAP_PORT, parsed.path.strip('/').split('/')
+
+
+class Distributor:
+    def __init__(self, image, group, url, szx, version, etag, port, hops):
+        self.image = image
+        self.group = group
+        self.url = url
+        self.szx = szx
+        self.version = version
+        self.etag = etag
+        self.port = port
+        self.msg_id = random.getrandbits(16)
+
+        self.sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_MULTICAST_HOPS, hops)
+
+    def next_msg_id(self):
+        self.msg_id = (self.msg_id + 1) & 0xffff
+        return self.msg_id
+
+    def announcement(self):
+        announce = {}
+        if self.version:
+            announce[MC_VERSION_KEY] = self.version
+        announce[MC_GROUP_KEY] = socket.inet_pton(socket.AF_INET6, self.group)
+        announce[MC_URL_KEY] = self.url
+        announce[MC_SIZE_KEY] = len(self.image)
+        announce[MC_SZX_KEY] = self.szx
+        if self.etag:
+            announce[MC_ETAG_KEY] = self.etag
+        return cbor_encode(announce)
+
+    def announce(self, node):
+        """Send the announcement to a receiver, return the response code or None"""
+        msg_id = self.next_msg_id()
+        token = os.urandom(4)
+        request = coap_encode(TYPE_CON, CODE_POST, msg_id, token,
+                              [(OPT_URI_PATH, MC_PATH.encode()),
+                               (OPT_CONTENT_FORMAT, coap_uint(CF_CBOR))],
+                              self.announcement())
+        timeout = ACK_TIMEOUT * random.uniform(1, ACK_RANDOM_FACTOR)
+
+        for _ in range(MAX_RETRANSMIT + 1):
+            self.sock.sendto(request, (node, self.port))
+            deadline = time.monotonic() + timeout
+            while True:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0 or not select.select([self.sock], [], [], remaining)[0]:
+                    break
+                try:
+                    msg_type, code, rsp_id, rsp_token, _, _ = coap_decode(self.sock.recv(1280))
+                except ValueError:
+                    continue
+                if msg_type == TYPE_RST and rsp_id == msg_id:
+                    return None
+                if msg_type == TYPE_ACK and rsp_id == msg_id and rsp_token == token:
+                    return code
+            timeout *= 2
+
+        return None
+
+    def push(self, interval, server=None):
+        size = block_size(self.szx)
+        num_blocks = (len(self.image) + size - 1) // size
+
+        for num in range(num_blocks):
+            more = num < num_blocks - 1
+            block1 = num << 4 | (0x08 if more else 0) | self.szx
+            request = coap_encode(TYPE_NON, CODE_POST, self.next_msg_id(), b'',
+                                  [(OPT_URI_PATH, MC_PATH.encode()),
+                                   (OPT_BLOCK1, coap_uint(block1))],
+                                  self.image[num * size:(num + 1) * size])
+            for _ in range(1 if more else LAST_BLOCK_REPEATS):
+                self.sock.sendto(request, (self.group, self.port))
+                wait(interval, server)
+
+            if num % 256 == 255 or not more:
+                print(f'pushed {num + 1}/{num_blocks} blocks', file=sys.stderr)
+
+
+class RepairServer:
+    """Serves the image with Block2 to the receivers fetching lost blocks"""
+
+    def __init__(self, image, path, port, etag):
+        self.image = image
+        self.path = path
+        self.etag = etag
+        self.requests = 0
+        self.sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM)
+        self.sock.bind(('::', port))
+
+    def handle(self):
+        data, addr = self.sock.recvfrom(1280)
+        try:
+            msg_type, code, msg_id, token, options, _ = coap_decode(data)
+        except ValueError:
+            return
+        if msg_type != TYPE_CON or code != CODE_GET:
+            return
+
+        path = [value.decode(errors='replace') for number, value in options
+                if number == OPT_URI_PATH]
+        block2 = [int.from_bytes(value, 'big') for number, value in options
+                  if number == OPT_BLOCK2]
+        rsp_options = []
+        payload = b''
+
+        if path != self.path:
+            rsp_code = CODE_NOT_FOUND
+        else:
+            num, szx = (block2[0] >> 4, block2[0] & 0x7) if block2 else (0, BLOCK_SZX_MAX)
+            szx = min(szx, BLOCK_SZX_MAX)
+            offset = num * block_size(szx)
+            if offset >= len(self.image) and offset > 0:
+                rsp_code = CODE_BAD_OPTION
+            else:
+                payload = self.image[offset:offset + block_size(szx)]
+                more = offset + len(payload) < len(self.image)
+                rsp_code = CODE_CONTENT
+                rsp_options.append((OPT_BLOCK2, coap_uint(num << 4 | (0x08 if more else 0) | szx)))
+                rsp_options.append((OPT_SIZE2, coap_uint(len(self.image))))
+                if self.etag:
+                    rsp_options.append((OPT_ETAG, self.etag))
+                self.requests += 1
+
+        self.sock.sendto(coap_encode(TYPE_ACK, rsp_code, msg_id, token, rsp_options, payload),
+                         addr)
+
+
+def wait(duration, server):
+    deadline = time.monotonic() + duration
+    while True:
+        remaining = deadline - time.monotonic()
+        if remaining <= 0:
+            return
+        if server and select.select([server.sock], [], [], remaining)[0]:
+            server.handle()
+        elif not server:
+            time.sleep(remaining)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('image', help='signed image to distribute')
+    parser.add_argument('nodes', nargs='+', help='addresses of the receivers')
+    parser.add_argument('--group', required=True, help='multicast address the image is pushed to')
+    parser.add_argument('--url', required=True, help='coap:// URL of the image for repairs')
+    parser.add_argument('--szx', type=int, default=MC_SZX_MIN,
+                        choices=range(MC_SZX_MIN, BLOCK_SZX_MAX + 1),
+                        help='block size exponent, block is 16 << SZX bytes (default: %(default)s)')
+    parser.add_argument('--version', help='announced version (default: from MCUboot header)')
+    parser.add_argument('--etag', help='ETag of the image at the repair URL, hex')
+    parser.add_argument('--interval', type=float, default=100,
+                        help='time between pushed blocks in ms (default: %(default)s)')
+    parser.add_argument('--hops', type=int, default=8,
+                        help='hop limit of pushed blocks (default: %(default)s)')
+    parser.add_argument('--port', type=int, default=COAP_PORT,
+                        help='CoAP port of the receivers (default: %(default)s)')
+    parser.add_argument('--serve', action='store_true',
+                        help='serve the image at the repair URL until no repair comes for --linger')
+    parser.add_argument('--linger', type=float, default=60,
+                        help='time in s to serve repairs after the push (default: %(default)s)')
+    args = parser.parse_args()
+
+    with open(args.image, 'rb') as f:
+        image = f.read()
+
+    if image[:len(DELTA_MAGIC)] == DELTA_MAGIC:
+        sys.exit('Delta images are patched in order and cannot be pushed to a group')
+
+    try:
+        _, repair_port, repair_path = parse_url(args.url)
+    except ValueError as e:
+        sys.exit(str(e))
+
+    etag = bytes.fromhex(args.etag) if args.etag else b''
+    if len(etag) > MAX_FOTA_ETAG_LEN:
+        sys.exit(f'ETag longer than {MAX_FOTA_ETAG_LEN} B')
+
+    version = args.version or image_version(image)
+    if not version:
+        print('No MCUboot header, announcing without version', file=sys.stderr)
+
+    distributor = Distributor(image, args.group, args.url, args.szx, version, etag, args.port,
+                              args.hops)
+    server = RepairServer(image, repair_path, repair_port, etag) if args.serve else None
+
+    joined = 0
+    for node in args.nodes:
+        code = distributor.announce(node)
+        if code is None:
+            status = 'no response'
+        elif code == 0x44:
+            status = 'joined'
+            joined += 1
+        elif code == 0x43:
+            status = 'already running the image'
+        elif code == 0xa3:
+            status = 'busy'
+        else:
+            status = f'refused ({code_str(code)})'
+        print(f'{node}: {status}')
+
+    if not joined:
+        sys.exit('No receiver joined the distribution')
+
+    distributor.push(args.interval / 1000, server)
+
+    if server:
+        # Receivers start repairing 2 s after the last block
+        while True:
+            served = server.requests
+            wait(args.linger, server)
+            if server.requests == served:
+                break
+        print(f'served {server.requests} repair blocks', file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Check that CoAP exchanges of the apps fit a single IEEE 802.15.4 frame
+
+Payloads are encoded by the prepare_*_payload() functions of the app sources, compiled for the host
+with scripts/coap_frame_size and sample data. The harness is built twice: with text keys
+(Content-Format 60) and with -DCOAP_COMPACT=1 (integer keys, Content-Format 65060), where responses
+are encoded as for a client sending Accept: 65060. The resulting 802.15.4 frame size is compared
+with the 127 B PHY limit. Messages which would need 6LoWPAN fragmentation make the script exit with
+an error, e.g.:
+
+$ ./scripts/coap_frame_size.py
+$ ./scripts/coap_frame_size.py --mesh --commands coap-commands
+$ ./scripts/coap_frame_size.py --zcbor ../modules/lib/zcbor
+
+Without --zcbor, the subset of zcbor from scripts/host/zcbor is used.
+
+Frame overhead model (Thread, secured MAC data frame):
+    MAC header 9 B (FCF, seq, PAN ID, short dst and src), aux security header 6 B, MIC 4 B,
+    FCS 2 B, optional mesh header 5 B, IPHC 2 B + 8 B for each inline unicast IID
+    (4 B for ff03::1 destination), UDP NHC 7 B. CoAP header 4 B with a 2 B token.
+"""
+
+import argparse
+import glob
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SCRIPT_DIR)
+HARNESS_DIR = os.path.join(SCRIPT_DIR, 'coap_frame_size')
+HOST_DIR = os.path.join(SCRIPT_DIR, 'host')
+ZCBOR_SUBSET_DIR = os.path.join(HOST_DIR, 'zcbor')
+
+# Kconfig values the sources need to compile, they do not change the payloads
+HOST_DEFINES = ['COAPS_PSK=0', 'CONFIG_DATA_ZONES=2', 'CONFIG_TEMP_RELAY_ZONE=1',
+                'CONFIG_PRJCNT_NUM_NTF_SINKS=2']
+
+FRAME_MAX = 127
+
+MAC_HDR = 9
+AUX_SEC_HDR = 6
+MIC = 4
+FCS = 2
+MESH_HDR = 5
+IPHC = 2
+IID_INLINE = 8
+MCAST_INLINE = 4
+UDP_NHC = 7
+
+TOKEN_LEN = 2
+
+OPT_URI_PATH = 11
+OPT_CONTENT_FORMAT = 12
+OPT_ACCEPT = 17
+
+CF_CBOR = 60
+CF_CBOR_COMPACT = 65060
+
+
+def build(out_dir, cc, zcbor, compact):
+    if zcbor:
+        zcbor_inc = os.path.join(zcbor, 'include')
+        zcbor_srcs = [os.path.join(zcbor, 'src', f'zcbor_{n}.c')
+                      for n in ('common', 'decode', 'encode')]
+    else:
+        zcbor_inc = os.path.join(ZCBOR_SUBSET_DIR, 'include')
+        zcbor_srcs = [os.path.join(ZCBOR_SUBSET_DIR, 'zcbor.c')]
+
+    # Handlers and threads of the sources are never called and are dropped with their references
+    cflags = ['-std=gnu11', '-O2', '-w', '-ffunction-sections', '-fdata-sections',
+              '-I', os.path.join(HOST_DIR, 'include'), '-I', zcbor_inc,
+              '-I', os.path.join(REPO_DIR, 'lib')]
+    cflags += [f'-D{d}' for d in HOST_DEFINES]
+    if compact:
+        cflags.append('-DCOAP_COMPACT=1')
+
+    # Every wrapper in HARNESS_DIR includes one source file of an app
+    srcs = sorted(glob.glob(os.path.join(HARNESS_DIR, '*.c')))
+    srcs += [os.path.join(REPO_DIR, 'lib', 'cbor_utils.c')] + zcbor_srcs
+
+    objs = []
+    for src in srcs:
+        obj = os.path.join(out_dir, f'{int(compact)}_{len(objs)}_{os.path.basename(src)}.o')
+        subprocess.run([cc] + cflags + ['-c', src, '-o', obj], check=True)
+        objs.append(obj)
+
+    exe = os.path.join(out_dir, 'compact' if compact else 'text')
+    subprocess.run([cc] + objs + ['-Wl,--gc-sections', '-o', exe], check=True)
+    return exe
+
+
+def payloads(exe):
+    result = subprocess.run([exe], capture_output=True, text=True)
+    sys.stderr.write(result.stderr)
+    if result.returncode:
+        raise RuntimeError(f'{os.path.basename(exe)}: {result.returncode} encoder(s) failed')
+
+    out = {}
+    for line in result.stdout.splitlines():
+        name, data = line.split(' ')
+        out[name] = bytes.fromhex(data)
+    return out
+
+
+def coap_option_nibble(value):
+    if value < 13:
+        return value, b''
+    if value < 269:
+        return 13, bytes([value - 13])
+    return 14, struct.pack('>H', value - 269)
+
+
+def coap_uint(value):
+    return value.to_bytes((value.bit_length() + 7) // 8, 'big')
+
+
+def coap_message(options, payload):
+    out = bytearray(4 + TOKEN_LEN)
+    last = 0
+    for number, value in sorted(options, key=lambda opt: opt[0]):
+        delta, delta_ext = coap_option_nibble(number - last)
+        length, length_ext = coap_option_nibble(len(value))
+        out += bytes([delta << 4 | length]) + delta_ext + length_ext + value
+        last = number
+    if payload:
+        out += b'\xff' + payload
+    return bytes(out)
+
+
+def frame_size(coap_len, multicast, mesh):
+    size = MAC_HDR + AUX_SEC_HDR + MIC + FCS + IPHC + UDP_NHC + coap_len
+    size += IID_INLINE + (MCAST_INLINE if multicast else IID_INLINE)
+    if mesh:
+        size += MESH_HDR
+    return size
+
+
+# (description, URI path, compact URI path, multicast, sends Accept, uses compact Content-Format,
+#  encoder in the harness). The ventilation unit is not ours and always gets Content-Format 60.
+EXCHANGES = [
+    ('sd request', ['sd'], ['sd'], True, True, True, 'sd_req'),
+    ('sd response', None, None, False, False, True, 'sd_rsp'),
+    ('prjcnt projector state', ['bedroom', 'prj'], ['bedroom', 'p'],
+     True, False, True, 'prjcnt_prj'),
+    ('temp_tscrn projector response', None, None, False, False, True, 'temp_tscrn_prj'),
+    ('temp_tscrn shades value', ['bedroom'], ['bedroom'], False, False, True, 'temp_tscrn_shades'),
+    ('shcnt value response', None, None, False, False, True, 'shcnt_val'),
+    ('temp_tscrn light colors', ['living'], ['living'], False, False, True, 'temp_tscrn_light'),
+    ('rgbw colors response', None, None, False, False, True, 'rgbw_colors'),
+    ('switch preset', ['living'], ['living'], False, False, True, 'switch_preset'),
+    ('temp_tscrn remote output', ['out'], ['out'], False, False, True, 'temp_tscrn_rmt_out'),
+    ('temp_tscrn ventilation', ['ap'], ['ap'], False, False, False, 'temp_tscrn_vent'),
+    ('temp_tscrn temperature response', None, None, False, False, True, 'temp_tscrn_temp'),
+    ('accnt temperature response', None, None, False, False, True, 'accnt_temp'),
+]
+
+
+def exchange_size(exchange, payload, compact, mesh):
+    _, path, compact_path, multicast, accept, compact_cf, _ = exchange
+    options = []
+    for segment in (compact_path if compact else path) or []:
+        options.append((OPT_URI_PATH, segment.encode()))
+    cf = CF_CBOR_COMPACT if compact and compact_cf else CF_CBOR
+    options.append((OPT_CONTENT_FORMAT, coap_uint(cf)))
+    if accept and compact:
+        options.append((OPT_ACCEPT, coap_uint(CF_CBOR_COMPACT)))
+    coap_len = len(coap_message(options, payload))
+    return coap_len, frame_size(coap_len, multicast, mesh)
+
+
+def command_file_size(path, mesh):
+    # Files in coap-commands are raw payloads posted with coap-client
+    with open(path, 'rb') as f:
+        payload = f.read()
+    options = [(OPT_URI_PATH, os.path.basename(path).encode()),
+               (OPT_CONTENT_FORMAT, coap_uint(CF_CBOR))]
+    coap_len = len(coap_message(options, payload))
+    return coap_len, frame_size(coap_len, False, mesh)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--mesh', action='store_true',
+                        help='include 6LoWPAN mesh header used by multi-hop forwarding')
+    parser.add_argument('--commands', metavar='DIR',
+                        help='also measure payload files from a directory like coap-commands')
+    parser.add_argument('--zcbor', metavar='DIR', help='sources of the zcbor module')
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'), help='host C compiler')
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        text = payloads(build(tmp, args.cc, args.zcbor, False))
+        compact = payloads(build(tmp, args.cc, args.zcbor, True))
+
+    oversized = 0
+
+    print(f'{"exchange":36} {"coap":>5} {"frame":>6} {"compact":>8} {"frame":>6}')
+    for exchange in EXCHANGES:
+        encoder = exchange[-1]
+        coap_len, frame = exchange_size(exchange, text[encoder], False, args.mesh)
+        c_coap_len, c_frame = exchange_size(exchange, compact[encoder], True, args.mesh)
+        mark = ' !' if max(frame, c_frame) > FRAME_MAX else ''
+        oversized += bool(mark)
+        print(f'{exchange[0]:36} {coap_len:5} {frame:6} {c_coap_len:8} {c_frame:6}{mark}')
+
+    if args.commands:
+        for name in sorted(os.listdir(args.commands)):
+            path = os.path.join(args.commands, name)
+            if not os.path.isfile(path):
+                continue
+            coap_len, frame = command_file_size(path, args.mesh)
+            mark = ' !' if frame > FRAME_MAX else ''
+            oversized += bool(mark)
+            print(f'{name:36} {coap_len:5} {frame:6}{mark}')
+
+    if oversized:
+        print(f'{oversized} message(s) exceed {FRAME_MAX} B frame', file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
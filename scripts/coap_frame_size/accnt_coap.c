@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Responses of accnt/src/coap.c
+
+#include "payloads.h"
+
+// Defined by every app
+#define coap_init accnt_coap_init
+#define prov_get_rsrc_label accnt_prov_get_rsrc_label
+
+#include "../../accnt/src/coap.c"
+
+int ds21_get_temperature(struct ds21_temperature *temp)
+{
+	temp->internal = 215;
+	temp->external = -35;
+	return 0;
+}
+
+const char *prov_get_rsrc_label(void)
+{
+	return "ac";
+}
+
+int payload_accnt_temp(uint8_t *payload, size_t len)
+{
+	return prepare_temp_payload(payload, len, IS_ENABLED(COAP_COMPACT));
+}
+
+int payload_accnt_prov(uint8_t *payload, size_t len)
+{
+	return prepare_prov_payload(payload, len);
+}
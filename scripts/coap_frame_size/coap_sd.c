@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Service discovery encoders of lib/coap_sd.c
+
+#include "payloads.h"
+
+#include "../../lib/coap_sd.c"
+
+int payload_sd_req(uint8_t *payload, size_t len)
+{
+	return prepare_sd_req_payload(payload, len, NULL, "shcnt");
+}
+
+int payload_sd_rsp(uint8_t *payload, size_t len)
+{
+	coap_sd_server_clear_all_rsrcs();
+	coap_sd_server_register_rsrc("bedroom", "shcnt");
+	coap_sd_server_register_rsrc("living", "shcnt");
+
+	return prepare_sd_rsp_payload(payload, len, IS_ENABLED(COAP_COMPACT));
+}
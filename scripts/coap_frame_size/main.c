@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Dump of CoAP payloads encoded by the app sources, built on the host by
+ * scripts/coap_frame_size.py. Every line is the name of an encoder and the payload in hex.
+ * The exit code is non-zero if any encoder fails.
+ */
+
+#include <stdio.h>
+
+#include "payloads.h"
+
+#define PAYLOAD_MAX 256
+
+static const struct {
+	const char *name;
+	int (*encode)(uint8_t *payload, size_t len);
+} encoders[] = {
+	{ "sd_req", payload_sd_req },
+	{ "sd_rsp", payload_sd_rsp },
+	{ "prjcnt_prj", payload_prjcnt_prj },
+	{ "prjcnt_prov", payload_prjcnt_prov },
+	{ "temp_tscrn_temp", payload_temp_tscrn_temp },
+	{ "temp_tscrn_prj", payload_temp_tscrn_prj },
+	{ "temp_tscrn_light", payload_temp_tscrn_light },
+	{ "temp_tscrn_shades", payload_temp_tscrn_shades },
+	{ "temp_tscrn_rmt_out", payload_temp_tscrn_rmt_out },
+	{ "temp_tscrn_vent", payload_temp_tscrn_vent },
+	{ "temp_tscrn_prov", payload_temp_tscrn_prov },
+	{ "shcnt_val", payload_shcnt_val },
+	{ "shcnt_prov", payload_shcnt_prov },
+	{ "rgbw_colors", payload_rgbw_colors },
+	{ "rgbw_prov", payload_rgbw_prov },
+	{ "switch_preset", payload_switch_preset },
+	{ "switch_prov", payload_switch_prov },
+	{ "accnt_temp", payload_accnt_temp },
+	{ "accnt_prov", payload_accnt_prov },
+};
+
+int main(void)
+{
+	int failures = 0;
+
+	for (size_t i = 0; i < sizeof(encoders) / sizeof(encoders[0]); ++i) {
+		uint8_t payload[PAYLOAD_MAX];
+		int len = encoders[i].encode(payload, sizeof(payload));
+
+		if (len < 0) {
+			fprintf(stderr, "%s: error %d\n", encoders[i].name, len);
+			failures++;
+			continue;
+		}
+
+		printf("%s ", encoders[i].name);
+		for (int j = 0; j < len; ++j) {
+			printf("%02x", payload[j]);
+		}
+		printf("\n");
+	}
+
+	return failures;
+}
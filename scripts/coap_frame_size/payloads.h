@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef COAP_FRAME_SIZE_PAYLOADS_H_
+#define COAP_FRAME_SIZE_PAYLOADS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Payload encoders of the app sources, called with sample data. Every function returns the length
+ * of the payload or a negative error code like the prepare_*_payload() function it wraps. With
+ * COAP_COMPACT defined, responses are encoded as for a client sending Accept: 65060.
+ */
+int payload_sd_req(uint8_t *payload, size_t len);
+int payload_sd_rsp(uint8_t *payload, size_t len);
+int payload_prjcnt_prj(uint8_t *payload, size_t len);
+int payload_prjcnt_prov(uint8_t *payload, size_t len);
+int payload_temp_tscrn_temp(uint8_t *payload, size_t len);
+int payload_temp_tscrn_prj(uint8_t *payload, size_t len);
+int payload_temp_tscrn_light(uint8_t *payload, size_t len);
+int payload_temp_tscrn_shades(uint8_t *payload, size_t len);
+int payload_temp_tscrn_rmt_out(uint8_t *payload, size_t len);
+int payload_temp_tscrn_vent(uint8_t *payload, size_t len);
+int payload_temp_tscrn_prov(uint8_t *payload, size_t len);
+int payload_shcnt_val(uint8_t *payload, size_t len);
+int payload_shcnt_prov(uint8_t *payload, size_t len);
+int payload_rgbw_colors(uint8_t *payload, size_t len);
+int payload_rgbw_prov(uint8_t *payload, size_t len);
+int payload_switch_preset(uint8_t *payload, size_t len);
+int payload_switch_prov(uint8_t *payload, size_t len);
+int payload_accnt_temp(uint8_t *payload, size_t len);
+int payload_accnt_prov(uint8_t *payload, size_t len);
+
+#endif // COAP_FRAME_SIZE_PAYLOADS_H_
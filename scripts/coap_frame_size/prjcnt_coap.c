@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Responses of prjcnt/src/coap.c
+
+#include "payloads.h"
+
+// Defined by every app
+#define coap_init prjcnt_coap_init
+#define prov_get_rsrc_label prjcnt_prov_get_rsrc_label
+
+#include "../../prjcnt/src/coap.c"
+
+const char *prov_get_rsrc_label(void)
+{
+	return "prj";
+}
+
+const char *prov_get_out_label(int id)
+{
+	static const char * const labels[] = { "bedrm", "livrm" };
+
+	return (id < ARRAY_SIZE(labels)) ? labels[id] : "";
+}
+
+int payload_prjcnt_prov(uint8_t *payload, size_t len)
+{
+	return prepare_prov_payload(payload, len);
+}
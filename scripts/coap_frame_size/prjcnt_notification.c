@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Projector state notification of prjcnt/src/notification.c
+
+#include "payloads.h"
+
+#include "../../prjcnt/src/notification.c"
+
+int payload_prjcnt_prj(uint8_t *payload, size_t len)
+{
+	return prepare_req_payload(payload, len, true);
+}
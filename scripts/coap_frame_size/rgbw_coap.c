@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Responses of rgbw/src/coap.c
+
+#include "payloads.h"
+
+// Defined by every app
+#define coap_init rgbw_coap_init
+#define prov_get_rsrc_label rgbw_prov_get_rsrc_label
+
+#include "../../rgbw/src/coap.c"
+
+int led_get(leds_brightness *leds)
+{
+	*leds = (leds_brightness){ .r = 255, .g = 255, .b = 255, .w = 255 };
+	return 0;
+}
+
+const char *prov_get_rsrc_label(void)
+{
+	return "bent";
+}
+
+int prov_get_preset(int preset_id, struct prov_leds_brightness *leds)
+{
+	// Two presets stored
+	if (preset_id >= 2) {
+		return -ENOENT;
+	}
+
+	*leds = (struct prov_leds_brightness){ .r = 255, .g = 93, .b = 44, .w = preset_id };
+	return 0;
+}
+
+int payload_rgbw_colors(uint8_t *payload, size_t len)
+{
+	return prepare_rgb_payload(payload, len, IS_ENABLED(COAP_COMPACT));
+}
+
+int payload_rgbw_prov(uint8_t *payload, size_t len)
+{
+	return prepare_prov_payload(payload, len);
+}
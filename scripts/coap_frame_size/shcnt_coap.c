@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Responses of shcnt/src/coap.c
+
+#include "payloads.h"
+
+// Defined by every app
+#define coap_init shcnt_coap_init
+#define prov_get_rsrc_label shcnt_prov_get_rsrc_label
+
+#include "../../shcnt/src/coap.c"
+
+static int get_pos(const struct device *dev)
+{
+	(void)dev;
+	return MOT_CNT_MAX;
+}
+
+static const struct mot_cnt_api mot_api = {
+	.get_pos = get_pos,
+};
+
+const struct device __device_m0 = { .api = &mot_api };
+const struct device __device_m1 = { .api = &mot_api };
+
+int pos_srv_get(int id, int *req, int *override, bool *prj)
+{
+	(void)id;
+	*req = MOT_CNT_MAX;
+	*override = MOT_CNT_STOP;
+	*prj = false;
+	return 0;
+}
+
+const char *prov_get_rsrc_label(int id)
+{
+	return id ? "shd1" : "shd0";
+}
+
+int prov_get_rsrc_duration(int id)
+{
+	(void)id;
+	return MOT_CNT_DEFAULT_TIME;
+}
+
+int prov_get_swing_interval(int id)
+{
+	(void)id;
+	return 500;
+}
+
+int payload_shcnt_val(uint8_t *payload, size_t len)
+{
+	return prepare_rsrc_payload(payload, len, 0, IS_ENABLED(COAP_COMPACT));
+}
+
+int payload_shcnt_prov(uint8_t *payload, size_t len)
+{
+	return prepare_prov_payload(payload, len);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Responses of switch/src/coap.c
+
+#include "payloads.h"
+
+// Defined by every app
+#define coap_init switch_coap_init
+#define prov_get_rsrc_label switch_prov_get_rsrc_label
+
+#include "../../switch/src/coap.c"
+
+const char *prov_get_rsrc_label(int rsrc_id)
+{
+	return rsrc_id ? "sw1" : "sw0";
+}
+
+const char *prov_get_output_rsrc_label(int rsrc_id)
+{
+	return rsrc_id ? "livrm" : "bedrm";
+}
+
+bool prov_get_analog_enabled(int rsrc_id)
+{
+	return rsrc_id == 0;
+}
+
+int prov_get_analog_threshold(int rsrc_id)
+{
+	(void)rsrc_id;
+	return 65535;
+}
+
+bool prov_get_monostable(void)
+{
+	return true;
+}
+
+int payload_switch_prov(uint8_t *payload, size_t len)
+{
+	return prepare_prov_payload(payload, len);
+}
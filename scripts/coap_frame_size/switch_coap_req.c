@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Preset request of switch/src/coap_req.c
+
+#include "payloads.h"
+
+#include "../../switch/src/coap_req.c"
+
+int payload_switch_preset(uint8_t *payload, size_t len)
+{
+	return prepare_req_payload(payload, len, 3);
+}
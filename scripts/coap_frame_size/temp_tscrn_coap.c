@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Responses of temp_tscrn/src/coap.c
+
+#include "payloads.h"
+
+// Defined by every app
+#define coap_init temp_tscrn_coap_init
+#define prov_get_rsrc_label temp_tscrn_prov_get_rsrc_label
+
+#include "../../temp_tscrn/src/coap.c"
+
+void data_dispatcher_get(data_t type, data_loc_t loc, data_dispatcher_publish_t *data)
+{
+	*data = (data_dispatcher_publish_t){ .loc = loc, .type = type };
+
+	switch (type) {
+	case DATA_TEMP_MEASUREMENT:
+		data->temp_measurement = 215;
+		break;
+	case DATA_TEMP_SETTING:
+		data->temp_setting = 205;
+		break;
+	case DATA_OUTPUT:
+		data->output = 1000;
+		break;
+	case DATA_CONTROLLER:
+		data->controller.mode = DATA_CTLR_PID;
+		data->controller.p = 2048;
+		data->controller.i = 255;
+		break;
+	case DATA_PRJ_ENABLED:
+		data->prj_validity = 120000;
+		break;
+	default:
+		break;
+	}
+}
+
+const char *prov_get_rsrc_label(data_loc_t loc)
+{
+	static const char * const labels[] = { "bedrm", "livrm" };
+
+	return (loc < ARRAY_SIZE(labels)) ? labels[loc] : "";
+}
+
+const char *prov_get_output_label(data_loc_t loc)
+{
+	static const char * const labels[] = { "out0", "out1" };
+
+	return (loc < ARRAY_SIZE(labels)) ? labels[loc] : "";
+}
+
+int payload_temp_tscrn_temp(uint8_t *payload, size_t len)
+{
+	return prepare_temp_payload(payload, len, 0, IS_ENABLED(COAP_COMPACT));
+}
+
+int payload_temp_tscrn_prj(uint8_t *payload, size_t len)
+{
+	return prepare_prj_payload(payload, len, 0, IS_ENABLED(COAP_COMPACT));
+}
+
+int payload_temp_tscrn_prov(uint8_t *payload, size_t len)
+{
+	return prepare_prov_payload(payload, len);
+}
@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Light request of temp_tscrn/src/light_conn.c
+
+#include "payloads.h"
+
+#include "../../temp_tscrn/src/light_conn.c"
+
+int payload_temp_tscrn_light(uint8_t *payload, size_t len)
+{
+	data_light_t light = { .r = 255, .g = 255, .b = 255, .w = 255 };
+
+	return prepare_req_payload(payload, len, &light);
+}
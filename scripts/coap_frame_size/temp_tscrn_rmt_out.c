@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Remote output request of temp_tscrn/src/rmt_out.c
+
+#include "payloads.h"
+
+#include "../../temp_tscrn/src/rmt_out.c"
+
+int payload_temp_tscrn_rmt_out(uint8_t *payload, size_t len)
+{
+	return prepare_req_payload(payload, len, OUT_MAX);
+}
@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Shades request of temp_tscrn/src/shades_conn.c
+
+#include "payloads.h"
+
+#include "../../temp_tscrn/src/shades_conn.c"
+
+int payload_temp_tscrn_shades(uint8_t *payload, size_t len)
+{
+	return prepare_req_payload(payload, len, 255);
+}
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Check batched display co-processor commands against a fake FT800
+
+temp_tscrn/src/copro_buf.c is compiled unchanged for the host with scripts/copro_buf_check/check.c,
+which emulates RAM_CMD and the FIFO registers of the co-processor. It checks encoding of every
+command, wrapping of the ring, data longer than the buffer and RAM_CMD, and recovery from SPI
+errors, co-processor faults and a stuck co-processor. The check is built for every buffer size
+given:
+
+$ ./scripts/copro_buf_check.py --buf-size 64,1024,4092
+
+The exit code is non-zero if any check fails.
+
+Then the shade control frame of temp_tscrn/src/display.c is built by scripts/copro_buf_check/frame.c
+with CONFIG_TEMP_DISPLAY_CMD_BATCH enabled and disabled, and with the defaults of the other options
+of temp_tscrn/Kconfig. SPI transactions and bytes per frame are printed for each page of shades,
+counted by a fake FT800 bus. Commands are written field by field without batching, as the ft8xx
+driver of Zephyr does.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from ctlr_bench import kconfig_defaults
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SCRIPT_DIR)
+HARNESS_DIR = os.path.join(SCRIPT_DIR, 'copro_buf_check')
+APP_DIR = os.path.join(REPO_DIR, 'temp_tscrn')
+
+# A co-processor wait that is not bounded hangs the check
+TIMEOUT_S = 10
+
+
+def build(out_dir, cc, buf_size):
+    exe = os.path.join(out_dir, f'check_{buf_size}')
+    subprocess.run([cc, '-O2', '-Wall',
+                    '-DCONFIG_TEMP_DISPLAY_CMD_BATCH=1',
+                    f'-DCONFIG_TEMP_DISPLAY_CMD_BUF_SIZE={buf_size}',
+                    '-I', os.path.join(SCRIPT_DIR, 'host', 'include'),
+                    '-I', os.path.join(REPO_DIR, 'temp_tscrn', 'src'),
+                    os.path.join(HARNESS_DIR, 'check.c'),
+                    '-o', exe], check=True)
+    return exe
+
+
+def build_assets(out_dir):
+    """Generate ft8xx_assets.h from the FT8XX_ASSETS list of the app CMakeLists.txt"""
+    with open(os.path.join(APP_DIR, 'CMakeLists.txt')) as f:
+        assets = re.search(r'set\(FT8XX_ASSETS\s+([^)]+)\)', f.read()).group(1)
+    assets = assets.replace('${CMAKE_CURRENT_SOURCE_DIR}', APP_DIR).split()
+    subprocess.run([sys.executable, os.path.join(SCRIPT_DIR, 'ft8xx_assets.py'),
+                    '--output', os.path.join(out_dir, 'ft8xx_assets.h')] + assets, check=True)
+
+
+def build_frame(out_dir, cc, batch):
+    exe = os.path.join(out_dir, f'frame_{batch}')
+    config = kconfig_defaults(os.path.join(APP_DIR, 'Kconfig'), {})
+    config['TEMP_DISPLAY_CMD_BATCH'] = batch
+    # display.c is built whole, the linker drops what the frame does not use
+    subprocess.run([cc, '-O2', '-w', '-ffunction-sections', '-fdata-sections',
+                    '-Wl,--gc-sections'] +
+                   [f'-DCONFIG_{k}={v}' for k, v in config.items()] +
+                   ['-I', os.path.join(SCRIPT_DIR, 'host', 'include'),
+                    '-I', os.path.join(APP_DIR, 'src'),
+                    '-I', os.path.join(REPO_DIR, 'lib'),
+                    '-I', out_dir,
+                    os.path.join(HARNESS_DIR, 'frame.c'),
+                    os.path.join(APP_DIR, 'src', 'copro_buf.c'),
+                    '-o', exe], check=True)
+    return exe
+
+
+def frame_traffic(out_dir, cc):
+    build_assets(out_dir)
+    pages = {}
+    for batch in (1, 0):
+        result = subprocess.run([build_frame(out_dir, cc, batch)], capture_output=True,
+                                text=True, check=True, timeout=TIMEOUT_S)
+        for line in result.stdout.splitlines():
+            _, page, _, transactions, _, size, _, cmd_bytes = line.split()
+            pages.setdefault(int(page), {})[batch] = \
+                (float(transactions), float(size), float(cmd_bytes))
+
+    print('shade control frame, SPI traffic per frame')
+    print(f'{"page":>4} {"cmd B":>6} {"batched":>8} {"bytes":>7} {"unbatched":>9} {"bytes":>7}')
+    for page, r in sorted(pages.items()):
+        print(f'{page:4} {r[1][2]:6.0f} {r[1][0]:8.1f} {r[1][1]:7.1f} {r[0][0]:9.1f} '
+              f'{r[0][1]:7.1f}')
+
+
+def int_list(value):
+    return [int(v) for v in value.split(',')]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--buf-size', type=int_list, default=[64, 1024, 4092],
+                        help='CONFIG_TEMP_DISPLAY_CMD_BUF_SIZE values, comma separated')
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'), help='host C compiler')
+    args = parser.parse_args()
+
+    failed = False
+    with tempfile.TemporaryDirectory() as tmp:
+        for buf_size in args.buf_size:
+            exe = build(tmp, args.cc, buf_size)
+            try:
+                result = subprocess.run([exe], capture_output=True, text=True,
+                                        timeout=TIMEOUT_S)
+            except subprocess.TimeoutExpired:
+                print(f'buffer {buf_size} bytes: timeout')
+                failed = True
+                continue
+
+            sys.stdout.write(result.stdout)
+            failed |= result.returncode != 0
+
+        frame_traffic(tmp, args.cc)
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
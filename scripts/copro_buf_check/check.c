@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Check of temp_tscrn/src/copro_buf.c against a fake FT800, built on the host by
+ * scripts/copro_buf_check.py.
+ *
+ * The fake co-processor consumes RAM_CMD from REG_CMD_READ to REG_CMD_WRITE, a few bytes every
+ * time REG_CMD_READ is polled. The stream of consumed bytes is compared with the expected
+ * commands. Writes over commands not consumed yet, failed SPI transfers, co-processor faults and
+ * a stuck co-processor are checked too. Failures are printed, the exit code is their number.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "copro_buf.c"
+
+#define REG_CPURESET_ADDR 0x10241cUL
+
+static uint8_t ram_cmd[FIFO_SIZE];
+static uint16_t reg_cmd_read;
+static uint16_t reg_cmd_write;
+static bool in_reset;
+
+// Bytes consumed by every REG_CMD_READ poll, 0 if the co-processor is stuck
+static unsigned int drain;
+static bool fault;
+
+// Index of the SPI transfer to fail, -1 if none
+static int fail_xfer;
+static int xfers;
+static unsigned int resets;
+static uint32_t now_ms;
+
+// Commands consumed by the co-processor since the last reset
+static uint8_t stream[16384];
+static size_t stream_len;
+
+static uint8_t expected[16384];
+static size_t expected_len;
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                           \
+	do {                                                                                       \
+		if (!(cond)) {                                                                     \
+			printf("%s:%d: ", __func__, __LINE__);                                     \
+			printf(__VA_ARGS__);                                                       \
+			printf("\n");                                                              \
+			failures++;                                                                \
+		}                                                                                  \
+	} while (0)
+
+// Virtual time of the check, one cycle per millisecond
+int32_t k_sleep(k_timeout_t timeout)
+{
+	now_ms += timeout.ms;
+
+	return 0;
+}
+
+uint32_t k_cycle_get_32(void)
+{
+	return now_ms;
+}
+
+static uint16_t pending(void)
+{
+	return (reg_cmd_write - reg_cmd_read) & FIFO_MASK;
+}
+
+static void consume(size_t len)
+{
+	len = MIN(len, pending());
+
+	for (size_t i = 0; i < len; i++) {
+		if (stream_len < sizeof(stream)) {
+			stream[stream_len++] = ram_cmd[reg_cmd_read];
+		}
+		reg_cmd_read = (reg_cmd_read + 1) & FIFO_MASK;
+	}
+}
+
+int spi_write_dt(const struct spi_dt_spec *spec, const struct spi_buf_set *tx)
+{
+	const uint8_t *hdr = tx->buffers[0].buf;
+	const uint8_t *data = tx->buffers[1].buf;
+	size_t len = tx->buffers[1].len;
+	uint32_t addr = ((hdr[0] & 0x3fUL) << 16) | (hdr[1] << 8) | hdr[2];
+	bool fail = (xfers++ == fail_xfer);
+
+	(void)spec;
+
+	CHECK(tx->count == 2 && tx->buffers[0].len == 3, "unexpected transfer layout");
+	CHECK(hdr[0] & FT800_MEM_WRITE, "transfer is not a memory write");
+	CHECK(!in_reset, "transfer during co-processor reset");
+
+	if (fail) {
+		// Part of the data reaches the display before the error is detected
+		len /= 2;
+	}
+
+	CHECK(addr >= RAM_CMD && addr + len <= RAM_CMD + FIFO_SIZE,
+	      "write of %zu bytes at 0x%06x outside of RAM_CMD", len, addr);
+
+	for (size_t i = 0; i < len; i++) {
+		uint16_t offset = (addr - RAM_CMD + i) & FIFO_MASK;
+
+		CHECK(((offset - reg_cmd_read) & FIFO_MASK) >= pending(),
+		      "write at offset %u overwrites pending commands", offset);
+		ram_cmd[offset] = data[i];
+	}
+
+	return fail ? -EIO : 0;
+}
+
+void ft8xx_wr8(uint32_t address, uint8_t data)
+{
+	CHECK(address == REG_CPURESET_ADDR, "unexpected write of 0x%06x", address);
+
+	if (data) {
+		in_reset = true;
+		resets++;
+	} else {
+		CHECK(reg_cmd_read == 0 && reg_cmd_write == 0, "FIFO not cleared by the reset");
+		in_reset = false;
+		fault = false;
+		stream_len = 0;
+	}
+}
+
+void ft8xx_wr16(uint32_t address, uint16_t data)
+{
+	if (address == REG_CMD_READ) {
+		CHECK(in_reset, "REG_CMD_READ written out of reset");
+		reg_cmd_read = data;
+	} else if (address == REG_CMD_WRITE) {
+		CHECK(data % 4 == 0, "REG_CMD_WRITE %u not aligned", data);
+		CHECK(in_reset || ((data - reg_cmd_read) & FIFO_MASK) <= FIFO_MAX_FILL,
+		      "REG_CMD_WRITE %u overruns REG_CMD_READ %u", data, reg_cmd_read);
+		reg_cmd_write = data;
+	} else {
+		CHECK(false, "unexpected write of 0x%06x", address);
+	}
+}
+
+uint16_t ft8xx_rd16(uint32_t address)
+{
+	if (address == REG_CMD_READ) {
+		if (fault) {
+			return FIFO_FAULT;
+		}
+
+		consume(drain);
+		return reg_cmd_read;
+	}
+
+	if (address == REG_CMD_WRITE) {
+		return reg_cmd_write;
+	}
+
+	CHECK(false, "unexpected read of 0x%06x", address);
+	return 0;
+}
+
+static void fake_reset(uint16_t offset, unsigned int drain_per_poll)
+{
+	reg_cmd_read = offset;
+	reg_cmd_write = offset;
+	in_reset = false;
+	drain = drain_per_poll;
+	fault = false;
+	fail_xfer = -1;
+	xfers = 0;
+	resets = 0;
+	now_ms = 0;
+	stream_len = 0;
+	expected_len = 0;
+
+	copro_buf_init();
+	copro_buf_wait_cycles();
+}
+
+static void exp32(uint32_t value)
+{
+	sys_put_le32(value, &expected[expected_len]);
+	expected_len += 4;
+}
+
+static void exp16x2(uint16_t first, uint16_t second)
+{
+	exp32(first | ((uint32_t)second << 16));
+}
+
+static void exp_data(const void *data, size_t len)
+{
+	memcpy(&expected[expected_len], data, len);
+	memset(&expected[expected_len + len], 0, ROUND_UP(len, 4) - len);
+	expected_len += ROUND_UP(len, 4);
+}
+
+static void check_stream(const char *name)
+{
+	consume(FIFO_SIZE);
+
+	CHECK(stream_len == expected_len, "%s: %zu bytes consumed, %zu expected", name,
+	      stream_len, expected_len);
+	CHECK(memcmp(stream, expected, MIN(stream_len, expected_len)) == 0,
+	      "%s: consumed commands differ", name);
+}
+
+// Every command, starting at the given offset of RAM_CMD
+static void check_commands(uint16_t offset)
+{
+	int ret;
+
+	fake_reset(offset, 0);
+
+	copro_buf_dlstart();
+	exp32(CMD_DLSTART);
+	copro_buf_bgcolor(0x102030);
+	exp32(CMD_BGCOLOR);
+	exp32(0x102030);
+	copro_buf_fgcolor(0x405060);
+	exp32(CMD_FGCOLOR);
+	exp32(0x405060);
+	copro_buf_text(1, -2, 29, 1536, "Back");
+	exp32(CMD_TEXT);
+	exp16x2(1, -2);
+	exp16x2(29, 1536);
+	exp_data("Back", 5);
+	copro_buf_number(3, 4, 31, 0, -1234);
+	exp32(CMD_NUMBER);
+	exp16x2(3, 4);
+	exp16x2(31, 0);
+	exp32(-1234);
+	copro_buf_slider(10, 20, 30, 40, 0, 5, 255);
+	exp32(CMD_SLIDER);
+	exp16x2(10, 20);
+	exp16x2(30, 40);
+	exp16x2(0, 5);
+	exp16x2(255, 0);
+	copro_buf_toggle(5, 6, 70, 27, 0, 65535, "on\xffoff");
+	exp32(CMD_TOGGLE);
+	exp16x2(5, 6);
+	exp16x2(70, 27);
+	exp16x2(0, 65535);
+	exp_data("on\xffoff", 7);
+	copro_buf_track(0, 0, 480, 272, 7);
+	exp32(CMD_TRACK);
+	exp16x2(0, 0);
+	exp16x2(480, 272);
+	exp16x2(7, 0);
+	copro_buf_append(0x1000, 96);
+	exp32(CMD_APPEND);
+	exp32(0x1000);
+	exp32(96);
+	copro_buf_memcpy(0x2000, RAM_DL, 96);
+	exp32(CMD_MEMCPY);
+	exp32(0x2000);
+	exp32(RAM_DL);
+	exp32(96);
+	copro_buf_cmd(0x00000000);
+	exp32(0x00000000);
+	copro_buf_swap();
+	exp32(CMD_SWAP);
+
+	ret = copro_buf_flush();
+	CHECK(ret == (int)expected_len, "offset %u: flushed %d, expected %zu", offset, ret,
+	      expected_len);
+	check_stream("commands");
+}
+
+// Data longer than the buffer, and than RAM_CMD, drained slowly by the co-processor
+static void check_inflate(size_t len, unsigned int drain_per_poll)
+{
+	static uint8_t data[12000];
+	int ret;
+
+	fake_reset(4000, drain_per_poll);
+
+	for (size_t i = 0; i < len; i++) {
+		data[i] = i * 7 + 3;
+	}
+
+	copro_buf_inflate(0x1234, data, len);
+	exp32(CMD_INFLATE);
+	exp32(0x1234);
+	exp_data(data, len);
+
+	ret = copro_buf_flush();
+	CHECK(ret == (int)expected_len, "inflate %zu: flushed %d, expected %zu", len, ret,
+	      expected_len);
+	CHECK(resets == 0, "inflate %zu: co-processor reset", len);
+	check_stream("inflate");
+}
+
+// The flush after a failure reports it, the next frame is written to the cleared RAM_CMD
+static void check_recovery(const char *name, int flush_ret)
+{
+	int ret;
+
+	CHECK(flush_ret == -EIO, "%s: flush returned %d", name, flush_ret);
+	CHECK(resets == 1, "%s: %u co-processor resets", name, resets);
+	CHECK(reg_cmd_read == 0 && reg_cmd_write == 0, "%s: FIFO not cleared", name);
+
+	drain = 64;
+	stream_len = 0;
+	expected_len = 0;
+	copro_buf_text(3, 4, 27, 0, "next");
+	exp32(CMD_TEXT);
+	exp16x2(3, 4);
+	exp16x2(27, 0);
+	exp_data("next", 5);
+
+	ret = copro_buf_flush();
+	CHECK(ret == (int)expected_len, "%s: next frame flushed %d", name, ret);
+	check_stream(name);
+}
+
+static void check_spi_error(int xfer)
+{
+	// Longer than the largest buffer, so it takes more than one transfer
+	static uint8_t data[6000];
+	int ret;
+
+	fake_reset(100, 64);
+	fail_xfer = xfer;
+
+	copro_buf_dlstart();
+	copro_buf_inflate(0, data, sizeof(data));
+	copro_buf_text(1, 2, 26, 0, "after");
+	ret = copro_buf_flush();
+
+	// Commands after the failure would be executed after the reset
+	CHECK(xfers == xfer + 1, "spi error: %d transfers, failed one is %d", xfers, xfer);
+	check_recovery("spi error", ret);
+}
+
+static void check_fault(void)
+{
+	fake_reset(0, 64);
+	fault = true;
+
+	copro_buf_text(1, 2, 26, 0, "fault");
+	copro_buf_swap();
+
+	check_recovery("fault", copro_buf_flush());
+}
+
+static void check_stuck(void)
+{
+	int ret;
+
+	fake_reset(0, 0);
+	// Co-processor stopped with RAM_CMD almost full
+	reg_cmd_write = 4000;
+	copro_buf_init();
+
+	for (int i = 0; i < 50; i++) {
+		copro_buf_swap();
+	}
+	ret = copro_buf_flush();
+
+	CHECK(now_ms <= FIFO_WAIT_TIMEOUT_MS + 1, "stuck: waited %u ms", now_ms);
+	CHECK(copro_buf_wait_cycles() == now_ms, "stuck: wait time not reported");
+	check_recovery("stuck", ret);
+}
+
+int main(void)
+{
+	check_commands(0);
+	check_commands(4000);
+	check_commands(4092);
+	check_inflate(301, 0);
+	check_inflate(3000, 16);
+	check_inflate(10000, 64);
+	check_spi_error(0);
+	check_spi_error(1);
+	check_fault();
+	check_stuck();
+
+	printf("buffer %d bytes: %d failures\n", CONFIG_TEMP_DISPLAY_CMD_BUF_SIZE, failures);
+
+	return failures;
+}
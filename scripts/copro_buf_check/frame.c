@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * SPI traffic of the shade control frame of temp_tscrn/src/display.c, built on the host by
+ * scripts/copro_buf_check.py with temp_tscrn/src/copro_buf.c with and without
+ * CONFIG_TEMP_DISPLAY_CMD_BATCH.
+ *
+ * The fake FT800 counts every SPI transaction and its bytes: 3 bytes of address followed by the
+ * data of a write, 3 bytes of address, a dummy byte and the data of a read. The co-processor
+ * consumes RAM_CMD as soon as REG_CMD_WRITE is written. Without batching, commands are written
+ * the way the ft8xx driver of Zephyr writes them: every field of a command with its own memory
+ * write, REG_CMD_WRITE updated after every command, and REG_CMD_READ read when the copy of it in
+ * the driver shows too little space.
+ *
+ * Fragments are built as at boot, then every page of shades is drawn FRAMES times with all shades
+ * available and new values in every frame. Per page it prints:
+ * "page <n> transactions <per frame> bytes <per frame> cmd_bytes <per frame>"
+ */
+
+#include <stdio.h>
+
+#include <zephyr/drivers/spi.h>
+
+#include "display.c"
+
+#define FRAMES 100
+
+#define RAM_CMD_SIZE     4096UL
+#define RAM_CMD_MAX_FILL (RAM_CMD_SIZE - 4UL)
+
+#define CMD_DLSTART 0xffffff00UL
+#define CMD_SWAP    0xffffff01UL
+
+// Display list of a fragment reported in REG_CMD_DL, its length does not change the traffic
+#define FRAGMENT_DL_LEN 64
+
+static unsigned long transactions;
+static unsigned long bus_bytes;
+
+static uint16_t reg_cmd_write;
+
+// Copies of the FIFO pointers kept by the ft8xx driver
+static uint16_t drv_cmd_read;
+static uint16_t drv_cmd_write;
+
+const char *shades_conn_ids[DATA_SHADE_ID_NUM] = {
+	"dsl", "dsc", "dsr", "ks", "ls", "bs",
+};
+
+int continuous_sd_get_addr(const char *name, const char *type, struct in6_addr *addr)
+{
+	return 0;
+}
+
+int k_sem_take(struct k_sem *sem, k_timeout_t timeout)
+{
+	return 0;
+}
+
+void k_sem_give(struct k_sem *sem)
+{
+}
+
+k_spinlock_key_t k_spin_lock(struct k_spinlock *lock)
+{
+	return 0;
+}
+
+void k_spin_unlock(struct k_spinlock *lock, k_spinlock_key_t key)
+{
+}
+
+int64_t k_uptime_get(void)
+{
+	return 0;
+}
+
+uint32_t k_cycle_get_32(void)
+{
+	return 0;
+}
+
+int32_t k_sleep(k_timeout_t timeout)
+{
+	return 0;
+}
+
+static void bus_write(uint32_t address, size_t len)
+{
+	transactions++;
+	bus_bytes += 3 + len;
+}
+
+static void bus_read(size_t len)
+{
+	transactions++;
+	bus_bytes += 4 + len;
+}
+
+int spi_write_dt(const struct spi_dt_spec *spec, const struct spi_buf_set *tx)
+{
+	transactions++;
+
+	for (size_t i = 0; i < tx->count; i++) {
+		bus_bytes += tx->buffers[i].len;
+	}
+
+	return 0;
+}
+
+static void reg_write(uint32_t address, uint32_t data, size_t len)
+{
+	bus_write(address, len);
+
+	if (address == REG_CMD_WRITE) {
+		reg_cmd_write = data & (RAM_CMD_SIZE - 1);
+	}
+}
+
+void ft8xx_wr8(uint32_t address, uint8_t data)
+{
+	reg_write(address, data, sizeof(data));
+}
+
+void ft8xx_wr16(uint32_t address, uint16_t data)
+{
+	reg_write(address, data, sizeof(data));
+}
+
+void ft8xx_wr32(uint32_t address, uint32_t data)
+{
+	reg_write(address, data, sizeof(data));
+}
+
+static uint32_t reg_read(uint32_t address, size_t len)
+{
+	bus_read(len);
+
+	switch (address) {
+	case REG_CMD_READ:
+	case REG_CMD_WRITE:
+		// RAM_CMD is consumed as soon as it is written
+		return reg_cmd_write;
+	case REG_CMD_DL:
+		return FRAGMENT_DL_LEN;
+	default:
+		return 0;
+	}
+}
+
+uint8_t ft8xx_rd8(uint32_t address)
+{
+	return reg_read(address, sizeof(uint8_t));
+}
+
+uint16_t ft8xx_rd16(uint32_t address)
+{
+	return reg_read(address, sizeof(uint16_t));
+}
+
+uint32_t ft8xx_rd32(uint32_t address)
+{
+	return reg_read(address, sizeof(uint32_t));
+}
+
+static void drv_begin(size_t len)
+{
+	while (RAM_CMD_MAX_FILL - ((drv_cmd_write - drv_cmd_read) & (RAM_CMD_SIZE - 1)) < len) {
+		drv_cmd_read = ft8xx_rd32(REG_CMD_READ);
+	}
+}
+
+// Memory write of a field at the driver copy of REG_CMD_WRITE
+static void drv_put(size_t len)
+{
+	bus_write(RAM_CMD + drv_cmd_write, len);
+	drv_cmd_write = (drv_cmd_write + len) & (RAM_CMD_SIZE - 1);
+}
+
+// Padding and reserved fields are not written
+static void drv_skip(size_t len)
+{
+	drv_cmd_write = (drv_cmd_write + len) & (RAM_CMD_SIZE - 1);
+}
+
+static void drv_end(void)
+{
+	ft8xx_wr32(REG_CMD_WRITE, drv_cmd_write);
+}
+
+static void drv_put_str(const char *s)
+{
+	size_t len = strlen(s) + 1;
+
+	drv_put(len);
+	drv_skip(ROUND_UP(len, 4) - len);
+}
+
+static size_t str_size(const char *s)
+{
+	return ROUND_UP(strlen(s) + 1, 4);
+}
+
+void ft8xx_copro_cmd(uint32_t cmd)
+{
+	drv_begin(sizeof(cmd));
+	drv_put(sizeof(cmd));
+	drv_end();
+}
+
+void ft8xx_copro_cmd_dlstart(void)
+{
+	ft8xx_copro_cmd(CMD_DLSTART);
+}
+
+void ft8xx_copro_cmd_swap(void)
+{
+	ft8xx_copro_cmd(CMD_SWAP);
+}
+
+static void drv_cmd_color(void)
+{
+	drv_begin(8);
+	drv_put(4);
+	drv_put(4);
+	drv_end();
+}
+
+void ft8xx_copro_cmd_bgcolor(uint32_t c)
+{
+	drv_cmd_color();
+}
+
+void ft8xx_copro_cmd_fgcolor(uint32_t c)
+{
+	drv_cmd_color();
+}
+
+// Command followed by 16 bit fields
+static void drv_cmd_fields(unsigned int fields, size_t tail)
+{
+	drv_begin(4 + ROUND_UP(fields * 2, 4) + tail);
+	drv_put(4);
+	for (unsigned int i = 0; i < fields; i++) {
+		drv_put(2);
+	}
+}
+
+void ft8xx_copro_cmd_text(int16_t x, int16_t y, int16_t font, uint16_t options, const char *s)
+{
+	drv_cmd_fields(4, str_size(s));
+	drv_put_str(s);
+	drv_end();
+}
+
+void ft8xx_copro_cmd_number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n)
+{
+	drv_cmd_fields(4, sizeof(n));
+	drv_put(sizeof(n));
+	drv_end();
+}
+
+void ft8xx_copro_cmd_slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options,
+			    uint16_t val, uint16_t range)
+{
+	drv_cmd_fields(7, 0);
+	drv_skip(2);
+	drv_end();
+}
+
+void ft8xx_copro_cmd_toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options,
+			    uint16_t state, const char *s)
+{
+	drv_cmd_fields(6, str_size(s));
+	drv_put_str(s);
+	drv_end();
+}
+
+void ft8xx_copro_cmd_track(int16_t x, int16_t y, int16_t w, int16_t h, int16_t tag)
+{
+	drv_cmd_fields(5, 0);
+	drv_skip(2);
+	drv_end();
+}
+
+int main(void)
+{
+	const int shades_per_page = 4;
+	const int pages = (DATA_SHADE_ID_NUM - 1) / shades_per_page + 1;
+	data_shades_curr_t shades;
+
+	copro_buf_init();
+	fragments_init();
+
+	curr_screen = SCREEN_SHADES_CONTROL;
+
+	for (int page = 0; page < pages; page++) {
+		unsigned long cmd_bytes = 0;
+
+		curr_page = page;
+		transactions = 0;
+		bus_bytes = 0;
+
+		for (int frame = 0; frame < FRAMES; frame++) {
+			for (int i = 0; i < DATA_SHADE_ID_NUM; i++) {
+				shades.values[i] = (frame + 40 * i) % 256;
+			}
+
+			update_shade_control(&shades, page);
+			cmd_bytes += screen_stats[SCREEN_SHADES_CONTROL].cmd_bytes;
+			screen_stats[SCREEN_SHADES_CONTROL].cmd_bytes = 0;
+		}
+
+		printf("page %d transactions %.1f bytes %.1f cmd_bytes %.1f\n", page,
+		       (double)transactions / FRAMES, (double)bus_bytes / FRAMES,
+		       (double)cmd_bytes / FRAMES);
+	}
+
+	return 0;
+}
@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Benchmark temp_tscrn controller parameters in the closed loop simulation
+
+The simulation is built for native_sim from temp_tscrn/sim and runs the unchanged controller and
+relay output against a first-order thermal model of the room in accelerated time:
+
+$ west build -b native_sim temp_tscrn/sim
+$ ./scripts/ctlr_bench.py --p 2048,3584 --i 128,255 --csv bench.csv
+$ ./scripts/ctlr_bench.py --onoff --hyst 3,5 --sim-args "-tau=7200 -hours=72"
+
+With --host the same sources are built with the host C compiler against the kernel, zbus and GPIO
+replacements in scripts/host instead, so no Zephyr tree is needed. Sources and include
+directories are taken from temp_tscrn/sim/CMakeLists.txt and numeric options from the defaults in
+the Kconfig files it sources.
+
+With --baseline the metrics are compared with a CSV written earlier with --csv, and the script
+fails if any of them got worse by more than --tolerance percent. Without parameters on the command
+line, the parameters of the baseline rows are run. temp_tscrn/sim/baseline.csv is the reference
+for CI:
+
+$ ./scripts/ctlr_bench.py --host --baseline temp_tscrn/sim/baseline.csv
+
+Metrics are described in temp_tscrn/sim/src/main.c.
+"""
+
+import argparse
+import csv
+import itertools
+import os
+import re
+import shlex
+import subprocess
+import sys
+import tempfile
+
+PARAMS = ('mode', 'p', 'i', 'hyst')
+# Lower is better for all metrics
+METRICS = ('rise_min', 'overshoot', 'settling_min', 'mae', 'switches', 'on_min', 'energy_wh')
+# Metrics for which -1 means that the state was never reached
+NEVER = ('rise_min', 'settling_min')
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SCRIPT_DIR)
+SIM_DIR = os.path.join(REPO_DIR, 'temp_tscrn', 'sim')
+HOST_DIR = os.path.join(SCRIPT_DIR, 'host')
+
+
+def kconfig_defaults(path, defaults):
+    """Collect numeric defaults of options in path and in Kconfig files it rsources"""
+    option = None
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            m = re.match(r'rsource\s+"(.+)"', line)
+            if m:
+                kconfig_defaults(os.path.join(os.path.dirname(path), m.group(1)), defaults)
+                continue
+            m = re.match(r'(?:menu)?config\s+(\w+)', line)
+            if m:
+                option = m.group(1)
+                continue
+            m = re.match(r'default\s+(-?\d+|0x[0-9a-fA-F]+)$', line)
+            if m and option and option not in defaults:
+                defaults[option] = m.group(1)
+    return defaults
+
+
+def cmake_list(command):
+    """Arguments of all 'command(app PRIVATE ...)' calls in the CMakeLists.txt of the simulation"""
+    with open(os.path.join(SIM_DIR, 'CMakeLists.txt')) as f:
+        text = f.read()
+    return [os.path.normpath(os.path.join(SIM_DIR, p))
+            for args in re.findall(rf'^{command}\(app PRIVATE ([^)]+)\)', text, re.MULTILINE)
+            for p in args.split()]
+
+
+def build(out_dir, cc):
+    config = kconfig_defaults(os.path.join(SIM_DIR, 'Kconfig'), {})
+    cflags = ['-O2', '-w', '-I', os.path.join(HOST_DIR, 'include')]
+    cflags += [f'-I{d}' for d in cmake_list('target_include_directories')]
+    cflags += [f'-DCONFIG_{k}={v}' for k, v in config.items()]
+
+    objs = []
+    for src in cmake_list('target_sources') + [os.path.join(HOST_DIR, 'kernel.c')]:
+        obj = os.path.join(out_dir, f'{len(objs)}_{os.path.basename(src)}.o')
+        # main() of the simulation runs in the main thread of the harness
+        rename = ['-Dmain=app_main'] if os.path.dirname(src) == os.path.join(SIM_DIR, 'src') else []
+        subprocess.run([cc] + cflags + rename + ['-c', src, '-o', obj], check=True)
+        objs.append(obj)
+
+    exe = os.path.join(out_dir, 'ctlr_sim')
+    subprocess.run([cc] + objs + ['-lm', '-o', exe], check=True)
+    return exe
+
+
+def run(exe, sim_args, args):
+    result = subprocess.run([exe] + args + sim_args, capture_output=True, text=True, check=True)
+
+    for line in result.stdout.splitlines():
+        if line.startswith('bench '):
+            fields = dict(f.split('=', 1) for f in line.split()[1:])
+            return {k: (v if k == 'mode' else int(v)) for k, v in fields.items()}
+
+    raise RuntimeError(f'No result in output of {exe} {" ".join(args)}')
+
+
+def runs(args, baseline):
+    if baseline and not (args.onoff or args.p or args.i or args.hyst):
+        for row in baseline.values():
+            if row['mode'] == 'onoff':
+                yield ['-onoff', f'-hyst={row["hyst"]}']
+            else:
+                yield [f'-p={row["p"]}', f'-i={row["i"]}']
+        return
+
+    if args.onoff:
+        for hyst in args.hyst or [5]:
+            yield ['-onoff', f'-hyst={hyst}']
+    else:
+        for p, i in itertools.product(args.p or [3584], args.i or [255]):
+            yield [f'-p={p}', f'-i={i}']
+
+
+def key(result):
+    if result['mode'] == 'onoff':
+        return ('onoff', result['hyst'])
+    return ('pid', result['p'], result['i'])
+
+
+def read_baseline(path):
+    with open(path, newline='') as f:
+        baseline = {}
+        for row in csv.DictReader(f):
+            row = {k: (v if k == 'mode' else int(v)) for k, v in row.items()}
+            baseline[key(row)] = row
+        return baseline
+
+
+def regressions(result, base, tolerance):
+    found = []
+    for m in METRICS:
+        value = result[m]
+        ref = base[m]
+
+        if m in NEVER and value < 0:
+            if ref >= 0:
+                found.append(f'{m} never reached, was {ref}')
+            continue
+        if m in NEVER and ref < 0:
+            continue
+
+        if value > ref + max(1, abs(ref) * tolerance / 100):
+            found.append(f'{m} {value}, was {ref}')
+    return found
+
+
+def int_list(value):
+    return [int(v) for v in value.split(',')]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--exe', default='build/zephyr/zephyr.exe',
+                        help='simulation built for native_sim')
+    parser.add_argument('--host', action='store_true',
+                        help='build the simulation with the host C compiler instead of --exe')
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'), help='host C compiler')
+    parser.add_argument('--onoff', action='store_true', help='benchmark on-off controller')
+    parser.add_argument('--p', type=int_list, help='PID P gains, comma separated (3584)')
+    parser.add_argument('--i', type=int_list, help='PID I gains, comma separated (255)')
+    parser.add_argument('--hyst', type=int_list,
+                        help='on-off hysteresis in 0.1 C, comma separated (5)')
+    parser.add_argument('--sim-args', default='', help='parameters of the thermal model')
+    parser.add_argument('--csv', help='write results to CSV')
+    parser.add_argument('--baseline', help='CSV of results to compare with')
+    parser.add_argument('--tolerance', type=float, default=5.0,
+                        help='allowed degradation of metrics in percent')
+    args = parser.parse_args()
+
+    sim_args = shlex.split(args.sim_args)
+    baseline = read_baseline(args.baseline) if args.baseline else None
+
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(tmp, args.cc) if args.host else args.exe
+        results = [run(exe, sim_args, r) for r in runs(args, baseline)]
+
+    print(' '.join(f'{c:>12}' for c in PARAMS + METRICS))
+    for r in results:
+        print(' '.join(f'{r[c]:>12}' for c in PARAMS + METRICS))
+
+    if args.csv:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=PARAMS + METRICS)
+            writer.writeheader()
+            for r in results:
+                writer.writerow({c: r[c] for c in PARAMS + METRICS})
+
+    if not baseline:
+        return 0
+
+    failed = False
+    for r in results:
+        base = baseline.get(key(r))
+        if base is None:
+            print(f'{key(r)}: not in baseline')
+            continue
+        for msg in regressions(r, base, args.tolerance):
+            print(f'{key(r)}: {msg}')
+            failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Benchmark the data dispatcher on the host and compare it with another revision
+
+lib/data_dispatcher.c is compiled for the host against the kernel and zbus of scripts/host
+with scripts/dispatcher_bench/bench.c. Revisions before the dispatcher was moved to lib use
+temp_tscrn/src/data_dispatcher.c. For the working tree, and for --ref if given, it reports:
+ - abba: whether a subscriber called by a publisher can publish to another channel while a
+         thread publishing to that channel waits for the dispatcher
+ - static RAM of the dispatcher (data and bss objects built with --cflags)
+ - RAM of a queued subscription to temperature measurements with its buffer
+ - stack frame of the zbus listener of the dispatcher, or of data_dispatcher_publish() calling
+   the subscribers in revisions without zbus
+ - average time of data_dispatcher_publish() with an inline and --queued queued subscribers
+ - average time from a publication to the callback of the inline and of the queued subscribers,
+   with the publisher preempted by the work queue of the dispatcher
+
+$ ./scripts/dispatcher_bench.py --ref HEAD~1
+
+Static RAM and stack depend on the compiler and on the kernel objects of the host build, pointers
+are 8 B on 64 bit hosts. Times are host times, useful only for comparison.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from ctlr_bench import kconfig_defaults
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SCRIPT_DIR)
+HOST_DIR = os.path.join(SCRIPT_DIR, 'host')
+HARNESS_DIR = os.path.join(SCRIPT_DIR, 'dispatcher_bench')
+
+COLUMNS = ('source', 'abba', 'ram_b', 'subscriber_b', 'listener_stack_b', 'publish_avg_ns',
+           'publish_max_us', 'inline_delivery_ns', 'queued_delivery_ns')
+SOURCE_DIRS = ('lib', 'temp_tscrn/src')
+
+
+def checkout(ref, out_dir):
+    """Write data_dispatcher.[ch] of git revision ref to out_dir"""
+    for src_dir in SOURCE_DIRS:
+        files = {}
+        for name in ('data_dispatcher.c', 'data_dispatcher.h'):
+            result = subprocess.run(['git', '-C', REPO_DIR, 'show', f'{ref}:{src_dir}/{name}'],
+                                    capture_output=True)
+            if result.returncode:
+                break
+            files[name] = result.stdout
+        else:
+            for name, data in files.items():
+                with open(os.path.join(out_dir, name), 'wb') as f:
+                    f.write(data)
+            return out_dir
+
+    raise SystemExit(f'No data dispatcher in {", ".join(SOURCE_DIRS)} of {ref}')
+
+
+def build(out_dir, lib_dir, cc, cflags):
+    config = kconfig_defaults(os.path.join(REPO_DIR, 'lib', 'Kconfig.data_dispatcher'), {})
+    config.update(kconfig_defaults(os.path.join(REPO_DIR, 'temp_tscrn', 'Kconfig.zones'), {}))
+    flags = ['-O2', '-w', '-I', os.path.join(HOST_DIR, 'include'), '-I', lib_dir]
+    flags += [f'-DCONFIG_{k}={v}' for k, v in config.items()] + cflags
+
+    objs = []
+    for src in (os.path.join(lib_dir, 'data_dispatcher.c'), os.path.join(HOST_DIR, 'kernel.c'),
+                os.path.join(HARNESS_DIR, 'bench.c')):
+        obj = os.path.join(out_dir, os.path.basename(src)[:-2] + '.o')
+        subprocess.run([cc] + flags + ['-fstack-usage', '-c', src, '-o', obj], check=True,
+                       cwd=out_dir)
+        objs.append(obj)
+
+    exe = os.path.join(out_dir, 'bench')
+    subprocess.run([cc] + cflags + objs + ['-o', exe], check=True)
+    return exe, objs[0]
+
+
+def static_ram(obj):
+    """Sum of sizes of data and bss objects, without padding between them"""
+    out = subprocess.run(['nm', '-S', obj], capture_output=True, text=True, check=True).stdout
+    return sum(int(f[1], 16) for f in (line.split() for line in out.splitlines())
+               if len(f) == 4 and f[2] in 'bBdD')
+
+
+def listener_stack(obj):
+    frames = {}
+    with open(obj[:-2] + '.su') as f:
+        for line in f:
+            m = re.search(r':(\w+)\s+(\d+)', line)
+            if m:
+                frames[m.group(1)] = int(m.group(2))
+    return frames.get('chan_changed', frames.get('data_dispatcher_publish', -1))
+
+
+def run(exe, args):
+    result = subprocess.run([exe] + args, capture_output=True, text=True)
+    fields = {}
+    for line in result.stdout.splitlines():
+        fields.update(f.split('=', 1) for f in line.split() if '=' in f)
+    if result.returncode == 2 or result.stderr:
+        sys.stderr.write(result.stderr)
+    return fields
+
+
+def bench(name, lib_dir, out_dir, args):
+    exe, obj = build(out_dir, lib_dir, args.cc, args.cflags.split())
+    abba = run(exe, ['-abba']).get('abba', 'deadlock')
+    latency = run(exe, [f'-n={args.n}', f'-queued={args.queued}'])
+    result = {
+        'source': name,
+        'abba': abba,
+        'ram_b': static_ram(obj),
+        'listener_stack_b': listener_stack(obj),
+    }
+    for c in COLUMNS:
+        result.setdefault(c, latency.get(c, '-'))
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--ref', help='git revision to compare with')
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'), help='host C compiler')
+    parser.add_argument('--cflags', default='', help='additional compiler flags')
+    parser.add_argument('--n', type=int, default=100000, help='number of publications')
+    parser.add_argument('--queued', type=int, default=2, help='number of queued subscribers')
+    args = parser.parse_args()
+
+    results = []
+    with tempfile.TemporaryDirectory() as tmp:
+        tree_dir = os.path.join(tmp, 'tree')
+        os.mkdir(tree_dir)
+        results.append(bench('tree', os.path.join(REPO_DIR, 'lib'), tree_dir, args))
+
+        if args.ref:
+            ref_dir = os.path.join(tmp, 'ref')
+            os.mkdir(ref_dir)
+            results.append(bench(args.ref, checkout(args.ref, ref_dir), ref_dir, args))
+
+    print(' '.join(f'{c:>16}' for c in COLUMNS))
+    for r in results:
+        print(' '.join(f'{r[c]:>16}' for c in COLUMNS))
+
+    return 0 if results[0]['abba'] == 'ok' else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Benchmark of lib/data_dispatcher.c on the host kernel of scripts/host, built by
+ * scripts/dispatcher_bench.py.
+ *
+ * With -abba a subscriber called by the publisher of a setting publishes an output after it was
+ * preempted by another thread publishing the output. If the dispatcher takes a lock of its own
+ * under the channel lock held by zbus, the threads wait for each other forever.
+ *
+ * Otherwise temperature measurements are published -n times to a subscriber called by the
+ * publisher and to -queued subscribers of the dispatcher work queue, and the time spent in
+ * data_dispatcher_publish() is printed. Then they are published -n times again by a thread
+ * preempted by the work queue, so that every publication is delivered to all subscribers, and the
+ * average time from the publication to the callbacks is printed with the RAM of a queued
+ * subscription.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <zephyr/kernel.h>
+
+#include <data_dispatcher.h>
+
+#include "cmdline.h"
+#include "posix_native_task.h"
+
+#define MAX_QUEUED 8
+
+static bool     arg_abba;
+static uint32_t arg_n = 100000;
+static uint32_t arg_queued = 2;
+
+static bool abba_pub_done;
+static bool abba_out_done;
+
+static uint32_t inline_calls;
+static uint32_t queued_calls;
+
+static bool     delivery_phase;
+static bool     delivery_done;
+static uint64_t publish_ns;
+static uint64_t inline_delivery_ns;
+static uint64_t queued_delivery_ns;
+static uint32_t queued_delivered;
+
+static void abba_pub_process(void *p1, void *p2, void *p3);
+static void abba_out_process(void *p1, void *p2, void *p3);
+static void delivery_process(void *p1, void *p2, void *p3);
+
+K_THREAD_DEFINE(abba_pub_thread, 1024, abba_pub_process, NULL, NULL, NULL, 2, 0, K_TICKS_FOREVER);
+K_THREAD_DEFINE(abba_out_thread, 1024, abba_out_process, NULL, NULL, NULL, 3, 0, K_TICKS_FOREVER);
+K_THREAD_DEFINE(delivery_thread, 1024, delivery_process, NULL, NULL, NULL,
+		CONFIG_DATA_DISPATCHER_WORKQ_PRIO + 1, 0, K_TICKS_FOREVER);
+
+static void publish(data_t type, int16_t value)
+{
+	data_dispatcher_publish_t data = {
+		.type = type,
+		.loc = 0,
+		.temp_measurement = value,
+	};
+
+	data_dispatcher_publish(&data);
+}
+
+static void setting_changed(const data_dispatcher_publish_t *data)
+{
+	(void)data;
+
+	// Preempted by the output thread while the setting channel is locked
+	k_sleep(K_MSEC(10));
+	publish(DATA_OUTPUT, 1);
+}
+
+static data_dispatcher_subscribe_t setting_sbscr = {
+	.callback = setting_changed,
+};
+
+static void abba_pub_process(void *p1, void *p2, void *p3)
+{
+	publish(DATA_TEMP_SETTING, 215);
+	abba_pub_done = true;
+}
+
+static void abba_out_process(void *p1, void *p2, void *p3)
+{
+	k_sleep(K_MSEC(5));
+	publish(DATA_OUTPUT, 2);
+	abba_out_done = true;
+}
+
+static int abba(void)
+{
+	data_dispatcher_subscribe(DATA_TEMP_SETTING, &setting_sbscr);
+
+	k_thread_start(abba_pub_thread);
+	k_thread_start(abba_out_thread);
+
+	k_sleep(K_SECONDS(1));
+
+	printf("abba=%s\n", (abba_pub_done && abba_out_done) ? "ok" : "deadlock");
+	return (abba_pub_done && abba_out_done) ? 0 : 1;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void meas_inline(const data_dispatcher_publish_t *data)
+{
+	(void)data;
+	inline_calls++;
+
+	if (delivery_phase) {
+		inline_delivery_ns += now_ns() - publish_ns;
+	}
+}
+
+static void meas_queued(const data_dispatcher_publish_t *data)
+{
+	(void)data;
+	queued_calls++;
+
+	if (delivery_phase) {
+		queued_delivery_ns += now_ns() - publish_ns;
+		queued_delivered++;
+	}
+}
+
+static data_dispatcher_subscribe_t meas_inline_sbscr = {
+	.callback = meas_inline,
+};
+
+static data_dispatcher_subscribe_t meas_queued_sbscr[MAX_QUEUED];
+
+// Revisions before subscriptions had buffers kept the state in data_dispatcher_subscribe_t
+#ifdef DATA_DISPATCHER_BUF_SIZE
+#define SUBSCRIBER_BUF_SIZE DATA_DISPATCHER_BUF_SIZE(int16_t, DATA_LOC_NUM, 1, 0)
+static uint8_t meas_queued_buf[MAX_QUEUED][SUBSCRIBER_BUF_SIZE];
+#else
+#define SUBSCRIBER_BUF_SIZE 0
+#endif
+
+static void delivery_process(void *p1, void *p2, void *p3)
+{
+	for (uint32_t i = 0; i < arg_n; i++) {
+		publish_ns = now_ns();
+		publish(DATA_TEMP_MEASUREMENT, (int16_t)(i & 0x3ff));
+	}
+
+	delivery_done = true;
+}
+
+static int latency(void)
+{
+	data_dispatcher_stats_t stats;
+	uint64_t start;
+	uint64_t total;
+
+	if (arg_queued > MAX_QUEUED) {
+		printf("At most %u queued subscribers\n", MAX_QUEUED);
+		return 1;
+	}
+
+	data_dispatcher_subscribe(DATA_TEMP_MEASUREMENT, &meas_inline_sbscr);
+	for (uint32_t i = 0; i < arg_queued; i++) {
+		meas_queued_sbscr[i].callback = meas_queued;
+		meas_queued_sbscr[i].work_q = &data_dispatcher_work_q;
+#ifdef DATA_DISPATCHER_BUF_SIZE
+		meas_queued_sbscr[i].buf = meas_queued_buf[i];
+		meas_queued_sbscr[i].buf_size = sizeof(meas_queued_buf[i]);
+#endif
+		data_dispatcher_subscribe(DATA_TEMP_MEASUREMENT, &meas_queued_sbscr[i]);
+	}
+
+	start = now_ns();
+	for (uint32_t i = 0; i < arg_n; i++) {
+		publish(DATA_TEMP_MEASUREMENT, (int16_t)(i & 0x3ff));
+	}
+	total = now_ns() - start;
+
+	// Let the work queue deliver the last measurement
+	k_sleep(K_MSEC(1));
+
+	data_dispatcher_stats_get(DATA_TEMP_MEASUREMENT, &stats);
+
+	printf("publish_avg_ns=%llu publish_max_us=%u inline_calls=%u queued_calls=%u "
+	       "coalesced=%u\n",
+	       (unsigned long long)(total / arg_n), stats.publish_max_us, inline_calls,
+	       queued_calls, stats.coalesced);
+
+	inline_calls = 0;
+	delivery_phase = true;
+	k_thread_start(delivery_thread);
+
+	while (!delivery_done) {
+		k_sleep(K_MSEC(10));
+	}
+
+	printf("inline_delivery_ns=%llu queued_delivery_ns=%llu subscriber_b=%zu\n",
+	       (unsigned long long)(inline_delivery_ns / arg_n),
+	       (unsigned long long)(queued_delivered ? queued_delivery_ns / queued_delivered : 0),
+	       sizeof(meas_queued_sbscr[0]) + SUBSCRIBER_BUF_SIZE);
+
+	return ((inline_calls == arg_n) && (queued_delivered == arg_n * arg_queued)) ? 0 : 1;
+}
+
+int app_main(void)
+{
+	data_dispatcher_init();
+
+	return arg_abba ? abba() : latency();
+}
+
+static void add_options(void)
+{
+	static struct args_struct_t options[] = {
+		{ .is_switch = true, .option = "abba", .type = 'b', .dest = &arg_abba,
+		  .descript = "Check publishing from a callback preempted by another publisher" },
+		{ .option = "n", .name = "n", .type = 'u', .dest = &arg_n,
+		  .descript = "Number of published measurements" },
+		{ .option = "queued", .name = "n", .type = 'u', .dest = &arg_queued,
+		  .descript = "Number of queued subscribers" },
+		ARG_TABLE_ENDMARKER
+	};
+
+	native_add_command_line_opts(options);
+}
+
+NATIVE_TASK(add_options, PRE_BOOT_1, 1);
@@ -0,0 +1,278 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Generate delta FOTA image for lib/fota_delta.c
+
+The delta reconstructs the new signed image from the signed image running on the device
+(primary slot). It is served to the device instead of the full image, e.g.:
+
+$ ./scripts/fota_delta.py old/zephyr.signed.bin build/temp_tscrn/zephyr/zephyr.signed.bin \
+        temp_tscrn.delta
+
+The build of the apps runs it when given the old image (lib/fota_delta.cmake), writing
+zephyr.signed.delta next to zephyr.signed.bin:
+
+$ west build -b <board> temp_tscrn -- -DFOTA_DELTA_BASE=old/zephyr.signed.bin
+
+Format (little endian):
+    header: magic "ZDLT", old image size (u32), CRC32 of old image (u32), new image size (u32)
+    ops:    0x00 COPY   <old offset: varint> <length: varint>
+            0x01 INSERT <length: varint> <length bytes>
+            0x02 ADD    <old offset: varint> <length: varint> <diff>
+Varints are unsigned LEB128.
+
+ADD produces length bytes of the old image from the offset, each plus a diff byte (mod 256), as in
+bsdiff. It covers code that moved together with the addresses it contains, where only some bytes
+change. The diff is not compressed, so unchanged bytes are coded as 0x00 followed by their count
+(varint, non-zero) and any other diff byte is added to one old byte.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = b'ZDLT'
+OP_COPY = 0
+OP_INSERT = 1
+OP_ADD = 2
+
+# Shortest match worth a COPY op. Shorter matches cost more than literal bytes
+MIN_MATCH = 12
+# Number of old image positions remembered per key. Limits time spent on repetitive data
+MAX_CANDIDATES = 8
+# Changed bytes in a row ending an ADD. Longer runs are new data rather than modified old data
+MAX_ADD_MISMATCH = 8
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7f
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def build_index(old):
+    index = {}
+    for i in range(len(old) - MIN_MATCH + 1):
+        candidates = index.setdefault(old[i:i + MIN_MATCH], [])
+        if len(candidates) < MAX_CANDIDATES:
+            candidates.append(i)
+    return index
+
+
+def longest_match(old, new, pos, candidates, prev_end, end=None):
+    end = len(new) if end is None else end
+    best_off = 0
+    best_len = 0
+    # Prefer continuing previous copy. It is the most likely match and the cheapest op
+    if prev_end is not None and prev_end not in candidates:
+        candidates = [prev_end] + candidates
+    for off in candidates:
+        length = 0
+        while (off + length < len(old) and pos + length < end and
+               old[off + length] == new[pos + length]):
+            length += 1
+        if length > best_len:
+            best_off = off
+            best_len = length
+    return best_off, best_len
+
+
+def add_extent(old, new, off, pos):
+    length = 0
+    j = 0
+    while off + j < len(old) and pos + j < len(new) and j - length < MAX_ADD_MISMATCH:
+        if old[off + j] == new[pos + j]:
+            length = j + 1
+        j += 1
+    return length
+
+
+def add_diff(old, new, off, pos, length):
+    out = bytearray()
+    i = 0
+    while i < length:
+        run = 0
+        while i + run < length and old[off + i + run] == new[pos + i + run]:
+            run += 1
+        if run:
+            out.append(0)
+            out.extend(varint(run))
+            i += run
+        else:
+            out.append((new[pos + i] - old[off + i]) & 0xff)
+            i += 1
+    return bytes(out)
+
+
+def copy_insert_cost(old, new, index, pos, end, prev_end):
+    # Size of new[pos:end] coded without ADD, with the same matching as diff()
+    cost = 0
+    literal = 0
+    while pos < end:
+        candidates = index.get(new[pos:pos + MIN_MATCH], [])
+        off, length = longest_match(old, new, pos, candidates, prev_end, end)
+        if length >= MIN_MATCH:
+            if literal:
+                cost += 1 + len(varint(literal)) + literal
+                literal = 0
+            cost += 1 + len(varint(off)) + len(varint(length))
+            pos += length
+            prev_end = off + length
+        else:
+            literal += 1
+            pos += 1
+            prev_end = None if prev_end is None else prev_end + 1
+    if literal:
+        cost += 1 + len(varint(literal)) + literal
+    return cost
+
+
+def diff(old, new):
+    index = build_index(old)
+    ops = bytearray()
+    literal = bytearray()
+    prev_end = None
+    pos = 0
+
+    def flush_literal():
+        if literal:
+            ops.append(OP_INSERT)
+            ops.extend(varint(len(literal)))
+            ops.extend(literal)
+            literal.clear()
+
+    while pos < len(new):
+        candidates = index.get(new[pos:pos + MIN_MATCH], [])
+        off, length = longest_match(old, new, pos, candidates, prev_end)
+
+        # Modified old data continuing the previous op, unless an exact match covers it
+        if prev_end is not None and prev_end < len(old):
+            add_len = add_extent(old, new, prev_end, pos)
+            if add_len > length:
+                add = add_diff(old, new, prev_end, pos, add_len)
+                add_cost = 1 + len(varint(prev_end)) + len(varint(add_len)) + len(add)
+                if add_cost < copy_insert_cost(old, new, index, pos, pos + add_len, prev_end):
+                    flush_literal()
+                    ops.append(OP_ADD)
+                    ops.extend(varint(prev_end))
+                    ops.extend(varint(add_len))
+                    ops.extend(add)
+                    pos += add_len
+                    prev_end += add_len
+                    continue
+
+        if length >= MIN_MATCH:
+            flush_literal()
+            ops.append(OP_COPY)
+            ops.extend(varint(off))
+            ops.extend(varint(length))
+            pos += length
+            prev_end = off + length
+        else:
+            literal.append(new[pos])
+            pos += 1
+            prev_end = None if prev_end is None else prev_end + 1
+
+    flush_literal()
+
+    header = MAGIC + struct.pack('<III', len(old), zlib.crc32(old), len(new))
+    return header + bytes(ops)
+
+
+def patch(old, delta):
+    if delta[:4] != MAGIC:
+        raise ValueError('Not a delta image')
+
+    old_size, old_crc, new_size = struct.unpack('<III', delta[4:16])
+    if old_size != len(old) or old_crc != zlib.crc32(old):
+        raise ValueError('Delta generated for different base image')
+
+    new = bytearray()
+    pos = 16
+    while pos < len(delta):
+        op = delta[pos]
+        pos += 1
+        if op == OP_COPY:
+            off, pos = read_varint(delta, pos)
+            length, pos = read_varint(delta, pos)
+            new.extend(old[off:off + length])
+        elif op == OP_INSERT:
+            length, pos = read_varint(delta, pos)
+            new.extend(delta[pos:pos + length])
+            pos += length
+        elif op == OP_ADD:
+            off, pos = read_varint(delta, pos)
+            length, pos = read_varint(delta, pos)
+            if off + length > len(old):
+                raise ValueError('ADD out of old image')
+            end = off + length
+            while off < end:
+                byte = delta[pos]
+                pos += 1
+                if byte:
+                    new.append((old[off] + byte) & 0xff)
+                    off += 1
+                    continue
+                run, pos = read_varint(delta, pos)
+                if not run or off + run > end:
+                    raise ValueError('Invalid ADD run')
+                new.extend(old[off:off + run])
+                off += run
+        else:
+            raise ValueError('Unknown op {}'.format(op))
+
+    if len(new) != new_size:
+        raise ValueError('Delta produced wrong size')
+
+    return bytes(new)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('old', help='signed image running on devices')
+    parser.add_argument('new', help='new signed image')
+    parser.add_argument('out', help='delta image to serve')
+    args = parser.parse_args()
+
+    with open(args.old, 'rb') as f:
+        old = f.read()
+    with open(args.new, 'rb') as f:
+        new = f.read()
+
+    delta = diff(old, new)
+
+    if patch(old, delta) != new:
+        sys.exit('Delta verification failed')
+
+    with open(args.out, 'wb') as f:
+        f.write(delta)
+
+    print('{}: {} B ({:.1f}% of {} B image)'.format(args.out, len(delta),
+                                                 100.0 * len(delta) / len(new), len(new)))
+
+
+if __name__ == '__main__':
+    main()
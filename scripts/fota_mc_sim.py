@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compare airtime of multicast and sequential unicast FOTA of lib/coap_fota.c
+
+Sequential unicast: each of N nodes fetches the whole image with Block2 requests, every block is
+a request and a response over all hops between the node and the server. Multicast: the image is
+announced to each node, pushed once to the group with MPL forwarding by every router, and each
+node fetches the blocks it lost with the same Block2 requests, e.g.:
+
+$ ./scripts/fota_mc_sim.py
+$ ./scripts/fota_mc_sim.py --size 180000 --loss 0.05 --nodes 1 5 10 20 40
+
+Topology: a random tree of routers below the border router, each node is a child of a random
+router. The server and the distributor are behind the border router. A multicast frame is
+received over a link when any of the MPL transmissions of the parent router gets through, which
+ignores the redundancy of other neighbors of a mesh. Unicast frames are retried by the MAC layer
+and the whole CoAP exchange is retransmitted when a hop gives up. Results are expected values,
+averaged over --runs random topologies.
+
+Frame model of lib/coap_fota.c: 21 B MAC header, security and FCS, 5 B mesh header, 3 B IPHC
+with addresses compressed by context, 7 B UDP NHC. Block size is the largest fitting a frame.
+Multicast frames carry the MPL option and the destination group inline and no mesh header.
+Airtime of a frame includes 6 B of preamble, SFD and PHR at 250 kbit/s. Acknowledged frames add
+turnaround and the ACK frame.
+"""
+
+import argparse
+import random
+
+FRAME_MAX_LEN = 127
+MAC_OVERHEAD = 21
+MESH_HDR = 5
+IPHC = 3
+INLINE_ADDR_LEN = 16
+MCAST_INLINE = 4
+MPL_OPTION = 8
+UDP_NHC = 7
+
+# CoAP header, token, ETag, Block2 option and payload marker of a Block2 response
+COAP_BLOCK_OVERHEAD = 17
+# CoAP header, token, Uri-Path, Block2 and Size2 options of a Block2 request
+COAP_BLOCK_REQ = 4 + 4 + 1 + 8 + 3 + 1
+# CoAP header without token, Uri-Path "fota_mc", Block1 option and payload marker of a push
+COAP_PUSH_OVERHEAD = 4 + 8 + 4 + 1
+# Announcement with a 40 B repair URL and its 2.04 response
+COAP_ANNOUNCE = 4 + 4 + 8 + 2 + 1 + 80
+COAP_ANNOUNCE_RSP = 4 + 4
+
+BLOCK_SZX_MIN = 0
+BLOCK_SZX_MAX = 2
+MC_SZX_MIN = 1
+
+PHY_HDR = 6
+SYMBOL_US_PER_BYTE = 32
+TURNAROUND_US = 192
+ACK_LEN = 5
+
+FOTA_MAX_RETRANSMIT = 4
+
+
+def block_size(szx):
+    return 16 << szx
+
+
+def airtime_us(length):
+    return (length + PHY_HDR) * SYMBOL_US_PER_BYTE
+
+
+def unicast_frame(coap_len, off_mesh):
+    return MAC_OVERHEAD + MESH_HDR + IPHC + UDP_NHC + coap_len + \
+        (INLINE_ADDR_LEN if off_mesh else 0)
+
+
+def multicast_frame(coap_len, off_mesh):
+    return MAC_OVERHEAD + IPHC + MCAST_INLINE + MPL_OPTION + UDP_NHC + coap_len + \
+        (INLINE_ADDR_LEN if off_mesh else 0)
+
+
+def largest_szx(frame, overhead, min_szx, off_mesh):
+    for szx in range(BLOCK_SZX_MAX, min_szx, -1):
+        if frame(overhead + block_size(szx), off_mesh) <= FRAME_MAX_LEN:
+            return szx
+    return min_szx
+
+
+def hop_cost(length, loss, mac_retries):
+    """Expected airtime of a unicast frame over one hop and the probability that the hop fails"""
+    frame = airtime_us(length)
+    ack = TURNAROUND_US + airtime_us(ACK_LEN)
+    attempts = sum(loss ** k for k in range(mac_retries + 1))
+    fail = loss ** (mac_retries + 1)
+    return attempts * frame + (1 - fail) * ack, fail
+
+
+def exchange_cost(req_len, rsp_len, hops, loss, mac_retries):
+    """Expected airtime of a CoAP exchange over a number of hops, with retransmissions"""
+    req, req_fail = hop_cost(req_len, loss, mac_retries)
+    rsp, rsp_fail = hop_cost(rsp_len, loss, mac_retries)
+    success = ((1 - req_fail) * (1 - rsp_fail)) ** hops
+    # A failed attempt is counted as a whole one, which overestimates a little
+    attempts = sum((1 - success) ** k for k in range(FOTA_MAX_RETRANSMIT + 1))
+    return attempts * hops * (req + rsp)
+
+
+def topology(routers, nodes, max_depth, rng):
+    """Return the depth of each router (the border router is 0) and the router of each node"""
+    depth = [0]
+    for _ in range(1, routers):
+        parents = [r for r in range(len(depth)) if depth[r] < max_depth - 1]
+        depth.append(depth[rng.choice(parents)] + 1)
+    return depth, [rng.randrange(routers) for _ in range(nodes)]
+
+
+def simulate(args, nodes, rng):
+    off_mesh = args.off_mesh
+    uc_szx = largest_szx(unicast_frame, COAP_BLOCK_OVERHEAD, BLOCK_SZX_MIN, off_mesh)
+    mc_szx = largest_szx(multicast_frame, COAP_PUSH_OVERHEAD, MC_SZX_MIN, off_mesh)
+
+    uc_blocks = -(-args.size // block_size(uc_szx))
+    mc_blocks = -(-args.size // block_size(mc_szx))
+
+    req_len = unicast_frame(COAP_BLOCK_REQ, off_mesh)
+    uc_rsp_len = unicast_frame(COAP_BLOCK_OVERHEAD + block_size(uc_szx), off_mesh)
+    mc_rsp_len = unicast_frame(COAP_BLOCK_OVERHEAD + block_size(mc_szx), off_mesh)
+    push_len = multicast_frame(COAP_PUSH_OVERHEAD + block_size(mc_szx), off_mesh)
+    ann_len = unicast_frame(COAP_ANNOUNCE, off_mesh)
+    ann_rsp_len = unicast_frame(COAP_ANNOUNCE_RSP, off_mesh)
+
+    # Probability that a link delivers a multicast frame in one of the MPL transmissions
+    mc_link = 1 - args.loss ** args.mpl
+
+    unicast = push = repair = announce = 0.0
+    for _ in range(args.runs):
+        depth, parent = topology(args.routers, nodes, args.depth, rng)
+
+        for router in parent:
+            hops = depth[router] + 1
+            unicast += uc_blocks * exchange_cost(req_len, uc_rsp_len, hops, args.loss,
+                                                 args.mac_retries)
+            announce += exchange_cost(ann_len, ann_rsp_len, hops, args.loss, args.mac_retries)
+            lost = mc_blocks * (1 - mc_link ** hops)
+            repair += lost * exchange_cost(req_len, mc_rsp_len, hops, args.loss,
+                                           args.mac_retries)
+
+        # Every router forwards the blocks it received, the border router gets all of them
+        reached = sum(mc_link ** d for d in depth)
+        push += mc_blocks * reached * args.mpl * airtime_us(push_len)
+
+    runs = args.runs * 1e6
+    return {
+        'uc_szx': uc_szx,
+        'mc_szx': mc_szx,
+        'unicast': unicast / runs,
+        'announce': announce / runs,
+        'push': push / runs,
+        'repair': repair / runs,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--nodes', type=int, nargs='+', default=[1, 2, 5, 10, 20, 50],
+                        help='numbers of updated nodes (default: %(default)s)')
+    parser.add_argument('--size', type=int, default=256 * 1024,
+                        help='image size in bytes (default: %(default)s)')
+    parser.add_argument('--routers', type=int, default=10,
+                        help='routers including the border router (default: %(default)s)')
+    parser.add_argument('--depth', type=int, default=4,
+                        help='maximum hops from the border router to a node (default: %(default)s)')
+    parser.add_argument('--loss', type=float, default=0.1,
+                        help='loss probability of a frame over a link (default: %(default)s)')
+    parser.add_argument('--mac-retries', type=int, default=3,
+                        help='MAC retransmissions of unicast frames (default: %(default)s)')
+    parser.add_argument('--mpl', type=int, default=2,
+                        help='transmissions of each multicast frame by every router '
+                        '(default: %(default)s)')
+    parser.add_argument('--off-mesh', action='store_true',
+                        help='server and distributor address is not compressed by context')
+    parser.add_argument('--runs', type=int, default=200,
+                        help='random topologies averaged (default: %(default)s)')
+    parser.add_argument('--seed', type=int, default=0, help='seed of the topologies')
+    args = parser.parse_args()
+
+    if args.routers < 1 or args.depth < 1:
+        parser.error('need the border router and at least one hop')
+    if args.routers > 1 and args.depth < 2:
+        parser.error('routers below the border router need --depth of at least 2')
+
+    rng = random.Random(args.seed)
+    results = [(n, simulate(args, n, rng)) for n in args.nodes]
+
+    print(f'image {args.size} B, unicast blocks {block_size(results[0][1]["uc_szx"])} B, '
+          f'multicast blocks {block_size(results[0][1]["mc_szx"])} B, airtime in s')
+    print(f'{"nodes":>5} {"unicast":>9} {"announce":>9} {"push":>9} {"repair":>9} '
+          f'{"multicast":>9} {"ratio":>6}')
+    for n, r in results:
+        multicast = r['announce'] + r['push'] + r['repair']
+        print(f'{n:5} {r["unicast"]:9.1f} {r["announce"]:9.2f} {r["push"]:9.1f} '
+              f'{r["repair"]:9.1f} {multicast:9.1f} {multicast / r["unicast"]:6.2f}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Convert PNG images to compressed FT800 bitmaps
+
+Every asset is given as NAME:FORMAT:CELLS:PNG. The image is converted to the FT800 bitmap
+FORMAT, compressed with zlib and written to a header included by temp_tscrn/src/display.c,
+which inflates it into RAM_G with CMD_INFLATE at boot. Images of fonts and icon sets are split
+into CELLS cells of equal height stacked vertically, drawn with the cell argument of VERTEX2II.
+
+Luminance formats are drawn as an alpha mask in the current color. They are taken from the alpha
+channel of the image if it has one, from the gray level otherwise.
+
+Only non-interlaced PNG images with 8 bits per channel are supported:
+
+$ ./scripts/ft8xx_assets.py -o ft8xx_assets.h clock_digits:L4:10:temp_tscrn/assets/clock_digits.png
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+# Channels of PNG color types
+PNG_CHANNELS = {0: 1, 2: 3, 4: 2, 6: 4}
+
+# Bitmap formats: FT800 code and bits per pixel
+FORMATS = {
+    'ARGB1555': (0, 16),
+    'L1':       (1, 1),
+    'L4':       (2, 4),
+    'L8':       (3, 8),
+    'ARGB4':    (6, 16),
+    'RGB565':   (7, 16),
+}
+
+MAX_SIZE = 511
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa = abs(p - a)
+    pb = abs(p - b)
+    pc = abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    if pb <= pc:
+        return b
+    return c
+
+
+def read_png(path):
+    """Width, height and rows of RGBA tuples, alpha is None without alpha channel"""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if not data.startswith(PNG_SIGNATURE):
+        raise ValueError(f'{path}: not a PNG image')
+
+    pos = len(PNG_SIGNATURE)
+    idat = b''
+    while pos < len(data):
+        length, kind = struct.unpack_from('>I4s', data, pos)
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+
+        if kind == b'IHDR':
+            width, height, depth, color, _, _, interlace = struct.unpack('>IIBBBBB', body)
+        elif kind == b'IDAT':
+            idat += body
+        elif kind == b'IEND':
+            break
+
+    if depth != 8 or color not in PNG_CHANNELS or interlace:
+        raise ValueError(f'{path}: unsupported PNG, depth {depth}, color type {color}, '
+                         f'interlace {interlace}')
+
+    bpp = PNG_CHANNELS[color]
+    stride = width * bpp
+    raw = zlib.decompress(idat)
+    prev = bytearray(stride)
+    rows = []
+
+    for y in range(height):
+        start = y * (stride + 1)
+        ftype = raw[start]
+        line = bytearray(raw[start + 1:start + 1 + stride])
+
+        for i in range(stride):
+            a = line[i - bpp] if i >= bpp else 0
+            b = prev[i]
+            c = prev[i - bpp] if i >= bpp else 0
+            if ftype == 1:
+                line[i] = (line[i] + a) & 0xff
+            elif ftype == 2:
+                line[i] = (line[i] + b) & 0xff
+            elif ftype == 3:
+                line[i] = (line[i] + (a + b) // 2) & 0xff
+            elif ftype == 4:
+                line[i] = (line[i] + paeth(a, b, c)) & 0xff
+
+        row = []
+        for x in range(width):
+            px = line[x * bpp:(x + 1) * bpp]
+            if color == 0:
+                row.append((px[0], px[0], px[0], None))
+            elif color == 2:
+                row.append((px[0], px[1], px[2], None))
+            elif color == 4:
+                row.append((px[0], px[0], px[0], px[1]))
+            else:
+                row.append((px[0], px[1], px[2], px[3]))
+        rows.append(row)
+        prev = line
+
+    return width, height, rows
+
+
+def luminance(px):
+    r, g, b, a = px
+    if a is not None:
+        return a
+    return (r * 299 + g * 587 + b * 114) // 1000
+
+
+def convert_row(row, fmt):
+    bits = FORMATS[fmt][1]
+    out = bytearray()
+
+    if bits < 8:
+        per_byte = 8 // bits
+        for x in range(0, len(row), per_byte):
+            byte = 0
+            for i in range(per_byte):
+                # Leftmost pixel in the most significant bits
+                value = luminance(row[x + i]) >> (8 - bits) if x + i < len(row) else 0
+                byte |= value << (8 - bits * (i + 1))
+            out.append(byte)
+        return out
+
+    for px in row:
+        r, g, b, a = px
+        a = 255 if a is None else a
+        if fmt == 'L8':
+            out.append(luminance(px))
+        elif fmt == 'ARGB1555':
+            out += struct.pack('<H', (a >> 7) << 15 | (r >> 3) << 10 | (g >> 3) << 5 | b >> 3)
+        elif fmt == 'ARGB4':
+            out += struct.pack('<H', (a >> 4) << 12 | (r >> 4) << 8 | (g >> 4) << 4 | b >> 4)
+        elif fmt == 'RGB565':
+            out += struct.pack('<H', (r >> 3) << 11 | (g >> 2) << 5 | b >> 3)
+    return out
+
+
+class Asset:
+    def __init__(self, spec):
+        try:
+            self.name, self.fmt, cells, self.path = spec.split(':', 3)
+            self.cells = int(cells)
+        except ValueError:
+            raise ValueError(f'{spec}: expected NAME:FORMAT:CELLS:PNG')
+
+        if self.fmt not in FORMATS:
+            raise ValueError(f'{spec}: unknown format {self.fmt}')
+
+        width, height, rows = read_png(self.path)
+
+        if self.cells < 1 or height % self.cells:
+            raise ValueError(f'{self.path}: height {height} not divisible into {self.cells} cells')
+
+        self.width = width
+        self.height = height // self.cells
+        if self.width > MAX_SIZE or self.height > MAX_SIZE:
+            raise ValueError(f'{self.path}: cell {self.width}x{self.height} too large')
+
+        self.stride = (width * FORMATS[self.fmt][1] + 7) // 8
+        raw = b''.join(convert_row(row, self.fmt) for row in rows)
+        self.size = len(raw)
+        self.data = zlib.compress(raw, 9)
+
+
+def write_header(path, assets):
+    with open(path, 'w') as f:
+        f.write('/* Generated by scripts/ft8xx_assets.py, do not edit */\n\n')
+        f.write('#ifndef FT8XX_ASSETS_H_\n#define FT8XX_ASSETS_H_\n\n')
+        f.write('#include <stdint.h>\n\n')
+
+        f.write('enum ft8xx_asset_id {\n')
+        for a in assets:
+            f.write(f'    ASSET_{a.name.upper()},\n')
+        f.write('\n    ASSET_NUM\n};\n\n')
+
+        f.write('struct ft8xx_asset {\n')
+        f.write('    const uint8_t *data; // zlib stream\n')
+        f.write('    uint32_t data_len;\n')
+        f.write('    uint32_t size;       // Inflated size in RAM_G\n')
+        f.write('    uint8_t  format;\n')
+        f.write('    uint16_t stride;\n')
+        f.write('    uint16_t width;\n')
+        f.write('    uint16_t height;     // Height of a cell\n')
+        f.write('    uint8_t  cells;\n')
+        f.write('};\n\n')
+
+        for a in assets:
+            f.write(f'// {os.path.basename(a.path)}: {a.fmt}, {a.cells} cells of '
+                    f'{a.width}x{a.height}, {a.size} B inflated\n')
+            f.write(f'static const uint8_t asset_{a.name}[{len(a.data)}] = {{\n')
+            for i in range(0, len(a.data), 12):
+                f.write('    ' + ' '.join(f'0x{b:02x},' for b in a.data[i:i + 12]) + '\n')
+            f.write('};\n\n')
+
+        f.write('static const struct ft8xx_asset ft8xx_assets[ASSET_NUM] = {\n')
+        for a in assets:
+            f.write(f'    [ASSET_{a.name.upper()}] = {{\n')
+            f.write(f'        .data     = asset_{a.name},\n')
+            f.write(f'        .data_len = sizeof(asset_{a.name}),\n')
+            f.write(f'        .size     = {a.size},\n')
+            f.write(f'        .format   = {FORMATS[a.fmt][0]}, // {a.fmt}\n')
+            f.write(f'        .stride   = {a.stride},\n')
+            f.write(f'        .width    = {a.width},\n')
+            f.write(f'        .height   = {a.height},\n')
+            f.write(f'        .cells    = {a.cells},\n')
+            f.write('    },\n')
+        f.write('};\n\n#endif // FT8XX_ASSETS_H_\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('assets', nargs='+', help='NAME:FORMAT:CELLS:PNG')
+    parser.add_argument('-o', '--output', required=True, help='generated header')
+    args = parser.parse_args()
+
+    assets = [Asset(spec) for spec in args.assets]
+    write_header(args.output, assets)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
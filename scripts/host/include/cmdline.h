@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Command line options of native_sim, parsed by scripts/host/kernel.c */
+
+#ifndef HOST_CMDLINE_H_
+#define HOST_CMDLINE_H_
+
+#include <stdbool.h>
+
+struct args_struct_t {
+	bool is_mandatory;
+	bool is_switch;
+	char *option;
+	char *name;
+	char type;
+	void *dest;
+	void (*call_when_found)(char *argv, int offset);
+	char *descript;
+};
+
+#define ARG_TABLE_ENDMARKER { false, false, NULL, NULL, 0, NULL, NULL, NULL }
+
+void native_add_command_line_opts(struct args_struct_t *args);
+
+#endif // HOST_CMDLINE_H_
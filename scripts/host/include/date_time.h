@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_DATE_TIME_H_
+#define HOST_DATE_TIME_H_
+
+#include <stdint.h>
+#include <time.h>
+
+struct date_time_evt;
+
+typedef void (*date_time_evt_handler_t)(const struct date_time_evt *evt);
+
+int date_time_now(int64_t *unix_time_ms);
+int date_time_update_async(date_time_evt_handler_t evt_handler);
+
+#endif // HOST_DATE_TIME_H_
@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_OPENTHREAD_THREAD_H_
+#define HOST_OPENTHREAD_THREAD_H_
+
+typedef struct otInstance otInstance;
+
+#endif // HOST_OPENTHREAD_THREAD_H_
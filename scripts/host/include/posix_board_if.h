@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_POSIX_BOARD_IF_H_
+#define HOST_POSIX_BOARD_IF_H_
+
+void posix_exit(int exit_code);
+
+#endif // HOST_POSIX_BOARD_IF_H_
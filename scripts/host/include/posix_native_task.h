@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_POSIX_NATIVE_TASK_H_
+#define HOST_POSIX_NATIVE_TASK_H_
+
+// Tasks run before the command line is parsed, which is all PRE_BOOT_1 tasks need
+#define NATIVE_TASK(fn, level, prio)                                  \
+	__attribute__((constructor)) static void _native_task_##fn(void) \
+	{                                                                  \
+		fn();                                                      \
+	}
+
+#endif // HOST_POSIX_NATIVE_TASK_H_
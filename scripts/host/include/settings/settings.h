@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_SETTINGS_H_
+#define HOST_SETTINGS_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef ssize_t (*settings_read_cb)(void *cb_arg, void *data, size_t len);
+
+struct settings_handler {
+	const char *name;
+	int (*h_get)(const char *key, char *val, int val_len_max);
+	int (*h_set)(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg);
+	int (*h_commit)(void);
+	int (*h_export)(int (*export_func)(const char *name, const void *val, size_t val_len));
+};
+
+int settings_save_one(const char *name, const void *value, size_t val_len);
+
+#endif // HOST_SETTINGS_H_
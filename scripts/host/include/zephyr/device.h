@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Devices of the nodes used by the app sources are defined by the harnesses as __device_<label>,
+ * e.g. __device_m0 for DT_NODELABEL(m0). Phandles of driver instances point at the adc node.
+ */
+
+#ifndef HOST_DEVICE_H_
+#define HOST_DEVICE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
+struct device {
+	const char *name;
+	const void *config;
+	const void *api;
+	void *data;
+};
+
+#define DT_NODELABEL(label)   label
+#define DT_NODE_EXISTS(node)  0
+#define DEVICE_DT_GET(node)   Z_DEVICE_DT_GET(node)
+#define Z_DEVICE_DT_GET(node) (&__device_##node)
+
+#define DT_INST_PHANDLE(inst, prop)                 DT_NODELABEL(adc)
+#define DT_INST_IO_CHANNELS_INPUT_BY_IDX(inst, idx) 0
+#define DT_INST_FOREACH_STATUS_OKAY(fn)             fn(0)
+
+#define DEVICE_DT_INST_GET(inst) (&Z_UTIL_CAT(__device_dt_inst_, inst))
+#define DEVICE_DT_INST_DEFINE(inst, init_fn, pm, data_ptr, cfg_ptr, level, prio, api_ptr)      \
+	const struct device Z_UTIL_CAT(__device_dt_inst_, inst) = {                               \
+		.name = STRINGIFY(DT_DRV_COMPAT), .config = (cfg_ptr), .api = (api_ptr),          \
+		.data = (data_ptr),                                                               \
+	}
+
+extern const struct device __device_adc;
+extern const struct device __device_ft800;
+extern const struct device __device_m0;
+extern const struct device __device_m1;
+
+bool device_is_ready(const struct device *dev);
+
+#endif // HOST_DEVICE_H_
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_ADC_H_
+#define HOST_ADC_H_
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+
+enum adc_gain {
+	ADC_GAIN_1_4,
+};
+
+enum adc_reference {
+	ADC_REF_VDD_1_4,
+};
+
+#define ADC_ACQ_TIME_DEFAULT 0
+
+struct adc_channel_cfg {
+	enum adc_gain gain;
+	enum adc_reference reference;
+	uint16_t acquisition_time;
+	uint8_t channel_id;
+};
+
+struct adc_sequence_options {
+	uint32_t interval_us;
+	uint16_t extra_samplings;
+};
+
+struct adc_sequence {
+	const struct adc_sequence_options *options;
+	uint32_t channels;
+	void *buffer;
+	size_t buffer_size;
+	uint8_t resolution;
+};
+
+static inline int adc_channel_setup(const struct device *dev, const struct adc_channel_cfg *cfg)
+{
+	return 0;
+}
+
+// Samples are fed to the drivers by the harnesses, not read from the ADC
+static inline int adc_read(const struct device *dev, const struct adc_sequence *sequence)
+{
+	return -ENOTSUP;
+}
+
+#endif // HOST_ADC_H_
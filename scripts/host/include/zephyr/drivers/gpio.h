@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_GPIO_H_
+#define HOST_GPIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+
+struct gpio_dt_spec {
+	const struct device *port;
+	uint8_t pin;
+	uint16_t dt_flags;
+};
+
+typedef uint32_t gpio_flags_t;
+
+#define GPIO_OUTPUT          BIT(17)
+#define GPIO_OUTPUT_INIT_LOW BIT(18)
+#define GPIO_OUTPUT_INACTIVE (GPIO_OUTPUT | GPIO_OUTPUT_INIT_LOW)
+
+// The relay of the controller simulation is the only GPIO
+extern const struct device sim_gpio0;
+
+#define GPIO_DT_SPEC_GET(node, prop) { .port = &sim_gpio0, .pin = 0 }
+
+bool gpio_is_ready_dt(const struct gpio_dt_spec *spec);
+int gpio_pin_configure_dt(const struct gpio_dt_spec *spec, gpio_flags_t extra_flags);
+int gpio_pin_set_dt(const struct gpio_dt_spec *spec, int value);
+int gpio_pin_toggle_dt(const struct gpio_dt_spec *spec);
+
+#endif // HOST_GPIO_H_
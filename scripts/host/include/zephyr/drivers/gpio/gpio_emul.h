@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_GPIO_EMUL_H_
+#define HOST_GPIO_EMUL_H_
+
+#include <zephyr/drivers/gpio.h>
+
+int gpio_emul_output_get(const struct device *port, uint8_t pin);
+
+#endif // HOST_GPIO_EMUL_H_
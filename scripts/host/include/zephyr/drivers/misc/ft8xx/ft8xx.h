@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_FT8XX_H_
+#define HOST_FT8XX_H_
+
+#include <stdint.h>
+
+#include <zephyr/device.h>
+
+typedef void (*ft8xx_int_callback)(void);
+
+void ft8xx_register_int(ft8xx_int_callback callback);
+uint32_t ft8xx_get_tracker_value(void);
+
+#endif // HOST_FT8XX_H_
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_FT8XX_COMMON_H_
+#define HOST_FT8XX_COMMON_H_
+
+#include <stdint.h>
+
+// Register access of the fake FT800 of the harness
+void ft8xx_wr8(uint32_t address, uint8_t data);
+void ft8xx_wr16(uint32_t address, uint16_t data);
+void ft8xx_wr32(uint32_t address, uint32_t data);
+uint8_t ft8xx_rd8(uint32_t address);
+uint16_t ft8xx_rd16(uint32_t address);
+uint32_t ft8xx_rd32(uint32_t address);
+
+#endif // HOST_FT8XX_COMMON_H_
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Co-processor commands of the ft8xx driver, used by the unbatched implementation of
+ * temp_tscrn/src/copro_buf.c. Defined by the harness faking the driver.
+ */
+
+#ifndef HOST_FT8XX_COPRO_H_
+#define HOST_FT8XX_COPRO_H_
+
+#include <stdint.h>
+
+#define OPT_3D      0
+#define OPT_FLAT    256
+#define OPT_CENTERX 512
+#define OPT_CENTERY 1024
+#define OPT_CENTER  1536
+#define OPT_RIGHTX  2048
+
+void ft8xx_copro_cmd(uint32_t cmd);
+void ft8xx_copro_cmd_dlstart(void);
+void ft8xx_copro_cmd_swap(void);
+void ft8xx_copro_cmd_bgcolor(uint32_t c);
+void ft8xx_copro_cmd_fgcolor(uint32_t c);
+void ft8xx_copro_cmd_text(int16_t x, int16_t y, int16_t font, uint16_t options, const char *s);
+void ft8xx_copro_cmd_number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n);
+void ft8xx_copro_cmd_slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options,
+			    uint16_t val, uint16_t range);
+void ft8xx_copro_cmd_toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options,
+			    uint16_t state, const char *s);
+void ft8xx_copro_cmd_track(int16_t x, int16_t y, int16_t w, int16_t h, int16_t tag);
+
+#endif // HOST_FT8XX_COPRO_H_
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_FT8XX_DL_H_
+#define HOST_FT8XX_DL_H_
+
+#define BITMAPS    1
+#define POINTS     2
+#define LINES      3
+#define LINE_STRIP 4
+#define RECTS      9
+
+#define VERTEX2F(x, y) ((1UL << 30) | (((x) & 32767UL) << 15) | ((y) & 32767UL))
+#define VERTEX2II(x, y, handle, cell) \
+	((2UL << 30) | (((x) & 511UL) << 21) | (((y) & 511UL) << 12) | (((handle) & 31UL) << 7) | \
+	 ((cell) & 127UL))
+#define DISPLAY() (0UL << 24)
+#define CLEAR_COLOR_RGB(red, green, blue) \
+	((2UL << 24) | (((red) & 255UL) << 16) | (((green) & 255UL) << 8) | ((blue) & 255UL))
+#define TAG(s) ((3UL << 24) | ((s) & 255UL))
+#define COLOR_RGB(red, green, blue) \
+	((4UL << 24) | (((red) & 255UL) << 16) | (((green) & 255UL) << 8) | ((blue) & 255UL))
+#define LINE_WIDTH(width) ((14UL << 24) | ((width) & 4095UL))
+#define BEGIN(prim) ((31UL << 24) | ((prim) & 15UL))
+#define END() (33UL << 24)
+#define CLEAR(c, s, t) ((38UL << 24) | (((c) & 1UL) << 2) | (((s) & 1UL) << 1) | ((t) & 1UL))
+
+#endif // HOST_FT8XX_DL_H_
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_FT8XX_MEMORY_H_
+#define HOST_FT8XX_MEMORY_H_
+
+#define RAM_G   0x000000UL
+#define RAM_DL  0x100000UL
+#define RAM_CMD 0x108000UL
+
+#define REG_INT_FLAGS 0x102498UL
+#define REG_INT_MASK  0x1024a0UL
+#define REG_PWM_DUTY  0x1024c0UL
+#define REG_CMD_READ  0x1024e4UL
+#define REG_CMD_WRITE 0x1024e8UL
+#define REG_CMD_DL    0x1024ecUL
+#define REG_TOUCH_TAG 0x102518UL
+#define REG_TRACKER   0x109000UL
+
+#endif // HOST_FT8XX_MEMORY_H_
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_FT8XX_REFERENCE_API_H_
+#define HOST_FT8XX_REFERENCE_API_H_
+
+#include <zephyr/drivers/misc/ft8xx/ft8xx_common.h>
+
+static inline void wr8(uint32_t address, uint8_t data)
+{
+	ft8xx_wr8(address, data);
+}
+
+static inline void wr16(uint32_t address, uint16_t data)
+{
+	ft8xx_wr16(address, data);
+}
+
+static inline void wr32(uint32_t address, uint32_t data)
+{
+	ft8xx_wr32(address, data);
+}
+
+static inline uint8_t rd8(uint32_t address)
+{
+	return ft8xx_rd8(address);
+}
+
+static inline uint16_t rd16(uint32_t address)
+{
+	return ft8xx_rd16(address);
+}
+
+static inline uint32_t rd32(uint32_t address)
+{
+	return ft8xx_rd32(address);
+}
+
+#endif // HOST_FT8XX_REFERENCE_API_H_
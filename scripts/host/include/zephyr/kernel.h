@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host replacement of the Zephyr kernel shared by the harnesses in scripts, implemented by
+ * scripts/host/kernel.c for the harnesses running threads. Its threads are switched only when they
+ * block, in the order of their priorities, and time advances only when all threads are blocked.
+ * Cycles are nanoseconds of the host clock, so that the data dispatcher statistics measure the host
+ * execution time.
+ *
+ * Harnesses calling single functions of the app sources do not link the kernel. They define the
+ * few functions they call, the rest is dropped by the linker with --gc-sections.
+ */
+
+#ifndef HOST_KERNEL_H_
+#define HOST_KERNEL_H_
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+typedef struct {
+	int64_t ms;
+} k_timeout_t;
+
+typedef int64_t k_ticks_t;
+
+#define K_FOREVER ((k_timeout_t){ -1 })
+#define K_NO_WAIT ((k_timeout_t){ 0 })
+#define K_MSEC(ms) ((k_timeout_t){ (ms) })
+#define K_SECONDS(s) ((k_timeout_t){ (s) * 1000LL })
+#define K_MINUTES(m) K_SECONDS((m) * 60LL)
+#define K_TICKS_FOREVER (-1)
+#define K_ESSENTIAL 0
+
+#define MSEC_PER_SEC 1000
+
+int64_t k_uptime_get(void);
+uint32_t k_uptime_get_32(void);
+uint32_t k_cycle_get_32(void);
+
+static inline uint32_t k_cyc_to_us_ceil32(uint32_t cyc)
+{
+	return (cyc + 999U) / 1000U;
+}
+
+static inline uint64_t k_cyc_to_us_ceil64(uint64_t cyc)
+{
+	return (cyc + 999U) / 1000U;
+}
+
+static inline uint32_t k_cyc_to_us_floor32(uint32_t cyc)
+{
+	return cyc / 1000U;
+}
+
+static inline uint64_t k_cyc_to_us_floor64(uint64_t cyc)
+{
+	return cyc / 1000U;
+}
+
+void *k_malloc(size_t size);
+void k_free(void *ptr);
+
+typedef void (*k_thread_entry_t)(void *p1, void *p2, void *p3);
+
+enum sim_thread_state {
+	SIM_THREAD_DORMANT,
+	SIM_THREAD_READY,
+	SIM_THREAD_SLEEPING,
+	SIM_THREAD_WAITING,
+};
+
+struct k_thread {
+	const char *name;
+	k_thread_entry_t entry;
+	void *p1;
+	void *p2;
+	void *p3;
+	int prio;
+	enum sim_thread_state state;
+	int64_t wakeup;      // Virtual time of the end of sleep
+	int64_t ready_seq;   // Order of ready threads of the same priority
+	const void *wait_on; // Object the waiting thread is blocked on
+	ucontext_t ctx;
+	void *stack;
+	struct k_thread *next;
+};
+
+typedef struct k_thread *k_tid_t;
+
+// Threads of K_THREAD_DEFINE, created by the kernel before main() of the app
+struct sim_thread_init {
+	struct k_thread *thread;
+	const char *name;
+	k_thread_entry_t entry;
+	void *p1;
+	void *p2;
+	void *p3;
+	int prio;
+	int delay;
+};
+
+void sim_thread_define(struct k_thread *thread, const char *name, k_thread_entry_t entry,
+		       void *p1, void *p2, void *p3, int prio, int delay);
+
+// Kept in a section only if the kernel is linked, the linker drops it from other harnesses.
+// Natural alignment keeps the section an array, the compiler aligns large objects further.
+#define K_THREAD_DEFINE(name, stack_size, entry, p1, p2, p3, prio, options, delay)             \
+	static struct k_thread _k_thread_obj_##name;                                              \
+	const k_tid_t name = &_k_thread_obj_##name;                                               \
+	static const struct sim_thread_init _k_thread_init_##name                                 \
+		__attribute__((section("sim_thread_init"), used,                                  \
+			       aligned(__alignof__(struct sim_thread_init)))) = {                 \
+			&_k_thread_obj_##name, #name, entry, p1, p2, p3, prio, delay,             \
+	}
+
+#define K_KERNEL_STACK_DEFINE(name, size) char name[size]
+#define K_KERNEL_STACK_MEMBER(name, size) char name[size]
+#define K_KERNEL_STACK_SIZEOF(name) sizeof(name)
+#define K_THREAD_STACK_DEFINE(name, size) char name[size]
+#define K_THREAD_STACK_SIZEOF(name) sizeof(name)
+
+k_tid_t k_thread_create(struct k_thread *thread, char *stack, size_t stack_size,
+			k_thread_entry_t entry, void *p1, void *p2, void *p3, int prio,
+			uint32_t options, k_timeout_t delay);
+void k_thread_start(k_tid_t thread);
+int32_t k_sleep(k_timeout_t timeout);
+
+struct k_spinlock {
+	int unused;
+};
+
+typedef int k_spinlock_key_t;
+
+// Threads made ready while a spinlock is held preempt the current one when it is released
+k_spinlock_key_t k_spin_lock(struct k_spinlock *lock);
+void k_spin_unlock(struct k_spinlock *lock, k_spinlock_key_t key);
+
+struct k_mutex {
+	k_tid_t owner;
+	uint32_t lock_count;
+};
+
+#define K_MUTEX_DEFINE(name) struct k_mutex name = { 0 }
+
+int k_mutex_lock(struct k_mutex *mutex, k_timeout_t timeout);
+int k_mutex_unlock(struct k_mutex *mutex);
+
+struct k_sem {
+	unsigned int count;
+	unsigned int limit;
+};
+
+#define K_SEM_DEFINE(name, initial, max) struct k_sem name = { (initial), (max) }
+
+int k_sem_take(struct k_sem *sem, k_timeout_t timeout);
+void k_sem_give(struct k_sem *sem);
+void k_sem_reset(struct k_sem *sem);
+
+struct k_timer {
+	void (*expiry_fn)(struct k_timer *timer);
+};
+
+#define K_TIMER_DEFINE(name, expiry, stop) struct k_timer name = { (expiry) }
+
+void k_timer_start(struct k_timer *timer, k_timeout_t duration, k_timeout_t period);
+void k_timer_stop(struct k_timer *timer);
+
+struct k_work;
+struct k_work_q;
+
+typedef void (*k_work_handler_t)(struct k_work *work);
+
+struct k_work {
+	k_work_handler_t handler;
+	struct k_work_q *queue;
+	bool queued;
+	struct k_work *next;
+};
+
+struct k_work_delayable {
+	struct k_work work;
+	bool scheduled;
+	int64_t expiry;
+	struct k_work_delayable *next_timer;
+};
+
+struct k_work_q {
+	struct k_thread thread;
+	struct k_work *head;
+	struct k_work *tail;
+};
+
+struct k_work_queue_config {
+	const char *name;
+};
+
+#define K_WORK_DEFINE(name, work_handler) struct k_work name = { .handler = (work_handler) }
+#define K_WORK_DELAYABLE_DEFINE(name, work_handler) \
+	struct k_work_delayable name = { .work = { .handler = (work_handler) } }
+
+void k_work_init(struct k_work *work, k_work_handler_t handler);
+int k_work_submit(struct k_work *work);
+int k_work_submit_to_queue(struct k_work_q *queue, struct k_work *work);
+bool k_work_cancel(struct k_work *work);
+void k_work_init_delayable(struct k_work_delayable *dwork, k_work_handler_t handler);
+int k_work_schedule(struct k_work_delayable *dwork, k_timeout_t delay);
+int k_work_reschedule(struct k_work_delayable *dwork, k_timeout_t delay);
+int k_work_reschedule_for_queue(struct k_work_q *queue, struct k_work_delayable *dwork,
+				k_timeout_t delay);
+int k_work_cancel_delayable(struct k_work_delayable *dwork);
+void k_work_queue_start(struct k_work_q *queue, void *stack, size_t stack_size, int prio,
+			const struct k_work_queue_config *cfg);
+
+// Blocks the current thread until sim_wake() is called with the same object
+void sim_wait(const void *obj);
+void sim_wake(const void *obj);
+
+#endif // HOST_KERNEL_H_
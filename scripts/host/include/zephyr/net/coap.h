@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_COAP_H_
+#define HOST_COAP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/net/socket.h>
+
+#define COAP_TOKEN_MAX_LEN 8
+
+enum coap_option_num {
+	COAP_OPTION_URI_PATH = 11,
+	COAP_OPTION_CONTENT_FORMAT = 12,
+	COAP_OPTION_URI_QUERY = 15,
+	COAP_OPTION_ACCEPT = 17,
+	COAP_OPTION_BLOCK2 = 23,
+	COAP_OPTION_BLOCK1 = 27,
+	COAP_OPTION_SIZE2 = 28,
+	COAP_OPTION_SIZE1 = 60,
+};
+
+enum coap_method {
+	COAP_METHOD_GET = 1,
+	COAP_METHOD_POST = 2,
+	COAP_METHOD_PUT = 3,
+	COAP_METHOD_DELETE = 4,
+};
+
+enum coap_msgtype {
+	COAP_TYPE_CON = 0,
+	COAP_TYPE_NON_CON = 1,
+	COAP_TYPE_ACK = 2,
+	COAP_TYPE_RESET = 3,
+};
+
+#define COAP_MAKE_RESPONSE_CODE(class, det) (((class) << 5) | (det))
+
+enum coap_response_code {
+	COAP_RESPONSE_CODE_OK = COAP_MAKE_RESPONSE_CODE(2, 0),
+	COAP_RESPONSE_CODE_CREATED = COAP_MAKE_RESPONSE_CODE(2, 1),
+	COAP_RESPONSE_CODE_DELETED = COAP_MAKE_RESPONSE_CODE(2, 2),
+	COAP_RESPONSE_CODE_VALID = COAP_MAKE_RESPONSE_CODE(2, 3),
+	COAP_RESPONSE_CODE_CHANGED = COAP_MAKE_RESPONSE_CODE(2, 4),
+	COAP_RESPONSE_CODE_CONTENT = COAP_MAKE_RESPONSE_CODE(2, 5),
+	COAP_RESPONSE_CODE_CONTINUE = COAP_MAKE_RESPONSE_CODE(2, 31),
+	COAP_RESPONSE_CODE_BAD_REQUEST = COAP_MAKE_RESPONSE_CODE(4, 0),
+	COAP_RESPONSE_CODE_NOT_FOUND = COAP_MAKE_RESPONSE_CODE(4, 4),
+	COAP_RESPONSE_CODE_NOT_ALLOWED = COAP_MAKE_RESPONSE_CODE(4, 5),
+	COAP_RESPONSE_CODE_INCOMPLETE = COAP_MAKE_RESPONSE_CODE(4, 8),
+	COAP_RESPONSE_CODE_REQUEST_TOO_LARGE = COAP_MAKE_RESPONSE_CODE(4, 13),
+	COAP_RESPONSE_CODE_UNSUPPORTED_CONTENT_FORMAT = COAP_MAKE_RESPONSE_CODE(4, 15),
+	COAP_RESPONSE_CODE_INTERNAL_ERROR = COAP_MAKE_RESPONSE_CODE(5, 0),
+	COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE = COAP_MAKE_RESPONSE_CODE(5, 3),
+};
+
+enum coap_content_format {
+	COAP_CONTENT_FORMAT_TEXT_PLAIN = 0,
+	COAP_CONTENT_FORMAT_APP_OCTET_STREAM = 42,
+	COAP_CONTENT_FORMAT_APP_CBOR = 60,
+};
+
+enum coap_block_size {
+	COAP_BLOCK_16,
+	COAP_BLOCK_32,
+	COAP_BLOCK_64,
+	COAP_BLOCK_128,
+	COAP_BLOCK_256,
+	COAP_BLOCK_512,
+	COAP_BLOCK_1024,
+};
+
+struct coap_packet {
+	uint8_t *data;
+	uint16_t offset;
+	uint16_t max_len;
+	uint8_t hdr_len;
+	uint16_t opt_len;
+	uint16_t delta;
+};
+
+struct coap_option {
+	uint16_t delta;
+	uint8_t len;
+	uint8_t value[12];
+};
+
+struct coap_block_context {
+	size_t total_size;
+	size_t current;
+	enum coap_block_size block_size;
+};
+
+struct coap_resource;
+struct coap_observer;
+
+typedef int (*coap_method_t)(struct coap_resource *resource, struct coap_packet *request,
+			     struct sockaddr *addr, socklen_t addr_len);
+
+struct coap_resource {
+	coap_method_t get, post, put, del, fetch, patch, ipatch;
+	void (*notify)(struct coap_resource *resource, struct coap_observer *observer);
+	const char * const *path;
+	void *user_data;
+};
+
+int coap_packet_init(struct coap_packet *cpkt, uint8_t *data, uint16_t max_len, uint8_t ver,
+		     uint8_t type, uint8_t token_len, const uint8_t *token, uint8_t code,
+		     uint16_t id);
+int coap_packet_parse(struct coap_packet *cpkt, uint8_t *data, uint16_t len,
+		      struct coap_option *options, uint8_t opt_num);
+int coap_packet_append_option(struct coap_packet *cpkt, uint16_t code, const uint8_t *value,
+			      uint16_t len);
+int coap_append_option_int(struct coap_packet *cpkt, uint16_t code, unsigned int val);
+int coap_packet_append_payload_marker(struct coap_packet *cpkt);
+int coap_packet_append_payload(struct coap_packet *cpkt, const uint8_t *payload,
+			       uint16_t payload_len);
+const uint8_t *coap_packet_get_payload(const struct coap_packet *cpkt, uint16_t *len);
+int coap_find_options(const struct coap_packet *cpkt, uint16_t code, struct coap_option *options,
+		      uint16_t veclen);
+unsigned int coap_option_value_to_int(const struct coap_option *option);
+uint8_t coap_header_get_type(const struct coap_packet *cpkt);
+uint8_t coap_header_get_code(const struct coap_packet *cpkt);
+uint16_t coap_header_get_id(const struct coap_packet *cpkt);
+uint8_t coap_header_get_token(const struct coap_packet *cpkt, uint8_t *token);
+int coap_handle_request(struct coap_packet *cpkt, struct coap_resource *resources,
+			struct coap_option *options, uint8_t opt_num, struct sockaddr *addr,
+			socklen_t addr_len);
+uint8_t *coap_next_token(void);
+uint16_t coap_next_id(void);
+
+#endif // HOST_COAP_H_
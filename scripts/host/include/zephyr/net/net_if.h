@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_NET_IF_H_
+#define HOST_NET_IF_H_
+
+#include <stdbool.h>
+
+struct net_if;
+
+typedef void (*net_if_cb_t)(struct net_if *iface, void *user_data);
+
+bool net_if_is_up(struct net_if *iface);
+void net_if_foreach(net_if_cb_t cb, void *user_data);
+
+#endif // HOST_NET_IF_H_
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_SOCKET_H_
+#define HOST_SOCKET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include <zephyr/kernel.h>
+
+#define AF_INET6         10
+#define SOCK_DGRAM       2
+#define IPPROTO_IPV6     41
+#define IPPROTO_UDP      17
+#define IPPROTO_DTLS_1_2 273
+#define SOL_SOCKET       1
+#define SO_RCVTIMEO      20
+#define SOL_TLS          282
+#define TLS_SEC_TAG_LIST 1
+#define TLS_DTLS_ROLE    6
+#define TLS_DTLS_ROLE_SERVER 1
+#define IPV6_ADD_MEMBERSHIP 20
+#define IPV6_MULTICAST_HOPS 18
+
+typedef unsigned short sa_family_t;
+typedef size_t socklen_t;
+
+struct in6_addr {
+	uint8_t s6_addr[16];
+};
+
+struct sockaddr {
+	sa_family_t sa_family;
+	char data[26];
+};
+
+struct sockaddr_in6 {
+	sa_family_t sin6_family;
+	uint16_t sin6_port;
+	struct in6_addr sin6_addr;
+	uint8_t sin6_scope_id;
+};
+
+struct ipv6_mreq {
+	struct in6_addr ipv6mr_multiaddr;
+	int ipv6mr_ifindex;
+};
+
+struct pollfd {
+	int fd;
+	short events;
+	short revents;
+};
+
+#define POLLIN 1
+
+int socket(int family, int type, int proto);
+int bind(int sock, const struct sockaddr *addr, socklen_t addrlen);
+int close(int sock);
+int poll(struct pollfd *fds, int nfds, int timeout);
+ssize_t send(int sock, const void *buf, size_t len, int flags);
+ssize_t sendto(int sock, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr,
+	       socklen_t addrlen);
+ssize_t recvfrom(int sock, void *buf, size_t max_len, int flags, struct sockaddr *src_addr,
+		 socklen_t *addrlen);
+int setsockopt(int sock, int level, int optname, const void *optval, socklen_t optlen);
+int getsockopt(int sock, int level, int optname, void *optval, socklen_t *optlen);
+int inet_pton(int family, const char *src, void *dst);
+
+uint16_t htons(uint16_t value);
+uint16_t ntohs(uint16_t value);
+
+bool net_ipv6_is_addr_unspecified(const struct in6_addr *addr);
+bool net_ipv6_is_ll_addr(const struct in6_addr *addr);
+bool net_ipv6_is_addr_mcast_scope(const struct in6_addr *addr, int scope);
+
+#endif // HOST_SOCKET_H_
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_TLS_CREDENTIALS_H_
+#define HOST_TLS_CREDENTIALS_H_
+
+#include <stddef.h>
+
+typedef int sec_tag_t;
+
+enum tls_credential_type {
+	TLS_CREDENTIAL_PSK,
+	TLS_CREDENTIAL_PSK_ID,
+};
+
+int tls_credential_add(sec_tag_t tag, enum tls_credential_type type, const void *cred,
+		       size_t credlen);
+
+#endif // HOST_TLS_CREDENTIALS_H_
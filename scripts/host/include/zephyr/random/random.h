@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_RANDOM_H_
+#define HOST_RANDOM_H_
+
+#include <stdint.h>
+
+uint32_t sys_rand32_get(void);
+
+#endif // HOST_RANDOM_H_
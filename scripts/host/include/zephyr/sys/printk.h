@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_PRINTK_H_
+#define HOST_PRINTK_H_
+
+#include <stdio.h>
+
+#define printk printf
+
+#endif // HOST_PRINTK_H_
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_UTIL_H_
+#define HOST_UTIL_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUILD_ASSERT(cond, ...) _Static_assert(cond, #cond)
+#define __ASSERT(cond, ...) assert(cond)
+#define __ASSERT_NO_MSG(cond) assert(cond)
+#define __aligned(x) __attribute__((aligned(x)))
+
+#define BIT(n) (1UL << (n))
+#define BIT_MASK(n) (BIT(n) - 1UL)
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+#define CONTAINER_OF(ptr, type, field) ((type *)(((char *)(ptr)) - offsetof(type, field)))
+#define ROUND_UP(x, align) ((((x) + (align) - 1) / (align)) * (align))
+
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define Z_STRINGIFY(x) #x
+#define STRINGIFY(s) Z_STRINGIFY(s)
+
+#define Z_UTIL_PRIMCAT(a, b) a##b
+#define Z_UTIL_CAT(a, b) Z_UTIL_PRIMCAT(a, b)
+#define Z_DEBRACKET(...) __VA_ARGS__
+
+// IS_ENABLED() of Zephyr: 1 if the macro is defined to 1, 0 otherwise
+#define IS_ENABLED(config_macro) _IS_ENABLED1(config_macro)
+#define _IS_ENABLED1(config_macro) _IS_ENABLED2(_XXXX##config_macro)
+#define _XXXX1 _YYYY,
+#define _IS_ENABLED2(one_or_two_args) _IS_ENABLED3(one_or_two_args 1, 0)
+#define _IS_ENABLED3(ignore_this, val, ...) val
+
+// LISTIFY of Zephyr, up to 8 elements, enough for CONFIG_DATA_ZONES
+#define LISTIFY(LEN, F, sep, ...) Z_UTIL_CAT(Z_LISTIFY_, LEN)(F, sep, __VA_ARGS__)
+
+#define Z_LISTIFY_1(F, sep, ...) F(0, __VA_ARGS__)
+#define Z_LISTIFY_2(F, sep, ...) Z_LISTIFY_1(F, sep, __VA_ARGS__) Z_DEBRACKET sep F(1, __VA_ARGS__)
+#define Z_LISTIFY_3(F, sep, ...) Z_LISTIFY_2(F, sep, __VA_ARGS__) Z_DEBRACKET sep F(2, __VA_ARGS__)
+#define Z_LISTIFY_4(F, sep, ...) Z_LISTIFY_3(F, sep, __VA_ARGS__) Z_DEBRACKET sep F(3, __VA_ARGS__)
+#define Z_LISTIFY_5(F, sep, ...) Z_LISTIFY_4(F, sep, __VA_ARGS__) Z_DEBRACKET sep F(4, __VA_ARGS__)
+#define Z_LISTIFY_6(F, sep, ...) Z_LISTIFY_5(F, sep, __VA_ARGS__) Z_DEBRACKET sep F(5, __VA_ARGS__)
+#define Z_LISTIFY_7(F, sep, ...) Z_LISTIFY_6(F, sep, __VA_ARGS__) Z_DEBRACKET sep F(6, __VA_ARGS__)
+#define Z_LISTIFY_8(F, sep, ...) Z_LISTIFY_7(F, sep, __VA_ARGS__) Z_DEBRACKET sep F(7, __VA_ARGS__)
+
+#endif // HOST_UTIL_H_
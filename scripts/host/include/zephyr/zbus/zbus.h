@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Channels are locked while their listeners run, like in zbus. Publishing to or reading a channel
+ * locked by the same thread aborts the simulation as a deadlock.
+ */
+
+#ifndef HOST_ZBUS_H_
+#define HOST_ZBUS_H_
+
+#include <stddef.h>
+
+#include <zephyr/kernel.h>
+
+struct zbus_channel;
+
+struct zbus_observer {
+	const char *name;
+	void (*callback)(const struct zbus_channel *chan);
+};
+
+struct zbus_channel_data {
+	k_tid_t owner;
+};
+
+struct zbus_channel {
+	const char *name;
+	void *message;
+	size_t message_size;
+	void *user_data;
+	const struct zbus_observer *const *observers;
+	struct zbus_channel_data *data;
+};
+
+#define ZBUS_LISTENER_DEFINE(_name, _cb) \
+	const struct zbus_observer _name = { .name = #_name, .callback = (_cb) }
+
+// Observers are referenced by address, the simulation uses a single observer per channel
+#define ZBUS_OBSERVERS(_obs) &_obs
+#define ZBUS_MSG_INIT(...) { __VA_ARGS__ }
+
+#define ZBUS_CHAN_DEFINE(_name, _type, _validator, _user_data, _observers, _init_val)          \
+	static _type _name##_msg = _init_val;                                                      \
+	static struct zbus_channel_data _name##_data;                                              \
+	static const struct zbus_observer *const _name##_obs_list[] = { _observers, NULL };      \
+	const struct zbus_channel _name = {                                                        \
+		.name = #_name,                                                                    \
+		.message = &_name##_msg,                                                           \
+		.message_size = sizeof(_type),                                                     \
+		.user_data = (_user_data),                                                         \
+		.observers = _name##_obs_list,                                                    \
+		.data = &_name##_data,                                                             \
+	}
+
+#define Z_ZBUS_CHAN_DECLARE(_name) extern const struct zbus_channel _name
+#define ZBUS_CHAN_DECLARE(...) FOR_EACH_CHAN(Z_ZBUS_CHAN_DECLARE, __VA_ARGS__)
+
+#define FOR_EACH_CHAN(F, ...) \
+	Z_UTIL_CAT(Z_FOR_EACH_CHAN_, Z_NUM_ARGS(__VA_ARGS__))(F, __VA_ARGS__)
+#define Z_NUM_ARGS(...) Z_NUM_ARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1)
+#define Z_NUM_ARGS_(_1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+#define Z_FOR_EACH_CHAN_1(F, a) F(a)
+#define Z_FOR_EACH_CHAN_2(F, a, ...) F(a); Z_FOR_EACH_CHAN_1(F, __VA_ARGS__)
+#define Z_FOR_EACH_CHAN_3(F, a, ...) F(a); Z_FOR_EACH_CHAN_2(F, __VA_ARGS__)
+#define Z_FOR_EACH_CHAN_4(F, a, ...) F(a); Z_FOR_EACH_CHAN_3(F, __VA_ARGS__)
+#define Z_FOR_EACH_CHAN_5(F, a, ...) F(a); Z_FOR_EACH_CHAN_4(F, __VA_ARGS__)
+#define Z_FOR_EACH_CHAN_6(F, a, ...) F(a); Z_FOR_EACH_CHAN_5(F, __VA_ARGS__)
+#define Z_FOR_EACH_CHAN_7(F, a, ...) F(a); Z_FOR_EACH_CHAN_6(F, __VA_ARGS__)
+#define Z_FOR_EACH_CHAN_8(F, a, ...) F(a); Z_FOR_EACH_CHAN_7(F, __VA_ARGS__)
+
+static inline void *zbus_chan_user_data(const struct zbus_channel *chan)
+{
+	return chan->user_data;
+}
+
+static inline const void *zbus_chan_const_msg(const struct zbus_channel *chan)
+{
+	return chan->message;
+}
+
+static inline size_t zbus_chan_msg_size(const struct zbus_channel *chan)
+{
+	return chan->message_size;
+}
+
+int zbus_chan_pub(const struct zbus_channel *chan, const void *msg, k_timeout_t timeout);
+int zbus_chan_read(const struct zbus_channel *chan, void *msg, k_timeout_t timeout);
+
+#endif // HOST_ZBUS_H_
@@ -0,0 +1,677 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host replacement of the kernel, zbus, GPIO and native_sim board of temp_tscrn/sim, built by
+ * scripts/ctlr_bench.py --host and scripts/dispatcher_bench.py. The app sources are compiled
+ * unchanged, main() of the app is renamed to app_main() and runs in the main thread.
+ *
+ * Threads are ucontext coroutines with virtual time. The ready thread of the highest priority
+ * runs until it blocks. A thread made ready by the running one preempts it if its priority is
+ * higher. When no thread is ready, time jumps to the nearest wakeup or work timeout. If nothing
+ * can wake any thread, the simulation is deadlocked and aborted.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/zbus/zbus.h>
+
+#include "cmdline.h"
+#include "posix_board_if.h"
+
+#define THREAD_STACK_SIZE (256 * 1024)
+#define MAIN_THREAD_PRIO  0
+#define MAX_OPT_TABLES    8
+
+int app_main(void);
+
+// Bounds of the section of K_THREAD_DEFINE, null if no thread is defined
+extern const struct sim_thread_init __start_sim_thread_init[] __attribute__((weak));
+extern const struct sim_thread_init __stop_sim_thread_init[] __attribute__((weak));
+
+static struct k_thread *threads;
+static struct k_thread *current;
+static struct k_thread main_thread;
+static struct k_work_delayable *timers;
+static ucontext_t sched_ctx;
+static int64_t now_ms;
+static int64_t ready_seq;
+static int64_t preempted_seq;
+static int spin_depth;
+
+static struct args_struct_t *opt_tables[MAX_OPT_TABLES];
+static int opt_tables_num;
+
+const struct device sim_gpio0 = {
+	.name = "gpio0",
+};
+
+static int gpio_level;
+
+static void sim_abort(const char *msg)
+{
+	fprintf(stderr, "sim: %s at %lld ms in thread %s\n", msg, (long long)now_ms,
+		current ? current->name : "-");
+	for (struct k_thread *t = threads; t != NULL; t = t->next) {
+		if (t->state == SIM_THREAD_WAITING) {
+			fprintf(stderr, "sim: thread %s waits on %p\n", t->name, t->wait_on);
+		}
+	}
+	exit(2);
+}
+
+int64_t k_uptime_get(void)
+{
+	return now_ms;
+}
+
+uint32_t k_cycle_get_32(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static void make_ready(struct k_thread *thread)
+{
+	thread->state = SIM_THREAD_READY;
+	thread->ready_seq = ++ready_seq;
+}
+
+static struct k_thread *next_ready(void)
+{
+	struct k_thread *best = NULL;
+
+	for (struct k_thread *t = threads; t != NULL; t = t->next) {
+		if ((t->state == SIM_THREAD_READY) &&
+		    ((best == NULL) || (t->prio < best->prio) ||
+		     ((t->prio == best->prio) && (t->ready_seq < best->ready_seq)))) {
+			best = t;
+		}
+	}
+
+	return best;
+}
+
+// Called by the running thread after it changed its state
+static void switch_out(void)
+{
+	struct k_thread *thread = current;
+
+	if (spin_depth != 0) {
+		sim_abort("thread blocked with a spinlock held");
+	}
+
+	swapcontext(&thread->ctx, &sched_ctx);
+}
+
+// A thread made ready by the running one with a higher priority runs first
+static void preempt_check(void)
+{
+	struct k_thread *best = next_ready();
+
+	if ((current != NULL) && (spin_depth == 0) && (best != NULL) && (best->prio < current->prio)) {
+		current->state = SIM_THREAD_READY;
+		// Preempted thread is the first of its priority to run again
+		current->ready_seq = --preempted_seq;
+		switch_out();
+	}
+}
+
+static void thread_trampoline(void)
+{
+	current->entry(current->p1, current->p2, current->p3);
+
+	current->state = SIM_THREAD_DORMANT;
+	switch_out();
+}
+
+static void thread_create(struct k_thread *thread)
+{
+	thread->stack = malloc(THREAD_STACK_SIZE);
+	if (thread->stack == NULL) {
+		sim_abort("no memory for thread stack");
+	}
+
+	getcontext(&thread->ctx);
+	thread->ctx.uc_stack.ss_sp = thread->stack;
+	thread->ctx.uc_stack.ss_size = THREAD_STACK_SIZE;
+	thread->ctx.uc_link = NULL;
+	makecontext(&thread->ctx, thread_trampoline, 0);
+
+	thread->state = SIM_THREAD_DORMANT;
+	thread->next = threads;
+	threads = thread;
+}
+
+void sim_thread_define(struct k_thread *thread, const char *name, k_thread_entry_t entry,
+		       void *p1, void *p2, void *p3, int prio, int delay)
+{
+	thread->name = name;
+	thread->entry = entry;
+	thread->p1 = p1;
+	thread->p2 = p2;
+	thread->p3 = p3;
+	thread->prio = prio;
+	thread_create(thread);
+
+	if (delay != K_TICKS_FOREVER) {
+		make_ready(thread);
+	}
+}
+
+void k_thread_start(k_tid_t thread)
+{
+	if (thread->state == SIM_THREAD_DORMANT) {
+		make_ready(thread);
+		preempt_check();
+	}
+}
+
+int32_t k_sleep(k_timeout_t timeout)
+{
+	if (timeout.ms == 0) {
+		return 0;
+	}
+
+	if (timeout.ms < 0) {
+		current->state = SIM_THREAD_WAITING;
+		current->wait_on = NULL;
+	} else {
+		current->state = SIM_THREAD_SLEEPING;
+		current->wakeup = now_ms + timeout.ms;
+	}
+
+	switch_out();
+
+	return 0;
+}
+
+void sim_wait(const void *obj)
+{
+	current->state = SIM_THREAD_WAITING;
+	current->wait_on = obj;
+	switch_out();
+}
+
+void sim_wake(const void *obj)
+{
+	bool woken = false;
+
+	for (struct k_thread *t = threads; t != NULL; t = t->next) {
+		if ((t->state == SIM_THREAD_WAITING) && (t->wait_on == obj) && (obj != NULL)) {
+			make_ready(t);
+			woken = true;
+		}
+	}
+
+	if (woken) {
+		preempt_check();
+	}
+}
+
+k_spinlock_key_t k_spin_lock(struct k_spinlock *lock)
+{
+	(void)lock;
+
+	return spin_depth++;
+}
+
+void k_spin_unlock(struct k_spinlock *lock, k_spinlock_key_t key)
+{
+	(void)lock;
+
+	spin_depth = key;
+	if (spin_depth == 0) {
+		preempt_check();
+	}
+}
+
+int k_mutex_lock(struct k_mutex *mutex, k_timeout_t timeout)
+{
+	while ((mutex->owner != NULL) && (mutex->owner != current)) {
+		if (timeout.ms == 0) {
+			return -EBUSY;
+		}
+		sim_wait(mutex);
+	}
+
+	mutex->owner = current;
+	mutex->lock_count++;
+
+	return 0;
+}
+
+int k_mutex_unlock(struct k_mutex *mutex)
+{
+	if (mutex->owner != current) {
+		sim_abort("mutex unlocked by a thread not owning it");
+	}
+
+	if (--mutex->lock_count == 0) {
+		mutex->owner = NULL;
+		sim_wake(mutex);
+	}
+
+	return 0;
+}
+
+void k_work_init(struct k_work *work, k_work_handler_t handler)
+{
+	memset(work, 0, sizeof(*work));
+	work->handler = handler;
+}
+
+int k_work_submit_to_queue(struct k_work_q *queue, struct k_work *work)
+{
+	if (work->queued) {
+		return 0;
+	}
+
+	work->queue = queue;
+	work->queued = true;
+	work->next = NULL;
+
+	if (queue->tail != NULL) {
+		queue->tail->next = work;
+	} else {
+		queue->head = work;
+	}
+	queue->tail = work;
+
+	sim_wake(queue);
+
+	return 1;
+}
+
+bool k_work_cancel(struct k_work *work)
+{
+	struct k_work_q *queue = work->queue;
+	struct k_work *prev = NULL;
+
+	if (!work->queued) {
+		return false;
+	}
+
+	for (struct k_work *item = queue->head; item != NULL; prev = item, item = item->next) {
+		if (item != work) {
+			continue;
+		}
+
+		if (prev != NULL) {
+			prev->next = item->next;
+		} else {
+			queue->head = item->next;
+		}
+		if (queue->tail == item) {
+			queue->tail = prev;
+		}
+		break;
+	}
+
+	work->queued = false;
+
+	return false;
+}
+
+static void timer_remove(struct k_work_delayable *dwork)
+{
+	for (struct k_work_delayable **item = &timers; *item != NULL; item = &(*item)->next_timer) {
+		if (*item == dwork) {
+			*item = dwork->next_timer;
+			break;
+		}
+	}
+
+	dwork->scheduled = false;
+}
+
+int k_work_reschedule_for_queue(struct k_work_q *queue, struct k_work_delayable *dwork,
+				k_timeout_t delay)
+{
+	if (dwork->scheduled) {
+		timer_remove(dwork);
+	}
+
+	dwork->work.queue = queue;
+
+	if (delay.ms == 0) {
+		return k_work_submit_to_queue(queue, &dwork->work);
+	}
+
+	dwork->expiry = now_ms + delay.ms;
+	dwork->scheduled = true;
+	dwork->next_timer = timers;
+	timers = dwork;
+
+	return 1;
+}
+
+int k_work_cancel_delayable(struct k_work_delayable *dwork)
+{
+	if (dwork->scheduled) {
+		timer_remove(dwork);
+	}
+
+	k_work_cancel(&dwork->work);
+
+	return 0;
+}
+
+static void work_q_process(void *p1, void *p2, void *p3)
+{
+	struct k_work_q *queue = p1;
+
+	(void)p2;
+	(void)p3;
+
+	while (1) {
+		struct k_work *work = queue->head;
+
+		if (work == NULL) {
+			sim_wait(queue);
+			continue;
+		}
+
+		queue->head = work->next;
+		if (queue->head == NULL) {
+			queue->tail = NULL;
+		}
+		work->queued = false;
+
+		work->handler(work);
+	}
+}
+
+void k_work_queue_start(struct k_work_q *queue, void *stack, size_t stack_size, int prio,
+			const struct k_work_queue_config *cfg)
+{
+	(void)stack;
+	(void)stack_size;
+
+	queue->head = NULL;
+	queue->tail = NULL;
+	sim_thread_define(&queue->thread, cfg->name, work_q_process, queue, NULL, NULL, prio,
+			  K_TICKS_FOREVER);
+	k_thread_start(&queue->thread);
+}
+
+static void chan_lock(const struct zbus_channel *chan)
+{
+	while (chan->data->owner != NULL) {
+		if (chan->data->owner == current) {
+			fprintf(stderr, "sim: %s locked again by its owner\n", chan->name);
+			sim_abort("deadlock");
+		}
+		sim_wait(chan->data);
+	}
+
+	chan->data->owner = current;
+}
+
+static void chan_unlock(const struct zbus_channel *chan)
+{
+	chan->data->owner = NULL;
+	sim_wake(chan->data);
+}
+
+int zbus_chan_pub(const struct zbus_channel *chan, const void *msg, k_timeout_t timeout)
+{
+	(void)timeout;
+
+	chan_lock(chan);
+
+	memcpy(chan->message, msg, chan->message_size);
+
+	for (const struct zbus_observer *const *obs = chan->observers; *obs != NULL; obs++) {
+		(*obs)->callback(chan);
+	}
+
+	chan_unlock(chan);
+
+	return 0;
+}
+
+int zbus_chan_read(const struct zbus_channel *chan, void *msg, k_timeout_t timeout)
+{
+	(void)timeout;
+
+	chan_lock(chan);
+	memcpy(msg, chan->message, chan->message_size);
+	chan_unlock(chan);
+
+	return 0;
+}
+
+bool gpio_is_ready_dt(const struct gpio_dt_spec *spec)
+{
+	return spec->port == &sim_gpio0;
+}
+
+int gpio_pin_configure_dt(const struct gpio_dt_spec *spec, gpio_flags_t extra_flags)
+{
+	(void)spec;
+
+	if ((extra_flags & GPIO_OUTPUT_INIT_LOW) == GPIO_OUTPUT_INIT_LOW) {
+		gpio_level = 0;
+	}
+
+	return 0;
+}
+
+int gpio_pin_set_dt(const struct gpio_dt_spec *spec, int value)
+{
+	(void)spec;
+
+	gpio_level = value ? 1 : 0;
+
+	return 0;
+}
+
+int gpio_pin_toggle_dt(const struct gpio_dt_spec *spec)
+{
+	(void)spec;
+
+	gpio_level = !gpio_level;
+
+	return 0;
+}
+
+int gpio_emul_output_get(const struct device *port, uint8_t pin)
+{
+	(void)port;
+	(void)pin;
+
+	return gpio_level;
+}
+
+void native_add_command_line_opts(struct args_struct_t *args)
+{
+	if (opt_tables_num == MAX_OPT_TABLES) {
+		sim_abort("too many option tables");
+	}
+
+	opt_tables[opt_tables_num++] = args;
+}
+
+void posix_exit(int exit_code)
+{
+	fflush(stdout);
+	exit(exit_code);
+}
+
+static void print_help(const char *exe)
+{
+	printf("Usage: %s [options]\n", exe);
+
+	for (int i = 0; i < opt_tables_num; i++) {
+		for (struct args_struct_t *opt = opt_tables[i]; opt->option != NULL; opt++) {
+			if (opt->is_switch) {
+				printf("  -%-20s %s\n", opt->option, opt->descript);
+			} else {
+				printf("  -%s=<%s>%*s %s\n", opt->option, opt->name,
+				       (int)(17 - strlen(opt->option) - strlen(opt->name)), "",
+				       opt->descript);
+			}
+		}
+	}
+}
+
+static bool parse_opt(struct args_struct_t *opt, const char *arg)
+{
+	size_t len = strlen(opt->option);
+	const char *value;
+	char *end;
+
+	if (strncmp(arg, opt->option, len) != 0) {
+		return false;
+	}
+
+	if (opt->is_switch) {
+		if (arg[len] != '\0') {
+			return false;
+		}
+		*(bool *)opt->dest = true;
+		return true;
+	}
+
+	if (arg[len] != '=') {
+		return false;
+	}
+	value = &arg[len + 1];
+
+	switch (opt->type) {
+	case 'u':
+		*(uint32_t *)opt->dest = strtoul(value, &end, 0);
+		break;
+	case 'i':
+		*(int32_t *)opt->dest = strtol(value, &end, 0);
+		break;
+	case 'd':
+		*(double *)opt->dest = strtod(value, &end);
+		break;
+	default:
+		return false;
+	}
+
+	return (*end == '\0');
+}
+
+static void parse_args(int argc, char **argv)
+{
+	for (int a = 1; a < argc; a++) {
+		const char *arg = argv[a];
+		bool found = false;
+
+		if (!strcmp(arg, "--help") || !strcmp(arg, "-help")) {
+			print_help(argv[0]);
+			exit(0);
+		}
+
+		while (*arg == '-') {
+			arg++;
+		}
+
+		for (int i = 0; (i < opt_tables_num) && !found; i++) {
+			for (struct args_struct_t *opt = opt_tables[i]; opt->option != NULL; opt++) {
+				if (parse_opt(opt, arg)) {
+					found = true;
+					break;
+				}
+			}
+		}
+
+		if (!found) {
+			fprintf(stderr, "Invalid argument %s\n", argv[a]);
+			exit(1);
+		}
+	}
+}
+
+static void main_thread_process(void *p1, void *p2, void *p3)
+{
+	(void)p1;
+	(void)p2;
+	(void)p3;
+
+	posix_exit(app_main());
+}
+
+// Wakes threads and expires timers at the nearest point of time
+static bool advance_time(void)
+{
+	int64_t next = INT64_MAX;
+
+	for (struct k_thread *t = threads; t != NULL; t = t->next) {
+		if ((t->state == SIM_THREAD_SLEEPING) && (t->wakeup < next)) {
+			next = t->wakeup;
+		}
+	}
+	for (struct k_work_delayable *d = timers; d != NULL; d = d->next_timer) {
+		if (d->expiry < next) {
+			next = d->expiry;
+		}
+	}
+
+	if (next == INT64_MAX) {
+		return false;
+	}
+
+	now_ms = next;
+
+	for (struct k_thread *t = threads; t != NULL; t = t->next) {
+		if ((t->state == SIM_THREAD_SLEEPING) && (t->wakeup <= now_ms)) {
+			make_ready(t);
+		}
+	}
+
+	for (struct k_work_delayable *d = timers; d != NULL;) {
+		struct k_work_delayable *next_timer = d->next_timer;
+
+		if (d->expiry <= now_ms) {
+			timer_remove(d);
+			k_work_submit_to_queue(d->work.queue, &d->work);
+		}
+		d = next_timer;
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	parse_args(argc, argv);
+
+	for (const struct sim_thread_init *t = __start_sim_thread_init; t < __stop_sim_thread_init;
+	     t++) {
+		sim_thread_define(t->thread, t->name, t->entry, t->p1, t->p2, t->p3, t->prio,
+				  t->delay);
+	}
+	sim_thread_define(&main_thread, "main", main_thread_process, NULL, NULL, NULL,
+			  MAIN_THREAD_PRIO, 0);
+
+	while (1) {
+		current = next_ready();
+
+		if (current == NULL) {
+			if (!advance_time()) {
+				sim_abort("deadlock, no thread can run");
+			}
+			continue;
+		}
+
+		swapcontext(&sched_ctx, &current->ctx);
+		current = NULL;
+	}
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Subset of the zcbor 0.8 API used by the CoAP payload encoders, implemented in
+ * scripts/host/zcbor/zcbor.c for host harnesses run without the zcbor module. Containers, unions
+ * and unordered map searches follow the zcbor semantics of backups and element counts. Its speed
+ * says nothing about zcbor, benchmarks are built against the zcbor module.
+ */
+
+#ifndef HOST_ZCBOR_COMMON_H_
+#define HOST_ZCBOR_COMMON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ZCBOR_TAG_DECFRAC_ARR 4
+#define ZCBOR_LARGE_ELEM_COUNT ((size_t)-2)
+
+struct zcbor_string {
+	const uint8_t *value;
+	size_t len;
+};
+
+struct zcbor_state_constant;
+
+typedef struct {
+	union {
+		uint8_t *payload_mut;
+		const uint8_t *payload;
+	};
+	const uint8_t *payload_bak;
+	size_t elem_count;
+	bool indefinite;
+	const uint8_t *payload_end;
+	// Start of the unordered map and its element count, to wrap searches around
+	const uint8_t *map_start;
+	size_t map_elem_count;
+	struct zcbor_state_constant *constant_state;
+} zcbor_state_t;
+
+struct zcbor_state_constant {
+	zcbor_state_t *backup_list;
+	size_t current_backup;
+	size_t num_backups;
+};
+
+void zcbor_new_state(zcbor_state_t *state_array, size_t n_states, const uint8_t *payload,
+		     size_t payload_len, size_t elem_count, struct zcbor_state_constant *constant);
+
+bool zcbor_new_backup(zcbor_state_t *state, size_t new_elem_count);
+bool zcbor_union_start_code(zcbor_state_t *state);
+bool zcbor_union_elem_code(zcbor_state_t *state);
+bool zcbor_union_end_code(zcbor_state_t *state);
+
+#endif // HOST_ZCBOR_COMMON_H_
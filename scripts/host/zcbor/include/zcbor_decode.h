@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_ZCBOR_DECODE_H_
+#define HOST_ZCBOR_DECODE_H_
+
+#include <zcbor_common.h>
+
+// Flags of duplicate key detection are not supported, n_flags is ignored
+#define ZCBOR_STATE_D(name, num_backups, payload, payload_size, elem_count, n_flags)             \
+	zcbor_state_t name[(num_backups) + 1];                                                     \
+	struct zcbor_state_constant name##_constant;                                               \
+	zcbor_new_state(name, (num_backups) + 1, payload, payload_size, elem_count,              \
+			&name##_constant)
+
+bool zcbor_int32_decode(zcbor_state_t *state, int32_t *result);
+bool zcbor_uint32_decode(zcbor_state_t *state, uint32_t *result);
+bool zcbor_bool_decode(zcbor_state_t *state, bool *result);
+bool zcbor_tstr_decode(zcbor_state_t *state, struct zcbor_string *result);
+bool zcbor_bstr_decode(zcbor_state_t *state, struct zcbor_string *result);
+bool zcbor_tag_decode(zcbor_state_t *state, uint32_t *result);
+bool zcbor_any_skip(zcbor_state_t *state, void *result);
+
+bool zcbor_list_start_decode(zcbor_state_t *state);
+bool zcbor_map_start_decode(zcbor_state_t *state);
+bool zcbor_list_end_decode(zcbor_state_t *state);
+bool zcbor_map_end_decode(zcbor_state_t *state);
+bool zcbor_list_map_end_force_decode(zcbor_state_t *state);
+bool zcbor_array_at_end(zcbor_state_t *state);
+
+bool zcbor_unordered_map_start_decode(zcbor_state_t *state);
+bool zcbor_unordered_map_end_decode(zcbor_state_t *state);
+bool zcbor_search_key_tstr_term(zcbor_state_t *state, const char *str, size_t maxlen);
+
+#endif // HOST_ZCBOR_DECODE_H_
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HOST_ZCBOR_ENCODE_H_
+#define HOST_ZCBOR_ENCODE_H_
+
+#include <zcbor_common.h>
+
+#define ZCBOR_STATE_E(name, num_backups, payload, payload_size, elem_count)                      \
+	zcbor_state_t name[(num_backups) + 1];                                                     \
+	struct zcbor_state_constant name##_constant;                                               \
+	zcbor_new_state(name, (num_backups) + 1, payload, payload_size, elem_count,              \
+			&name##_constant)
+
+bool zcbor_int32_put(zcbor_state_t *state, int32_t input);
+bool zcbor_uint32_put(zcbor_state_t *state, uint32_t input);
+bool zcbor_bool_put(zcbor_state_t *state, bool input);
+bool zcbor_tstr_encode_ptr(zcbor_state_t *state, const char *str, size_t len);
+bool zcbor_tstr_put_term(zcbor_state_t *state, const char *str, size_t maxlen);
+bool zcbor_tag_put(zcbor_state_t *state, uint32_t tag);
+
+#define zcbor_tstr_put_lit(state, str) zcbor_tstr_encode_ptr(state, str, sizeof(str) - 1)
+
+bool zcbor_list_start_encode(zcbor_state_t *state, size_t max_num);
+bool zcbor_map_start_encode(zcbor_state_t *state, size_t max_num);
+bool zcbor_list_end_encode(zcbor_state_t *state, size_t max_num);
+bool zcbor_map_end_encode(zcbor_state_t *state, size_t max_num);
+
+#endif // HOST_ZCBOR_ENCODE_H_
@@ -0,0 +1,651 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host implementation of the zcbor subset declared in scripts/host/zcbor/include. Decoding
+ * functions do not consume anything if they fail. Starting a container creates a backup holding
+ * the element count of the outer container, ending it restores the count and keeps the position.
+ * Unordered map searches scan from the current position to the end of the map and wrap around to
+ * its start, skipping keys and values which do not match, like zcbor_unordered_map_search().
+ */
+
+#include <string.h>
+
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+
+#define FLAG_RESTORE      1
+#define FLAG_CONSUME      2
+#define FLAG_KEEP_PAYLOAD 4
+
+#define MAJOR_UINT  0
+#define MAJOR_NINT  1
+#define MAJOR_BSTR  2
+#define MAJOR_TSTR  3
+#define MAJOR_LIST  4
+#define MAJOR_MAP   5
+#define MAJOR_TAG   6
+#define MAJOR_SIMPLE 7
+
+#define AI_INDEFINITE 31
+#define BREAK         0xff
+#define SIMPLE_FALSE  0xf4
+#define SIMPLE_TRUE   0xf5
+
+void zcbor_new_state(zcbor_state_t *state_array, size_t n_states, const uint8_t *payload,
+		     size_t payload_len, size_t elem_count, struct zcbor_state_constant *constant)
+{
+	memset(state_array, 0, n_states * sizeof(*state_array));
+
+	state_array[0].payload = payload;
+	state_array[0].payload_end = payload + payload_len;
+	state_array[0].elem_count = elem_count;
+	state_array[0].constant_state = constant;
+
+	constant->backup_list = state_array;
+	constant->current_backup = 0;
+	constant->num_backups = n_states - 1;
+}
+
+bool zcbor_new_backup(zcbor_state_t *state, size_t new_elem_count)
+{
+	struct zcbor_state_constant *constant = state->constant_state;
+
+	if (constant->current_backup == constant->num_backups) {
+		return false;
+	}
+
+	constant->backup_list[++constant->current_backup] = *state;
+	state->elem_count = new_elem_count;
+
+	return true;
+}
+
+static bool process_backup(zcbor_state_t *state, int flags)
+{
+	struct zcbor_state_constant *constant = state->constant_state;
+
+	if (constant->current_backup == 0) {
+		return false;
+	}
+
+	if (flags & FLAG_RESTORE) {
+		const uint8_t *payload = state->payload;
+
+		*state = constant->backup_list[constant->current_backup];
+		if (flags & FLAG_KEEP_PAYLOAD) {
+			state->payload = payload;
+		}
+	}
+
+	if (flags & FLAG_CONSUME) {
+		constant->current_backup--;
+	}
+
+	return true;
+}
+
+bool zcbor_union_start_code(zcbor_state_t *state)
+{
+	return zcbor_new_backup(state, state->elem_count);
+}
+
+bool zcbor_union_elem_code(zcbor_state_t *state)
+{
+	return process_backup(state, FLAG_RESTORE);
+}
+
+bool zcbor_union_end_code(zcbor_state_t *state)
+{
+	return process_backup(state, FLAG_CONSUME);
+}
+
+// Reads an item header at *pp without checking element counts
+static bool header_read(const uint8_t **pp, const uint8_t *end, uint8_t *major, uint64_t *arg,
+			bool *indefinite)
+{
+	const uint8_t *p = *pp;
+	uint8_t ai;
+
+	if (p >= end) {
+		return false;
+	}
+
+	*major = *p >> 5;
+	ai = *p & 0x1f;
+	p++;
+	*indefinite = false;
+
+	if (ai < 24) {
+		*arg = ai;
+	} else if (ai <= 27) {
+		size_t len = 1U << (ai - 24);
+
+		if ((size_t)(end - p) < len) {
+			return false;
+		}
+
+		*arg = 0;
+		for (size_t i = 0; i < len; i++) {
+			*arg = (*arg << 8) | *p++;
+		}
+	} else if ((ai == AI_INDEFINITE) && (*major >= MAJOR_BSTR) && (*major <= MAJOR_MAP)) {
+		*indefinite = true;
+		*arg = 0;
+	} else {
+		return false;
+	}
+
+	*pp = p;
+	return true;
+}
+
+static bool at_break(const zcbor_state_t *state)
+{
+	return state->indefinite && (state->payload < state->payload_end) &&
+	       (*state->payload == BREAK);
+}
+
+bool zcbor_array_at_end(zcbor_state_t *state)
+{
+	return (!state->indefinite && (state->elem_count == 0)) || at_break(state);
+}
+
+// Decodes a header of an element of the current container, nothing is consumed on failure
+static bool value_decode(zcbor_state_t *state, uint8_t expected_major, uint64_t *arg,
+			 bool *indefinite)
+{
+	const uint8_t *p = state->payload;
+	uint8_t major;
+
+	if ((state->elem_count == 0) || at_break(state)) {
+		return false;
+	}
+
+	if (!header_read(&p, state->payload_end, &major, arg, indefinite) ||
+	    (major != expected_major)) {
+		return false;
+	}
+
+	state->payload = p;
+	state->elem_count--;
+
+	return true;
+}
+
+static bool skip_item(const uint8_t **pp, const uint8_t *end)
+{
+	uint8_t major;
+	uint64_t arg;
+	bool indefinite;
+
+	if (!header_read(pp, end, &major, &arg, &indefinite)) {
+		return false;
+	}
+
+	switch (major) {
+	case MAJOR_UINT:
+	case MAJOR_NINT:
+	case MAJOR_SIMPLE:
+		return true;
+
+	case MAJOR_BSTR:
+	case MAJOR_TSTR:
+		if (indefinite) {
+			while ((*pp < end) && (**pp != BREAK)) {
+				if (!skip_item(pp, end)) {
+					return false;
+				}
+			}
+			break;
+		}
+		if ((uint64_t)(end - *pp) < arg) {
+			return false;
+		}
+		*pp += arg;
+		return true;
+
+	case MAJOR_LIST:
+	case MAJOR_MAP:
+		if (indefinite) {
+			while ((*pp < end) && (**pp != BREAK)) {
+				if (!skip_item(pp, end)) {
+					return false;
+				}
+			}
+			break;
+		}
+		for (uint64_t i = 0; i < ((major == MAJOR_MAP) ? 2 * arg : arg); i++) {
+			if (!skip_item(pp, end)) {
+				return false;
+			}
+		}
+		return true;
+
+	case MAJOR_TAG:
+		return skip_item(pp, end);
+
+	default:
+		return false;
+	}
+
+	// Break of an indefinite length item
+	if (*pp >= end) {
+		return false;
+	}
+	(*pp)++;
+
+	return true;
+}
+
+bool zcbor_any_skip(zcbor_state_t *state, void *result)
+{
+	const uint8_t *p = state->payload;
+
+	(void)result;
+
+	if ((state->elem_count == 0) || at_break(state)) {
+		return false;
+	}
+
+	if (!skip_item(&p, state->payload_end)) {
+		return false;
+	}
+
+	state->payload = p;
+	state->elem_count--;
+
+	return true;
+}
+
+bool zcbor_uint32_decode(zcbor_state_t *state, uint32_t *result)
+{
+	const uint8_t *payload = state->payload;
+	uint64_t arg;
+	bool indefinite;
+
+	if (!value_decode(state, MAJOR_UINT, &arg, &indefinite)) {
+		return false;
+	}
+
+	if (arg > UINT32_MAX) {
+		state->payload = payload;
+		state->elem_count++;
+		return false;
+	}
+
+	*result = (uint32_t)arg;
+	return true;
+}
+
+bool zcbor_int32_decode(zcbor_state_t *state, int32_t *result)
+{
+	const uint8_t *payload = state->payload;
+	uint64_t arg;
+	bool indefinite;
+
+	if (value_decode(state, MAJOR_UINT, &arg, &indefinite)) {
+		if (arg <= INT32_MAX) {
+			*result = (int32_t)arg;
+			return true;
+		}
+	} else if (value_decode(state, MAJOR_NINT, &arg, &indefinite)) {
+		if (arg <= INT32_MAX) {
+			*result = -1 - (int32_t)arg;
+			return true;
+		}
+	} else {
+		return false;
+	}
+
+	state->payload = payload;
+	state->elem_count++;
+	return false;
+}
+
+bool zcbor_bool_decode(zcbor_state_t *state, bool *result)
+{
+	if ((state->elem_count == 0) || at_break(state) ||
+	    (state->payload >= state->payload_end)) {
+		return false;
+	}
+
+	if ((*state->payload != SIMPLE_FALSE) && (*state->payload != SIMPLE_TRUE)) {
+		return false;
+	}
+
+	*result = (*state->payload == SIMPLE_TRUE);
+	state->payload++;
+	state->elem_count--;
+
+	return true;
+}
+
+static bool str_decode(zcbor_state_t *state, uint8_t major, struct zcbor_string *result)
+{
+	const uint8_t *payload = state->payload;
+	uint64_t arg;
+	bool indefinite;
+
+	if (!value_decode(state, major, &arg, &indefinite)) {
+		return false;
+	}
+
+	// Chunked strings are not supported, as in zcbor
+	if (indefinite || ((uint64_t)(state->payload_end - state->payload) < arg)) {
+		state->payload = payload;
+		state->elem_count++;
+		return false;
+	}
+
+	result->value = state->payload;
+	result->len = arg;
+	state->payload += arg;
+
+	return true;
+}
+
+bool zcbor_tstr_decode(zcbor_state_t *state, struct zcbor_string *result)
+{
+	return str_decode(state, MAJOR_TSTR, result);
+}
+
+bool zcbor_bstr_decode(zcbor_state_t *state, struct zcbor_string *result)
+{
+	return str_decode(state, MAJOR_BSTR, result);
+}
+
+bool zcbor_tag_decode(zcbor_state_t *state, uint32_t *result)
+{
+	uint64_t arg;
+	bool indefinite;
+
+	if (!value_decode(state, MAJOR_TAG, &arg, &indefinite)) {
+		return false;
+	}
+
+	// Tags are not elements of the container
+	state->elem_count++;
+	*result = (uint32_t)arg;
+
+	return true;
+}
+
+static bool container_start_decode(zcbor_state_t *state, uint8_t major)
+{
+	const uint8_t *payload = state->payload;
+	uint64_t arg;
+	bool indefinite;
+
+	if (!value_decode(state, major, &arg, &indefinite)) {
+		return false;
+	}
+
+	if (!zcbor_new_backup(state, 0)) {
+		state->payload = payload;
+		state->elem_count++;
+		return false;
+	}
+
+	state->indefinite = indefinite;
+	if (indefinite) {
+		state->elem_count = ZCBOR_LARGE_ELEM_COUNT;
+	} else {
+		state->elem_count = (major == MAJOR_MAP) ? 2 * arg : arg;
+	}
+
+	return true;
+}
+
+static bool container_end_decode(zcbor_state_t *state)
+{
+	if (!zcbor_array_at_end(state)) {
+		return false;
+	}
+
+	if (state->indefinite) {
+		state->payload++;
+	}
+
+	return process_backup(state, FLAG_RESTORE | FLAG_CONSUME | FLAG_KEEP_PAYLOAD);
+}
+
+bool zcbor_list_start_decode(zcbor_state_t *state)
+{
+	return container_start_decode(state, MAJOR_LIST);
+}
+
+bool zcbor_map_start_decode(zcbor_state_t *state)
+{
+	return container_start_decode(state, MAJOR_MAP);
+}
+
+bool zcbor_list_end_decode(zcbor_state_t *state)
+{
+	return container_end_decode(state);
+}
+
+bool zcbor_map_end_decode(zcbor_state_t *state)
+{
+	return container_end_decode(state);
+}
+
+bool zcbor_list_map_end_force_decode(zcbor_state_t *state)
+{
+	return process_backup(state, FLAG_RESTORE | FLAG_CONSUME | FLAG_KEEP_PAYLOAD);
+}
+
+bool zcbor_unordered_map_start_decode(zcbor_state_t *state)
+{
+	if (!zcbor_map_start_decode(state)) {
+		return false;
+	}
+
+	state->map_start = state->payload;
+	state->map_elem_count = state->elem_count;
+
+	return true;
+}
+
+bool zcbor_unordered_map_end_decode(zcbor_state_t *state)
+{
+	return zcbor_list_map_end_force_decode(state);
+}
+
+static bool key_tstr_expect(zcbor_state_t *state, const char *str, size_t len)
+{
+	const uint8_t *payload = state->payload;
+	size_t elem_count = state->elem_count;
+	struct zcbor_string key;
+
+	if (!zcbor_tstr_decode(state, &key)) {
+		return false;
+	}
+
+	if ((key.len == len) && (memcmp(key.value, str, len) == 0)) {
+		return true;
+	}
+
+	state->payload = payload;
+	state->elem_count = elem_count;
+	return false;
+}
+
+bool zcbor_search_key_tstr_term(zcbor_state_t *state, const char *str, size_t maxlen)
+{
+	size_t len = strnlen(str, maxlen);
+	const uint8_t *payload = state->payload;
+
+	// Not at a key
+	if (!state->indefinite && (state->elem_count & 1)) {
+		return false;
+	}
+
+	do {
+		if (zcbor_array_at_end(state)) {
+			state->payload = state->map_start;
+			state->elem_count = state->map_elem_count;
+			continue;
+		}
+
+		if (key_tstr_expect(state, str, len)) {
+			return true;
+		}
+
+		if (!zcbor_any_skip(state, NULL) || !zcbor_any_skip(state, NULL)) {
+			return false;
+		}
+	} while (state->payload != payload);
+
+	return false;
+}
+
+static size_t header_len(uint64_t arg)
+{
+	if (arg < 24) {
+		return 1;
+	} else if (arg <= UINT8_MAX) {
+		return 2;
+	} else if (arg <= UINT16_MAX) {
+		return 3;
+	} else if (arg <= UINT32_MAX) {
+		return 5;
+	}
+	return 9;
+}
+
+static void header_write(uint8_t *p, uint8_t major, uint64_t arg, size_t len)
+{
+	static const uint8_t ai[] = { [2] = 24, [3] = 25, [5] = 26, [9] = 27 };
+
+	if (len == 1) {
+		*p = (major << 5) | (uint8_t)arg;
+		return;
+	}
+
+	*p++ = (major << 5) | ai[len];
+	for (size_t i = len - 1; i > 0; i--) {
+		*p++ = (uint8_t)(arg >> (8 * (i - 1)));
+	}
+}
+
+static bool value_encode(zcbor_state_t *state, uint8_t major, uint64_t arg)
+{
+	size_t len = header_len(arg);
+
+	if ((size_t)(state->payload_end - state->payload) < len) {
+		return false;
+	}
+
+	header_write(state->payload_mut, major, arg, len);
+	state->payload_mut += len;
+	state->elem_count++;
+
+	return true;
+}
+
+bool zcbor_uint32_put(zcbor_state_t *state, uint32_t input)
+{
+	return value_encode(state, MAJOR_UINT, input);
+}
+
+bool zcbor_int32_put(zcbor_state_t *state, int32_t input)
+{
+	if (input < 0) {
+		return value_encode(state, MAJOR_NINT, (uint64_t)(-1 - (int64_t)input));
+	}
+	return value_encode(state, MAJOR_UINT, (uint64_t)input);
+}
+
+bool zcbor_bool_put(zcbor_state_t *state, bool input)
+{
+	return value_encode(state, MAJOR_SIMPLE, input ? (SIMPLE_TRUE & 0x1f) : (SIMPLE_FALSE & 0x1f));
+}
+
+bool zcbor_tstr_encode_ptr(zcbor_state_t *state, const char *str, size_t len)
+{
+	uint8_t *payload = state->payload_mut;
+
+	if (!value_encode(state, MAJOR_TSTR, len)) {
+		return false;
+	}
+
+	if ((size_t)(state->payload_end - state->payload) < len) {
+		state->payload_mut = payload;
+		state->elem_count--;
+		return false;
+	}
+
+	memcpy(state->payload_mut, str, len);
+	state->payload_mut += len;
+
+	return true;
+}
+
+bool zcbor_tstr_put_term(zcbor_state_t *state, const char *str, size_t maxlen)
+{
+	return zcbor_tstr_encode_ptr(state, str, strnlen(str, maxlen));
+}
+
+bool zcbor_tag_put(zcbor_state_t *state, uint32_t tag)
+{
+	if (!value_encode(state, MAJOR_TAG, tag)) {
+		return false;
+	}
+
+	// Tags are not elements of the container
+	state->elem_count--;
+
+	return true;
+}
+
+// The header is sized for max_num elements and updated with the actual number when closed
+static bool container_start_encode(zcbor_state_t *state, uint8_t major, size_t max_num)
+{
+	state->payload_bak = state->payload;
+
+	if (!value_encode(state, major, max_num)) {
+		return false;
+	}
+
+	return zcbor_new_backup(state, 0);
+}
+
+static bool container_end_encode(zcbor_state_t *state, uint8_t major, size_t max_num)
+{
+	struct zcbor_state_constant *constant = state->constant_state;
+	size_t num = (major == MAJOR_MAP) ? state->elem_count / 2 : state->elem_count;
+	const zcbor_state_t *backup;
+
+	if ((constant->current_backup == 0) || (num > max_num)) {
+		return false;
+	}
+
+	backup = &constant->backup_list[constant->current_backup];
+	header_write((uint8_t *)backup->payload_bak, major, num, header_len(max_num));
+
+	return process_backup(state, FLAG_RESTORE | FLAG_CONSUME | FLAG_KEEP_PAYLOAD);
+}
+
+bool zcbor_list_start_encode(zcbor_state_t *state, size_t max_num)
+{
+	return container_start_encode(state, MAJOR_LIST, max_num);
+}
+
+bool zcbor_map_start_encode(zcbor_state_t *state, size_t max_num)
+{
+	return container_start_encode(state, MAJOR_MAP, max_num);
+}
+
+bool zcbor_list_end_encode(zcbor_state_t *state, size_t max_num)
+{
+	return container_end_encode(state, MAJOR_LIST, max_num);
+}
+
+bool zcbor_map_end_encode(zcbor_state_t *state, size_t max_num)
+{
+	return container_end_encode(state, MAJOR_MAP, max_num);
+}
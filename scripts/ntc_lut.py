@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Generate the NTC conversion table of temp_tscrn
+
+The table maps the averaged ADC code to temperature in 0.01 C. It is generated by the build from
+the ntc devicetree node and interpolated linearly by temp_tscrn/src/ntc.c.
+
+The interpolation can be validated against the B parameter formula on the host:
+
+$ ./scripts/ntc_lut.py --r-ref 10000 --check
+"""
+
+import argparse
+import math
+import sys
+
+ADC_RESOLUTION = 12
+C_OFFSET = 273.15
+
+# Averaged code passed to the table has 4 fractional bits, an entry every 32 ADC codes
+CODE_BITS = ADC_RESOLUTION + 4
+STEP_BITS = 4 + 5
+NUM_ENTRIES = (1 << (CODE_BITS - STEP_BITS)) + 1
+
+TEMP_MAX = 32767
+TEMP_MIN = -32767
+
+# Range in which the sensor is expected to work
+CHECK_RANGE = (-30.0, 100.0)
+CHECK_MAX_ERR = 0.05
+
+
+def temperature(code, args):
+    """Temperature in C of the code with CODE_BITS bits, None if out of range"""
+    adc_max = (1 << ADC_RESOLUTION) - 1
+    avg_raw = code / (1 << (CODE_BITS - ADC_RESOLUTION))
+
+    if avg_raw <= 0 or avg_raw >= adc_max:
+        return None
+
+    r = adc_max / avg_raw - 1.0
+    if not args.ntc_before_r_ref:
+        r = 1 / r
+    r = args.r_ref * r
+
+    return 1.0 / (math.log(r / args.r_nom) / args.b_const + 1 / (C_OFFSET + args.t_nom)) - C_OFFSET
+
+
+def table(args):
+    lut = []
+    for i in range(NUM_ENTRIES):
+        code = i << STEP_BITS
+        t = temperature(code, args)
+
+        if t is None:
+            # Open or shorted sensor, the limit depends on the direction of the curve
+            low_code = (code == 0)
+            t_cc = TEMP_MIN if low_code == args.ntc_before_r_ref else TEMP_MAX
+        else:
+            t_cc = max(TEMP_MIN, min(TEMP_MAX, round(t * 100)))
+
+        lut.append(t_cc)
+
+    return lut
+
+
+def interpolate(lut, code):
+    """Same integer arithmetic as ntc_channel_get()"""
+    idx = code >> STEP_BITS
+    frac = code & ((1 << STEP_BITS) - 1)
+    diff = lut[idx + 1] - lut[idx]
+
+    return lut[idx] + int(diff * frac / (1 << STEP_BITS))
+
+
+def check(args):
+    lut = table(args)
+    max_err = 0.0
+    max_err_code = 0
+
+    for code in range(1 << CODE_BITS):
+        t = temperature(code, args)
+        if t is None or not CHECK_RANGE[0] <= t <= CHECK_RANGE[1]:
+            continue
+
+        err = abs(interpolate(lut, code) / 100 - t)
+        if err > max_err:
+            max_err = err
+            max_err_code = code
+
+    print(f'Max error {max_err:.4f} C at code {max_err_code / (1 << (CODE_BITS - ADC_RESOLUTION))} '
+          f'in range {CHECK_RANGE[0]} C to {CHECK_RANGE[1]} C')
+
+    return 0 if max_err <= CHECK_MAX_ERR else 1
+
+
+def write_header(args):
+    lut = table(args)
+
+    with open(args.output, 'w') as f:
+        f.write('/* Generated by scripts/ntc_lut.py, do not edit */\n\n')
+        f.write('#ifndef NTC_LUT_H_\n#define NTC_LUT_H_\n\n')
+        f.write('#include <stdint.h>\n\n')
+        f.write(f'#define NTC_LUT_CODE_BITS {CODE_BITS}\n')
+        f.write(f'#define NTC_LUT_STEP_BITS {STEP_BITS}\n\n')
+        f.write('// Temperature in 0.01 C of every (1 << NTC_LUT_STEP_BITS) code\n')
+        f.write(f'static const int16_t ntc_lut[{NUM_ENTRIES}] = {{\n')
+        for i in range(0, NUM_ENTRIES, 8):
+            f.write('    ' + ' '.join(f'{t},' for t in lut[i:i + 8]) + '\n')
+        f.write('};\n\n#endif // NTC_LUT_H_\n')
+
+    return 0
+
+
+def dt_bool(value):
+    return value.lower() in ('1', 'true', 'yes', 'on')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--r-ref', type=int, required=True, help='reference resistance [ohm]')
+    parser.add_argument('--ntc-before-r-ref', type=dt_bool, default=False,
+                        help='NTC between supply and reference resistor')
+    parser.add_argument('--b-const', type=int, default=3380, help='B constant [K]')
+    parser.add_argument('--r-nom', type=int, default=10000, help='nominal resistance [ohm]')
+    parser.add_argument('--t-nom', type=int, default=25, help='nominal temperature [C]')
+    parser.add_argument('-o', '--output', help='generated header')
+    parser.add_argument('--check', action='store_true',
+                        help='compare interpolated table with the formula')
+    args = parser.parse_args()
+
+    if args.check:
+        return check(args)
+
+    if not args.output:
+        parser.error('--output is required')
+
+    return write_header(args)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
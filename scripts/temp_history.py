@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hubert Miś
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Decode temperature history downloaded from temp_tscrn
+
+The history is served by the hist resource with CoAP Block2 transfer. Time range can be
+limited with f=<unix time> and t=<unix time> queries, e.g.:
+
+$ coap-client -m get -B 60 -o hist.bin "coap://[fd00::1]/hist?f=1760000000"
+$ ./scripts/temp_history.py hist.bin > hist.csv
+
+Output is CSV with a row per sample: unix time, then measurement, setting and output of every
+location. Temperatures are in C, output in percent. Missing measurements are empty.
+
+Block format is described in temp_tscrn/src/history.h.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+VERSION = 1
+HDR_FMT = '<BBHII'
+HDR_LOC_FMT = '<hhB'
+TEMP_INVALID = -32768
+BLOCK_END = 0
+
+
+def varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise EOFError
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode(data):
+    """Yield (time, [(measurement, setting, output), ...]) with raw values"""
+    pos = 0
+    while pos < len(data):
+        version, num_loc, interval, seq, time = struct.unpack_from(HDR_FMT, data, pos)
+        if version != VERSION:
+            raise ValueError(f'Unsupported block version {version} at offset {pos}')
+        pos += struct.calcsize(HDR_FMT)
+
+        values = []
+        for _ in range(num_loc):
+            values.append(list(struct.unpack_from(HDR_LOC_FMT, data, pos)))
+            pos += struct.calcsize(HDR_LOC_FMT)
+        yield time, [tuple(v) for v in values]
+
+        # The newest block is not terminated
+        try:
+            while pos < len(data) and data[pos] != BLOCK_END:
+                dt, pos = varint(data, pos)
+                fields = []
+                for _ in range(num_loc * 3):
+                    field, pos = varint(data, pos)
+                    fields.append(unzigzag(field))
+                time += dt * interval
+                for loc in range(num_loc):
+                    for i in range(3):
+                        values[loc][i] += fields[loc * 3 + i]
+                yield time, [tuple(v) for v in values]
+        except EOFError:
+            return
+        pos += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('file', help='history downloaded from the hist resource')
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        data = f.read()
+
+    writer = csv.writer(sys.stdout)
+    header_written = False
+    for time, values in decode(data):
+        if not header_written:
+            header = ['time']
+            for loc in range(len(values)):
+                header += [f'meas{loc}', f'sett{loc}', f'out{loc}']
+            writer.writerow(header)
+            header_written = True
+
+        row = [time]
+        for meas, sett, out in values:
+            row.append('' if meas == TEMP_INVALID else meas / 10)
+            row.append(sett / 10)
+            row.append(max(round(out * 100 / 255), 1) if out else 0)
+        writer.writerow(row)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -16,15 +16,16 @@
 #include <coap_server.h>
 #include "prov.h"
 
-#include <net/socket.h>
-#include <net/coap.h>
-#include <tinycbor/cbor.h>
-#include <tinycbor/cbor_buf_reader.h>
-#include <tinycbor/cbor_buf_writer.h>
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
 
 #define MAX_COAP_MSG_LEN 256
 #define MAX_COAP_PAYLOAD_LEN 64
 
+// Payload formats are described in lib/cddl
+
 #define RSRC0_KEY "r0"
 #define RSRC1_KEY "r1"
 #define DUR0_KEY "d0"
@@ -32,7 +33,16 @@
 #define SW_INT0_KEY "i0"
 #define SW_INT1_KEY "i1"
 
-static int handle_prov_post(CborValue *value, 
+enum {
+    PROV_RSRC0,
+    PROV_RSRC1,
+    PROV_DUR0,
+    PROV_DUR1,
+    PROV_SW_INT0,
+    PROV_SW_INT1,
+};
+
+static int handle_prov_post(zcbor_state_t *value, 
 	       	enum coap_response_code *rsp_code, void *context)
 {
     (void)context;
@@ -40,66 +50,48 @@ static int handle_prov_post(CborValue *value,
     int r;
     bool updated = false;
 
-    char str[PROV_LBL_MAX_LEN];
-    int int_val;
-
-    // Handle rsrc0
-    r = cbor_extract_from_map_string(value, RSRC0_KEY, str, sizeof(str));
-    if ((r >= 0) && (r < PROV_LBL_MAX_LEN)) {
-        r = prov_set_rsrc_label(0, str);
-
-        if (r == 0) {
-            updated = true;
-        }
-    }
-
-    // Handle rsrc1
-    r = cbor_extract_from_map_string(value, RSRC1_KEY, str, sizeof(str));
-    if ((r >= 0) && (r < PROV_LBL_MAX_LEN)) {
-        r = prov_set_rsrc_label(1, str);
-
-        if (r == 0) {
-            updated = true;
-        }
-    }
-
-    // Handle duration 0
-    r = cbor_extract_from_map_int(value, DUR0_KEY, &int_val);
-    if (!r && int_val >= 0) {
-        r = prov_set_rsrc_duration(0, int_val);
+    char rsrc[2][PROV_LBL_MAX_LEN];
+    int dur[2];
+    int sw_int[2];
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [PROV_RSRC0]   = CBOR_MAP_FIELD_TSTR(RSRC0_KEY, rsrc[0]),
+        [PROV_RSRC1]   = CBOR_MAP_FIELD_TSTR(RSRC1_KEY, rsrc[1]),
+        [PROV_DUR0]    = CBOR_MAP_FIELD_INT(DUR0_KEY, &dur[0]),
+        [PROV_DUR1]    = CBOR_MAP_FIELD_INT(DUR1_KEY, &dur[1]),
+        [PROV_SW_INT0] = CBOR_MAP_FIELD_INT(SW_INT0_KEY, &sw_int[0]),
+        [PROV_SW_INT1] = CBOR_MAP_FIELD_INT(SW_INT1_KEY, &sw_int[1]),
+    };
 
-        if (r == 0) {
-            updated = true;
-        }
-    }
+    r = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
+    if (r) return r;
 
-    // Handle duration 1
-    r = cbor_extract_from_map_int(value, DUR1_KEY, &int_val);
-    if (!r && int_val >= 0) {
-        r = prov_set_rsrc_duration(1, int_val);
+    for (int i = 0; i < 2; i++) {
+        // Handle rsrc
+        if (CBOR_MAP_PRESENT(present, PROV_RSRC0 + i)) {
+            r = prov_set_rsrc_label(i, rsrc[i]);
 
-        if (r == 0) {
-            updated = true;
+            if (r == 0) {
+                updated = true;
+            }
         }
-    }
 
-    // Handle swing interval 0
-    r = cbor_extract_from_map_int(value, SW_INT0_KEY, &int_val);
-    if (!r && int_val >= 0) {
-        r = prov_set_swing_interval(0, int_val);
+        // Handle duration
+        if (CBOR_MAP_PRESENT(present, PROV_DUR0 + i) && (dur[i] >= 0)) {
+            r = prov_set_rsrc_duration(i, dur[i]);
 
-        if (r == 0) {
-            updated = true;
+            if (r == 0) {
+                updated = true;
+            }
         }
-    }
 
-    // Handle swing interval 1
-    r = cbor_extract_from_map_int(value, SW_INT1_KEY, &int_val);
-    if (!r && int_val >= 0) {
-        r = prov_set_swing_interval(1, int_val);
+        // Handle swing interval
+        if (CBOR_MAP_PRESENT(present, PROV_SW_INT0 + i) && (sw_int[i] >= 0)) {
+            r = prov_set_swing_interval(i, sw_int[i]);
 
-        if (r == 0) {
-            updated = true;
+            if (r == 0) {
+                updated = true;
+            }
         }
     }
 
@@ -123,45 +115,40 @@ static int prov_post(struct coap_resource *resource,
 
 static int prepare_prov_payload(uint8_t *payload, size_t len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
     const char *label;
     int duration;
     int interval;
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
-
-    if (cbor_encoder_create_map(&ce, &map, 6) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 6)) return -EINVAL;
 
     label = prov_get_rsrc_label(0);
-    if (cbor_encode_text_string(&map, RSRC0_KEY, strlen(RSRC0_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_text_string(&map, label, strlen(label)) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, RSRC0_KEY)) return -EINVAL;
+    if (!zcbor_tstr_put_term(ce, label, PROV_LBL_MAX_LEN)) return -EINVAL;
 
     label = prov_get_rsrc_label(1);
-    if (cbor_encode_text_string(&map, RSRC1_KEY, strlen(RSRC1_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_text_string(&map, label, strlen(label)) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, RSRC1_KEY)) return -EINVAL;
+    if (!zcbor_tstr_put_term(ce, label, PROV_LBL_MAX_LEN)) return -EINVAL;
 
     duration = prov_get_rsrc_duration(0);
-    if (cbor_encode_text_string(&map, DUR0_KEY, strlen(DUR0_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, duration) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, DUR0_KEY)) return -EINVAL;
+    if (!zcbor_int32_put(ce, duration)) return -EINVAL;
 
     duration = prov_get_rsrc_duration(1);
-    if (cbor_encode_text_string(&map, DUR1_KEY, strlen(DUR1_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, duration) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, DUR1_KEY)) return -EINVAL;
+    if (!zcbor_int32_put(ce, duration)) return -EINVAL;
 
     interval = prov_get_swing_interval(0);
-    if (cbor_encode_text_string(&map, SW_INT0_KEY, strlen(SW_INT0_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, interval) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, SW_INT0_KEY)) return -EINVAL;
+    if (!zcbor_int32_put(ce, interval)) return -EINVAL;
 
     interval = prov_get_swing_interval(1);
-    if (cbor_encode_text_string(&map, SW_INT1_KEY, strlen(SW_INT1_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, interval) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, SW_INT1_KEY)) return -EINVAL;
+    if (!zcbor_int32_put(ce, interval)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 6)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int prov_get(struct coap_resource *resource,
@@ -187,24 +174,19 @@ static int prov_get(struct coap_resource *resource,
 
 static int prepare_dbg_payload(uint8_t *payload, size_t len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
     uint32_t *log;
     uint32_t log_len = debug_log_get(&log);
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
-
-    if (cbor_encoder_create_array(&ce, &map, log_len) != CborNoError) return -EINVAL;
+    if (!zcbor_list_start_encode(ce, log_len)) return -EINVAL;
 
     for (int i = 0; i < log_len; i++) {
-	    if (cbor_encode_int(&map, log[i]) != CborNoError) return -EINVAL;
+	    if (!zcbor_uint32_put(ce, log[i])) return -EINVAL;
     }
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_list_end_encode(ce, log_len)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int dbg_get(struct coap_resource *resource,
@@ -227,48 +209,59 @@ static int dbg_get(struct coap_resource *resource,
 }
 
 #define VAL_KEY "val"
+#define VAL_KEY_ID 1
 #define VAL_MIN "up"
 #define VAL_MAX "down"
 #define VAL_STOP "stop"
-#define VAL_LABEL_MAX_LEN 5
 
 #define REQ_KEY "r"
+#define REQ_KEY_ID 2
 #define OVR_KEY "o"
+#define OVR_KEY_ID 3
 #define PRJ_KEY "p"
+#define PRJ_STATE_KEY_ID 4
+
+enum {
+    VAL_LABEL,
+    VAL_POS,
+};
 
-static int handle_rsrc_post(CborValue *value,
+static int handle_rsrc_post(zcbor_state_t *value,
 	       	enum coap_response_code *rsp_code, void *context)
 {
     int mot_id = *(int *)context;
-    bool updated = false;
     int r;
-    char str[VAL_LABEL_MAX_LEN];
+    struct zcbor_string str;
     int int_val;
+    uint32_t present;
+    // val is either a direction label or a position
+    const struct cbor_map_field fields[] = {
+        [VAL_LABEL] = CBOR_MAP_FIELD_ID(VAL_KEY, VAL_KEY_ID, CBOR_MAP_FIELD_TSTR_REF, &str, 0),
+        [VAL_POS]   = CBOR_MAP_FIELD_ID(VAL_KEY, VAL_KEY_ID, CBOR_MAP_FIELD_INT, &int_val, 0),
+    };
 
     *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
-    // Handle val
-    r = cbor_extract_from_map_string(value, VAL_KEY, str, sizeof(str));
-    if ((r >= 0) && (r < VAL_LABEL_MAX_LEN)) {
-        if (strncmp(str, VAL_STOP, strlen(VAL_STOP)) == 0) {
-	    int ret = pos_srv_req(mot_id, MOT_CNT_STOP);
-            if (ret == 0) updated = true;
-        } else if (strncmp(str, VAL_MAX, strlen(VAL_MAX)) == 0) {
-	    int ret = pos_srv_req(mot_id, MOT_CNT_MAX);
-            if (ret == 0) updated = true;
-        } else if (strncmp(str, VAL_MIN, strlen(VAL_MIN)) == 0) {
-	    int ret = pos_srv_req(mot_id, MOT_CNT_MIN);
-            if (ret == 0) updated = true;
-        }
-    }
+    r = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
+    if (r) return r;
 
-    r = cbor_extract_from_map_int(value, VAL_KEY, &int_val);
-    if (!r && int_val >= 0) {
+    if (CBOR_MAP_PRESENT(present, VAL_LABEL)) {
+        if ((str.len == strlen(VAL_STOP)) && (strncmp(str.value, VAL_STOP, str.len) == 0)) {
+            r = pos_srv_req(mot_id, MOT_CNT_STOP);
+        } else if ((str.len == strlen(VAL_MAX)) && (strncmp(str.value, VAL_MAX, str.len) == 0)) {
+            r = pos_srv_req(mot_id, MOT_CNT_MAX);
+        } else if ((str.len == strlen(VAL_MIN)) && (strncmp(str.value, VAL_MIN, str.len) == 0)) {
+            r = pos_srv_req(mot_id, MOT_CNT_MIN);
+        } else {
+            r = -EINVAL;
+        }
+    } else if (CBOR_MAP_PRESENT(present, VAL_POS) && (int_val >= 0)) {
         r = pos_srv_req(mot_id, int_val);
-        if (r == 0) updated = true;
+    } else {
+        r = -EINVAL;
     }
 
-    if (updated) {
+    if (r == 0) {
         *rsp_code = COAP_RESPONSE_CODE_CHANGED;
     }
 
@@ -285,11 +278,9 @@ static int rsrc_post(struct coap_resource *resource,
 		    handle_rsrc_post, &mot_id);
 }
 
-static int prepare_rsrc_payload(uint8_t *payload, size_t len, int id)
+static int prepare_rsrc_payload(uint8_t *payload, size_t len, int id, bool compact)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
     const struct device *mot_cnt = mot_cnt_map_from_id(id);
     const struct mot_cnt_api *api = mot_cnt->api;
     int value = api->get_pos(mot_cnt);
@@ -301,26 +292,23 @@ static int prepare_rsrc_payload(uint8_t *payload, size_t len, int id)
 
     if (r) return r;
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
+    if (!zcbor_map_start_encode(ce, 4)) return -EINVAL;
 
-    if (cbor_encoder_create_map(&ce, &map, 4) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, VAL_KEY, VAL_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_int32_put(ce, value)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, VAL_KEY, strlen(VAL_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, value) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, REQ_KEY, REQ_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_int32_put(ce, req)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, REQ_KEY, strlen(REQ_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, req) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, OVR_KEY, OVR_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_int32_put(ce, override)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, OVR_KEY, strlen(OVR_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, override) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, PRJ_KEY, PRJ_STATE_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_bool_put(ce, prj)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, PRJ_KEY, strlen(PRJ_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_boolean(&map, prj) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 4)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
-
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int rsrc_get(struct coap_resource *resource,
@@ -332,7 +320,8 @@ static int rsrc_get(struct coap_resource *resource,
     uint8_t payload[MAX_COAP_PAYLOAD_LEN];
     size_t payload_len;
 
-    r = prepare_rsrc_payload(payload, MAX_COAP_PAYLOAD_LEN, mc_id);
+    r = prepare_rsrc_payload(payload, MAX_COAP_PAYLOAD_LEN, mc_id,
+                             coap_server_accepts_compact(request));
     if (r < 0) {
         return r;
     }
@@ -343,29 +332,41 @@ static int rsrc_get(struct coap_resource *resource,
 }
 
 #define VALIDITY_KEY "d"
+#define VALIDITY_KEY_ID 2
 #define PRJ_KEY "p"
+#define PRJ_KEY_ID 1
+
+enum {
+    PRJ_VALIDITY,
+    PRJ_ACTIVE,
+};
 
-static int handle_prj_post(CborValue *value,
+static int handle_prj_post(zcbor_state_t *value,
 	       	enum coap_response_code *rsp_code, void *context)
 {
     int mot_id = *(int *)context;
     int ret;
     int validity_ms = 2 * 60 * 1000;
     bool prj_active = false;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [PRJ_VALIDITY] = CBOR_MAP_FIELD_ID(VALIDITY_KEY, VALIDITY_KEY_ID, CBOR_MAP_FIELD_INT,
+                                           &validity_ms, 0),
+        [PRJ_ACTIVE]   = CBOR_MAP_FIELD_ID(PRJ_KEY, PRJ_KEY_ID, CBOR_MAP_FIELD_BOOL, &prj_active, 0),
+    };
 
     *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
+    ret = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
+    if (ret) return ret;
+
     // Handle validity
-    ret = cbor_extract_from_map_int(value, VALIDITY_KEY, &validity_ms);
     if (validity_ms <= 0) {
-        *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
         return -EINVAL;
     }
 
     // Handle projector being enabled
-    ret = cbor_extract_from_map_bool(value, PRJ_KEY, &prj_active);
-    if (ret) {
-        *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+    if (!CBOR_MAP_PRESENT(present, PRJ_ACTIVE)) {
         return -EINVAL;
     }
 
@@ -430,19 +431,25 @@ static int prj1_post(struct coap_resource *resource,
 static struct coap_resource * rsrcs_get(int sock)
 {
     static const char * const fota_path [] = {"fota_req", NULL};
+    static const char * const fota_mc_path [] = {"fota_mc", NULL};
     static const char * const sd_path [] = {"sd", NULL};
     static const char * const prov_path[] = {"prov", NULL};
     static const char * const dbg_path[] = {"dbg", NULL};
     static const char * rsrc0_path[] = {NULL, NULL};
     static const char * prj0_path[] = {NULL, "prj", NULL};
+    static const char * prj0_short_path[] = {NULL, "p", NULL};
     static const char * rsrc1_path[] = {NULL, NULL};
     static const char * prj1_path[] = {NULL, "prj", NULL};
+    static const char * prj1_short_path[] = {NULL, "p", NULL};
 
     static struct coap_resource resources[] = {
         { .get = coap_fota_get,
           .post = coap_fota_post,
           .path = fota_path,
         },
+        { .post = coap_fota_mc_post,
+          .path = fota_mc_path,
+        },
         { .get = coap_sd_server,
           .path = sd_path,
         },
@@ -461,6 +468,9 @@ static struct coap_resource * rsrcs_get(int sock)
 	{ .post = prj0_post,
 	  .path = prj0_path,
 	},
+	{ .post = prj0_post,
+	  .path = prj0_short_path,
+	},
 	{ .get = rsrc1_get,
 	  .post = rsrc1_post,
 	  .put = rsrc1_post,
@@ -469,16 +479,21 @@ static struct coap_resource * rsrcs_get(int sock)
 	{ .post = prj1_post,
 	  .path = prj1_path,
 	},
+	{ .post = prj1_post,
+	  .path = prj1_short_path,
+	},
         { .path = NULL } // Array terminator
     };
 
-    int rsrc0_index = ARRAY_SIZE(resources) - 5;
-    int rsrc1_index = ARRAY_SIZE(resources) - 3;
+    int rsrc0_index = ARRAY_SIZE(resources) - 7;
+    int rsrc1_index = ARRAY_SIZE(resources) - 4;
 
     rsrc0_path[0] = prov_get_rsrc_label(0);
     prj0_path[0] = rsrc0_path[0];
+    prj0_short_path[0] = rsrc0_path[0];
     rsrc1_path[0] = prov_get_rsrc_label(1);
     prj1_path[0] = rsrc1_path[0];
+    prj1_short_path[0] = rsrc1_path[0];
 
     if (!rsrc0_path[0] || !strlen(rsrc0_path[0])) {
 	    resources[rsrc0_index].path = NULL;
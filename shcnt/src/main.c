@@ -12,9 +12,11 @@
 #include "pos_srv.h"
 #include "prov.h"
 
+#include <coap_fota.h>
+#include <coap_server.h>
+#include <dfu_utils.h>
 #include <dfu/mcuboot.h>
 #include <drivers/gpio.h>
-#include <net/fota_download.h>
 #include <net/openthread.h>
 #include <openthread/thread.h>
 #include <power/reboot.h>
@@ -22,6 +24,9 @@
 
 #define TX_POWER 8
 
+#define CHECK_THREAD_TIMEOUT_MS (30UL * 1000UL)
+#define CHECK_COAP_TIMEOUT_MS   (5UL * 1000UL)
+
 // Heartbeat
 #define HEARTBEAT_STACK_SIZE 512
 #define LED_NODE_ID DT_NODELABEL(led_status)
@@ -52,14 +57,6 @@ void hb_proc(void *, void *, void *)
 K_THREAD_STACK_DEFINE(hb_thread_stack, HEARTBEAT_STACK_SIZE);
 static struct k_thread hb_thread_data;
 
-// Fota
-void fota_callback(const struct fota_download_evt *evt)
-{
-    if (evt->id == FOTA_DOWNLOAD_EVT_FINISHED) {
-        sys_reboot(SYS_REBOOT_COLD);
-    }
-}
-
 // Main
 void main(void)
 {
@@ -67,6 +64,7 @@ void main(void)
 
 	settings_subsys_init();
 	settings_register(prov_get_settings_handler());
+	settings_register(coap_fota_get_settings_handler());
 	settings_load();
 
 	otError error;
@@ -82,12 +80,14 @@ void main(void)
 	error = otIp6SubscribeMulticastAddress(ot_instance, &site_local_all_nodes_addr);
 	assert(error == OT_ERROR_NONE);
 
-	fota_download_init(fota_callback);
+	coap_fota_init();
 	coap_init();
 	pos_srv_init();
 
 	k_thread_create(&hb_thread_data, hb_thread_stack, K_THREAD_STACK_SIZEOF(hb_thread_stack),
 			hb_proc, NULL, NULL, NULL, 5, 0, K_NO_WAIT);
 
-	boot_write_img_confirmed();
+	dfu_utils_register_check(dfu_utils_check_thread_attached, CHECK_THREAD_TIMEOUT_MS);
+	dfu_utils_register_check(coap_server_is_running, CHECK_COAP_TIMEOUT_MS);
+	dfu_utils_confirm_when_healthy();
 }
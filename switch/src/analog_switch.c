@@ -11,6 +11,14 @@
 #include <drivers/adc.h>
 #include <device.h>
 #include <logging/log.h>
+#include <sys/atomic.h>
+#include <sys/byteorder.h>
+
+#ifdef CONFIG_ANALOG_SWITCH_CONTINUOUS
+#include <helpers/nrfx_gppi.h>
+#include <nrfx_saadc.h>
+#include <nrfx_timer.h>
+#endif
 
 #include "led.h"
 
@@ -31,6 +39,36 @@ enum last_change {
 	DEC,
 };
 
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+#define TRACE_VERSION 1
+#define TRACE_LEN     CONFIG_ANALOG_SWITCH_TRACE_LEN
+#define TRACE_POST    CONFIG_ANALOG_SWITCH_TRACE_POST
+
+// Trace header, little-endian
+#define TRACE_HDR_VERSION   0
+#define TRACE_HDR_SOURCE    1
+#define TRACE_HDR_INTERVAL  2
+#define TRACE_HDR_NUM       4
+#define TRACE_HDR_TRIGGER   6
+#define TRACE_HDR_ITERS     8
+#define TRACE_HDR_THRESHOLD 10
+#define TRACE_HDR_DEBOUNCE  12
+#define TRACE_HDR_LEN       14
+
+BUILD_ASSERT(TRACE_POST < TRACE_LEN, "No space for samples before the trigger");
+
+enum trace_state {
+	TRACE_RECORDING,
+	TRACE_TRIGGERED,
+	TRACE_FROZEN,
+};
+
+enum trace_source {
+	TRACE_SOURCE_DETECTION,
+	TRACE_SOURCE_MANUAL,
+};
+#endif
+
 struct analog_switch_data {
     uint16_t raw;
     uint16_t events;
@@ -47,21 +85,50 @@ struct analog_switch_data {
     analog_switch_callback_t callback;
     void *                   callback_ctx;
 
+    // Detection state
+    int      iter;
+    int      debouncing;
+    uint32_t prev_avg;
+
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+    uint16_t trace[TRACE_LEN];
+    uint16_t trace_head;    // Next sample position in the ring
+    uint16_t trace_num;     // Recorded samples
+    uint16_t trace_post;    // Samples left to record after the trigger
+    uint16_t trace_trigger; // Position of the trigger sample in the ring
+    uint8_t  trace_source;
+    uint8_t  trace_hdr[TRACE_HDR_LEN];
+    atomic_t trace_state;
+    atomic_t trace_manual; // Trigger requested out of the sampling thread
+#endif
+
+#ifdef CONFIG_ANALOG_SWITCH_CONTINUOUS
+    bool enabled;
+#ifdef CONFIG_ANALOG_SWITCH_LIMITS
+    bool limits_armed;
+#endif
+#else
     K_KERNEL_STACK_MEMBER(thread_stack, THREAD_STACK_SIZE);
     struct k_thread thread_data;
     k_tid_t thread_id;
+#endif
 };
 
 struct analog_switch_cfg {
+#ifndef CONFIG_ANALOG_SWITCH_CONTINUOUS
     struct adc_sequence adc_table;
     const struct device *adc;
+#endif
     uint8_t input_id;
+    uint8_t channel;
 };
 
+#ifndef CONFIG_ANALOG_SWITCH_CONTINUOUS
 static struct adc_sequence_options options = {
 	.extra_samplings = 0,
 	.interval_us = 15,
 };
+#endif
 
 #ifdef CONFIG_ADC_NRFX_SAADC
 #define INPUT_CONFIG                                                           \
@@ -70,30 +137,427 @@ static struct adc_sequence_options options = {
 #define INPUT_CONFIG
 #endif
 
-static void thread_process(void *, void *, void *);
+static uint32_t avg(uint32_t avg, uint16_t sample)
+{
+	if (avg == UINT32_MAX) return sample;
 
-static int as_init(const struct device *dev)
+	if (sample > avg * AVG_CUTOFF_FACTOR) return avg;
+
+	uint32_t divider = 1UL << AVG_FACTOR;
+	uint32_t multiplier = divider - 1;
+
+	uint64_t mult_result = (uint64_t)multiplier * (uint64_t)avg;
+	uint64_t sum_result = mult_result + sample;
+	uint32_t result = sum_result / divider;
+
+	return result;
+}
+
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+static void trace_freeze(struct analog_switch_data *drv_data)
+{
+	uint8_t *hdr = drv_data->trace_hdr;
+	uint16_t first = (drv_data->trace_head + TRACE_LEN - drv_data->trace_num) % TRACE_LEN;
+
+	hdr[TRACE_HDR_VERSION] = TRACE_VERSION;
+	hdr[TRACE_HDR_SOURCE] = drv_data->trace_source;
+	sys_put_le16(ADC_INTERVAL_MS, &hdr[TRACE_HDR_INTERVAL]);
+	sys_put_le16(drv_data->trace_num, &hdr[TRACE_HDR_NUM]);
+	sys_put_le16((drv_data->trace_trigger + TRACE_LEN - first) % TRACE_LEN,
+		     &hdr[TRACE_HDR_TRIGGER]);
+	sys_put_le16(drv_data->det_iters, &hdr[TRACE_HDR_ITERS]);
+	sys_put_le16(drv_data->det_threshold, &hdr[TRACE_HDR_THRESHOLD]);
+	hdr[TRACE_HDR_DEBOUNCE] = drv_data->debounce_cnt;
+	hdr[TRACE_HDR_DEBOUNCE + 1] = 0;
+
+	atomic_set(&drv_data->trace_state, TRACE_FROZEN);
+}
+
+static void trace_sample(struct analog_switch_data *drv_data, uint16_t sample)
+{
+	atomic_val_t state = atomic_get(&drv_data->trace_state);
+
+	if (state == TRACE_FROZEN) return;
+
+	drv_data->trace[drv_data->trace_head] = sample;
+	drv_data->trace_head = (drv_data->trace_head + 1) % TRACE_LEN;
+	if (drv_data->trace_num < TRACE_LEN) {
+		drv_data->trace_num++;
+	}
+
+	if ((state == TRACE_TRIGGERED) && (--drv_data->trace_post == 0)) {
+		trace_freeze(drv_data);
+	}
+}
+
+static void trace_start(struct analog_switch_data *drv_data, enum trace_source source)
+{
+	if (atomic_get(&drv_data->trace_state) != TRACE_RECORDING) return;
+
+	drv_data->trace_source = source;
+	drv_data->trace_post = TRACE_POST;
+	drv_data->trace_trigger = (drv_data->trace_head + TRACE_LEN - 1) % TRACE_LEN;
+
+	atomic_set(&drv_data->trace_state, TRACE_TRIGGERED);
+}
+#endif
+
+// Called for every sample, detection runs every det_iters samples
+static void process_sample(const struct device *dev, uint16_t sample)
+{
+	struct analog_switch_data *drv_data = dev->data;
+	uint32_t avg_delta;
+
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+	trace_sample(drv_data, sample);
+
+	if (atomic_clear(&drv_data->trace_manual)) {
+		trace_start(drv_data, TRACE_SOURCE_MANUAL);
+	}
+#endif
+
+	drv_data->avg = avg(drv_data->avg, sample);
+
+	if (drv_data->prev_avg == UINT32_MAX) {
+		drv_data->prev_avg = drv_data->avg;
+	}
+
+	if (++drv_data->iter < drv_data->det_iters) {
+		return;
+	}
+
+	if (drv_data->iter_led_indication) {
+		led_analog_toggle();
+	}
+
+	drv_data->iter = 0;
+
+	if (drv_data->debouncing <= 0) {
+		bool detected = false;
+
+		if (drv_data->debouncing_led_indication) {
+			led_analog_toggle();
+		}
+
+		avg_delta = drv_data->det_threshold;
+		if ((drv_data->avg > drv_data->prev_avg + avg_delta) &&
+		    (drv_data->last_change != INC)) {
+			detected = true;
+			drv_data->last_change = INC;
+		}
+		if (drv_data->avg < drv_data->prev_avg - avg_delta &&
+		    drv_data->last_change != DEC) {
+			detected = true;
+			drv_data->last_change = DEC;
+		}
+
+		if (detected) {
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+			trace_start(drv_data, TRACE_SOURCE_DETECTION);
+#endif
+			drv_data->events++;
+			drv_data->debouncing = drv_data->debounce_cnt;
+			if (drv_data->callback) drv_data->callback(
+					drv_data->last_change == DEC,
+					drv_data->callback_ctx);
+		}
+	} else {
+		drv_data->debouncing--;
+	}
+
+	drv_data->prev_avg = drv_data->avg;
+}
+
+#if defined(CONFIG_ANALOG_SWITCH_CONTINUOUS) || defined(CONFIG_ANALOG_SWITCH_RUNTIME_STATS)
+#define AS_DEV(idx) DEVICE_DT_INST_GET(idx),
+
+static const struct device *const as_devs[] = {
+	DT_INST_FOREACH_STATUS_OKAY(AS_DEV)
+};
+
+#define NUM_SWITCHES ARRAY_SIZE(as_devs)
+#endif
+
+#ifdef CONFIG_ANALOG_SWITCH_CONTINUOUS
+/*
+ * All switches share the SAADC. TIMER triggers the SAMPLE task through PPI every ADC_INTERVAL_MS,
+ * so that all channels are converted in scan mode and written by EasyDMA to a block buffer.
+ * Samples of a full buffer are processed in a single thread wakeup.
+ *
+ * With start_on_end, the buffer after the one being written is requested as soon as the
+ * conversion to it starts, after the previous buffer is reported done. There are three buffers,
+ * so that the one processed by the sampler thread is not given to EasyDMA until the thread is
+ * done with it.
+ */
+#define BLOCK_LEN  (CONFIG_ANALOG_SWITCH_BLOCK_SAMPLES * NUM_SWITCHES)
+#define NUM_BLOCKS 3
+#define NO_BLOCK   NUM_BLOCKS
+
+#define SAADC_NODE DT_NODELABEL(adc)
+
+struct block {
+	const nrf_saadc_value_t *samples;
+	uint32_t                 process; // Bit per switch
+};
+
+static nrf_saadc_value_t blocks[NUM_BLOCKS][BLOCK_LEN];
+static uint8_t dma_block;        // Buffer set last, being written when the next one is requested
+static atomic_t sampler_block;   // Buffer owned by the sampler thread, NO_BLOCK if none
+static const nrfx_timer_t sample_timer = NRFX_TIMER_INSTANCE(2);
+static atomic_t sampler_started;
+
+// A block waits in the queue until the sampler thread takes it, the thread owns one block at a time
+K_MSGQ_DEFINE(block_msgq, sizeof(struct block), 1, 4);
+
+K_THREAD_STACK_DEFINE(sampler_stack, THREAD_STACK_SIZE);
+static struct k_thread sampler_thread;
+
+static uint16_t sample_value(nrf_saadc_value_t sample)
+{
+	// Single-ended conversion of an input close to ground can be negative
+	return sample < 0 ? 0 : (uint16_t)sample;
+}
+
+#ifdef CONFIG_ANALOG_SWITCH_LIMITS
+static atomic_t limit_hits;
+
+/*
+ * While all samples stay within +-det_threshold/2 of the average, the average cannot change by
+ * more than det_threshold and no transition can be detected. The window is armed with SAADC limits
+ * and blocks are not processed until a sample crosses it.
+ */
+static void arm_limits(const struct device *dev)
 {
 	struct analog_switch_data *drv_data = dev->data;
 	const struct analog_switch_cfg *drv_cfg = dev->config;
+	int32_t half = drv_data->det_threshold / 2;
+	k_spinlock_key_t key;
+	static struct k_spinlock lock;
 
-	if (drv_cfg->adc == NULL) {
-		LOG_ERR("Failed to get ADC device.");
-		return -EINVAL;
+	if (drv_data->limits_armed || (drv_data->debouncing > 0) ||
+	    (drv_data->avg == UINT32_MAX)) {
+		return;
+	}
+
+	key = k_spin_lock(&lock);
+	if (nrfx_saadc_limits_set(drv_cfg->channel,
+				  (int16_t)MAX((int32_t)drv_data->avg - half, INT16_MIN),
+				  (int16_t)MIN((int32_t)drv_data->avg + half, INT16_MAX))
+	    == NRFX_SUCCESS) {
+		drv_data->limits_armed = true;
+	}
+	k_spin_unlock(&lock, key);
+}
+
+static void limit_hit(uint8_t channel)
+{
+	struct analog_switch_data *drv_data = as_devs[channel]->data;
+
+	nrfx_saadc_limits_set(channel, NRFX_SAADC_LIMITL_DISABLED, NRFX_SAADC_LIMITH_DISABLED);
+	drv_data->limits_armed = false;
+	atomic_or(&limit_hits, BIT(channel));
+}
+#endif
+
+static void block_done(const nrf_saadc_value_t *samples)
+{
+	struct block block = {
+		.samples = samples,
+		.process = BIT_MASK(NUM_SWITCHES),
+	};
+
+	for (int i = 0; i < NUM_SWITCHES; i++) {
+		struct analog_switch_data *drv_data = as_devs[i]->data;
+
+		drv_data->raw = sample_value(samples[BLOCK_LEN - NUM_SWITCHES + i]);
+
+#ifdef CONFIG_ANALOG_SWITCH_LIMITS
+		if (drv_data->limits_armed) {
+			block.process &= ~BIT(i);
+		}
+#endif
+	}
+
+#ifdef CONFIG_ANALOG_SWITCH_LIMITS
+	block.process |= atomic_clear(&limit_hits);
+	if (!block.process) return;
+#endif
+
+	// Block is dropped if the previous one is still processed
+	if (!atomic_cas(&sampler_block, NO_BLOCK, (samples - blocks[0]) / BLOCK_LEN)) return;
+
+	(void)k_msgq_put(&block_msgq, &block, K_NO_WAIT);
+}
+
+// Neither the buffer being written nor the one owned by the sampler thread
+static uint8_t free_block(void)
+{
+	atomic_val_t owned = atomic_get(&sampler_block);
+
+	for (uint8_t i = 0; i < NUM_BLOCKS; i++) {
+		if ((i != dma_block) && (i != owned)) return i;
+	}
+
+	CODE_UNREACHABLE;
+}
+
+static void saadc_handler(nrfx_saadc_evt_t const *evt)
+{
+	switch (evt->type) {
+		case NRFX_SAADC_EVT_BUF_REQ:
+			// Requested when EasyDMA starts writing the buffer set before
+			dma_block = free_block();
+			nrfx_saadc_buffer_set(blocks[dma_block], BLOCK_LEN);
+			break;
+
+		case NRFX_SAADC_EVT_DONE:
+			block_done(evt->data.done.p_buffer);
+			break;
+
+#ifdef CONFIG_ANALOG_SWITCH_LIMITS
+		case NRFX_SAADC_EVT_LIMIT:
+			limit_hit(evt->data.limit.channel);
+			break;
+#endif
+
+		default:
+			break;
+	}
+}
+
+static void timer_handler(nrf_timer_event_t event_type, void *ctx)
+{
+	// Compare event is used only by PPI
+	(void)event_type;
+	(void)ctx;
+}
+
+static void sampler_process(void *, void *, void *)
+{
+	struct block block;
+
+	while (1) {
+		k_msgq_get(&block_msgq, &block, K_FOREVER);
+
+		for (int i = 0; i < NUM_SWITCHES; i++) {
+			const struct device *dev = as_devs[i];
+			struct analog_switch_data *drv_data = dev->data;
+
+			if (!drv_data->enabled || !(block.process & BIT(i))) continue;
+
+			for (int s = i; s < BLOCK_LEN; s += NUM_SWITCHES) {
+				process_sample(dev, sample_value(block.samples[s]));
+			}
+
+#ifdef CONFIG_ANALOG_SWITCH_LIMITS
+			arm_limits(dev);
+#endif
+		}
+
+		atomic_set(&sampler_block, NO_BLOCK);
+	}
+}
+
+static int sampler_start(void)
+{
+	nrfx_err_t err;
+	uint8_t ppi_ch;
+	nrfx_saadc_channel_t channels[NUM_SWITCHES];
+	nrfx_saadc_adv_config_t adv_cfg = NRFX_SAADC_DEFAULT_ADV_CONFIG;
+	nrfx_timer_config_t timer_cfg = NRFX_TIMER_DEFAULT_CONFIG(NRFX_MHZ_TO_HZ(1));
+
+	IRQ_CONNECT(DT_IRQN(SAADC_NODE), DT_IRQ(SAADC_NODE, priority),
+		    nrfx_isr, nrfx_saadc_irq_handler, 0);
+
+	err = nrfx_saadc_init(DT_IRQ(SAADC_NODE, priority));
+	if (err != NRFX_SUCCESS) goto error;
+
+	for (int i = 0; i < NUM_SWITCHES; i++) {
+		const struct analog_switch_cfg *drv_cfg = as_devs[i]->config;
+
+		channels[i] = (nrfx_saadc_channel_t)NRFX_SAADC_DEFAULT_CHANNEL_SE(
+				NRF_SAADC_INPUT_AIN0 + drv_cfg->input_id, drv_cfg->channel);
+		channels[i].channel_config.gain = NRF_SAADC_GAIN1_4;
+		channels[i].channel_config.reference = NRF_SAADC_REFERENCE_VDD4;
 	}
 
+	err = nrfx_saadc_channels_config(channels, NUM_SWITCHES);
+	if (err != NRFX_SUCCESS) goto error;
+
+	// END restarts conversion to the next buffer without waiting for the CPU
+	adv_cfg.start_on_end = true;
+	err = nrfx_saadc_advanced_mode_set(BIT_MASK(NUM_SWITCHES), NRF_SAADC_RESOLUTION_12BIT,
+					   &adv_cfg, saadc_handler);
+	if (err != NRFX_SUCCESS) goto error;
+
+	atomic_set(&sampler_block, NO_BLOCK);
+	dma_block = 0;
+	err = nrfx_saadc_buffer_set(blocks[dma_block], BLOCK_LEN);
+	if (err != NRFX_SUCCESS) goto error;
+
+	err = nrfx_timer_init(&sample_timer, &timer_cfg, timer_handler);
+	if (err != NRFX_SUCCESS) goto error;
+
+	nrfx_timer_extended_compare(&sample_timer, NRF_TIMER_CC_CHANNEL0,
+				    nrfx_timer_ms_to_ticks(&sample_timer, ADC_INTERVAL_MS),
+				    NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, false);
+
+	err = nrfx_gppi_channel_alloc(&ppi_ch);
+	if (err != NRFX_SUCCESS) goto error;
+
+	nrfx_gppi_channel_endpoints_setup(ppi_ch,
+		nrfx_timer_compare_event_address_get(&sample_timer, NRF_TIMER_CC_CHANNEL0),
+		nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_SAMPLE));
+	nrfx_gppi_channels_enable(BIT(ppi_ch));
+
+	k_thread_create(&sampler_thread, sampler_stack, K_THREAD_STACK_SIZEOF(sampler_stack),
+			sampler_process, NULL, NULL, NULL, THREAD_PRIORITY, 0, K_NO_WAIT);
+
+	err = nrfx_saadc_mode_trigger();
+	if (err != NRFX_SUCCESS) goto error;
+
+	nrfx_timer_enable(&sample_timer);
+
+	return 0;
+
+error:
+	LOG_ERR("Failed to start sampling: %d", err);
+	return -EIO;
+}
+#else
+static void thread_process(void *, void *, void *);
+#endif
+
+static int as_init(const struct device *dev)
+{
+	struct analog_switch_data *drv_data = dev->data;
+	const struct analog_switch_cfg *drv_cfg = dev->config;
+
 	drv_data->avg           = UINT32_MAX;
 	drv_data->det_iters     = 40;
 	drv_data->det_threshold = 24;
 	drv_data->debounce_cnt  = 3; 
 	drv_data->last_change   = NONE;
 
+	drv_data->iter       = 0;
+	drv_data->debouncing = 0;
+	drv_data->prev_avg   = UINT32_MAX;
+
 	drv_data->iter_led_indication       = false;
 	drv_data->debouncing_led_indication = false;
 
 	drv_data->callback     = NULL;
 	drv_data->callback_ctx = NULL;
 
+#ifdef CONFIG_ANALOG_SWITCH_CONTINUOUS
+	// SAADC is configured for all switches when the first one is enabled
+	(void)drv_cfg;
+#else
+	if (drv_cfg->adc == NULL) {
+		LOG_ERR("Failed to get ADC device.");
+		return -EINVAL;
+	}
+
 	struct adc_channel_cfg ch_cfg = {
 	    .gain = ADC_GAIN_1_4,
 	    .reference = ADC_REF_VDD_1_4,
@@ -112,99 +576,44 @@ static int as_init(const struct device *dev)
 					      THREAD_PRIORITY,
 					      0,
 					      K_FOREVER);
+#endif
 
 	return 0;
 }
 
-static uint32_t avg(uint32_t avg, uint16_t sample)
-{
-	if (avg == UINT32_MAX) return sample;
-
-	if (sample > avg * AVG_CUTOFF_FACTOR) return avg;
-
-	uint32_t divider = 1UL << AVG_FACTOR;
-	uint32_t multiplier = divider - 1;
-
-	uint64_t mult_result = (uint64_t)multiplier * (uint64_t)avg;
-	uint64_t sum_result = mult_result + sample;
-	uint32_t result = sum_result / divider;
-
-	return result;
-}
-
+#ifndef CONFIG_ANALOG_SWITCH_CONTINUOUS
 static void thread_process(void *arg1, void *, void *)
 {
 	const struct device *dev = arg1;
 	struct analog_switch_data *drv_data = dev->data;
 	const struct analog_switch_cfg *drv_cfg = dev->config;
 	int r;
-	int i = 0;
-	int debouncing = 0;
-	uint32_t prev_avg = UINT32_MAX;
-	uint32_t avg_delta;
 
 	while (1) {
 		r = adc_read(drv_cfg->adc, &drv_cfg->adc_table);
 		if (r) continue; // TODO: If happens multiple times in a raw, report error somewhere?
- 
-		drv_data->avg = avg(drv_data->avg, drv_data->raw);
-
-		if (prev_avg == UINT32_MAX) {
-			prev_avg = drv_data->avg;
-		}
 
-		if (++i >= drv_data->det_iters) {
-			if (drv_data->iter_led_indication) {
-				led_analog_toggle();
-			}
-
-			i = 0;
-
-			if (debouncing <= 0) {
-				bool detected = false;
-
-				if (drv_data->debouncing_led_indication) {
-					led_analog_toggle();
-				}
-				
-				avg_delta = drv_data->det_threshold;
-				if ((drv_data->avg > prev_avg + avg_delta) &&
-				    (drv_data->last_change != INC)) {
-					detected = true;
-					drv_data->last_change = INC;
-				}
-				if (drv_data->avg < prev_avg - avg_delta &&
-				    drv_data->last_change != DEC) {
-					detected = true;
-					drv_data->last_change = DEC;
-				}
-
-				if (detected) {
-					drv_data->events++;
-					debouncing = drv_data->debounce_cnt;
-					if (drv_data->callback) drv_data->callback(
-							drv_data->last_change == DEC,
-							drv_data->callback_ctx);
-				}
-			} else {
-				debouncing--;
-			}
-
-			prev_avg = drv_data->avg;
-		}
+		process_sample(dev, drv_data->raw);
 
 		k_sleep(K_MSEC(ADC_INTERVAL_MS));
 	}
 }
+#endif
 
 static int get(const struct device *dev, uint16_t *result)
 {
-	int ret = 0;
 	struct analog_switch_data *drv_data = dev->data;
+
+#ifdef CONFIG_ANALOG_SWITCH_CONTINUOUS
+	// The latest sample of the last block
+	if (!atomic_get(&sampler_started)) return -EAGAIN;
+#else
+	int ret = 0;
 	const struct analog_switch_cfg *drv_cfg = dev->config;
 
 	ret = adc_read(drv_cfg->adc, &drv_cfg->adc_table);
 	if (ret) return ret;
+#endif
 
 	*result = drv_data->raw;
 	return 0;
@@ -225,7 +634,16 @@ static int register_callback(const struct device *dev,
 static int enable(const struct device *dev)
 {
 	struct analog_switch_data *drv_data = dev->data;
+
+#ifdef CONFIG_ANALOG_SWITCH_CONTINUOUS
+	drv_data->enabled = true;
+
+	if (atomic_cas(&sampler_started, 0, 1)) {
+		return sampler_start();
+	}
+#else
 	k_thread_start(drv_data->thread_id);
+#endif
 
 	return 0;
 }
@@ -278,6 +696,96 @@ static int get_config(const struct device *dev, int *iters, int *threshold, int
 	return 0;
 }
 
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+// Manual trigger captures a press which was not detected
+static int trace_trigger(const struct device *dev)
+{
+	struct analog_switch_data *drv_data = dev->data;
+
+	if (atomic_get(&drv_data->trace_state) != TRACE_RECORDING) return -EALREADY;
+
+	atomic_set(&drv_data->trace_manual, 1);
+
+	return 0;
+}
+
+static int trace_rearm(const struct device *dev)
+{
+	struct analog_switch_data *drv_data = dev->data;
+
+	// Recording trace is kept
+	if (atomic_get(&drv_data->trace_state) != TRACE_FROZEN) return 0;
+
+	drv_data->trace_num = 0;
+	atomic_clear(&drv_data->trace_manual);
+	atomic_set(&drv_data->trace_state, TRACE_RECORDING);
+
+	return 0;
+}
+
+static int trace_get(const struct device *dev, size_t offset, uint8_t *buf, size_t len,
+		     size_t *size)
+{
+	struct analog_switch_data *drv_data = dev->data;
+	uint16_t first;
+	size_t copied = 0;
+
+	if (atomic_get(&drv_data->trace_state) != TRACE_FROZEN) return -EBUSY;
+
+	*size = TRACE_HDR_LEN + drv_data->trace_num * sizeof(uint16_t);
+	first = (drv_data->trace_head + TRACE_LEN - drv_data->trace_num) % TRACE_LEN;
+
+	for (; (copied < len) && (offset < *size); copied++, offset++) {
+		if (offset < TRACE_HDR_LEN) {
+			buf[copied] = drv_data->trace_hdr[offset];
+		} else {
+			size_t s = (offset - TRACE_HDR_LEN) / sizeof(uint16_t);
+			uint16_t sample = drv_data->trace[(first + s) % TRACE_LEN];
+
+			buf[copied] = ((offset - TRACE_HDR_LEN) % sizeof(uint16_t)) ?
+				      (sample >> 8) : (sample & 0xff);
+		}
+	}
+
+	return copied;
+}
+#endif
+
+#ifdef CONFIG_ANALOG_SWITCH_RUNTIME_STATS
+int analog_switch_runtime_get(uint64_t *sampling, uint64_t *total)
+{
+	k_thread_runtime_stats_t stats;
+	int r;
+
+	*sampling = 0;
+
+#ifdef CONFIG_ANALOG_SWITCH_CONTINUOUS
+	if (atomic_get(&sampler_started)) {
+		r = k_thread_runtime_stats_get(&sampler_thread, &stats);
+		if (r) return r;
+
+		*sampling = stats.execution_cycles;
+	}
+#else
+	for (int i = 0; i < NUM_SWITCHES; i++) {
+		struct analog_switch_data *drv_data = as_devs[i]->data;
+
+		r = k_thread_runtime_stats_get(drv_data->thread_id, &stats);
+		if (r) return r;
+
+		*sampling += stats.execution_cycles;
+	}
+#endif
+
+	r = k_thread_runtime_stats_all_get(&stats);
+	if (r) return r;
+
+	*total = stats.execution_cycles;
+
+	return 0;
+}
+#endif
+
 static const struct analog_switch_driver_api as_api = {
 	.get = &get,
 	.register_callback = register_callback,
@@ -286,20 +794,33 @@ static const struct analog_switch_driver_api as_api = {
 	.get_events = get_events,
 	.set_config = set_config,
 	.get_config = get_config,
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+	.trace_trigger = trace_trigger,
+	.trace_rearm = trace_rearm,
+	.trace_get = trace_get,
+#endif
 };
 
-#define ANALOG_SWITCH_INIT(idx)                                                \
-    static struct analog_switch_data as_##idx##_data;                          \
-    static const struct analog_switch_cfg as_##idx##_cfg = {                   \
+#ifdef CONFIG_ANALOG_SWITCH_CONTINUOUS
+#define ADC_CONFIG(idx)
+#else
+#define ADC_CONFIG(idx)                                                        \
         .adc = DEVICE_DT_GET(DT_INST_PHANDLE(idx, io_channels)),               \
-        .input_id = DT_INST_IO_CHANNELS_INPUT_BY_IDX(idx, 0),                  \
         .adc_table = {                                                         \
             .options = &options,                                               \
             .resolution = ADC_RESOLUTION,                                      \
             .buffer = &as_##idx##_data.raw,                                    \
             .buffer_size = sizeof(as_##idx##_data.raw),                        \
             .channels = BIT(DT_INST_IO_CHANNELS_INPUT_BY_IDX(idx, 0)),         \
-        },                                                                     \
+        },
+#endif
+
+#define ANALOG_SWITCH_INIT(idx)                                                \
+    static struct analog_switch_data as_##idx##_data;                          \
+    static const struct analog_switch_cfg as_##idx##_cfg = {                   \
+        .input_id = DT_INST_IO_CHANNELS_INPUT_BY_IDX(idx, 0),                  \
+        .channel = idx,                                                        \
+        ADC_CONFIG(idx)                                                        \
     };                                                                         \
                                                                                \
     DEVICE_DT_INST_DEFINE(idx, &as_init, NULL,                                 \
@@ -12,6 +12,7 @@
 #ifndef ANALOG_SWITCH_H_
 #define ANALOG_SWITCHC_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <device.h>
     
@@ -48,6 +49,30 @@ typedef int (*analog_switch_api_get_config)(const struct device *dev,
 					    int *det_threshold,
 					    int *debounce_cnt);
 
+/** @brief Trigger trace capture, the trace is frozen after the post-trigger samples */
+typedef int (*analog_switch_api_trace_trigger)(const struct device *dev);
+
+/** @brief Drop the frozen trace and record a new one */
+typedef int (*analog_switch_api_trace_rearm)(const struct device *dev);
+
+/** @brief Copy a part of the frozen trace
+ *
+ * The trace format is described in scripts/as_replay.py.
+ *
+ * @param[in]  dev    Analog switch device
+ * @param[in]  offset Offset of the first byte to copy
+ * @param[out] buf    Buffer for the trace data
+ * @param[in]  len    Capacity of @p buf
+ * @param[out] size   Total size of the trace
+ *
+ * @return Number of copied bytes, -EBUSY if the trace is still being recorded
+ */
+typedef int (*analog_switch_api_trace_get)(const struct device *dev,
+                                           size_t offset,
+                                           uint8_t *buf,
+                                           size_t len,
+                                           size_t *size);
+
 struct analog_switch_driver_api {
 	analog_switch_api_get               get;
 	analog_switch_api_register_callback register_callback;
@@ -56,8 +81,23 @@ struct analog_switch_driver_api {
 	analog_switch_api_get_events        get_events;
 	analog_switch_api_set_config        set_config;
 	analog_switch_api_get_config        get_config;
+	analog_switch_api_trace_trigger     trace_trigger;
+	analog_switch_api_trace_rearm       trace_rearm;
+	analog_switch_api_trace_get         trace_get;
 };
 
+/**
+ * @brief Get CPU time used by analog switch sampling
+ *
+ * Requires CONFIG_ANALOG_SWITCH_RUNTIME_STATS.
+ *
+ * @param[out] sampling Execution cycles of the sampling threads since boot
+ * @param[out] total    Execution cycles of all threads since boot, idle included
+ *
+ * @return 0 on success, negative error code otherwise
+ */
+int analog_switch_runtime_get(uint64_t *sampling, uint64_t *total);
+
 #ifdef __cplusplus
 }   
 #endif
@@ -6,6 +6,10 @@
 
 #include "coap.h"
 
+#include <errno.h>
+#include <stdint.h>
+
+#include <cbor_utils.h>
 #include <coap_fota.h>
 #include <coap_reboot.h>
 #include <coap_sd.h>
@@ -13,15 +17,17 @@
 #include "led.h"
 #include "prov.h"
 
-#include <net/socket.h>
-#include <net/coap.h>
-#include <tinycbor/cbor.h>
-#include <tinycbor/cbor_buf_reader.h>
-#include <tinycbor/cbor_buf_writer.h>
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
 
 #define MAX_COAP_MSG_LEN 256
 #define MAX_COAP_PAYLOAD_LEN 64
 
+// Payload formats are described in lib/cddl
+
 #define RSRC0_KEY "r0"
 #define RSRC1_KEY "r1"
 #define OUT0_KEY "o0"
@@ -32,211 +38,80 @@
 #define THRESHOLD1_KEY "t1"
 #define MONOSTABLE_KEY "m"
 
-static int prov_post(struct coap_resource *resource,
-        struct coap_packet *request,
-        struct sockaddr *addr, socklen_t addr_len)
+enum {
+    PROV_RSRC0,
+    PROV_RSRC1,
+    PROV_OUT0,
+    PROV_OUT1,
+    PROV_ANALOG0,
+    PROV_ANALOG1,
+    PROV_THRESHOLD0,
+    PROV_THRESHOLD1,
+    PROV_MONOSTABLE,
+};
+
+static int handle_prov_post(zcbor_state_t *cd,
+	       	enum coap_response_code *rsp_code, void *context)
 {
-    int sock = *(int*)resource->user_data;
-    uint16_t id;
-    uint8_t code;
-    uint8_t type;
-    uint8_t tkl;
-    uint8_t token[COAP_TOKEN_MAX_LEN];
-    int r = 0;
-    struct coap_option option;
-    const uint8_t *payload;
-    uint16_t payload_len;
-    enum coap_response_code rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
-
-    code = coap_header_get_code(request);
-    type = coap_header_get_type(request);
-    id = coap_header_get_id(request);
-    tkl = coap_header_get_token(request, token);
-
-    if (type != COAP_TYPE_CON) {
-        return -EINVAL;
-    }
-
-#if BLOCK_GLOBAL_ACCESS
-    if (!addr_is_local(addr, addr_len) && !sock_is_secure(sock)) {
-        // TODO: Send ACK Forbidden?
-        return -EINVAL;
-    }
-#endif
-
-    r = coap_find_options(request, COAP_OPTION_CONTENT_FORMAT, &option, 1); 
-    if (r != 1) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
-
-    if (coap_option_value_to_int(&option) != COAP_CONTENT_FORMAT_APP_CBOR) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_UNSUPPORTED_CONTENT_FORMAT, token, tkl);
-        return -EINVAL;
-    }
+    (void)context;
 
-    payload = coap_packet_get_payload(request, &payload_len);
-    if (!payload) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
-
-    CborError cbor_error;
-    CborParser parser;
-    CborValue value;
-    struct cbor_buf_reader reader;
+    int r = -EINVAL;
     bool updated = false;
+    char rsrc[2][PROV_LBL_MAX_LEN];
+    char out[2][PROV_LBL_MAX_LEN];
+    bool analog[2];
+    int threshold[2];
+    bool monostable;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [PROV_RSRC0]      = CBOR_MAP_FIELD_TSTR(RSRC0_KEY, rsrc[0]),
+        [PROV_RSRC1]      = CBOR_MAP_FIELD_TSTR(RSRC1_KEY, rsrc[1]),
+        [PROV_OUT0]       = CBOR_MAP_FIELD_TSTR(OUT0_KEY, out[0]),
+        [PROV_OUT1]       = CBOR_MAP_FIELD_TSTR(OUT1_KEY, out[1]),
+        [PROV_ANALOG0]    = CBOR_MAP_FIELD_BOOL(ANALOG0_KEY, &analog[0]),
+        [PROV_ANALOG1]    = CBOR_MAP_FIELD_BOOL(ANALOG1_KEY, &analog[1]),
+        [PROV_THRESHOLD0] = CBOR_MAP_FIELD_INT(THRESHOLD0_KEY, &threshold[0]),
+        [PROV_THRESHOLD1] = CBOR_MAP_FIELD_INT(THRESHOLD1_KEY, &threshold[1]),
+        [PROV_MONOSTABLE] = CBOR_MAP_FIELD_BOOL(MONOSTABLE_KEY, &monostable),
+    };
 
-    cbor_buf_reader_init(&reader, payload, payload_len);
-
-    cbor_error = cbor_parser_init(&reader.r, 0, &parser, &value);
-    if (cbor_error != CborNoError) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
-
-    if (!cbor_value_is_map(&value)) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
-
-    CborValue map_val;
-
-    // Handle rsrc0
-    cbor_error = cbor_value_map_find_value(&value, RSRC0_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_text_string(&map_val)) {
-        size_t str_len;
-
-        cbor_error = cbor_value_get_string_length(&map_val, &str_len);
-        if ((cbor_error == CborNoError) && (str_len < PROV_LBL_MAX_LEN)) {
-            char str[PROV_LBL_MAX_LEN];
-            str_len = PROV_LBL_MAX_LEN;
-
-            cbor_error = cbor_value_copy_text_string(&map_val, str, &str_len, NULL);
-            if (cbor_error == CborNoError) {
-                r = prov_set_rsrc_label(0, str);
-
-                if (r == 0) {
-                    updated = true;
-                }
-            }
-        }
-    }
-
-    // Handle rsrc1
-    cbor_error = cbor_value_map_find_value(&value, RSRC1_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_text_string(&map_val)) {
-        size_t str_len;
-
-        cbor_error = cbor_value_get_string_length(&map_val, &str_len);
-        if ((cbor_error == CborNoError) && (str_len < PROV_LBL_MAX_LEN)) {
-            char str[PROV_LBL_MAX_LEN];
-            str_len = PROV_LBL_MAX_LEN;
-
-            cbor_error = cbor_value_copy_text_string(&map_val, str, &str_len, NULL);
-            if (cbor_error == CborNoError) {
-                r = prov_set_rsrc_label(1, str);
-
-                if (r == 0) {
-                    updated = true;
-                }
-            }
-        }
-    }
-
-    // Handle output0
-    cbor_error = cbor_value_map_find_value(&value, OUT0_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_text_string(&map_val)) {
-        size_t str_len;
-
-        cbor_error = cbor_value_get_string_length(&map_val, &str_len);
-        if ((cbor_error == CborNoError) && (str_len < PROV_LBL_MAX_LEN)) {
-            char str[PROV_LBL_MAX_LEN];
-            str_len = PROV_LBL_MAX_LEN;
-
-            cbor_error = cbor_value_copy_text_string(&map_val, str, &str_len, NULL);
-            if (cbor_error == CborNoError) {
-                r = prov_set_output_rsrc_label(0, str);
-
-                if (r == 0) {
-                    updated = true;
-                }
-            }
-        }
-    }
-
-    // Handle output1
-    cbor_error = cbor_value_map_find_value(&value, OUT1_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_text_string(&map_val)) {
-        size_t str_len;
-
-        cbor_error = cbor_value_get_string_length(&map_val, &str_len);
-        if ((cbor_error == CborNoError) && (str_len < PROV_LBL_MAX_LEN)) {
-            char str[PROV_LBL_MAX_LEN];
-            str_len = PROV_LBL_MAX_LEN;
-
-            cbor_error = cbor_value_copy_text_string(&map_val, str, &str_len, NULL);
-            if (cbor_error == CborNoError) {
-                r = prov_set_output_rsrc_label(1, str);
+    *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
-                if (r == 0) {
-                    updated = true;
-                }
-            }
-        }
-    }
+    r = cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present);
+    if (r) return r;
 
-    // Handle analog0
-    cbor_error = cbor_value_map_find_value(&value, ANALOG0_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_boolean(&map_val)) {
-        bool enabled;
-        cbor_error = cbor_value_get_boolean(&map_val, &enabled);
-        if (cbor_error == CborNoError) {
-            r = prov_set_analog_enabled(0, enabled);
+    for (int i = 0; i < 2; i++) {
+        // Handle rsrc
+        if (CBOR_MAP_PRESENT(present, PROV_RSRC0 + i)) {
+            r = prov_set_rsrc_label(i, rsrc[i]);
 
             if (r == 0) {
                 updated = true;
             }
         }
-    }
 
-    // Handle analog1
-    cbor_error = cbor_value_map_find_value(&value, ANALOG1_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_boolean(&map_val)) {
-        bool enabled;
-        cbor_error = cbor_value_get_boolean(&map_val, &enabled);
-        if (cbor_error == CborNoError) {
-            r = prov_set_analog_enabled(1, enabled);
+        // Handle output
+        if (CBOR_MAP_PRESENT(present, PROV_OUT0 + i)) {
+            r = prov_set_output_rsrc_label(i, out[i]);
 
             if (r == 0) {
                 updated = true;
             }
         }
-    }
 
-    // Handle threshold0
-    cbor_error = cbor_value_map_find_value(&value, THRESHOLD0_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        uint64_t req_threshold;
-
-        cbor_error = cbor_value_get_uint64(&map_val, &req_threshold);
-        if ((cbor_error == CborNoError) && (req_threshold <= UINT16_MAX)) {
-            r = prov_set_analog_threshold(0, req_threshold);
+        // Handle analog
+        if (CBOR_MAP_PRESENT(present, PROV_ANALOG0 + i)) {
+            r = prov_set_analog_enabled(i, analog[i]);
 
             if (r == 0) {
                 updated = true;
             }
         }
-    }
 
-    // Handle threshold1
-    cbor_error = cbor_value_map_find_value(&value, THRESHOLD1_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        uint64_t req_threshold;
-
-        cbor_error = cbor_value_get_uint64(&map_val, &req_threshold);
-        if ((cbor_error == CborNoError) && (req_threshold <= UINT16_MAX)) {
-            r = prov_set_analog_threshold(1, req_threshold);
+        // Handle threshold
+        if (CBOR_MAP_PRESENT(present, PROV_THRESHOLD0 + i) &&
+                (threshold[i] >= 0) && (threshold[i] <= UINT16_MAX)) {
+            r = prov_set_analog_threshold(i, threshold[i]);
 
             if (r == 0) {
                 updated = true;
@@ -245,81 +120,80 @@ static int prov_post(struct coap_resource *resource,
     }
 
     // Handle monostable
-    cbor_error = cbor_value_map_find_value(&value, MONOSTABLE_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_boolean(&map_val)) {
-        bool enabled;
-        cbor_error = cbor_value_get_boolean(&map_val, &enabled);
-        if (cbor_error == CborNoError) {
-            r = prov_set_monostable(enabled);
+    if (CBOR_MAP_PRESENT(present, PROV_MONOSTABLE)) {
+        r = prov_set_monostable(monostable);
 
-            if (r == 0) {
-                updated = true;
-            }
+        if (r == 0) {
+            updated = true;
         }
     }
 
     if (updated) {
-        rsp_code = COAP_RESPONSE_CODE_CHANGED;
+        *rsp_code = COAP_RESPONSE_CODE_CHANGED;
         prov_store();
     }
 
-    r = coap_server_send_ack(sock, addr, addr_len, id, rsp_code, token, tkl);
     return r;
 }
 
+static int prov_post(struct coap_resource *resource,
+        struct coap_packet *request,
+        struct sockaddr *addr, socklen_t addr_len)
+{
+    int sock = *(int*)resource->user_data;
+
+    return coap_server_handle_simple_setter(sock, resource, request, addr, addr_len,
+		    handle_prov_post, NULL);
+}
+
 static int prepare_prov_payload(uint8_t *payload, size_t len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
     const char *label;
     bool enabled;
     int threshold;
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
-
-    if (cbor_encoder_create_map(&ce, &map, 9) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 9)) return -EINVAL;
 
     label = prov_get_rsrc_label(0);
-    if (cbor_encode_text_string(&map, RSRC0_KEY, strlen(RSRC0_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_text_string(&map, label, strlen(label)) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, RSRC0_KEY)) return -EINVAL;
+    if (!zcbor_tstr_put_term(ce, label, PROV_LBL_MAX_LEN)) return -EINVAL;
 
     label = prov_get_rsrc_label(1);
-    if (cbor_encode_text_string(&map, RSRC1_KEY, strlen(RSRC1_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_text_string(&map, label, strlen(label)) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, RSRC1_KEY)) return -EINVAL;
+    if (!zcbor_tstr_put_term(ce, label, PROV_LBL_MAX_LEN)) return -EINVAL;
 
     label = prov_get_output_rsrc_label(0);
-    if (cbor_encode_text_string(&map, OUT0_KEY, strlen(OUT0_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_text_string(&map, label, strlen(label)) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, OUT0_KEY)) return -EINVAL;
+    if (!zcbor_tstr_put_term(ce, label, PROV_LBL_MAX_LEN)) return -EINVAL;
 
     label = prov_get_output_rsrc_label(1);
-    if (cbor_encode_text_string(&map, OUT1_KEY, strlen(OUT1_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_text_string(&map, label, strlen(label)) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, OUT1_KEY)) return -EINVAL;
+    if (!zcbor_tstr_put_term(ce, label, PROV_LBL_MAX_LEN)) return -EINVAL;
 
     enabled = prov_get_analog_enabled(0);
-    if (cbor_encode_text_string(&map, ANALOG0_KEY, strlen(ANALOG0_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_boolean(&map, enabled) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, ANALOG0_KEY)) return -EINVAL;
+    if (!zcbor_bool_put(ce, enabled)) return -EINVAL;
 
     enabled = prov_get_analog_enabled(1);
-    if (cbor_encode_text_string(&map, ANALOG1_KEY, strlen(ANALOG1_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_boolean(&map, enabled) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, ANALOG1_KEY)) return -EINVAL;
+    if (!zcbor_bool_put(ce, enabled)) return -EINVAL;
 
     threshold = prov_get_analog_threshold(0);
-    if (cbor_encode_text_string(&map, THRESHOLD0_KEY, strlen(THRESHOLD0_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, threshold) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, THRESHOLD0_KEY)) return -EINVAL;
+    if (!zcbor_int32_put(ce, threshold)) return -EINVAL;
 
     threshold = prov_get_analog_threshold(1);
-    if (cbor_encode_text_string(&map, THRESHOLD1_KEY, strlen(THRESHOLD1_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, threshold) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, THRESHOLD1_KEY)) return -EINVAL;
+    if (!zcbor_int32_put(ce, threshold)) return -EINVAL;
 
     enabled = prov_get_monostable();
-    if (cbor_encode_text_string(&map, MONOSTABLE_KEY, strlen(MONOSTABLE_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_boolean(&map, enabled) != CborNoError) return -EINVAL;
+    if (!zcbor_tstr_put_lit(ce, MONOSTABLE_KEY)) return -EINVAL;
+    if (!zcbor_bool_put(ce, enabled)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 9)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int prov_get(struct coap_resource *resource,
@@ -327,158 +201,54 @@ static int prov_get(struct coap_resource *resource,
         struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
-    uint16_t id;
-    uint8_t code;
-    uint8_t type;
-    uint8_t tkl;
-    uint8_t token[COAP_TOKEN_MAX_LEN];
-    uint8_t *data;
     int r = 0;
-    struct coap_packet response;
     uint8_t payload[MAX_COAP_PAYLOAD_LEN];
+    size_t payload_len;
 
-    code = coap_header_get_code(request);
-    type = coap_header_get_type(request);
-    id = coap_header_get_id(request);
-    tkl = coap_header_get_token(request, token);
-
-    if (type != COAP_TYPE_CON) {
-        return -EINVAL;
-    }
-
-#if BLOCK_GLOBAL_ACCESS
-    if (!addr_is_local(addr, addr_len) && !sock_is_secure(sock)) {
-        // TODO: Send ACK Forbidden?
-        return -EINVAL;
-    }
-#endif
-
-    data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
-    if (!data) {
-        return -ENOMEM;
-    }
-
-    r = coap_packet_init(&response, data, MAX_COAP_MSG_LEN,
-                 1, COAP_TYPE_ACK, tkl, token,
-                 COAP_RESPONSE_CODE_CONTENT, id);
+    r = prepare_prov_payload(payload, sizeof(payload));
     if (r < 0) {
-        goto end;
+        return r;
     }
+    payload_len = r;
 
-    r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_APP_CBOR);
-    if (r < 0) {
-        goto end;
-    }
+    return coap_server_handle_simple_getter(sock, resource, request, addr, addr_len,
+                    payload, payload_len);
+}
 
-    r = coap_packet_append_payload_marker(&response);
-    if (r < 0) {
-        goto end;
-    }
+#define PULSE_KEY "p"
 
-    r = prepare_prov_payload(payload, MAX_COAP_PAYLOAD_LEN);
-    if (r < 0) {
-        goto end;
-    }
+static int handle_pulse_post(zcbor_state_t *cd,
+	       	enum coap_response_code *rsp_code, void *context)
+{
+    (void)context;
+    uint32_t req_num_pulses;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        CBOR_MAP_FIELD_UINT(PULSE_KEY, &req_num_pulses),
+    };
+    int r;
 
-    r = coap_packet_append_payload(&response, payload, r);
-    if (r < 0) {
-        goto end;
-    }
+    *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
-    r = coap_server_send_coap_reply(sock, &response, addr, addr_len);
+    // Handle pulse
+    r = cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present);
+    if (r) return r;
+    if (!present) return -EINVAL;
 
-end:
-    k_free(data);
+    led_set_pulses(req_num_pulses);
+    *rsp_code = COAP_RESPONSE_CODE_CHANGED;
 
-    return r;
+    return 0;
 }
 
-#define PULSE_KEY "p"
-
 static int pulse_post(struct coap_resource *resource,
         struct coap_packet *request,
         struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
-    uint16_t id;
-    uint8_t code;
-    uint8_t type;
-    uint8_t tkl;
-    uint8_t token[COAP_TOKEN_MAX_LEN];
-    int r = 0;
-    struct coap_option option;
-    const uint8_t *payload;
-    uint16_t payload_len;
-    enum coap_response_code rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
-    code = coap_header_get_code(request);
-    type = coap_header_get_type(request);
-    id = coap_header_get_id(request);
-    tkl = coap_header_get_token(request, token);
-
-    if (type != COAP_TYPE_CON) {
-        return -EINVAL;
-    }
-
-#if BLOCK_GLOBAL_ACCESS
-    if (!addr_is_local(addr, addr_len) && !sock_is_secure(sock)) {
-        // TODO: Send ACK Forbidden?
-        return -EINVAL;
-    }
-#endif
-
-    r = coap_find_options(request, COAP_OPTION_CONTENT_FORMAT, &option, 1); 
-    if (r != 1) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
-
-    if (coap_option_value_to_int(&option) != COAP_CONTENT_FORMAT_APP_CBOR) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_UNSUPPORTED_CONTENT_FORMAT, token, tkl);
-        return -EINVAL;
-    }
-
-    payload = coap_packet_get_payload(request, &payload_len);
-    if (!payload) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
-
-    CborError cbor_error;
-    CborParser parser;
-    CborValue value;
-    struct cbor_buf_reader reader;
-
-    cbor_buf_reader_init(&reader, payload, payload_len);
-
-    cbor_error = cbor_parser_init(&reader.r, 0, &parser, &value);
-    if (cbor_error != CborNoError) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
-
-    if (!cbor_value_is_map(&value)) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
-
-    CborValue map_val;
-
-    // Handle pulse
-    cbor_error = cbor_value_map_find_value(&value, PULSE_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        uint64_t req_num_pulses;
-
-        cbor_error = cbor_value_get_uint64(&map_val, &req_num_pulses);
-        if ((cbor_error == CborNoError) && (req_num_pulses <= ULONG_MAX)) {
-            led_set_pulses(req_num_pulses);
-            rsp_code = COAP_RESPONSE_CODE_CHANGED;
-        }
-    }
-
-    r = coap_server_send_ack(sock, addr, addr_len, id, rsp_code, token, tkl);
-    return r;
+    return coap_server_handle_simple_setter(sock, resource, request, addr, addr_len,
+		    handle_pulse_post, NULL);
 }
 
 #include "analog_switch.h"
@@ -489,6 +259,9 @@ static int pulse_post(struct coap_resource *resource,
 #define ITER_KEY "i"
 #define THRES_KEY "t"
 #define DEBOUNCE_KEY "deb"
+#define DEBOUNCE_LED_KEY "dl"
+#define ITER_LED_KEY "il"
+#define TRIGGER_KEY "trg"
 
 static const struct device *map_id_to_dev(uint8_t id)
 {
@@ -506,31 +279,62 @@ static const struct device *map_id_to_dev(uint8_t id)
 	}
 }
 
-typedef int (*dev_callback)(const struct device *dev, CborValue *value);
+enum {
+    ADC_DEV,
+    ADC_ITER,
+    ADC_THRES,
+    ADC_DEBOUNCE,
+    ADC_DEBOUNCE_LED,
+    ADC_ITER_LED,
+    ADC_TRIGGER,
+};
+
+struct adc_req {
+    int dev_id;
+    int iters;
+    int threshold;
+    int debounce;
+    int debounce_led;
+    int iter_led;
+    int trigger;
+    uint32_t present;
+};
+
+static int decode_adc_req(zcbor_state_t *cd, struct adc_req *req)
+{
+    const struct cbor_map_field fields[] = {
+        [ADC_DEV]          = CBOR_MAP_FIELD_INT(DEV_KEY, &req->dev_id),
+        [ADC_ITER]         = CBOR_MAP_FIELD_INT(ITER_KEY, &req->iters),
+        [ADC_THRES]        = CBOR_MAP_FIELD_INT(THRES_KEY, &req->threshold),
+        [ADC_DEBOUNCE]     = CBOR_MAP_FIELD_INT(DEBOUNCE_KEY, &req->debounce),
+        [ADC_DEBOUNCE_LED] = CBOR_MAP_FIELD_INT(DEBOUNCE_LED_KEY, &req->debounce_led),
+        [ADC_ITER_LED]     = CBOR_MAP_FIELD_INT(ITER_LED_KEY, &req->iter_led),
+        [ADC_TRIGGER]      = CBOR_MAP_FIELD_INT(TRIGGER_KEY, &req->trigger),
+    };
+
+    return cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &req->present);
+}
 
-static int call_function_for_devs(CborValue *value, dev_callback callback)
+typedef int (*dev_callback)(const struct device *dev, const struct adc_req *req);
+
+static int call_function_for_devs(const struct adc_req *req, dev_callback callback)
 {
-    CborError cbor_error;
-    CborValue map_val;
     const struct device *dev;
     int r = -EINVAL;
 
     // Handle device
-    cbor_error = cbor_value_map_find_value(value, "d", &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        uint64_t dev_id;
-        cbor_error = cbor_value_get_uint64(&map_val, &dev_id);
-        if ((cbor_error == CborNoError) && (dev_id <= UINT8_MAX)) {
-            dev = map_id_to_dev(dev_id);
+    if (CBOR_MAP_PRESENT(req->present, ADC_DEV)) {
+        if ((req->dev_id >= 0) && (req->dev_id <= UINT8_MAX)) {
+            dev = map_id_to_dev(req->dev_id);
             if (dev != NULL) {
-                r = callback(dev, value);
+                r = callback(dev, req);
             }
 	}
     } else {
         for (int i = 0; i < 2; ++i) {
             dev = map_id_to_dev(i);
             if (dev != NULL) {
-                r = callback(dev, value);
+                r = callback(dev, req);
 		if (r) return r;
 	    } else {
                 return -EINVAL;
@@ -541,20 +345,13 @@ static int call_function_for_devs(CborValue *value, dev_callback callback)
     return r;
 }
 
-
 static int prepare_adc_payload(uint8_t *payload, size_t len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
-
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
+    ZCBOR_STATE_E(ce, 2, payload, len, 1);
 
-    if (cbor_encoder_create_map(&ce, &map, 2) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 2)) return -EINVAL;
 
     for (int i = 0; i < 2; i++) {
-	    CborEncoder submap;
 	    const struct device *dev = map_id_to_dev(i);
 	    if (dev == NULL) return 0;
 
@@ -563,21 +360,21 @@ static int prepare_adc_payload(uint8_t *payload, size_t len)
 	    const struct analog_switch_driver_api *api = dev->api;
 	    r = api->get(dev, &val);
 
-	    if (cbor_encode_int(&map, i) != CborNoError) return -EINVAL;
-	    if (cbor_encoder_create_map(&map, &submap, 2) != CborNoError) return -EINVAL;
+	    if (!zcbor_int32_put(ce, i)) return -EINVAL;
+	    if (!zcbor_map_start_encode(ce, 2)) return -EINVAL;
 
-	    if (cbor_encode_text_string(&submap, RET_KEY, strlen(RET_KEY)) != CborNoError) return -EINVAL;
-	    if (cbor_encode_int(&submap, r) != CborNoError) return -EINVAL;
+	    if (!zcbor_tstr_put_lit(ce, RET_KEY)) return -EINVAL;
+	    if (!zcbor_int32_put(ce, r)) return -EINVAL;
 
-	    if (cbor_encode_text_string(&submap, ADC_KEY, strlen(ADC_KEY)) != CborNoError) return -EINVAL;
-	    if (cbor_encode_int(&submap, val) != CborNoError) return -EINVAL;
+	    if (!zcbor_tstr_put_lit(ce, ADC_KEY)) return -EINVAL;
+	    if (!zcbor_uint32_put(ce, val)) return -EINVAL;
 
-	    if (cbor_encoder_close_container(&ce, &submap) != CborNoError) return -EINVAL;
+	    if (!zcbor_map_end_encode(ce, 2)) return -EINVAL;
     }
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 2)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int adc_get(struct coap_resource *resource,
@@ -585,86 +382,27 @@ static int adc_get(struct coap_resource *resource,
         struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
-    uint16_t id;
-    uint8_t code;
-    uint8_t type;
-    uint8_t tkl;
-    uint8_t token[COAP_TOKEN_MAX_LEN];
-    uint8_t *data;
     int r = 0;
-    struct coap_packet response;
     uint8_t payload[MAX_COAP_PAYLOAD_LEN];
+    size_t payload_len;
 
-    code = coap_header_get_code(request);
-    type = coap_header_get_type(request);
-    id = coap_header_get_id(request);
-    tkl = coap_header_get_token(request, token);
-
-    if (type != COAP_TYPE_CON) {
-        return -EINVAL;
-    }
-
-#if BLOCK_GLOBAL_ACCESS
-    if (!addr_is_local(addr, addr_len) && !sock_is_secure(sock)) {
-        // TODO: Send ACK Forbidden?
-        return -EINVAL;
-    }
-#endif
-
-    data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
-    if (!data) {
-        return -ENOMEM;
-    }
-
-    r = coap_packet_init(&response, data, MAX_COAP_MSG_LEN,
-                 1, COAP_TYPE_ACK, tkl, token,
-                 COAP_RESPONSE_CODE_CONTENT, id);
-    if (r < 0) {
-        goto end;
-    }
-
-    r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_APP_CBOR);
-    if (r < 0) {
-        goto end;
-    }
-
-    r = coap_packet_append_payload_marker(&response);
+    r = prepare_adc_payload(payload, sizeof(payload));
     if (r < 0) {
-        goto end;
-    }
-
-    r = prepare_adc_payload(payload, MAX_COAP_PAYLOAD_LEN);
-    if (r < 0) {
-        goto end;
-    }
-
-    r = coap_packet_append_payload(&response, payload, r);
-    if (r < 0) {
-        goto end;
+        return r;
     }
+    payload_len = r;
 
-    r = coap_server_send_coap_reply(sock, &response, addr, addr_len);
-
-end:
-    k_free(data);
-
-    return r;
+    return coap_server_handle_simple_getter(sock, resource, request, addr, addr_len,
+                    payload, payload_len);
 }
 
 static int prepare_adc_avg_payload(uint8_t *payload, size_t len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    ZCBOR_STATE_E(ce, 2, payload, len, 1);
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
-
-    if (cbor_encoder_create_map(&ce, &map, 2) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 2)) return -EINVAL;
 
     for (int i = 0; i < 2; i++) {
-	    CborEncoder submap;
 	    const struct device *dev = map_id_to_dev(i);
 	    if (dev == NULL) return 0;
 
@@ -674,21 +412,21 @@ static int prepare_adc_avg_payload(uint8_t *payload, size_t len)
 	    api->get_avg(dev, &val);
 	    api->get_events(dev, &ev);
 
-	    if (cbor_encode_int(&map, i) != CborNoError) return -EINVAL;
-	    if (cbor_encoder_create_map(&map, &submap, 2) != CborNoError) return -EINVAL;
+	    if (!zcbor_int32_put(ce, i)) return -EINVAL;
+	    if (!zcbor_map_start_encode(ce, 2)) return -EINVAL;
 
-	    if (cbor_encode_text_string(&submap, ADC_KEY, strlen(ADC_KEY)) != CborNoError) return -EINVAL;
-	    if (cbor_encode_int(&submap, val) != CborNoError) return -EINVAL;
+	    if (!zcbor_tstr_put_lit(ce, ADC_KEY)) return -EINVAL;
+	    if (!zcbor_uint32_put(ce, val)) return -EINVAL;
 
-	    if (cbor_encode_text_string(&submap, EV_KEY, strlen(EV_KEY)) != CborNoError) return -EINVAL;
-	    if (cbor_encode_int(&submap, ev) != CborNoError) return -EINVAL;
+	    if (!zcbor_tstr_put_lit(ce, EV_KEY)) return -EINVAL;
+	    if (!zcbor_uint32_put(ce, ev)) return -EINVAL;
 
-	    if (cbor_encoder_close_container(&ce, &submap) != CborNoError) return -EINVAL;
+	    if (!zcbor_map_end_encode(ce, 2)) return -EINVAL;
     }
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 2)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 static int adc_avg_get(struct coap_resource *resource,
@@ -696,212 +434,210 @@ static int adc_avg_get(struct coap_resource *resource,
         struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
-    uint16_t id;
-    uint8_t code;
-    uint8_t type;
-    uint8_t tkl;
-    uint8_t token[COAP_TOKEN_MAX_LEN];
-    uint8_t *data;
     int r = 0;
-    struct coap_packet response;
     uint8_t payload[MAX_COAP_PAYLOAD_LEN];
+    size_t payload_len;
 
-    code = coap_header_get_code(request);
-    type = coap_header_get_type(request);
-    id = coap_header_get_id(request);
-    tkl = coap_header_get_token(request, token);
-
-    if (type != COAP_TYPE_CON) {
-        return -EINVAL;
-    }
-
-#if BLOCK_GLOBAL_ACCESS
-    if (!addr_is_local(addr, addr_len) && !sock_is_secure(sock)) {
-        // TODO: Send ACK Forbidden?
-        return -EINVAL;
-    }
-#endif
-
-    data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
-    if (!data) {
-        return -ENOMEM;
-    }
-
-    r = coap_packet_init(&response, data, MAX_COAP_MSG_LEN,
-                 1, COAP_TYPE_ACK, tkl, token,
-                 COAP_RESPONSE_CODE_CONTENT, id);
+    r = prepare_adc_avg_payload(payload, sizeof(payload));
     if (r < 0) {
-        goto end;
+        return r;
     }
+    payload_len = r;
 
-    r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_APP_CBOR);
-    if (r < 0) {
-        goto end;
-    }
+    return coap_server_handle_simple_getter(sock, resource, request, addr, addr_len,
+                    payload, payload_len);
+}
 
-    r = coap_packet_append_payload_marker(&response);
-    if (r < 0) {
-        goto end;
-    }
+static int enable_for_dev(const struct device *dev, const struct adc_req *req)
+{
+    const struct analog_switch_driver_api *api = dev->api;
+    api->enable(dev);
+    return 0;
+}
 
-    r = prepare_adc_avg_payload(payload, MAX_COAP_PAYLOAD_LEN);
-    if (r < 0) {
-        goto end;
-    }
+static int handle_adc_enable_post(zcbor_state_t *cd,
+	       	enum coap_response_code *rsp_code, void *context)
+{
+    (void)context;
+    struct adc_req req;
+    int r;
 
-    r = coap_packet_append_payload(&response, payload, r);
-    if (r < 0) {
-        goto end;
-    }
+    r = decode_adc_req(cd, &req);
+    if (!r) r = call_function_for_devs(&req, enable_for_dev);
+    *rsp_code = r ? COAP_RESPONSE_CODE_BAD_REQUEST : COAP_RESPONSE_CODE_CHANGED;
 
-    r = coap_server_send_coap_reply(sock, &response, addr, addr_len);
+    return r;
+}
 
-end:
-    k_free(data);
+static int adc_enable_post(struct coap_resource *resource,
+        struct coap_packet *request,
+        struct sockaddr *addr, socklen_t addr_len)
+{
+    int sock = *(int*)resource->user_data;
 
-    return r;
+    return coap_server_handle_simple_setter(sock, resource, request, addr, addr_len,
+		    handle_adc_enable_post, NULL);
 }
 
-static int enable_for_dev(const struct device *dev, CborValue *map_val)
+static int prepare_adc_config_payload(uint8_t *payload, size_t len)
 {
-    const struct analog_switch_driver_api *api = dev->api;
-    api->enable(dev);
-    return 0;
+    ZCBOR_STATE_E(ce, 2, payload, len, 1);
+
+    if (!zcbor_map_start_encode(ce, 2)) return -EINVAL;
+
+    for (int i = 0; i < 2; i++) {
+	    const struct device *dev = map_id_to_dev(i);
+	    if (dev == NULL) return 0;
+
+	    int iters = 0;
+	    int threshold = 0;
+	    int debounce = 0;
+	    const struct analog_switch_driver_api *api = dev->api;
+	    api->get_config(dev, &iters, &threshold, &debounce);
+
+	    if (!zcbor_int32_put(ce, i)) return -EINVAL;
+	    if (!zcbor_map_start_encode(ce, 3)) return -EINVAL;
+
+	    if (!zcbor_tstr_put_lit(ce, ITER_KEY)) return -EINVAL;
+	    if (!zcbor_int32_put(ce, iters)) return -EINVAL;
+
+	    if (!zcbor_tstr_put_lit(ce, THRES_KEY)) return -EINVAL;
+	    if (!zcbor_int32_put(ce, threshold)) return -EINVAL;
+
+	    if (!zcbor_tstr_put_lit(ce, DEBOUNCE_KEY)) return -EINVAL;
+	    if (!zcbor_int32_put(ce, debounce)) return -EINVAL;
+
+	    if (!zcbor_map_end_encode(ce, 3)) return -EINVAL;
+    }
+
+    if (!zcbor_map_end_encode(ce, 2)) return -EINVAL;
+
+    return (size_t)(ce->payload - payload);
 }
 
-static int adc_enable_post(struct coap_resource *resource,
+static int adc_config_get(struct coap_resource *resource,
         struct coap_packet *request,
         struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
-    uint16_t id;
-    uint8_t code;
-    uint8_t type;
-    uint8_t tkl;
-    uint8_t token[COAP_TOKEN_MAX_LEN];
     int r = 0;
-    struct coap_option option;
-    const uint8_t *payload;
-    uint16_t payload_len;
-    enum coap_response_code rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
-
-    code = coap_header_get_code(request);
-    type = coap_header_get_type(request);
-    id = coap_header_get_id(request);
-    tkl = coap_header_get_token(request, token);
+    uint8_t payload[MAX_COAP_PAYLOAD_LEN];
+    size_t payload_len;
 
-    if (type != COAP_TYPE_CON) {
-        return -EINVAL;
+    r = prepare_adc_config_payload(payload, sizeof(payload));
+    if (r < 0) {
+        return r;
     }
+    payload_len = r;
 
-#if BLOCK_GLOBAL_ACCESS
-    if (!addr_is_local(addr, addr_len) && !sock_is_secure(sock)) {
-        // TODO: Send ACK Forbidden?
-        return -EINVAL;
-    }
-#endif
+    return coap_server_handle_simple_getter(sock, resource, request, addr, addr_len,
+                    payload, payload_len);
+}
 
-    r = coap_find_options(request, COAP_OPTION_CONTENT_FORMAT, &option, 1); 
-    if (r != 1) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
+static int set_config_for_dev(const struct device *dev, const struct adc_req *req)
+{
+    // Handle iters
+    if (!CBOR_MAP_PRESENT(req->present, ADC_ITER) || (req->iters < 0)) {
         return -EINVAL;
     }
 
-    if (coap_option_value_to_int(&option) != COAP_CONTENT_FORMAT_APP_CBOR) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_UNSUPPORTED_CONTENT_FORMAT, token, tkl);
+    // Handle threshold
+    if (!CBOR_MAP_PRESENT(req->present, ADC_THRES) ||
+            (req->threshold < 0) || (req->threshold > UINT8_MAX)) {
         return -EINVAL;
     }
 
-    payload = coap_packet_get_payload(request, &payload_len);
-    if (!payload) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
+    // Handle debouncing counter
+    if (!CBOR_MAP_PRESENT(req->present, ADC_DEBOUNCE) ||
+            (req->debounce < 0) || (req->debounce > UINT8_MAX)) {
         return -EINVAL;
     }
 
-    CborError cbor_error;
-    CborParser parser;
-    CborValue value;
-    struct cbor_buf_reader reader;
+    // Handle debouncing and iter leds, disabled if absent
+    bool debounce_led = CBOR_MAP_PRESENT(req->present, ADC_DEBOUNCE_LED) && req->debounce_led;
+    bool iter_led = CBOR_MAP_PRESENT(req->present, ADC_ITER_LED) && req->iter_led;
 
-    cbor_buf_reader_init(&reader, payload, payload_len);
+    const struct analog_switch_driver_api *api = dev->api;
+    api->set_config(dev, req->iters, req->threshold, req->debounce, debounce_led, iter_led);
 
-    cbor_error = cbor_parser_init(&reader.r, 0, &parser, &value);
-    if (cbor_error != CborNoError) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
+    return 0;
+}
 
-    if (!cbor_value_is_map(&value)) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
+static int handle_adc_config_post(zcbor_state_t *cd,
+	       	enum coap_response_code *rsp_code, void *context)
+{
+    (void)context;
+    struct adc_req req;
+    int r;
 
-    r = call_function_for_devs(&value, enable_for_dev);
-    if (!r) rsp_code = COAP_RESPONSE_CODE_CHANGED;
+    r = decode_adc_req(cd, &req);
+    if (!r) r = call_function_for_devs(&req, set_config_for_dev);
+    *rsp_code = r ? COAP_RESPONSE_CODE_BAD_REQUEST : COAP_RESPONSE_CODE_CHANGED;
 
-    r = coap_server_send_ack(sock, addr, addr_len, id, rsp_code, token, tkl);
     return r;
 }
 
-static int prepare_adc_config_payload(uint8_t *payload, size_t len)
+static int adc_config_post(struct coap_resource *resource,
+        struct coap_packet *request,
+        struct sockaddr *addr, socklen_t addr_len)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
+    int sock = *(int*)resource->user_data;
 
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
+    return coap_server_handle_simple_setter(sock, resource, request, addr, addr_len,
+		    handle_adc_config_post, NULL);
+}
 
-    if (cbor_encoder_create_map(&ce, &map, 2) != CborNoError) return -EINVAL;
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+#define BLOCK_SZX_MAX 2 // 64 B
+#define BLOCK_SIZE(szx) (16U << (szx))
 
-    for (int i = 0; i < 2; i++) {
-	    CborEncoder submap;
-	    const struct device *dev = map_id_to_dev(i);
-	    if (dev == NULL) return 0;
+#define BLOCK2_NUM(opt) ((uint32_t)(opt) >> 4)
+#define BLOCK2_MORE_BIT 0x08
+#define BLOCK2_SZX(opt) ((opt) & 0x07)
+#define BLOCK2_OPT(num, szx) (((num) << 4) | (szx))
 
-	    int iters = 0;
-	    int threshold = 0;
-	    int debounce = 0;
-	    const struct analog_switch_driver_api *api = dev->api;
-	    api->get_config(dev, &iters, &threshold, &debounce);
-
-	    if (cbor_encode_int(&map, i) != CborNoError) return -EINVAL;
-	    if (cbor_encoder_create_map(&map, &submap, 3) != CborNoError) return -EINVAL;
+#define COAP_CONTENT_FORMAT_OCTET_STREAM 42
 
-	    if (cbor_encode_text_string(&submap, ITER_KEY, strlen(ITER_KEY)) != CborNoError) return -EINVAL;
-	    if (cbor_encode_int(&submap, iters) != CborNoError) return -EINVAL;
-
-	    if (cbor_encode_text_string(&submap, THRES_KEY, strlen(THRES_KEY)) != CborNoError) return -EINVAL;
-	    if (cbor_encode_int(&submap, threshold) != CborNoError) return -EINVAL;
+// Device is selected with uri-query d=<id>
+static const struct device *parse_trace_query(struct coap_packet *request)
+{
+    struct coap_option option;
+    int r;
 
-	    if (cbor_encode_text_string(&submap, DEBOUNCE_KEY, strlen(DEBOUNCE_KEY)) != CborNoError) return -EINVAL;
-	    if (cbor_encode_int(&submap, debounce) != CborNoError) return -EINVAL;
+    r = coap_find_options(request, COAP_OPTION_URI_QUERY, &option, 1);
+    if (r != 1) return NULL;
 
-	    if (cbor_encoder_close_container(&ce, &submap) != CborNoError) return -EINVAL;
+    if ((option.len != 3) || (option.value[0] != 'd') || (option.value[1] != '=') ||
+            (option.value[2] < '0') || (option.value[2] > '9')) {
+        return NULL;
     }
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
-
-    return (size_t)(writer.ptr - payload);
+    return map_id_to_dev(option.value[2] - '0');
 }
 
-static int adc_config_get(struct coap_resource *resource,
+static int adc_trace_get(struct coap_resource *resource,
         struct coap_packet *request,
         struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
+    struct coap_packet response;
+    uint8_t payload[BLOCK_SIZE(BLOCK_SZX_MAX)];
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    const struct device *dev;
+    const struct analog_switch_driver_api *api;
+    uint8_t *data;
     uint16_t id;
-    uint8_t code;
     uint8_t type;
     uint8_t tkl;
-    uint8_t token[COAP_TOKEN_MAX_LEN];
-    uint8_t *data;
-    int r = 0;
-    struct coap_packet response;
-    uint8_t payload[MAX_COAP_PAYLOAD_LEN];
+    uint32_t num = 0;
+    uint8_t szx = BLOCK_SZX_MAX;
+    size_t offset;
+    size_t size = 0;
+    bool more;
+    int block2;
+    int len;
+    int r;
 
-    code = coap_header_get_code(request);
     type = coap_header_get_type(request);
     id = coap_header_get_id(request);
     tkl = coap_header_get_token(request, token);
@@ -910,12 +646,33 @@ static int adc_config_get(struct coap_resource *resource,
         return -EINVAL;
     }
 
-#if BLOCK_GLOBAL_ACCESS
-    if (!addr_is_local(addr, addr_len) && !sock_is_secure(sock)) {
-        // TODO: Send ACK Forbidden?
+    dev = parse_trace_query(request);
+    if (dev == NULL) {
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
         return -EINVAL;
     }
-#endif
+
+    block2 = coap_get_option_int(request, COAP_OPTION_BLOCK2);
+    if (block2 >= 0) {
+        num = BLOCK2_NUM(block2);
+        // Larger blocks would be fragmented
+        szx = MIN(BLOCK2_SZX(block2), BLOCK_SZX_MAX);
+    }
+
+    offset = num * BLOCK_SIZE(szx);
+
+    api = dev->api;
+    len = api->trace_get(dev, offset, payload, BLOCK_SIZE(szx), &size);
+    if (len == -EBUSY) {
+        // Trace not captured yet
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_NOT_FOUND, token, tkl);
+        return len;
+    } else if ((len < 0) || (offset >= size)) {
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_OPTION, token, tkl);
+        return -EINVAL;
+    }
+
+    more = (offset + len) < size;
 
     data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
     if (!data) {
@@ -930,22 +687,28 @@ static int adc_config_get(struct coap_resource *resource,
     }
 
     r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_APP_CBOR);
+            COAP_CONTENT_FORMAT_OCTET_STREAM);
     if (r < 0) {
         goto end;
     }
 
-    r = coap_packet_append_payload_marker(&response);
+    r = coap_append_option_int(&response, COAP_OPTION_BLOCK2,
+            BLOCK2_OPT(num, szx) | (more ? BLOCK2_MORE_BIT : 0));
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_append_option_int(&response, COAP_OPTION_SIZE2, size);
     if (r < 0) {
         goto end;
     }
 
-    r = prepare_adc_config_payload(payload, MAX_COAP_PAYLOAD_LEN);
+    r = coap_packet_append_payload_marker(&response);
     if (r < 0) {
         goto end;
     }
 
-    r = coap_packet_append_payload(&response, payload, r);
+    r = coap_packet_append_payload(&response, payload, len);
     if (r < 0) {
         goto end;
     }
@@ -958,162 +721,94 @@ end:
     return r;
 }
 
-static int set_config_for_dev(const struct device *dev, CborValue *value)
+// Trigger with "trg" set captures a press which was not detected, otherwise the trace is rearmed
+static int trace_for_dev(const struct device *dev, const struct adc_req *req)
 {
-    bool updated = true;
-    uint64_t req_det_iters;
-    uint64_t req_det_thres;
-    uint64_t req_deb_cnt;
-    uint64_t req_iter_led;
-    uint64_t req_deb_led;
-    bool iter_led = false;
-    bool debounce_led = false;
-    CborValue map_val;
-    CborError cbor_error;
-
-    // Handle iters
-    cbor_error = cbor_value_map_find_value(value, ITER_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        cbor_error = cbor_value_get_uint64(&map_val, &req_det_iters);
-        if ((cbor_error == CborNoError) && (req_det_iters <= INT_MAX)) {
-		// Ready to be updated
-        } else {
-		return -EINVAL;
-	}
-    } else {
-	    return -EINVAL;
-    }
-
-    // Handle threshold
-    cbor_error = cbor_value_map_find_value(value, THRES_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        cbor_error = cbor_value_get_uint64(&map_val, &req_det_thres);
-        if ((cbor_error == CborNoError) && (req_det_thres <= UINT8_MAX)) {
-		// Ready to be updated
-        } else {
-		return -EINVAL;
-	}
-    } else {
-	    return -EINVAL;
-    }
+    const struct analog_switch_driver_api *api = dev->api;
 
-    // Handle debouncing counter
-    cbor_error = cbor_value_map_find_value(value, DEBOUNCE_KEY, &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        cbor_error = cbor_value_get_uint64(&map_val, &req_deb_cnt);
-        if ((cbor_error == CborNoError) && (req_det_thres <= UINT8_MAX)) {
-		// Ready to be updated
-        } else {
-		return -EINVAL;
-	}
-    } else {
-	    return -EINVAL;
+    if (CBOR_MAP_PRESENT(req->present, ADC_TRIGGER) && req->trigger) {
+        return api->trace_trigger(dev);
     }
 
-    // Handle debouncing led
-    cbor_error = cbor_value_map_find_value(value, "dl", &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        cbor_error = cbor_value_get_uint64(&map_val, &req_deb_led);
-        if ((cbor_error == CborNoError) && req_deb_led) {
-		debounce_led = true;
-        }
-    }
-    // Handle iter led
-    cbor_error = cbor_value_map_find_value(value, "il", &map_val);
-    if ((cbor_error == CborNoError) && cbor_value_is_unsigned_integer(&map_val)) {
-        cbor_error = cbor_value_get_uint64(&map_val, &req_iter_led);
-        if ((cbor_error == CborNoError) && req_iter_led) {
-		iter_led = true;
-        }
-    }
+    return api->trace_rearm(dev);
+}
 
-    if (updated) {
-        const struct analog_switch_driver_api *api = dev->api;
-        api->set_config(dev, req_det_iters, req_det_thres, req_deb_cnt, debounce_led, iter_led);
+static int handle_adc_trace_post(zcbor_state_t *cd,
+	       	enum coap_response_code *rsp_code, void *context)
+{
+    (void)context;
+    struct adc_req req;
+    int r;
 
-	return 0;
-    }
+    r = decode_adc_req(cd, &req);
+    if (!r) r = call_function_for_devs(&req, trace_for_dev);
+    *rsp_code = r ? COAP_RESPONSE_CODE_BAD_REQUEST : COAP_RESPONSE_CODE_CHANGED;
 
-    return -EINVAL;
+    return r;
 }
 
-static int adc_config_post(struct coap_resource *resource,
+static int adc_trace_post(struct coap_resource *resource,
         struct coap_packet *request,
         struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
-    uint16_t id;
-    uint8_t code;
-    uint8_t type;
-    uint8_t tkl;
-    uint8_t token[COAP_TOKEN_MAX_LEN];
-    int r = 0;
-    struct coap_option option;
-    const uint8_t *payload;
-    uint16_t payload_len;
-    enum coap_response_code rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
-    code = coap_header_get_code(request);
-    type = coap_header_get_type(request);
-    id = coap_header_get_id(request);
-    tkl = coap_header_get_token(request, token);
+    return coap_server_handle_simple_setter(sock, resource, request, addr, addr_len,
+		    handle_adc_trace_post, NULL);
+}
+#endif
 
-    if (type != COAP_TYPE_CON) {
-        return -EINVAL;
-    }
+#ifdef CONFIG_ANALOG_SWITCH_RUNTIME_STATS
+#define LOAD_SAMPLING_KEY "s"
+#define LOAD_TOTAL_KEY "t"
 
-#if BLOCK_GLOBAL_ACCESS
-    if (!addr_is_local(addr, addr_len) && !sock_is_secure(sock)) {
-        // TODO: Send ACK Forbidden?
-        return -EINVAL;
-    }
-#endif
+static int prepare_adc_load_payload(uint8_t *payload, size_t len)
+{
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
+    uint64_t sampling;
+    uint64_t total;
+    int r;
 
-    r = coap_find_options(request, COAP_OPTION_CONTENT_FORMAT, &option, 1); 
-    if (r != 1) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
+    r = analog_switch_runtime_get(&sampling, &total);
+    if (r) return r;
 
-    if (coap_option_value_to_int(&option) != COAP_CONTENT_FORMAT_APP_CBOR) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_UNSUPPORTED_CONTENT_FORMAT, token, tkl);
-        return -EINVAL;
-    }
+    if (!zcbor_map_start_encode(ce, 2)) return -EINVAL;
 
-    payload = coap_packet_get_payload(request, &payload_len);
-    if (!payload) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
+    if (!zcbor_tstr_put_lit(ce, LOAD_SAMPLING_KEY)) return -EINVAL;
+    if (!zcbor_uint64_put(ce, sampling)) return -EINVAL;
 
-    CborError cbor_error;
-    CborParser parser;
-    CborValue value;
-    struct cbor_buf_reader reader;
+    if (!zcbor_tstr_put_lit(ce, LOAD_TOTAL_KEY)) return -EINVAL;
+    if (!zcbor_uint64_put(ce, total)) return -EINVAL;
 
-    cbor_buf_reader_init(&reader, payload, payload_len);
+    if (!zcbor_map_end_encode(ce, 2)) return -EINVAL;
 
-    cbor_error = cbor_parser_init(&reader.r, 0, &parser, &value);
-    if (cbor_error != CborNoError) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
+    return (size_t)(ce->payload - payload);
+}
 
-    if (!cbor_value_is_map(&value)) {
-        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
-        return -EINVAL;
-    }
+static int adc_load_get(struct coap_resource *resource,
+        struct coap_packet *request,
+        struct sockaddr *addr, socklen_t addr_len)
+{
+    int sock = *(int*)resource->user_data;
+    int r = 0;
+    uint8_t payload[MAX_COAP_PAYLOAD_LEN];
+    size_t payload_len;
 
-    r = call_function_for_devs(&value, set_config_for_dev);
-    if (!r) rsp_code = COAP_RESPONSE_CODE_CHANGED;
+    r = prepare_adc_load_payload(payload, sizeof(payload));
+    if (r < 0) {
+        return r;
+    }
+    payload_len = r;
 
-    r = coap_server_send_ack(sock, addr, addr_len, id, rsp_code, token, tkl);
-    return r;
+    return coap_server_handle_simple_getter(sock, resource, request, addr, addr_len,
+                    payload, payload_len);
 }
+#endif
 
 static struct coap_resource * rsrcs_get(int sock)
 {
     static const char * const fota_path [] = {"fota_req", NULL};
+    static const char * const fota_mc_path [] = {"fota_mc", NULL};
     static const char * const sd_path [] = {"sd", NULL};
     static const char * const prov_path[] = {"prov", NULL};
     static const char * const pulse_path[] = {"pulse", NULL};
@@ -1121,6 +816,12 @@ static struct coap_resource * rsrcs_get(int sock)
     static const char * const adc_avg_path[] = {"adc", "avg", NULL};
     static const char * const adc_enable_path[] = {"adc", "enable", NULL};
     static const char * const adc_config_path[] = {"adc", "config", NULL};
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+    static const char * const adc_trace_path[] = {"adc", "trace", NULL};
+#endif
+#ifdef CONFIG_ANALOG_SWITCH_RUNTIME_STATS
+    static const char * const adc_load_path[] = {"adc", "load", NULL};
+#endif
     static const char * const reboot_path[] = {"reboot", NULL};
 
     static struct coap_resource resources[] = {
@@ -1128,6 +829,9 @@ static struct coap_resource * rsrcs_get(int sock)
           .post = coap_fota_post,
           .path = fota_path,
         },
+        { .post = coap_fota_mc_post,
+          .path = fota_mc_path,
+        },
         { .get = coap_sd_server,
           .path = sd_path,
         },
@@ -1151,6 +855,17 @@ static struct coap_resource * rsrcs_get(int sock)
 	  .post = adc_config_post,
 	  .path = adc_config_path,
 	},
+#ifdef CONFIG_ANALOG_SWITCH_TRACE
+	{ .get = adc_trace_get,
+	  .post = adc_trace_post,
+	  .path = adc_trace_path,
+	},
+#endif
+#ifdef CONFIG_ANALOG_SWITCH_RUNTIME_STATS
+	{ .get = adc_load_get,
+	  .path = adc_load_path,
+	},
+#endif
 	{ .post = coap_reboot_post,
 	  .path = reboot_path,
 	},
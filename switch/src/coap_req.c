@@ -6,11 +6,12 @@
 
 #include "coap_req.h"
 
-#include <net/coap.h>
-
-#include <tinycbor/cbor.h>
-#include <tinycbor/cbor_buf_reader.h>
-#include <tinycbor/cbor_buf_writer.h>
+#include <cbor_utils.h>
+#include <coap_server.h>
+#include <zcbor_encode.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
 
 #define COAP_PORT 5683
 #define MAX_COAP_MSG_LEN 256
@@ -20,26 +21,22 @@
 #define COAP_NO_RESPONSE_SUPPRESS_ALL 0x1a
 
 #define PRESET_KEY "p"
+#define PRESET_KEY_ID 6
 
 static bool expect_rsp(void);
 
 static int prepare_req_payload(uint8_t *payload, size_t len, int val)
 {
-    struct cbor_buf_writer writer;
-    CborEncoder ce;
-    CborEncoder map;
-
-    cbor_buf_writer_init(&writer, payload, len);
-    cbor_encoder_init(&ce, &writer.enc, 0);
+    ZCBOR_STATE_E(ce, 1, payload, len, 1);
 
-    if (cbor_encoder_create_map(&ce, &map, 1) != CborNoError) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, 1)) return -EINVAL;
 
-    if (cbor_encode_text_string(&map, PRESET_KEY, strlen(PRESET_KEY)) != CborNoError) return -EINVAL;
-    if (cbor_encode_int(&map, val) != CborNoError) return -EINVAL;
+    if (cbor_encode_key(ce, PRESET_KEY, PRESET_KEY_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
+    if (!zcbor_int32_put(ce, val)) return -EINVAL;
 
-    if (cbor_encoder_close_container(&ce, &map) != CborNoError) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, 1)) return -EINVAL;
 
-    return (size_t)(writer.ptr - payload);
+    return (size_t)(ce->payload - payload);
 }
 
 
@@ -80,8 +77,7 @@ static int send_req(int sock, struct sockaddr_in6 *addr, const char *rsrc, int o
         goto end;
     }
 
-    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_APP_CBOR);
+    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT, COAP_CONTENT_FORMAT_REQ);
     if (r < 0) {
         goto end;
     }
@@ -11,11 +11,13 @@
 #include "prov.h"
 #include "switch.h"
 
+#include "coap_fota.h"
+#include "coap_server.h"
+#include "dfu_utils.h"
 #include "ot_sed.h"
 
 #include <dfu/mcuboot.h>
 #include <drivers/gpio.h>
-#include <net/fota_download.h>
 #include <net/openthread.h>
 #include <openthread/thread.h>
 #include <power/reboot.h>
@@ -23,13 +25,8 @@
 
 #define TX_POWER 8
 
-// Fota
-void fota_callback(const struct fota_download_evt *evt)
-{
-    if (evt->id == FOTA_DOWNLOAD_EVT_FINISHED) {
-        sys_reboot(SYS_REBOOT_COLD);
-    }
-}
+#define CHECK_THREAD_TIMEOUT_MS (30UL * 1000UL)
+#define CHECK_COAP_TIMEOUT_MS   (5UL * 1000UL)
 
 // Main
 void main(void)
@@ -38,6 +35,7 @@ void main(void)
 
 	settings_subsys_init();
 	settings_register(prov_get_settings_handler());
+	settings_register(coap_fota_get_settings_handler());
 	settings_load();
 
 	otError error;
@@ -54,11 +52,13 @@ void main(void)
 	assert(error == OT_ERROR_NONE);
 
 	ot_sed_init(ot_instance);
-	fota_download_init(fota_callback);
+	coap_fota_init();
 	coap_init();
 
 	switch_init();
 	led_init();
 
-	boot_write_img_confirmed();
+	dfu_utils_register_check(dfu_utils_check_thread_attached, CHECK_THREAD_TIMEOUT_MS);
+	dfu_utils_register_check(coap_server_is_running, CHECK_COAP_TIMEOUT_MS);
+	dfu_utils_confirm_when_healthy();
 }
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Room heated by the relay of the controlled zone is modelled as a first-order system:
+ *
+ *   dT/dt = (T_out + gain * relay - T) / tau
+ *
+ * The model is integrated every -step seconds of simulated time. Measurements are published
+ * the way src/sensor.c does it: when they differ by at least 0.07 C from the last published one.
+ *
+ * Metrics printed at the end of the run, temperatures in 0.1 C:
+ *  - rise_min:     time to reach the setting for the first time, -1 if never reached
+ *  - overshoot:    highest measurement above the setting after it was reached
+ *  - settling_min: time after which the measurement stays within -band of the setting,
+ *                  -1 if it is outside of the band at the end of the run
+ *  - mae:          mean absolute error in the second half of the run, in 0.01 C
+ *  - switches:     number of relay state changes
+ *  - on_min:       time the relay was on
+ *  - energy_wh:    on time multiplied by the -power of the heater
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/sys/printk.h>
+
+#include <data_dispatcher.h>
+#include "ctlr.h"
+#include "output.h"
+
+#include "cmdline.h"
+#include "posix_board_if.h"
+#include "posix_native_task.h"
+
+#define CTLR_LOC OUTPUT_RELAY_ZONE
+
+#define MEAS_PUBLISH_MC 70
+
+static const struct gpio_dt_spec rly_gpio_spec = GPIO_DT_SPEC_GET(DT_NODELABEL(relay0), gpios);
+
+// Defaults match the controller defaults of the data dispatcher
+static bool     arg_onoff;
+static uint32_t arg_p     = 3584;
+static uint32_t arg_i     = 255;
+static uint32_t arg_hyst  = 5;
+static int32_t  arg_setting = 210;
+static int32_t  arg_t_init  = 150;
+static int32_t  arg_t_out   = 50;
+static uint32_t arg_gain  = 250;
+static uint32_t arg_tau   = 4 * 3600;
+static uint32_t arg_power = 2000;
+static uint32_t arg_band  = 3;
+static uint32_t arg_hours = 48;
+static uint32_t arg_step  = 1;
+
+static void add_options(void)
+{
+    static struct args_struct_t options[] = {
+        { .is_switch = true, .option = "onoff", .type = 'b', .dest = &arg_onoff,
+          .descript = "On-off controller instead of PID" },
+        { .option = "p", .name = "p", .type = 'u', .dest = &arg_p,
+          .descript = "Proportional gain of PID controller" },
+        { .option = "i", .name = "i", .type = 'u', .dest = &arg_i,
+          .descript = "Integral gain of PID controller" },
+        { .option = "hyst", .name = "0.1C", .type = 'u', .dest = &arg_hyst,
+          .descript = "Hysteresis of on-off controller" },
+        { .option = "setting", .name = "0.1C", .type = 'i', .dest = &arg_setting,
+          .descript = "Temperature setting" },
+        { .option = "t_init", .name = "0.1C", .type = 'i', .dest = &arg_t_init,
+          .descript = "Initial room temperature" },
+        { .option = "t_out", .name = "0.1C", .type = 'i', .dest = &arg_t_out,
+          .descript = "Outside temperature" },
+        { .option = "gain", .name = "0.1C", .type = 'u', .dest = &arg_gain,
+          .descript = "Steady state temperature rise with the heater on" },
+        { .option = "tau", .name = "s", .type = 'u', .dest = &arg_tau,
+          .descript = "Time constant of the room" },
+        { .option = "power", .name = "W", .type = 'u', .dest = &arg_power,
+          .descript = "Power of the heater" },
+        { .option = "band", .name = "0.1C", .type = 'u', .dest = &arg_band,
+          .descript = "Settling band around the setting" },
+        { .option = "hours", .name = "h", .type = 'u', .dest = &arg_hours,
+          .descript = "Simulated time" },
+        { .option = "step", .name = "s", .type = 'u', .dest = &arg_step,
+          .descript = "Integration step of the model" },
+        ARG_TABLE_ENDMARKER
+    };
+
+    native_add_command_line_opts(options);
+}
+
+NATIVE_TASK(add_options, PRE_BOOT_1, 10);
+
+static void publish_measurement(int16_t temp)
+{
+    data_dispatcher_publish_t data = {
+        .loc = CTLR_LOC,
+        .type = DATA_TEMP_MEASUREMENT,
+        .temp_measurement = temp,
+    };
+
+    data_dispatcher_publish(&data);
+}
+
+static void publish_settings(void)
+{
+    data_dispatcher_publish_t sett_data = {
+        .loc = CTLR_LOC,
+        .type = DATA_TEMP_SETTING,
+        .temp_setting = arg_setting,
+    };
+    data_dispatcher_publish_t ctlr_data = {
+        .loc = CTLR_LOC,
+        .type = DATA_CONTROLLER,
+    };
+
+    if (arg_onoff) {
+        ctlr_data.controller.mode = DATA_CTLR_ONOFF;
+        ctlr_data.controller.hysteresis = arg_hyst;
+    } else {
+        ctlr_data.controller.mode = DATA_CTLR_PID;
+        ctlr_data.controller.p = arg_p;
+        ctlr_data.controller.i = arg_i;
+    }
+
+    data_dispatcher_publish(&sett_data);
+    data_dispatcher_publish(&ctlr_data);
+}
+
+int main(void)
+{
+    // Room temperature in 0.001 C
+    double temp_mc = arg_t_init * 100.0;
+    int32_t published_mc = temp_mc;
+    uint32_t duration = arg_hours * 3600;
+
+    int32_t rise = -1;
+    int32_t overshoot = 0;
+    int32_t settled = 0;
+    uint64_t err_sum = 0;
+    uint32_t err_num = 0;
+    uint32_t switches = 0;
+    uint32_t on_s = 0;
+    int prev_relay = 0;
+
+    if (!gpio_is_ready_dt(&rly_gpio_spec) || arg_step == 0 || arg_tau == 0) {
+        printk("Invalid simulation setup\n");
+        posix_exit(1);
+    }
+
+    data_dispatcher_init();
+
+    publish_settings();
+    publish_measurement(published_mc / 100);
+
+    ctlr_init();
+    output_init();
+
+    for (uint32_t t = arg_step; t <= duration; t += arg_step) {
+        k_sleep(K_SECONDS(arg_step));
+
+        int relay = gpio_emul_output_get(rly_gpio_spec.port, rly_gpio_spec.pin) > 0;
+        double target_mc = (arg_t_out + (relay ? (int32_t)arg_gain : 0)) * 100.0;
+
+        temp_mc += (target_mc - temp_mc) * arg_step / arg_tau;
+
+        if (abs((int32_t)temp_mc - published_mc) >= MEAS_PUBLISH_MC) {
+            published_mc = temp_mc;
+            publish_measurement(published_mc / 100);
+        }
+
+        if (relay != prev_relay) {
+            switches++;
+            prev_relay = relay;
+        }
+        if (relay) {
+            on_s += arg_step;
+        }
+
+        int32_t meas = published_mc / 100;
+        int32_t err = meas - arg_setting;
+
+        if (rise < 0 && err >= 0) {
+            rise = t;
+        }
+        if (rise >= 0 && err > overshoot) {
+            overshoot = err;
+        }
+        if (abs(err) > (int32_t)arg_band) {
+            settled = -1;
+        } else if (settled < 0) {
+            settled = t;
+        }
+        if (t > duration / 2) {
+            err_sum += abs((int32_t)(published_mc / 10 - arg_setting * 10));
+            err_num++;
+        }
+    }
+
+    printk("bench mode=%s p=%u i=%u hyst=%u rise_min=%d overshoot=%d settling_min=%d "
+           "mae=%u switches=%u on_min=%u energy_wh=%u\n",
+           arg_onoff ? "onoff" : "pid", arg_p, arg_i, arg_hyst,
+           rise < 0 ? -1 : rise / 60, overshoot, settled < 0 ? -1 : settled / 60,
+           err_num ? (uint32_t)(err_sum / err_num) : 0, switches, on_s / 60,
+           (uint32_t)((uint64_t)on_s * arg_power / 3600));
+
+    posix_exit(0);
+
+    return 0;
+}
@@ -8,6 +8,7 @@
 
 #include <errno.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <cbor_utils.h>
 #include <coap_fota.h>
@@ -15,10 +16,12 @@
 #include <coap_sd.h>
 #include <coap_server.h>
 #include <continuous_sd.h>
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
+#include "display.h"
+#include "history.h"
 #include "prov.h"
+#include "sensor.h"
 
-#include <net/fota_download.h>
 #include <zcbor_decode.h>
 #include <zcbor_encode.h>
 #include <zephyr/kernel.h>
@@ -32,9 +35,6 @@
 #define MAX_COAP_MSG_LEN 256
 #define MAX_COAP_PAYLOAD_LEN 128
 
-#define MAX_FOTA_PAYLOAD_LEN 64
-#define MAX_FOTA_PATH_LEN 16
-
 #define COAP_CONTENT_FORMAT_TEXT 0
 #define COAP_CONTENT_FORMAT_CBOR 60
 
@@ -100,6 +100,24 @@ static bool sock_is_secure(int sock)
 #endif
 
 
+// Resources of a zone are <label>, <label>/prj and <label>/p. Handlers find the zone by the path.
+static const char *zone_paths[DATA_LOC_NUM][2];
+static const char *zone_prj_paths[DATA_LOC_NUM][3];
+static const char *zone_prj_short_paths[DATA_LOC_NUM][3];
+
+static int resource_zone(const struct coap_resource *resource)
+{
+    for (int i = 0; i < DATA_LOC_NUM; ++i) {
+        if ((resource->path == zone_paths[i]) ||
+                (resource->path == zone_prj_paths[i]) ||
+                (resource->path == zone_prj_short_paths[i])) {
+            return i;
+        }
+    }
+
+    return -ENOENT;
+}
+
 #define MEAS_KEY   "m"
 #define SETT_KEY   "s"
 #define OUT_KEY    "o"
@@ -109,6 +127,19 @@ static bool sock_is_secure(int sock)
 #define HYST_KEY   "h"
 #define FRC_SW_KEY "f"
 
+// Integer aliases of the keys in the compact profile, see lib/cddl/temp.cddl
+#define MEAS_KEY_ID   1
+#define SETT_KEY_ID   2
+#define OUT_KEY_ID    3
+#define CNT_KEY_ID    4
+#define FRC_SW_KEY_ID 5
+
+// Keys of the controller map
+#define MODE_KEY_ID   1
+#define HYST_KEY_ID   2
+#define P_KEY_ID      3
+#define I_KEY_ID      4
+
 #define TAG_DECIMAL_FRACTION 4
 
 static const char * cnt_val_map[] = {
@@ -116,9 +147,9 @@ static const char * cnt_val_map[] = {
     [DATA_CTLR_PID]   = "pid",
 };
 
-static int prepare_temp_payload(uint8_t *payload, size_t len, data_loc_t loc)
+static int prepare_temp_payload(uint8_t *payload, size_t len, data_loc_t loc, bool compact)
 {
-    const data_dispatcher_publish_t *meas, *sett, *output, *ctlr, *frc_sw;
+    data_dispatcher_publish_t meas, sett, output, ctlr, frc_sw;
     ZCBOR_STATE_E(ce, 3, payload, len, 1);
     data_ctlr_mode_t ctlr_mode;
     const char *cm_str;
@@ -131,54 +162,61 @@ static int prepare_temp_payload(uint8_t *payload, size_t len, data_loc_t loc)
 
     if (!zcbor_map_start_encode(ce, 5)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, MEAS_KEY)) return -EINVAL;
-    if (cbor_encode_dec_frac_num(ce, -1, meas->temp_measurement)) return -EINVAL;
+    if (cbor_encode_key(ce, MEAS_KEY, MEAS_KEY_ID, compact)) return -EINVAL;
+    if (cbor_encode_dec_frac_num(ce, -1, meas.temp_measurement)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, SETT_KEY)) return -EINVAL;
-    if (cbor_encode_dec_frac_num(ce, -1, sett->temp_setting)) return -EINVAL;
+    if (cbor_encode_key(ce, SETT_KEY, SETT_KEY_ID, compact)) return -EINVAL;
+    if (cbor_encode_dec_frac_num(ce, -1, sett.temp_setting)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, OUT_KEY)) return -EINVAL;
-    if (!zcbor_int32_put(ce, output->output)) return -EINVAL;
+    if (cbor_encode_key(ce, OUT_KEY, OUT_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_int32_put(ce, output.output)) return -EINVAL;
 
-    ctlr_mode = ctlr->controller.mode;
+    ctlr_mode = ctlr.controller.mode;
     cm_str = cnt_val_map[ctlr_mode];
     uint32_t num_ctlr_map_items = ctlr_mode == DATA_CTLR_ONOFF ? 2 : 3;
-    if (!zcbor_tstr_put_lit(ce, CNT_KEY)) return -EINVAL;
+    if (cbor_encode_key(ce, CNT_KEY, CNT_KEY_ID, compact)) return -EINVAL;
     if (!zcbor_map_start_encode(ce, num_ctlr_map_items)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, CNT_KEY)) return -EINVAL;
+    if (cbor_encode_key(ce, CNT_KEY, MODE_KEY_ID, compact)) return -EINVAL;
     if (!zcbor_tstr_put_term(ce, cm_str, 6)) return -EINVAL;
 
     if (ctlr_mode == DATA_CTLR_ONOFF) {
-        if (!zcbor_tstr_put_lit(ce, HYST_KEY)) return -EINVAL;
-        if (!zcbor_int32_put(ce, ctlr->controller.hysteresis)) return -EINVAL;
+        if (cbor_encode_key(ce, HYST_KEY, HYST_KEY_ID, compact)) return -EINVAL;
+        if (!zcbor_int32_put(ce, ctlr.controller.hysteresis)) return -EINVAL;
     } else {
-        if (!zcbor_tstr_put_lit(ce, P_KEY)) return -EINVAL;
-        if (!zcbor_int32_put(ce, ctlr->controller.p)) return -EINVAL;
+        if (cbor_encode_key(ce, P_KEY, P_KEY_ID, compact)) return -EINVAL;
+        if (!zcbor_int32_put(ce, ctlr.controller.p)) return -EINVAL;
 
-        if (!zcbor_tstr_put_lit(ce, I_KEY)) return -EINVAL;
-        if (!zcbor_int32_put(ce, ctlr->controller.i)) return -EINVAL;
+        if (cbor_encode_key(ce, I_KEY, I_KEY_ID, compact)) return -EINVAL;
+        if (!zcbor_int32_put(ce, ctlr.controller.i)) return -EINVAL;
     }
 
     if (!zcbor_map_end_encode(ce, num_ctlr_map_items)) return -EINVAL;
 
-    if(!zcbor_tstr_put_lit(ce, FRC_SW_KEY)) return -EINVAL;
-    if (!zcbor_int32_put(ce, frc_sw->forced_switches)) return -EINVAL;
+    if (cbor_encode_key(ce, FRC_SW_KEY, FRC_SW_KEY_ID, compact)) return -EINVAL;
+    if (!zcbor_int32_put(ce, frc_sw.forced_switches)) return -EINVAL;
 
     if (!zcbor_map_end_encode(ce, 5)) return -EINVAL;
 
     return (size_t)(ce->payload - payload);
 }
 
-static int temp_handler(struct coap_resource *resource,
+static int temp_get(struct coap_resource *resource,
              struct coap_packet *request,
-             struct sockaddr *addr, socklen_t addr_len,
-             data_loc_t loc)
+             struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
     uint8_t payload[MAX_COAP_PAYLOAD_LEN];
     uint16_t payload_len;
-    int r = prepare_temp_payload(payload, MAX_COAP_PAYLOAD_LEN, loc);
+    int zone = resource_zone(resource);
+    int r;
+
+    if (zone < 0) {
+        return zone;
+    }
+
+    r = prepare_temp_payload(payload, MAX_COAP_PAYLOAD_LEN, zone,
+                             coap_server_accepts_compact(request));
     if (r < 0) {
         return -r;
     }
@@ -189,21 +227,76 @@ static int temp_handler(struct coap_resource *resource,
 }
 
 
+enum {
+    TEMP_MEAS,
+    TEMP_SETT,
+    TEMP_CNT,
+    TEMP_FRC_SW,
+};
+
+enum {
+    CNT_MODE,
+    CNT_HYST,
+    CNT_P,
+    CNT_I,
+};
+
 static int handle_temp_post(zcbor_state_t *cd, enum coap_response_code *rsp_code, void *context)
 {
-    int r = 0;
+    int r;
+    data_loc_t *loc = context;
+    int meas_val;
+    int temp_val;
+    int32_t requested_num_switches;
+    char str[6];
+    int hyst;
+    int p;
+    int i;
+    uint32_t present;
+
+    const struct cbor_map_field cnt_fields[] = {
+        [CNT_MODE] = CBOR_MAP_FIELD_ID(CNT_KEY, MODE_KEY_ID, CBOR_MAP_FIELD_TSTR, str, sizeof(str)),
+        [CNT_HYST] = CBOR_MAP_FIELD_ID(HYST_KEY, HYST_KEY_ID, CBOR_MAP_FIELD_INT, &hyst, 0),
+        [CNT_P]    = CBOR_MAP_FIELD_ID(P_KEY, P_KEY_ID, CBOR_MAP_FIELD_INT, &p, 0),
+        [CNT_I]    = CBOR_MAP_FIELD_ID(I_KEY, I_KEY_ID, CBOR_MAP_FIELD_INT, &i, 0),
+    };
+    struct cbor_submap cnt = {
+        .fields = cnt_fields,
+        .num_fields = ARRAY_SIZE(cnt_fields),
+    };
+    const struct cbor_map_field fields[] = {
+        [TEMP_MEAS]   = CBOR_MAP_FIELD_ID(MEAS_KEY, MEAS_KEY_ID, CBOR_MAP_FIELD_DEC_FRAC,
+                                          &meas_val, -1),
+        [TEMP_SETT]   = CBOR_MAP_FIELD_ID(SETT_KEY, SETT_KEY_ID, CBOR_MAP_FIELD_DEC_FRAC,
+                                          &temp_val, -1),
+        [TEMP_CNT]    = CBOR_MAP_FIELD_ID(CNT_KEY, CNT_KEY_ID, CBOR_MAP_FIELD_MAP, &cnt, 0),
+        [TEMP_FRC_SW] = CBOR_MAP_FIELD_ID(FRC_SW_KEY, FRC_SW_KEY_ID, CBOR_MAP_FIELD_INT,
+                                          &requested_num_switches, 0),
+    };
 
     *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
-    data_loc_t *loc = context;
 
-    // Handle temperature setting
-    if (zcbor_search_key_tstr_lit(cd, SETT_KEY)) {
-        int temp_val;
-        if (cbor_decode_dec_frac_num(cd, -1, &temp_val)) {
-            *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+    r = cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present);
+    if (r) return r;
+
+    // Handle measurement of a zone without sensor on the board
+    if (CBOR_MAP_PRESENT(present, TEMP_MEAS)) {
+        if (*loc < SENSOR_NUM) {
             return -EINVAL;
         }
 
+        data_dispatcher_publish_t meas = {
+            .loc = *loc,
+            .type = DATA_TEMP_MEASUREMENT,
+            .temp_measurement = meas_val,
+        };
+        data_dispatcher_publish(&meas);
+
+        *rsp_code = COAP_RESPONSE_CODE_CHANGED;
+    }
+
+    // Handle temperature setting
+    if (CBOR_MAP_PRESENT(present, TEMP_SETT)) {
         data_dispatcher_publish_t sett = {
             .loc = *loc,
             .type = DATA_TEMP_SETTING,
@@ -215,27 +308,16 @@ static int handle_temp_post(zcbor_state_t *cd, enum coap_response_code *rsp_code
     }
 
     // Handle controller
-    if (zcbor_search_key_tstr_lit(cd, CNT_KEY)) {
-        if (!zcbor_unordered_map_start_decode(cd)) {
-            *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
-            return -EINVAL;
-        }
-
+    if (CBOR_MAP_PRESENT(present, TEMP_CNT)) {
         bool updated = false;
-        const data_dispatcher_publish_t *ctlr;
         data_dispatcher_publish_t new_ctlr;
-        data_dispatcher_get(DATA_CONTROLLER, *loc, &ctlr);
-        new_ctlr = *ctlr;
-
-        char str[6];
-        int int_val;
+        data_dispatcher_get(DATA_CONTROLLER, *loc, &new_ctlr);
 
         // Handle controller mode
-        r = cbor_extract_from_map_string(cd, CNT_KEY, str, sizeof(str));
-        if (r >= 0) {
-           for (size_t i = 0; i < sizeof(cnt_val_map) / sizeof(cnt_val_map[0]); ++i) {
-               if (strncmp(cnt_val_map[i], str, sizeof(str)) == 0) {
-                   new_ctlr.controller.mode = i;
+        if (CBOR_MAP_PRESENT(cnt.present, CNT_MODE)) {
+           for (size_t m = 0; m < sizeof(cnt_val_map) / sizeof(cnt_val_map[0]); ++m) {
+               if (strncmp(cnt_val_map[m], str, sizeof(str)) == 0) {
+                   new_ctlr.controller.mode = m;
                    updated = true;
                    break;
                }
@@ -243,31 +325,23 @@ static int handle_temp_post(zcbor_state_t *cd, enum coap_response_code *rsp_code
         }
 
         // Handle hysteresis
-        r = cbor_extract_from_map_int(cd, HYST_KEY, &int_val);
-        if (r == 0) {
-            new_ctlr.controller.hysteresis = int_val;
+        if (CBOR_MAP_PRESENT(cnt.present, CNT_HYST)) {
+            new_ctlr.controller.hysteresis = hyst;
             updated = true;
         }
 
         // Handle P
-        r = cbor_extract_from_map_int(cd, P_KEY, &int_val);
-        if (r == 0) {
-            new_ctlr.controller.p = int_val;
+        if (CBOR_MAP_PRESENT(cnt.present, CNT_P)) {
+            new_ctlr.controller.p = p;
             updated = true;
         }
 
         // Handle I
-        r = cbor_extract_from_map_int(cd, I_KEY, &int_val);
-        if (r == 0) {
-            new_ctlr.controller.i = int_val;
+        if (CBOR_MAP_PRESENT(cnt.present, CNT_I)) {
+            new_ctlr.controller.i = i;
             updated = true;
         }
 
-        if (!zcbor_list_map_end_force_decode(cd)) {
-            *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
-            return -EINVAL;
-        }
-
         if (updated) {
             *rsp_code = COAP_RESPONSE_CODE_CHANGED;
             data_dispatcher_publish(&new_ctlr);
@@ -275,10 +349,7 @@ static int handle_temp_post(zcbor_state_t *cd, enum coap_response_code *rsp_code
     }
 
     // Handle forced switching
-    if (zcbor_search_key_tstr_lit(cd, FRC_SW_KEY)) {
-        int32_t requested_num_switches;
-        if (!zcbor_int32_decode(cd, &requested_num_switches)) return -EINVAL;
-
+    if (CBOR_MAP_PRESENT(present, TEMP_FRC_SW)) {
         data_dispatcher_publish_t frc_sw = {
             .loc = *loc,
             .type = DATA_FORCED_SWITCHING,
@@ -289,82 +360,81 @@ static int handle_temp_post(zcbor_state_t *cd, enum coap_response_code *rsp_code
         *rsp_code = COAP_RESPONSE_CODE_CHANGED;
     }
 
-    return r;
+    return 0;
 }
 
 static int temp_post(struct coap_resource *resource,
              struct coap_packet *request,
-             struct sockaddr *addr, socklen_t addr_len,
-             data_loc_t loc)
+             struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
+    int zone = resource_zone(resource);
+    data_loc_t loc = zone;
+
+    if (zone < 0) {
+        return zone;
+    }
 
     return coap_server_handle_simple_setter(sock, resource, request, addr, addr_len, handle_temp_post, &loc);
 }
 
-static int temp_local_get(struct coap_resource *resource,
-             struct coap_packet *request,
-             struct sockaddr *addr, socklen_t addr_len)
-{
-    return temp_handler(resource, request, addr, addr_len, DATA_LOC_LOCAL);
-}
+// Keys are r<zone> for resource labels and o<zone> for remote output labels
+#define RSRC_KEY_PREFIX 'r'
+#define OUT_KEY_PREFIX  'o'
+#define PROV_KEY_LEN    2
 
-static int temp_local_post(struct coap_resource *resource,
-             struct coap_packet *request,
-             struct sockaddr *addr, socklen_t addr_len)
-{
-    return temp_post(resource, request, addr, addr_len, DATA_LOC_LOCAL);
-}
+// Every zone has both labels, resource label of zone i is field 2 * i
+#define PROV_FIELDS_NUM (2 * DATA_LOC_NUM)
+#define PROV_PAYLOAD_LEN (1 + PROV_FIELDS_NUM * (1 + PROV_KEY_LEN + 1 + PROV_LBL_MAX_LEN))
 
-static int temp_remote_get(struct coap_resource *resource,
-             struct coap_packet *request,
-             struct sockaddr *addr, socklen_t addr_len)
-{
-    return temp_handler(resource, request, addr, addr_len, DATA_LOC_REMOTE);
-}
+BUILD_ASSERT(PROV_FIELDS_NUM <= 32, "Presence of provisioning keys is 32 bit");
 
-static int temp_remote_post(struct coap_resource *resource,
-             struct coap_packet *request,
-             struct sockaddr *addr, socklen_t addr_len)
+static char prov_keys[PROV_FIELDS_NUM][PROV_KEY_LEN + 1];
+
+static const char *prov_key(int field)
 {
-    return temp_post(resource, request, addr, addr_len, DATA_LOC_REMOTE);
-}
+    if (!prov_keys[field][0]) {
+        prov_keys[field][0] = (field % 2) ? OUT_KEY_PREFIX : RSRC_KEY_PREFIX;
+        prov_keys[field][1] = '0' + field / 2;
+    }
 
-#define RSRC0_KEY "r0"
-#define RSRC1_KEY "r1"
-#define OUT0_KEY "o0"
+    return prov_keys[field];
+}
 
 static int handle_prov_post(zcbor_state_t *cd, enum coap_response_code *rsp_code, void *context)
 {
     (void)context;
     int r = -EINVAL;
     bool updated = false;
-    char str[PROV_LBL_MAX_LEN];
-
-    // Handle rsrc0
-    r = cbor_extract_from_map_string(cd, RSRC0_KEY, str, sizeof(str));
-    if ((r >= 0) && (r < PROV_LBL_MAX_LEN)) {
-        r = prov_set_rsrc_label(DATA_LOC_LOCAL, str);
-
-        if (r == 0) {
-            updated = true;
-        }
+    char labels[PROV_FIELDS_NUM][PROV_LBL_MAX_LEN];
+    uint32_t present;
+    struct cbor_map_field fields[PROV_FIELDS_NUM];
+
+    for (int i = 0; i < PROV_FIELDS_NUM; ++i) {
+        fields[i] = (struct cbor_map_field) {
+            .key = prov_key(i),
+            .key_len = PROV_KEY_LEN,
+            .type = CBOR_MAP_FIELD_TSTR,
+            .value = labels[i],
+            .arg = PROV_LBL_MAX_LEN,
+        };
     }
 
-    // Handle rsrc1
-    r = cbor_extract_from_map_string(cd, RSRC1_KEY, str, sizeof(str));
-    if ((r >= 0) && (r < PROV_LBL_MAX_LEN)) {
-        r = prov_set_rsrc_label(DATA_LOC_REMOTE, str);
+    *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+
+    r = cbor_decode_map(cd, fields, ARRAY_SIZE(fields), &present);
+    if (r) return r;
 
-        if (r == 0) {
-            updated = true;
+    for (int i = 0; i < PROV_FIELDS_NUM; ++i) {
+        if (!CBOR_MAP_PRESENT(present, i)) {
+            continue;
         }
-    }
 
-    // Handle out0
-    r = cbor_extract_from_map_string(cd, OUT0_KEY, str, sizeof(str));
-    if ((r >= 0) && (r < PROV_LBL_MAX_LEN)) {
-        r = prov_set_loc_output_label(str);
+        if (i % 2) {
+            r = prov_set_output_label(i / 2, labels[i]);
+        } else {
+            r = prov_set_rsrc_label(i / 2, labels[i]);
+        }
 
         if (r == 0) {
             updated = true;
@@ -374,8 +444,6 @@ static int handle_prov_post(zcbor_state_t *cd, enum coap_response_code *rsp_code
     if (updated) {
         *rsp_code = COAP_RESPONSE_CODE_CHANGED;
         prov_store();
-    } else {
-        *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
     }
 
     return r;
@@ -391,26 +459,26 @@ static int prov_post(struct coap_resource *resource,
 		    handle_prov_post, NULL);
 }
 
+// Labels of the first two zones are always reported, labels of other zones only if provisioned
 static int prepare_prov_payload(uint8_t *payload, size_t len)
 {
     ZCBOR_STATE_E(ce, 2, payload, len, 1);
     const char *label;
 
-    if (!zcbor_map_start_encode(ce, 3)) return -EINVAL;
+    if (!zcbor_map_start_encode(ce, PROV_FIELDS_NUM)) return -EINVAL;
 
-    label = prov_get_rsrc_label(DATA_LOC_LOCAL);
-    if (!zcbor_tstr_put_lit(ce, RSRC0_KEY)) return -EINVAL;
-    if (!zcbor_tstr_put_term(ce, label, 8)) return -EINVAL;
+    for (int i = 0; i < PROV_FIELDS_NUM; ++i) {
+        label = (i % 2) ? prov_get_output_label(i / 2) : prov_get_rsrc_label(i / 2);
 
-    label = prov_get_rsrc_label(DATA_LOC_REMOTE);
-    if (!zcbor_tstr_put_lit(ce, RSRC1_KEY)) return -EINVAL;
-    if (!zcbor_tstr_put_term(ce, label, 8)) return -EINVAL;
+        if ((i >= 4) && !strlen(label)) {
+            continue;
+        }
 
-    label = prov_get_loc_output_label();
-    if (!zcbor_tstr_put_lit(ce, OUT0_KEY)) return -EINVAL;
-    if (!zcbor_tstr_put_term(ce, label, 8)) return -EINVAL;
+        if (!zcbor_tstr_put_term(ce, prov_key(i), PROV_KEY_LEN)) return -EINVAL;
+        if (!zcbor_tstr_put_term(ce, label, 8)) return -EINVAL;
+    }
 
-    if (!zcbor_map_end_encode(ce, 3)) return -EINVAL;
+    if (!zcbor_map_end_encode(ce, PROV_FIELDS_NUM)) return -EINVAL;
 
     return (size_t)(ce->payload - payload);
 }
@@ -421,10 +489,10 @@ static int prov_get(struct coap_resource *resource,
 {
     int sock = *(int*)resource->user_data;
     int r = 0;
-    uint8_t payload[MAX_COAP_PAYLOAD_LEN];
+    uint8_t payload[PROV_PAYLOAD_LEN];
     size_t payload_len = 0;
 
-    r = prepare_prov_payload(payload, MAX_COAP_PAYLOAD_LEN);
+    r = prepare_prov_payload(payload, sizeof(payload));
     if (r < 0) {
         return r;
     }
@@ -507,8 +575,161 @@ static int cont_sd_dbg_get(struct coap_resource *resource,
                     addr, addr_len, payload, payload_len);
 }
 
+// Without a query the disp resource reports refresh rates and names of screens. Counters of
+// a screen are reported with query s=<name>.
+#define DISP_QUERY_SCREEN "s="
+
+static int disp_query_screen(struct coap_packet *request)
+{
+    struct coap_option option;
+    size_t prefix_len = strlen(DISP_QUERY_SCREEN);
+    int r;
+
+    r = coap_find_options(request, COAP_OPTION_URI_QUERY, &option, 1);
+    if (r < 0) return r;
+    if (r == 0) return -ENOENT;
+
+    if ((option.len <= prefix_len) ||
+            memcmp(option.value, DISP_QUERY_SCREEN, prefix_len)) {
+        return -EINVAL;
+    }
+
+    for (size_t i = 0; i < display_screens_num(); ++i) {
+        display_screen_stats_t stats;
+        const char *name = display_screen_stats_get(i, &stats);
+
+        if ((strlen(name) == option.len - prefix_len) &&
+                !memcmp(name, &option.value[prefix_len], option.len - prefix_len)) {
+            return i;
+        }
+    }
+
+    return -EINVAL;
+}
+
+static int prepare_disp_payload(uint8_t *payload, size_t len)
+{
+    ZCBOR_STATE_E(ce, 2, payload, len, 1);
+    display_stats_t stats;
+    size_t screens = display_screens_num();
+
+    display_stats_get(&stats);
+
+    if (!zcbor_map_start_encode(ce, 6)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "rpm")) return -EINVAL;
+    if (!zcbor_uint32_put(ce, stats.redraws_per_min)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "spm")) return -EINVAL;
+    if (!zcbor_uint32_put(ce, stats.skipped_per_min)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "bps")) return -EINVAL;
+    if (!zcbor_uint32_put(ce, stats.cmd_bytes_per_s)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "ba")) return -EINVAL;
+    if (!zcbor_uint32_put(ce, stats.build_us_avg)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "bm")) return -EINVAL;
+    if (!zcbor_uint32_put(ce, stats.build_us_max)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "scr")) return -EINVAL;
+    if (!zcbor_list_start_encode(ce, screens)) return -EINVAL;
+
+    for (size_t i = 0; i < screens; ++i) {
+        display_screen_stats_t screen_stats;
+        const char *name = display_screen_stats_get(i, &screen_stats);
+
+        if (!zcbor_tstr_put_term(ce, name, 8)) return -EINVAL;
+    }
+
+    if (!zcbor_list_end_encode(ce, screens)) return -EINVAL;
+
+    if (!zcbor_map_end_encode(ce, 6)) return -EINVAL;
+
+    return (size_t)(ce->payload - payload);
+}
+
+static int prepare_disp_screen_payload(uint8_t *payload, size_t len, size_t screen)
+{
+    ZCBOR_STATE_E(ce, 2, payload, len, 1);
+    display_screen_stats_t stats;
+
+    if (!display_screen_stats_get(screen, &stats)) return -EINVAL;
+
+    if (!zcbor_map_start_encode(ce, 8)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "f")) return -EINVAL;
+    if (!zcbor_uint32_put(ce, stats.frames)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "bt")) return -EINVAL;
+    if (!zcbor_uint64_put(ce, stats.build_us)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "bm")) return -EINVAL;
+    if (!zcbor_uint32_put(ce, stats.build_us_max)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "b")) return -EINVAL;
+    if (!zcbor_uint64_put(ce, stats.cmd_bytes)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "cw")) return -EINVAL;
+    if (!zcbor_uint64_put(ce, stats.copro_wait_us)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "tn")) return -EINVAL;
+    if (!zcbor_uint32_put(ce, stats.touches)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "tt")) return -EINVAL;
+    if (!zcbor_uint64_put(ce, stats.touch_us)) return -EINVAL;
+
+    if (!zcbor_tstr_put_lit(ce, "tm")) return -EINVAL;
+    if (!zcbor_uint32_put(ce, stats.touch_us_max)) return -EINVAL;
+
+    if (!zcbor_map_end_encode(ce, 8)) return -EINVAL;
+
+    return (size_t)(ce->payload - payload);
+}
+
+static int disp_get(struct coap_resource *resource,
+        struct coap_packet *request,
+        struct sockaddr *addr, socklen_t addr_len)
+{
+    int sock = *(int*)resource->user_data;
+    uint8_t payload[MAX_COAP_PAYLOAD_LEN];
+    size_t payload_len = 0;
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    uint8_t tkl;
+    uint16_t id;
+    int screen;
+    int r;
+
+    screen = disp_query_screen(request);
+    if (screen == -ENOENT) {
+        r = prepare_disp_payload(payload, MAX_COAP_PAYLOAD_LEN);
+    } else if (screen >= 0) {
+        r = prepare_disp_screen_payload(payload, MAX_COAP_PAYLOAD_LEN, screen);
+    } else {
+        id = coap_header_get_id(request);
+        tkl = coap_header_get_token(request, token);
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
+        return screen;
+    }
+
+    if (r < 0) {
+        return r;
+    }
+    payload_len = r;
+
+    return coap_server_handle_simple_getter(sock, resource, request,
+                    addr, addr_len, payload, payload_len);
+}
+
 #define VALIDITY_KEY "d"
+#define VALIDITY_KEY_ID 2
 #define PRJ_KEY "p"
+#define PRJ_KEY_ID 1
+
+enum {
+    PRJ_VALIDITY,
+    PRJ_ACTIVE,
+};
 
 static int handle_prj_post(zcbor_state_t *value,
 	       	enum coap_response_code *rsp_code, void *context)
@@ -518,20 +739,25 @@ static int handle_prj_post(zcbor_state_t *value,
     int ret;
     int validity_ms = 2 * 60 * 1000;
     bool prj_active = false;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [PRJ_VALIDITY] = CBOR_MAP_FIELD_ID(VALIDITY_KEY, VALIDITY_KEY_ID, CBOR_MAP_FIELD_INT,
+                                           &validity_ms, 0),
+        [PRJ_ACTIVE]   = CBOR_MAP_FIELD_ID(PRJ_KEY, PRJ_KEY_ID, CBOR_MAP_FIELD_BOOL, &prj_active, 0),
+    };
 
     *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
 
+    ret = cbor_decode_map(value, fields, ARRAY_SIZE(fields), &present);
+    if (ret) return ret;
+
     // Handle validity
-    ret = cbor_extract_from_map_int(value, VALIDITY_KEY, &validity_ms);
     if (validity_ms <= 0) {
-        *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
         return -EINVAL;
     }
 
     // Handle projector being enabled
-    ret = cbor_extract_from_map_bool(value, PRJ_KEY, &prj_active);
-    if (ret) {
-        *rsp_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+    if (!CBOR_MAP_PRESENT(present, PRJ_ACTIVE)) {
         return -EINVAL;
     }
 
@@ -549,45 +775,37 @@ static int handle_prj_post(zcbor_state_t *value,
 
 static int prj_post(struct coap_resource *resource,
         struct coap_packet *request,
-        struct sockaddr *addr, socklen_t addr_len, data_loc_t rsrc_id)
+        struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
+    int zone = resource_zone(resource);
+    data_loc_t rsrc_id = zone;
+
+    if (zone < 0) {
+        return zone;
+    }
 
     return coap_server_handle_non_con_setter(sock, resource, request, addr, addr_len,
 		    handle_prj_post, &rsrc_id);
 }
 
-static int prj_remote_post(struct coap_resource *resource,
-        struct coap_packet *request,
-        struct sockaddr *addr, socklen_t addr_len)
-{
-	return prj_post(resource, request, addr, addr_len, DATA_LOC_REMOTE);
-}
-
-static int prj_local_post(struct coap_resource *resource,
-        struct coap_packet *request,
-        struct sockaddr *addr, socklen_t addr_len)
-{
-	return prj_post(resource, request, addr, addr_len, DATA_LOC_LOCAL);
-}
-
-static int prepare_prj_payload(uint8_t *payload, size_t len, data_loc_t loc)
+static int prepare_prj_payload(uint8_t *payload, size_t len, data_loc_t loc, bool compact)
 {
     ZCBOR_STATE_E(ce, 2, payload, len, 1);
-    const data_dispatcher_publish_t *prj;
+    data_dispatcher_publish_t prj;
 
     data_dispatcher_get(DATA_PRJ_ENABLED, loc, &prj);
-    uint16_t prj_validity = prj->prj_validity;
+    uint32_t prj_validity = prj.prj_validity;
 
     size_t map_len = prj_validity ? 2 : 1;
 
     if (!zcbor_map_start_encode(ce, map_len)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, PRJ_KEY)) return -EINVAL;
+    if (cbor_encode_key(ce, PRJ_KEY, PRJ_KEY_ID, compact)) return -EINVAL;
     if (!zcbor_bool_put(ce, prj_validity > 0)) return -EINVAL;
 
     if (prj_validity) {
-        if (!zcbor_tstr_put_lit(ce, VALIDITY_KEY)) return -EINVAL;
+        if (cbor_encode_key(ce, VALIDITY_KEY, VALIDITY_KEY_ID, compact)) return -EINVAL;
 	if (!zcbor_uint32_put(ce, prj_validity)) return -EINVAL;
     }
 
@@ -598,15 +816,19 @@ static int prepare_prj_payload(uint8_t *payload, size_t len, data_loc_t loc)
 
 static int prj_get(struct coap_resource *resource,
         struct coap_packet *request,
-        struct sockaddr *addr, socklen_t addr_len,
-	data_loc_t loc)
+        struct sockaddr *addr, socklen_t addr_len)
 {
     int sock = *(int*)resource->user_data;
     int r = 0;
     uint8_t payload[MAX_COAP_PAYLOAD_LEN];
     size_t payload_len = 0;
+    int zone = resource_zone(resource);
+
+    if (zone < 0) {
+        return zone;
+    }
 
-    r = prepare_prj_payload(payload, MAX_COAP_PAYLOAD_LEN, loc);
+    r = prepare_prj_payload(payload, MAX_COAP_PAYLOAD_LEN, zone, coap_server_accepts_compact(request));
     if (r < 0) {
         return r;
     }
@@ -616,36 +838,38 @@ static int prj_get(struct coap_resource *resource,
                     addr, addr_len, payload, payload_len);
 }
 
-static int prj_remote_get(struct coap_resource *resource,
-        struct coap_packet *request,
-        struct sockaddr *addr, socklen_t addr_len)
-{
-	return prj_get(resource, request, addr, addr_len, DATA_LOC_REMOTE);
-}
-static int prj_local_get(struct coap_resource *resource,
-        struct coap_packet *request,
-        struct sockaddr *addr, socklen_t addr_len)
-{
-	return prj_get(resource, request, addr, addr_len, DATA_LOC_LOCAL);
-}
+#define ZONE_RSRCS_NUM 3
 
 static struct coap_resource * rsrcs_get(int sock)
 {
     static const char * const fota_path [] = {"fota_req", NULL};
+    static const char * const fota_mc_path [] = {"fota_mc", NULL};
+#ifdef CONFIG_COAP_FOTA_CACHE
+    static const char * const fota_cache_path [] = {"fota_cache", NULL};
+#endif
     static const char * const sd_path [] = {"sd", NULL};
     static const char * const prov_path[] = {"prov", NULL};
     static const char * const reboot_path[] = {"reboot", NULL};
     static const char * const cont_sd_dbg_path[] = {"cont_sd", NULL};
-    static const char * rsrc_remote_path[] = {NULL, NULL};
-    static const char * prj_remote_path[] = {NULL, "prj", NULL};
-    static const char * rsrc_local_path[] = {NULL, NULL};
-    static const char * prj_local_path[] = {NULL, "prj", NULL};
+    static const char * const disp_path[] = {"disp", NULL};
+#ifdef CONFIG_TEMP_HISTORY
+    static const char * const hist_path[] = {"hist", NULL};
+#endif
 
-    static struct coap_resource resources[] = {
+    static const struct coap_resource node_resources[] = {
     { .get = coap_fota_get,
       .post = coap_fota_post,
       .path = fota_path,
     },
+    { .post = coap_fota_mc_post,
+      .path = fota_mc_path,
+    },
+#ifdef CONFIG_COAP_FOTA_CACHE
+    { .get = coap_fota_cache_get,
+      .post = coap_fota_cache_post,
+      .path = fota_cache_path,
+    },
+#endif
     { .get = coap_sd_server,
       .path = sd_path,
     },
@@ -659,44 +883,61 @@ static struct coap_resource * rsrcs_get(int sock)
     { .get = cont_sd_dbg_get,
       .path = cont_sd_dbg_path,
     },
-    { .get = temp_remote_get,
-      .post = temp_remote_post,
-      .path = rsrc_remote_path,
+    { .get = disp_get,
+      .path = disp_path,
     },
-    { .post = prj_remote_post,
-      .get = prj_remote_get,
-      .path = prj_remote_path,
+#ifdef CONFIG_TEMP_HISTORY
+    { .get = history_coap_get,
+      .path = hist_path,
     },
-    { .get = temp_local_get,
-      .post = temp_local_post,
-      .path = rsrc_local_path,
-    },
-    { .post = prj_local_post,
-      .get = prj_local_get,
-      .path = prj_local_path,
-    },
-        { .path = NULL } // Array terminator
+#endif
     };
 
-    const int rsrc_local_index = ARRAY_SIZE(resources) - 3;
+    // Node resources, resources of provisioned zones and the terminator
+    static struct coap_resource resources[ARRAY_SIZE(node_resources) +
+                                          ZONE_RSRCS_NUM * DATA_LOC_NUM + 1];
+    size_t num = ARRAY_SIZE(node_resources);
 
-    rsrc_remote_path[0] = prov_get_rsrc_label(DATA_LOC_REMOTE);
-    prj_remote_path[0] = rsrc_remote_path[0];
-    rsrc_local_path[0] = prov_get_rsrc_label(DATA_LOC_LOCAL);
-    prj_local_path[0] = rsrc_local_path[0];
+    memcpy(resources, node_resources, sizeof(node_resources));
 
-    if (!rsrc_local_path[0] || !strlen(rsrc_local_path[0])) {
-        resources[rsrc_local_index].path = NULL;
-    } else {
-        resources[rsrc_local_index].path = rsrc_local_path;
+    for (int i = 0; i < DATA_LOC_NUM; ++i) {
+        const char *label = prov_get_rsrc_label(i);
+
+        if (!label || !strlen(label)) {
+            continue;
+        }
+
+        zone_paths[i][0] = label;
+        zone_prj_paths[i][0] = label;
+        zone_prj_paths[i][1] = "prj";
+        zone_prj_short_paths[i][0] = label;
+        zone_prj_short_paths[i][1] = "p";
+
+        resources[num++] = (struct coap_resource) {
+            .get = temp_get,
+            .post = temp_post,
+            .path = zone_paths[i],
+        };
+        resources[num++] = (struct coap_resource) {
+            .get = prj_get,
+            .post = prj_post,
+            .path = zone_prj_paths[i],
+        };
+        resources[num++] = (struct coap_resource) {
+            .get = prj_get,
+            .post = prj_post,
+            .path = zone_prj_short_paths[i],
+        };
     }
 
+    resources[num] = (struct coap_resource) { .path = NULL }; // Array terminator
+
     // TODO: Replace it with something better
     static int user_data;
 
     user_data = sock;
 
-    for (int i = 0; i < ARRAY_SIZE(resources); ++i) {
+    for (size_t i = 0; i < num; ++i) {
         resources[i].user_data = &user_data;
     }
 
@@ -0,0 +1,456 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "copro_buf.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/spi.h>
+#include <zephyr/drivers/misc/ft8xx/ft8xx_common.h>
+#include <zephyr/drivers/misc/ft8xx/ft8xx_copro.h>
+#include <zephyr/drivers/misc/ft8xx/ft8xx_memory.h>
+#include <zephyr/drivers/misc/ft8xx/ft8xx_reference_api.h>
+#include <zephyr/sys/byteorder.h>
+
+#define CMD_DLSTART 0xffffff00UL
+#define CMD_SWAP    0xffffff01UL
+#define CMD_BGCOLOR 0xffffff09UL
+#define CMD_FGCOLOR 0xffffff0aUL
+#define CMD_TEXT    0xffffff0cUL
+#define CMD_SLIDER  0xffffff10UL
+#define CMD_TOGGLE  0xffffff12UL
+#define CMD_MEMCPY  0xffffff1dUL
+#define CMD_APPEND  0xffffff1eUL
+#define CMD_INFLATE 0xffffff22UL
+#define CMD_TRACK   0xffffff2cUL
+#define CMD_NUMBER  0xffffff2eUL
+
+// RAM_CMD is a 4 kB ring. It is empty when REG_CMD_READ equals REG_CMD_WRITE, so it can't be
+// filled completely.
+#define FIFO_SIZE     4096UL
+#define FIFO_MASK     (FIFO_SIZE - 1)
+#define FIFO_MAX_FILL (FIFO_SIZE - 4UL)
+
+#define FT800_MEM_WRITE 0x80
+
+#ifndef REG_CPURESET
+#define REG_CPURESET 0x10241cUL
+#endif
+
+// REG_CMD_READ value set by the co-processor when it detects an invalid command
+#define FIFO_FAULT 0xfff
+
+// RAM_CMD is drained within a frame time unless the co-processor is stuck
+#define FIFO_WAIT_TIMEOUT_MS 100
+
+#if CONFIG_TEMP_DISPLAY_CMD_BATCH
+
+BUILD_ASSERT(CONFIG_TEMP_DISPLAY_CMD_BUF_SIZE % 4 == 0, "Commands are 4 byte aligned");
+BUILD_ASSERT(CONFIG_TEMP_DISPLAY_CMD_BUF_SIZE <= FIFO_MAX_FILL, "Buffer larger than RAM_CMD");
+
+static const struct spi_dt_spec spi_spec = SPI_DT_SPEC_GET(DT_NODELABEL(ft800),
+                                                           SPI_WORD_SET(8) | SPI_OP_MODE_MASTER,
+                                                           0);
+
+static uint8_t buf[CONFIG_TEMP_DISPLAY_CMD_BUF_SIZE] __aligned(4);
+static size_t buf_len;
+
+// Offset in RAM_CMD the next command is written to, mirrors REG_CMD_WRITE
+static uint16_t fifo_wr;
+
+// Bytes flushed since the last copro_buf_flush() called by the user
+static size_t flushed;
+
+// Time spent waiting for free space in RAM_CMD since the last copro_buf_wait_cycles()
+static uint32_t wait_cycles;
+
+// Set when commands were lost. Following commands are dropped until copro_buf_flush(), because
+// they may continue a command that was not written, like data of CMD_INFLATE.
+static bool failed;
+
+// Single SPI transaction with the memory address followed by the data. SPIM sends both with
+// EasyDMA.
+static int mem_write(uint32_t addr, const uint8_t *data, size_t len)
+{
+    uint8_t hdr[3] = {
+        (uint8_t)(addr >> 16) | FT800_MEM_WRITE,
+        (uint8_t)(addr >> 8),
+        (uint8_t)addr,
+    };
+    const struct spi_buf tx_bufs[] = {
+        { .buf = hdr,          .len = sizeof(hdr) },
+        { .buf = (void *)data, .len = len },
+    };
+    const struct spi_buf_set tx = {
+        .buffers = tx_bufs,
+        .count   = ARRAY_SIZE(tx_bufs),
+    };
+
+    return spi_write_dt(&spi_spec, &tx);
+}
+
+static int fifo_wait_space(size_t len)
+{
+    uint32_t start = k_cycle_get_32();
+    int ret = -ETIMEDOUT;
+
+    for (int i = 0; i <= FIFO_WAIT_TIMEOUT_MS; i++) {
+        uint16_t rd = ft8xx_rd16(REG_CMD_READ);
+
+        if (rd == FIFO_FAULT) {
+            ret = -EIO;
+            break;
+        }
+
+        if (FIFO_MAX_FILL - ((fifo_wr - rd) & FIFO_MASK) >= len) {
+            ret = 0;
+            break;
+        }
+
+        k_sleep(K_MSEC(1));
+    }
+
+    wait_cycles += k_cycle_get_32() - start;
+
+    return ret;
+}
+
+// Commands in RAM_CMD are discarded and both FIFO pointers are cleared. RAM_G is preserved.
+static void copro_reset(void)
+{
+    ft8xx_wr8(REG_CPURESET, 1);
+    ft8xx_wr16(REG_CMD_READ, 0);
+    ft8xx_wr16(REG_CMD_WRITE, 0);
+    ft8xx_wr8(REG_CPURESET, 0);
+
+    fifo_wr = 0;
+}
+
+static void buf_write(void)
+{
+    size_t first = MIN(buf_len, FIFO_SIZE - fifo_wr);
+    int ret;
+
+    if (buf_len == 0 || failed) {
+        buf_len = 0;
+        return;
+    }
+
+    ret = fifo_wait_space(buf_len);
+
+    if (!ret) {
+        ret = mem_write(RAM_CMD + fifo_wr, buf, first);
+    }
+    if (!ret && first < buf_len) {
+        ret = mem_write(RAM_CMD, &buf[first], buf_len - first);
+    }
+
+    if (!ret) {
+        fifo_wr = (fifo_wr + buf_len) & FIFO_MASK;
+        ft8xx_wr16(REG_CMD_WRITE, fifo_wr);
+        flushed += buf_len;
+    } else {
+        // A part of a command may be already in RAM_CMD
+        copro_reset();
+        failed = true;
+    }
+
+    buf_len = 0;
+}
+
+static uint8_t *buf_reserve(size_t len)
+{
+    uint8_t *data;
+
+    __ASSERT(len <= sizeof(buf), "Command of %u bytes does not fit in the buffer", len);
+
+    if (buf_len + len > sizeof(buf)) {
+        buf_write();
+    }
+
+    data = &buf[buf_len];
+    buf_len += len;
+
+    return data;
+}
+
+static void put32(uint32_t value)
+{
+    sys_put_le32(value, buf_reserve(sizeof(value)));
+}
+
+static void put16x2(uint16_t first, uint16_t second)
+{
+    uint8_t *data = buf_reserve(2 * sizeof(uint16_t));
+
+    sys_put_le16(first, &data[0]);
+    sys_put_le16(second, &data[2]);
+}
+
+// Data is padded to 4 bytes. It may be longer than the buffer, which is flushed when full.
+static void put_data(const uint8_t *data, size_t len)
+{
+    size_t padded = ROUND_UP(len, 4);
+
+    while (padded > 0) {
+        if (buf_len == sizeof(buf)) {
+            buf_write();
+        }
+
+        size_t chunk = MIN(padded, sizeof(buf) - buf_len);
+        size_t copy  = MIN(chunk, len);
+
+        memcpy(&buf[buf_len], data, copy);
+        memset(&buf[buf_len + copy], 0, chunk - copy);
+
+        buf_len += chunk;
+        data    += copy;
+        len     -= copy;
+        padded  -= chunk;
+    }
+}
+
+// Strings are terminated with NUL
+static void put_str(const char *s)
+{
+    put_data((const uint8_t *)s, strlen(s) + 1);
+}
+
+void copro_buf_init(void)
+{
+    __ASSERT_NO_MSG(spi_is_ready_dt(&spi_spec));
+
+    buf_len = 0;
+    failed  = false;
+    fifo_wr = ft8xx_rd16(REG_CMD_WRITE) & FIFO_MASK;
+}
+
+int copro_buf_flush(void)
+{
+    int result;
+
+    buf_write();
+
+    result = failed ? -EIO : (int)flushed;
+    flushed = 0;
+    failed  = false;
+
+    return result;
+}
+
+uint32_t copro_buf_wait_cycles(void)
+{
+    uint32_t result = wait_cycles;
+
+    wait_cycles = 0;
+
+    return result;
+}
+
+void copro_buf_cmd(uint32_t cmd)
+{
+    put32(cmd);
+}
+
+void copro_buf_dlstart(void)
+{
+    put32(CMD_DLSTART);
+}
+
+void copro_buf_swap(void)
+{
+    put32(CMD_SWAP);
+}
+
+void copro_buf_bgcolor(uint32_t c)
+{
+    put32(CMD_BGCOLOR);
+    put32(c);
+}
+
+void copro_buf_fgcolor(uint32_t c)
+{
+    put32(CMD_FGCOLOR);
+    put32(c);
+}
+
+void copro_buf_text(int16_t x, int16_t y, int16_t font, uint16_t options, const char *s)
+{
+    put32(CMD_TEXT);
+    put16x2(x, y);
+    put16x2(font, options);
+    put_str(s);
+}
+
+void copro_buf_number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n)
+{
+    put32(CMD_NUMBER);
+    put16x2(x, y);
+    put16x2(font, options);
+    put32(n);
+}
+
+void copro_buf_slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options,
+                      uint16_t val, uint16_t range)
+{
+    put32(CMD_SLIDER);
+    put16x2(x, y);
+    put16x2(w, h);
+    put16x2(options, val);
+    put16x2(range, 0);
+}
+
+void copro_buf_toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options,
+                      uint16_t state, const char *s)
+{
+    put32(CMD_TOGGLE);
+    put16x2(x, y);
+    put16x2(w, font);
+    put16x2(options, state);
+    put_str(s);
+}
+
+void copro_buf_track(int16_t x, int16_t y, int16_t w, int16_t h, int16_t tag)
+{
+    put32(CMD_TRACK);
+    put16x2(x, y);
+    put16x2(w, h);
+    put16x2(tag, 0);
+}
+
+void copro_buf_append(uint32_t ptr, uint32_t num)
+{
+    put32(CMD_APPEND);
+    put32(ptr);
+    put32(num);
+}
+
+void copro_buf_memcpy(uint32_t dest, uint32_t src, uint32_t num)
+{
+    put32(CMD_MEMCPY);
+    put32(dest);
+    put32(src);
+    put32(num);
+}
+
+void copro_buf_inflate(uint32_t ptr, const uint8_t *data, size_t len)
+{
+    put32(CMD_INFLATE);
+    put32(ptr);
+    put_data(data, len);
+}
+
+#else // CONFIG_TEMP_DISPLAY_CMD_BATCH
+
+// Every command is written by the ft8xx driver with its own SPI transactions and REG_CMD_WRITE
+// update. Kept to compare frame build times.
+
+static uint16_t last_cmd_write;
+
+void copro_buf_init(void)
+{
+    last_cmd_write = ft8xx_rd16(REG_CMD_WRITE);
+}
+
+int copro_buf_flush(void)
+{
+    uint16_t cmd_write = ft8xx_rd16(REG_CMD_WRITE);
+    int result = (uint16_t)(cmd_write - last_cmd_write) & FIFO_MASK;
+
+    last_cmd_write = cmd_write;
+
+    return result;
+}
+
+uint32_t copro_buf_wait_cycles(void)
+{
+    // The driver waits for free space internally
+    return 0;
+}
+
+void copro_buf_cmd(uint32_t cmd)
+{
+    ft8xx_copro_cmd(cmd);
+}
+
+void copro_buf_dlstart(void)
+{
+    ft8xx_copro_cmd_dlstart();
+}
+
+void copro_buf_swap(void)
+{
+    ft8xx_copro_cmd_swap();
+}
+
+void copro_buf_bgcolor(uint32_t c)
+{
+    ft8xx_copro_cmd_bgcolor(c);
+}
+
+void copro_buf_fgcolor(uint32_t c)
+{
+    ft8xx_copro_cmd_fgcolor(c);
+}
+
+void copro_buf_text(int16_t x, int16_t y, int16_t font, uint16_t options, const char *s)
+{
+    ft8xx_copro_cmd_text(x, y, font, options, s);
+}
+
+void copro_buf_number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n)
+{
+    ft8xx_copro_cmd_number(x, y, font, options, n);
+}
+
+void copro_buf_slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options,
+                      uint16_t val, uint16_t range)
+{
+    ft8xx_copro_cmd_slider(x, y, w, h, options, val, range);
+}
+
+void copro_buf_toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options,
+                      uint16_t state, const char *s)
+{
+    ft8xx_copro_cmd_toggle(x, y, w, font, options, state, s);
+}
+
+void copro_buf_track(int16_t x, int16_t y, int16_t w, int16_t h, int16_t tag)
+{
+    ft8xx_copro_cmd_track(x, y, w, h, tag);
+}
+
+void copro_buf_append(uint32_t ptr, uint32_t num)
+{
+    ft8xx_copro_cmd(CMD_APPEND);
+    ft8xx_copro_cmd(ptr);
+    ft8xx_copro_cmd(num);
+}
+
+void copro_buf_memcpy(uint32_t dest, uint32_t src, uint32_t num)
+{
+    ft8xx_copro_cmd(CMD_MEMCPY);
+    ft8xx_copro_cmd(dest);
+    ft8xx_copro_cmd(src);
+    ft8xx_copro_cmd(num);
+}
+
+void copro_buf_inflate(uint32_t ptr, const uint8_t *data, size_t len)
+{
+    ft8xx_copro_cmd(CMD_INFLATE);
+    ft8xx_copro_cmd(ptr);
+
+    for (size_t i = 0; i < len; i += 4) {
+        uint8_t word[4] = { 0 };
+
+        memcpy(word, &data[i], MIN(len - i, sizeof(word)));
+        ft8xx_copro_cmd(sys_get_le32(word));
+    }
+}
+
+#endif // CONFIG_TEMP_DISPLAY_CMD_BATCH
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Batched FT800 co-processor commands
+ *
+ * Commands of a frame are accumulated in RAM and written to RAM_CMD with a single SPI transfer
+ * followed by a single REG_CMD_WRITE update when the frame is flushed. The buffer is also
+ * flushed when it gets full.
+ *
+ * After copro_buf_init() all co-processor commands must go through this module, because the
+ * FIFO write pointer cached by the ft8xx driver is not updated by it.
+ *
+ * If a SPI transfer fails, or RAM_CMD is not drained in time, the co-processor is reset and
+ * the remaining commands are dropped until the next copro_buf_flush(), which reports the error.
+ */
+
+#ifndef COPRO_BUF_H_
+#define COPRO_BUF_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void copro_buf_init(void);
+
+/**
+ * @brief Write buffered commands to the co-processor FIFO
+ *
+ * @return Number of bytes written to RAM_CMD since the previous flush
+ * @retval -EIO Commands were lost and the co-processor was reset. RAM_G content is preserved.
+ */
+int copro_buf_flush(void);
+
+/**
+ * @brief Get time spent waiting for free space in RAM_CMD
+ *
+ * @return Cycles spent waiting since the previous call, 0 if batching is disabled
+ */
+uint32_t copro_buf_wait_cycles(void);
+
+void copro_buf_cmd(uint32_t cmd);
+void copro_buf_dlstart(void);
+void copro_buf_swap(void);
+void copro_buf_bgcolor(uint32_t c);
+void copro_buf_fgcolor(uint32_t c);
+void copro_buf_text(int16_t x, int16_t y, int16_t font, uint16_t options, const char *s);
+void copro_buf_number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n);
+void copro_buf_slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options,
+                      uint16_t val, uint16_t range);
+void copro_buf_toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options,
+                      uint16_t state, const char *s);
+void copro_buf_track(int16_t x, int16_t y, int16_t w, int16_t h, int16_t tag);
+void copro_buf_append(uint32_t ptr, uint32_t num);
+void copro_buf_memcpy(uint32_t dest, uint32_t src, uint32_t num);
+
+/**
+ * @brief Inflate zlib compressed data into RAM_G
+ *
+ * @param ptr  Destination address in RAM_G
+ * @param data zlib stream
+ * @param len  Length of the stream, it may be longer than the command buffer
+ */
+void copro_buf_inflate(uint32_t ptr, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COPRO_BUF_H_
@@ -13,7 +13,7 @@
 
 #include <zephyr/kernel.h>
 
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 
 #define PID_INTERVAL (1000UL * 60UL * 3UL)
 
@@ -45,8 +45,13 @@ static void process_ctrl(const data_dispatcher_publish_t *meas_data,
                          const data_dispatcher_publish_t *ctlr_data,
                          data_loc_t loc)
 {
+    data_dispatcher_publish_t meas_snapshot;
+    data_dispatcher_publish_t sett_snapshot;
+    data_dispatcher_publish_t ctlr_snapshot;
+
     if (ctlr_data == NULL) {
-        data_dispatcher_get(DATA_CONTROLLER, loc, &ctlr_data);
+        data_dispatcher_get(DATA_CONTROLLER, loc, &ctlr_snapshot);
+        ctlr_data = &ctlr_snapshot;
     }
 
     // Do not process controller if output is forced by other means
@@ -59,10 +64,12 @@ static void process_ctrl(const data_dispatcher_publish_t *meas_data,
         case DATA_CTLR_ONOFF:
             {
                 if (meas_data == NULL) {
-                    data_dispatcher_get(DATA_TEMP_MEASUREMENT, loc, &meas_data);
+                    data_dispatcher_get(DATA_TEMP_MEASUREMENT, loc, &meas_snapshot);
+                    meas_data = &meas_snapshot;
                 }
                 if (sett_data == NULL) {
-                    data_dispatcher_get(DATA_TEMP_SETTING, loc, &sett_data);
+                    data_dispatcher_get(DATA_TEMP_SETTING, loc, &sett_snapshot);
+                    sett_data = &sett_snapshot;
                 }
                 onoff_ctrl(meas_data, sett_data, ctlr_data, loc);
             }
@@ -78,18 +85,18 @@ static void process_ctrl(const data_dispatcher_publish_t *meas_data,
 
 static bool check_forced_switching(data_loc_t loc)
 {
-    const data_dispatcher_publish_t *frc_sw_data;
+    data_dispatcher_publish_t frc_sw_data;
     data_dispatcher_get(DATA_FORCED_SWITCHING, loc, &frc_sw_data);
 
-	return frc_sw_data->forced_switches > 0;
+	return frc_sw_data.forced_switches > 0;
 }
 
 static bool check_projector(data_loc_t loc)
 {
-    const data_dispatcher_publish_t *prj_data;
+    data_dispatcher_publish_t prj_data;
     data_dispatcher_get(DATA_PRJ_ENABLED, loc, &prj_data);
 
-    return prj_data->prj_validity > 0;
+    return prj_data.prj_validity > 0;
 }
 
 static bool check_ctlr_running(data_loc_t loc)
@@ -155,9 +162,9 @@ static void pid_thread_process(void *a1, void *a2, void *a3)
 
     while (1) {
         for (int i = 0; i < DATA_LOC_NUM; ++i) {
-            const data_dispatcher_publish_t *meas_data;
-            const data_dispatcher_publish_t *sett_data;
-            const data_dispatcher_publish_t *ctlr_data;
+            data_dispatcher_publish_t meas_data;
+            data_dispatcher_publish_t sett_data;
+            data_dispatcher_publish_t ctlr_data;
             data_loc_t loc = (data_loc_t)i;
 
             data_dispatcher_publish_t out_data = {
@@ -172,28 +179,28 @@ static void pid_thread_process(void *a1, void *a2, void *a3)
             }
 
             data_dispatcher_get(DATA_CONTROLLER, loc, &ctlr_data);
-            if (ctlr_data->controller.mode != DATA_CTLR_PID) {
+            if (ctlr_data.controller.mode != DATA_CTLR_PID) {
                 continue;
             }
 
             data_dispatcher_get(DATA_TEMP_MEASUREMENT, loc, &meas_data);
             data_dispatcher_get(DATA_TEMP_SETTING, loc, &sett_data);
 
-            if (meas_data->temp_measurement < TEMP_MIN) {
+            if (meas_data.temp_measurement < TEMP_MIN) {
                 // Sensor error
                 out_data.output = 0;
                 data_dispatcher_publish(&out_data);
                 continue;
             }
 
-            int32_t diff = (int32_t)sett_data->temp_setting - (int32_t)meas_data->temp_measurement;
+            int32_t diff = (int32_t)sett_data.temp_setting - (int32_t)meas_data.temp_measurement;
 
             // P
-            int32_t output = diff * (int32_t)ctlr_data->controller.p;
+            int32_t output = diff * (int32_t)ctlr_data.controller.p;
 
             // I
             int32_t prev_i = pid_data[i].i;
-            int32_t new_i  = prev_i + diff * (int32_t)ctlr_data->controller.i;
+            int32_t new_i  = prev_i + diff * (int32_t)ctlr_data.controller.i;
             // Unwinding algorithm
             if (diff > 0) {
                 int32_t max_i = (int32_t)UINT16_MAX - output;
@@ -226,14 +233,31 @@ static void pid_thread_process(void *a1, void *a2, void *a3)
     }
 }
 
+// Controller is evaluated in the dispatcher work queue instead of the sensor or network threads.
+// Every measurement is delivered, so that the controller resumes at the next sample after
+// projector or forced switching expires.
+static uint8_t temp_meas_buf[DATA_DISPATCHER_BUF_SIZE(int16_t, DATA_LOC_NUM, 1, 0)];
 static data_dispatcher_subscribe_t sbscr_temp_meas = {
     .callback = changed_temperature,
+    .work_q   = &data_dispatcher_work_q,
+    .buf      = temp_meas_buf,
+    .buf_size = sizeof(temp_meas_buf),
 };
+static uint8_t temp_setting_buf[DATA_DISPATCHER_BUF_SIZE(int16_t, DATA_LOC_NUM, 1, 1)];
 static data_dispatcher_subscribe_t sbscr_temp_setting = {
-    .callback = changed_setting,
+    .callback  = changed_setting,
+    .work_q    = &data_dispatcher_work_q,
+    .on_change = true,
+    .buf       = temp_setting_buf,
+    .buf_size  = sizeof(temp_setting_buf),
 };
+static uint8_t ctlr_setting_buf[DATA_DISPATCHER_BUF_SIZE(data_controller_t, DATA_LOC_NUM, 1, 1)];
 static data_dispatcher_subscribe_t sbscr_ctlr_setting = {
-    .callback = changed_ctlr,
+    .callback  = changed_ctlr,
+    .work_q    = &data_dispatcher_work_q,
+    .on_change = true,
+    .buf       = ctlr_setting_buf,
+    .buf_size  = sizeof(ctlr_setting_buf),
 };
 
 void ctlr_init(void)
@@ -247,15 +271,15 @@ void ctlr_init(void)
 
 static void changed_temperature(const data_dispatcher_publish_t *data)
 {
-    const data_dispatcher_publish_t *ctlr_data;
+    data_dispatcher_publish_t ctlr_data;
     data_loc_t loc = data->loc;
 
     data_dispatcher_get(DATA_CONTROLLER, loc, &ctlr_data);
 
-    switch (ctlr_data->controller.mode) {
+    switch (ctlr_data.controller.mode) {
         case DATA_CTLR_ONOFF:
             {
-                process_ctrl(data, NULL, ctlr_data, loc);
+                process_ctrl(data, NULL, &ctlr_data, loc);
             }
             break;
 
@@ -269,15 +293,15 @@ static void changed_temperature(const data_dispatcher_publish_t *data)
 
 static void changed_setting(const data_dispatcher_publish_t *data)
 {
-    const data_dispatcher_publish_t *ctlr_data;
+    data_dispatcher_publish_t ctlr_data;
     data_loc_t loc = data->loc;
 
     data_dispatcher_get(DATA_CONTROLLER, loc, &ctlr_data);
 
-    switch (ctlr_data->controller.mode) {
+    switch (ctlr_data.controller.mode) {
         case DATA_CTLR_ONOFF:
             {
-                process_ctrl(NULL, data, ctlr_data, loc);
+                process_ctrl(NULL, data, &ctlr_data, loc);
             }
             break;
 
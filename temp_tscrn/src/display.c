@@ -20,15 +20,19 @@
 #include <zephyr/drivers/misc/ft8xx/ft8xx_memory.h>
 #include <zephyr/drivers/misc/ft8xx/ft8xx_reference_api.h>
 #include <zephyr/net/net_if.h>
+#include <zephyr/sys/atomic.h>
 
 #include <continuous_sd.h>
 
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
+#include "copro_buf.h"
+#include "ft8xx_assets.h"
+#include "history.h"
 #include "light_conn.h"
+#include "output.h"
 #include "shades_conn.h"
 #include "prov.h"
 
-#define CLOCK_LINE_WIDTH   10
 #define CLOCK_LINE_LENGTH  60
 #define CLOCK_DIGIT_SPACE  50
 #define CLOCK_NUMBER_SPACE 60
@@ -41,6 +45,15 @@
 
 #define DISPLAY_DEBUG 0
 
+// Print refresh statistics every window, e.g. to compare frame build times with and without
+// CONFIG_TEMP_DISPLAY_CMD_BATCH
+#define DISPLAY_STATS_PRINT 0
+
+#define TEMPS_ZONES_PER_PAGE 2
+#define TEMPS_NUM_PAGES      ((DATA_LOC_NUM - 1) / TEMPS_ZONES_PER_PAGE + 1)
+#define TEMPS_TAG_UP(zone)   (1 + (zone) * 2)
+#define TEMPS_TAG_DOWN(zone) (2 + (zone) * 2)
+
 #if DISPLAY_DEBUG
 uint32_t test;
 #endif
@@ -71,6 +84,24 @@ enum screen_t {
     #endif
 };
 
+#if DISPLAY_DEBUG
+#define SCREEN_NUM (SCREEN_DEBUG + 1)
+#else
+#define SCREEN_NUM (SCREEN_TEMPS + 1)
+#endif
+
+static const char *const screen_names[SCREEN_NUM] = {
+    [SCREEN_CLOCK]          = "clock",
+    [SCREEN_MENU]           = "menu",
+    [SCREEN_LIGHTS_MENU]    = "lights",
+    [SCREEN_LIGHT_CONTROL]  = "light",
+    [SCREEN_SHADES_CONTROL] = "shades",
+    [SCREEN_TEMPS]          = "temps",
+#if DISPLAY_DEBUG
+    [SCREEN_DEBUG]          = "debug",
+#endif
+};
+
 static enum screen_t curr_screen = SCREEN_CLOCK;
 static uint8_t curr_page = 0;
 
@@ -85,7 +116,24 @@ K_THREAD_DEFINE(touch_thread_id, TOUCH_THREAD_STACK_SIZE,
 
 K_SEM_DEFINE(touch_sem, 0, 1);
 
+// Interrupt sources of REG_INT_FLAGS and REG_INT_MASK
+#define INT_TAG          0x04
+#define INT_CONVCOMPLETE 0x80
+
+// Interval of repeated processing of a held button
+#define TOUCH_REPEAT_MS 100
+
+// Last REG_TRACKER value read by the touch thread
+static uint32_t touch_tracker;
+
+// Cycle counter of the last touch interrupt
+static volatile uint32_t touch_irq_cycles;
+// Cycle counter of the processed touch interrupt waiting for a frame with bit 0 set, 0 if none
+static atomic_t touch_start;
+
 #define INACTIVITY_TIME_MS (1000UL * 60UL)
+#define MINUTE_MS          (1000UL * 60UL)
+// Clock is redrawn at minute boundaries, or retried at this interval while time is unknown
 #define CLOCK_REFRESH_MS   1000UL
 void inactivity_work_handler(struct k_work *work);
 K_WORK_DEFINE(inactivity_work, inactivity_work_handler);
@@ -96,33 +144,427 @@ static void inactivity_timer_handler(struct k_timer *timer)
 }
 K_TIMER_DEFINE(inactivity_timer, inactivity_timer_handler, NULL);
 
-static void display_clock(void);
+static uint32_t display_clock(void);
 static void display_menu(void);
 static void display_lights_menu(void);
 static void display_light_control(void);
 static void display_shade_control(uint8_t page);
 static void display_curr_temps(void);
+static void clock_static(void);
+static void menu_static(void);
+static void lights_menu_static(void);
+static void light_control_static(void);
+static void shade_control_static(void);
+static void temps_static(void);
 static void temp_changed(const data_dispatcher_publish_t *data);
 static void vent_changed(const data_dispatcher_publish_t *data);
 static void light_changed(const data_dispatcher_publish_t *data);
 static void shades_changed(const data_dispatcher_publish_t *data);
 
-static data_dispatcher_subscribe_t temp_sbscr = {
-    .callback = temp_changed,
+// Redraw only on visible changes. Measurement noise of 0.1 C does not trigger a redraw
+static uint8_t temp_meas_buf[DATA_DISPATCHER_BUF_SIZE(int16_t, DATA_LOC_NUM, 0, 1)];
+static data_dispatcher_subscribe_t temp_meas_sbscr = {
+    .callback  = temp_changed,
+    .on_change = true,
+    .deadband  = 1,
+    .buf       = temp_meas_buf,
+    .buf_size  = sizeof(temp_meas_buf),
+};
+
+static uint8_t temp_sett_buf[DATA_DISPATCHER_BUF_SIZE(int16_t, DATA_LOC_NUM, 0, 1)];
+static data_dispatcher_subscribe_t temp_sett_sbscr = {
+    .callback  = temp_changed,
+    .on_change = true,
+    .buf       = temp_sett_buf,
+    .buf_size  = sizeof(temp_sett_buf),
 };
 
+static uint8_t vent_buf[DATA_DISPATCHER_BUF_SIZE(data_vent_sm_t, 1, 0, 1)];
 static data_dispatcher_subscribe_t vent_sbscr = {
-    .callback = vent_changed,
+    .callback  = vent_changed,
+    .on_change = true,
+    .buf       = vent_buf,
+    .buf_size  = sizeof(vent_buf),
 };
 
+static uint8_t light_buf[DATA_DISPATCHER_BUF_SIZE(data_light_t, 1, 0, 1)];
 static data_dispatcher_subscribe_t light_sbscr = {
-    .callback = light_changed,
+    .callback  = light_changed,
+    .on_change = true,
+    .buf       = light_buf,
+    .buf_size  = sizeof(light_buf),
 };
 
+static uint8_t shades_buf[DATA_DISPATCHER_BUF_SIZE(data_shades_curr_t, 1, 0, 1)];
 static data_dispatcher_subscribe_t shades_sbscr = {
-    .callback = shades_changed,
+    .callback  = shades_changed,
+    .on_change = true,
+    .buf       = shades_buf,
+    .buf_size  = sizeof(shades_buf),
+};
+
+/*
+ * Every screen describes what it is going to draw with a render state: the screen, the page and
+ * all values shown on it. A frame is built and swapped only if its state differs from the state
+ * of the last drawn frame, so refreshes without visible changes cost no SPI traffic.
+ */
+#define RENDER_STATE_SIZE 512
+#define RENDER_STATE_INVALID SIZE_MAX
+
+struct render_state {
+    size_t  len;
+    uint8_t data[RENDER_STATE_SIZE];
+};
+
+static struct render_state rendered;
+static struct render_state next_render;
+static bool frame_drawn;
+
+// Counters of the current statistics window, accessed only from the display thread
+static struct {
+    uint32_t frames;
+    uint32_t skipped;
+    uint32_t cmd_bytes;
+    uint32_t frame_start;  // Cycle counter when the frame build started
+    enum screen_t frame_screen;
+    uint64_t build_cycles;
+    uint32_t build_max_cycles;
+    int64_t  start;
+} stats_window;
+
+static display_stats_t stats;
+static display_screen_stats_t screen_stats[SCREEN_NUM];
+static struct k_spinlock stats_lock;
+
+static void stats_update(void)
+{
+    int64_t now = k_uptime_get();
+    int64_t elapsed = now - stats_window.start;
+
+    if (elapsed < MINUTE_MS) {
+        return;
+    }
+
+    display_stats_t new_stats = {
+        .redraws_per_min = (uint64_t)stats_window.frames * MINUTE_MS / elapsed,
+        .skipped_per_min = (uint64_t)stats_window.skipped * MINUTE_MS / elapsed,
+        .cmd_bytes_per_s = (uint64_t)stats_window.cmd_bytes * MSEC_PER_SEC / elapsed,
+        .build_us_avg    = stats_window.frames ?
+                           k_cyc_to_us_floor64(stats_window.build_cycles / stats_window.frames) : 0,
+        .build_us_max    = k_cyc_to_us_floor32(stats_window.build_max_cycles),
+    };
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    stats = new_stats;
+    k_spin_unlock(&stats_lock, key);
+
+#if DISPLAY_STATS_PRINT
+    printk("display: %u redraws/min, %u skipped/min, %u B/s, build avg %u us max %u us\n",
+           new_stats.redraws_per_min, new_stats.skipped_per_min, new_stats.cmd_bytes_per_s,
+           new_stats.build_us_avg, new_stats.build_us_max);
+#endif
+
+    stats_window.frames    = 0;
+    stats_window.skipped   = 0;
+    stats_window.cmd_bytes = 0;
+    stats_window.start     = now;
+
+    stats_window.build_cycles     = 0;
+    stats_window.build_max_cycles = 0;
+}
+
+static void render_add(const void *data, size_t len)
+{
+    if (next_render.len == RENDER_STATE_INVALID) {
+        return;
+    }
+
+    if (next_render.len + len > sizeof(next_render.data)) {
+        // State too large to be compared, the frame is always drawn
+        next_render.len = RENDER_STATE_INVALID;
+        return;
+    }
+
+    memcpy(&next_render.data[next_render.len], data, len);
+    next_render.len += len;
+}
+
+static void render_begin(void)
+{
+    next_render.len = 0;
+
+    render_add(&curr_screen, sizeof(curr_screen));
+    render_add(&curr_page, sizeof(curr_page));
+}
+
+// Returns false if the frame described by render_add() calls is already on the screen
+static bool render_needed(void)
+{
+    if ((next_render.len != RENDER_STATE_INVALID) && (next_render.len == rendered.len) &&
+            (memcmp(next_render.data, rendered.data, rendered.len) == 0)) {
+        stats_window.skipped++;
+        stats_update();
+        // Touch without visible change is not measured
+        atomic_clear(&touch_start);
+        return false;
+    }
+
+    if (next_render.len == RENDER_STATE_INVALID) {
+        rendered.len = 0;
+    } else {
+        rendered.len = next_render.len;
+        memcpy(rendered.data, next_render.data, next_render.len);
+    }
+
+    frame_drawn = true;
+    stats_window.frame_start  = k_cycle_get_32();
+    stats_window.frame_screen = curr_screen;
+    return true;
+}
+
+// Called after copro_buf_swap() with spi_sem taken. Build time of a frame ends when all its
+// commands are in RAM_CMD, it does not include their execution by the co-processor.
+static void render_done(void)
+{
+    int cmd_bytes = copro_buf_flush();
+
+    if (cmd_bytes < 0) {
+        // The frame is incomplete, draw it again after the co-processor reset
+        rendered.len = 0;
+        atomic_clear(&touch_start);
+        k_sem_give(&display_update_sem);
+        return;
+    }
+
+    uint32_t now = k_cycle_get_32();
+    uint32_t build_cycles = now - stats_window.frame_start;
+    uint32_t build_us = k_cyc_to_us_floor32(build_cycles);
+    uint32_t wait_us = k_cyc_to_us_floor32(copro_buf_wait_cycles());
+    uint32_t touch = atomic_clear(&touch_start);
+
+    stats_window.cmd_bytes += cmd_bytes;
+    stats_window.build_cycles += build_cycles;
+    stats_window.build_max_cycles = MAX(stats_window.build_max_cycles, build_cycles);
+    stats_window.frames++;
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    display_screen_stats_t *scr = &screen_stats[stats_window.frame_screen];
+
+    scr->frames++;
+    scr->build_us += build_us;
+    scr->build_us_max = MAX(scr->build_us_max, build_us);
+    scr->cmd_bytes += cmd_bytes;
+    scr->copro_wait_us += wait_us;
+
+    if (touch) {
+        uint32_t touch_us = k_cyc_to_us_floor32(now - (touch & ~1UL));
+
+        scr->touches++;
+        scr->touch_us += touch_us;
+        scr->touch_us_max = MAX(scr->touch_us_max, touch_us);
+    }
+
+    k_spin_unlock(&stats_lock, key);
+
+    stats_update();
+}
+
+void display_stats_get(display_stats_t *stats_out)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *stats_out = stats;
+    k_spin_unlock(&stats_lock, key);
+}
+
+size_t display_screens_num(void)
+{
+    return SCREEN_NUM;
+}
+
+const char *display_screen_stats_get(size_t screen, display_screen_stats_t *stats_out)
+{
+    if (screen >= SCREEN_NUM) {
+        return NULL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *stats_out = screen_stats[screen];
+    k_spin_unlock(&stats_lock, key);
+
+    return screen_names[screen];
+}
+
+/*
+ * Static parts of the screens are built once at boot and copied from RAM_DL to RAM_G. Frames
+ * append the fragment with CMD_APPEND and send only their dynamic part. Graphics state left by
+ * a fragment carries over to the commands following it.
+ */
+#define RAM_G_SIZE           (256UL * 1024UL)
+#define COPRO_IDLE_TIMEOUT_MS 100
+
+enum dl_fragment_id {
+    FRAGMENT_CLOCK,
+    FRAGMENT_MENU,
+    FRAGMENT_LIGHTS_MENU,
+    FRAGMENT_LIGHT_CONTROL,
+    FRAGMENT_SHADE_CONTROL,
+    FRAGMENT_TEMPS,
+
+    FRAGMENT_NUM
+};
+
+static void (*const fragment_builders[FRAGMENT_NUM])(void) = {
+    [FRAGMENT_CLOCK]         = clock_static,
+    [FRAGMENT_MENU]          = menu_static,
+    [FRAGMENT_LIGHTS_MENU]   = lights_menu_static,
+    [FRAGMENT_LIGHT_CONTROL] = light_control_static,
+    [FRAGMENT_SHADE_CONTROL] = shade_control_static,
+    [FRAGMENT_TEMPS]         = temps_static,
 };
 
+static struct {
+    uint32_t addr;
+    uint16_t len; // 0 if the fragment is not in RAM_G
+} fragments[FRAGMENT_NUM];
+
+// Next free address of RAM_G
+static uint32_t ram_g_free = RAM_G;
+
+static bool copro_wait_idle(void)
+{
+    for (int i = 0; i < COPRO_IDLE_TIMEOUT_MS; i++) {
+        if (rd16(REG_CMD_READ) == rd16(REG_CMD_WRITE)) {
+            return true;
+        }
+
+        k_sleep(K_MSEC(1));
+    }
+
+    return false;
+}
+
+static void fragment_build(enum dl_fragment_id id)
+{
+    uint16_t len;
+
+    copro_buf_dlstart();
+    fragment_builders[id]();
+
+    if (copro_buf_flush() < 0 || !copro_wait_idle()) {
+        return;
+    }
+
+    len = rd16(REG_CMD_DL);
+
+    if (len == 0 || ram_g_free + len > RAM_G + RAM_G_SIZE) {
+        return;
+    }
+
+    copro_buf_memcpy(ram_g_free, RAM_DL, len);
+
+    if (copro_buf_flush() < 0 || !copro_wait_idle()) {
+        return;
+    }
+
+    fragments[id].addr = ram_g_free;
+    fragments[id].len  = len;
+    ram_g_free += len;
+}
+
+// The display list being built is not swapped, so the screen is not affected
+static void fragments_init(void)
+{
+    k_sem_take(&spi_sem, K_FOREVER);
+
+    for (int i = 0; i < FRAGMENT_NUM; i++) {
+        fragment_build(i);
+    }
+
+    k_sem_give(&spi_sem);
+}
+
+// Falls back to sending the commands of the fragment if it could not be stored in RAM_G
+static void fragment_emit(enum dl_fragment_id id)
+{
+    if (fragments[id].len == 0) {
+        fragment_builders[id]();
+        return;
+    }
+
+    copro_buf_append(fragments[id].addr, fragments[id].len);
+}
+
+/*
+ * Bitmaps generated from temp_tscrn/assets by scripts/ft8xx_assets.py are inflated into RAM_G once
+ * at boot. An asset is drawn with the bitmap handle equal to its ID, set up by asset_setup() in
+ * the static fragment of the screen using it.
+ */
+#define ASSET_HANDLE(id) (id)
+
+BUILD_ASSERT(ASSET_NUM <= 15, "Bitmap handle 15 and above are used by the co-processor fonts");
+
+// Display list commands not provided by ft8xx_dl.h
+#ifndef BITMAP_HANDLE
+#define BITMAP_HANDLE(handle) ((5UL << 24) | ((handle) & 31UL))
+#endif
+#ifndef BITMAP_SOURCE
+#define BITMAP_SOURCE(addr) ((1UL << 24) | ((addr) & 1048575UL))
+#endif
+#ifndef BITMAP_LAYOUT
+#define BITMAP_LAYOUT(format, linestride, height) \
+    ((7UL << 24) | (((format) & 31UL) << 19) | (((linestride) & 1023UL) << 9) | \
+     ((height) & 511UL))
+#endif
+#ifndef BITMAP_SIZE
+#define BITMAP_SIZE(filter, wrapx, wrapy, width, height) \
+    ((8UL << 24) | (((filter) & 1UL) << 20) | (((wrapx) & 1UL) << 19) | \
+     (((wrapy) & 1UL) << 18) | (((width) & 511UL) << 9) | ((height) & 511UL))
+#endif
+#ifndef NEAREST
+#define NEAREST 0
+#endif
+#ifndef BORDER
+#define BORDER 0
+#endif
+
+static uint32_t asset_addr[ASSET_NUM];
+static bool asset_loaded[ASSET_NUM];
+
+static void assets_init(void)
+{
+    k_sem_take(&spi_sem, K_FOREVER);
+
+    for (int i = 0; i < ASSET_NUM; i++) {
+        const struct ft8xx_asset *asset = &ft8xx_assets[i];
+
+        if (ram_g_free + asset->size > RAM_G + RAM_G_SIZE) {
+            continue;
+        }
+
+        copro_buf_inflate(ram_g_free, asset->data, asset->data_len);
+
+        if (copro_buf_flush() < 0 || !copro_wait_idle()) {
+            continue;
+        }
+
+        asset_addr[i]   = ram_g_free;
+        asset_loaded[i] = true;
+        ram_g_free += ROUND_UP(asset->size, 4);
+    }
+
+    k_sem_give(&spi_sem);
+}
+
+static void asset_setup(enum ft8xx_asset_id id)
+{
+    const struct ft8xx_asset *asset = &ft8xx_assets[id];
+
+    copro_buf_cmd(BITMAP_HANDLE(ASSET_HANDLE(id)));
+    copro_buf_cmd(BITMAP_SOURCE(asset_addr[id]));
+    copro_buf_cmd(BITMAP_LAYOUT(asset->format, asset->stride, asset->height));
+    copro_buf_cmd(BITMAP_SIZE(NEAREST, BORDER, BORDER, asset->width, asset->height));
+}
+
 void display_init(void)
 {
     k_thread_start(touch_thread_id);
@@ -134,16 +576,35 @@ void display_debug(int32_t value)
 #if DISPLAY_DEBUG
     test = value;
 
-    cmd_dlstart();
-    cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
-    cmd(CLEAR(1, 1, 1));
+    copro_buf_dlstart();
+    copro_buf_cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
+    copro_buf_cmd(CLEAR(1, 1, 1));
 
     char debug_str[12];
     snprintf(debug_str, sizeof(debug_str), "0x%08x", test);
-    cmd_text(470, 30, 29, OPT_RIGHTX, debug_str);
+    copro_buf_text(470, 30, 29, OPT_RIGHTX, debug_str);
+
+    // Averages per frame of every screen
+    copro_buf_text(10, 60, 26, 0, "screen  frames  build us  bytes  wait us  touch us");
+
+    for (size_t i = 0; i < SCREEN_NUM; i++) {
+        display_screen_stats_t scr;
+        char stats_str[64];
+
+        display_screen_stats_get(i, &scr);
+
+        uint32_t frames = MAX(scr.frames, 1);
+
+        snprintf(stats_str, sizeof(stats_str), "%-6s %7u %9u %6u %8u %9u", screen_names[i],
+                 scr.frames, (uint32_t)(scr.build_us / frames), (uint32_t)(scr.cmd_bytes / frames),
+                 (uint32_t)(scr.copro_wait_us / frames),
+                 scr.touches ? (uint32_t)(scr.touch_us / scr.touches) : 0);
+        copro_buf_text(10, 80 + 18 * i, 26, 0, stats_str);
+    }
 
-    cmd(DISPLAY());
-    cmd_swap();
+    copro_buf_cmd(DISPLAY());
+    copro_buf_swap();
+    copro_buf_flush();
 #else
     (void)value;
 #endif
@@ -152,7 +613,6 @@ void display_debug(int32_t value)
 static void process_touch_menu(uint8_t tag,uint32_t iteration)
 {
 	bool publish_vent = false;
-	const data_dispatcher_publish_t *p_data;
 	data_dispatcher_publish_t data;
 
 	switch (tag) {
@@ -162,6 +622,7 @@ static void process_touch_menu(uint8_t tag,uint32_t iteration)
 			break;
 
 		case 2:
+			curr_page = 0;
 			curr_screen = SCREEN_TEMPS;
 			k_sem_give(&display_update_sem);
 			break;
@@ -190,8 +651,8 @@ static void process_touch_menu(uint8_t tag,uint32_t iteration)
         if ((now - last_vent_time) > 500LL) {
             last_vent_time = now;
 
-            data_dispatcher_get(DATA_VENT_CURR, 0, &p_data);
-            switch (p_data->vent_mode) {
+            data_dispatcher_get(DATA_VENT_CURR, 0, &data);
+            switch (data.vent_mode) {
                 case VENT_SM_UNAVAILABLE:
                 case VENT_SM_NONE:
                     next_sm = VENT_SM_AIRING;
@@ -255,9 +716,8 @@ static void process_touch_lights_menu(uint8_t tag,uint32_t iteration)
 
 static int get_tracker_val(uint8_t tag)
 {
-	uint32_t tracker = ft8xx_get_tracker_value();
-	if ((tracker & 0xff) != tag) return -1;
-	return tracker >> 16;
+	if ((touch_tracker & 0xff) != tag) return -1;
+	return touch_tracker >> 16;
 }
 
 static bool is_light_on(const data_light_t *light)
@@ -279,22 +739,18 @@ static void set_light(uint8_t tag, data_dispatcher_publish_t *publish_data, uint
 	int tracker_val = get_tracker_val(tag);
 	if (tracker_val < 0) return;
 
-	const data_dispatcher_publish_t *p_data;
-	data_dispatcher_get(DATA_LIGHT_CURR, 0, &p_data);
-	*publish_data = *p_data;
+	data_dispatcher_get(DATA_LIGHT_CURR, 0, publish_data);
 	*val = 255 - (tracker_val >> 8);
 	publish_light(publish_data);
 }
 
 static void toggle_light(void)
 {
-	const data_dispatcher_publish_t *p_data;
 	data_dispatcher_publish_t publish_data;
 
-	data_dispatcher_get(DATA_LIGHT_CURR, 0, &p_data);
-	publish_data = *p_data;
+	data_dispatcher_get(DATA_LIGHT_CURR, 0, &publish_data);
 
-	if (is_light_on(&p_data->light)) {
+	if (is_light_on(&publish_data.light)) {
 		publish_data.light.r = 0;
 		publish_data.light.g = 0;
 		publish_data.light.b = 0;
@@ -343,14 +799,11 @@ static void process_touch_light_control(uint8_t tag,uint32_t iteration)
 
 static void publish_shade(data_dispatcher_publish_t *req_data)
 {
-	const data_dispatcher_publish_t *curr_data = NULL;
+	data_dispatcher_publish_t new_curr_data;
 
-	data_dispatcher_get(DATA_SHADES_CURR, 0, &curr_data);
-	if (curr_data != NULL) {
-    	data_dispatcher_publish_t new_curr_data = *curr_data;
-	    new_curr_data.shades_curr.values[req_data->shades_req.id] = req_data->shades_req.value;
-		data_dispatcher_publish(&new_curr_data);
-	}
+	data_dispatcher_get(DATA_SHADES_CURR, 0, &new_curr_data);
+	new_curr_data.shades_curr.values[req_data->shades_req.id] = req_data->shades_req.value;
+	data_dispatcher_publish(&new_curr_data);
 
 	data_dispatcher_publish(req_data);
 }
@@ -495,38 +948,37 @@ static void process_touch_temps(uint8_t tag, uint32_t iteration)
     // TODO: Refactor interface and body of this function.
     // It should handle click and holding a button.
 
-    const data_dispatcher_publish_t *p_data;
     data_dispatcher_publish_t data;
-    data_loc_t loc = DATA_LOC_NUM;
-    int16_t diff = 0;
-    bool publish_setting = false;
 
-    switch (tag) {
-        case 1:
-            loc = DATA_LOC_LOCAL;
-            diff = 1;
-            publish_setting = true;
-            break;
+    if ((tag >= TEMPS_TAG_UP(0)) && (tag <= TEMPS_TAG_DOWN(DATA_LOC_NUM - 1))) {
+        data_loc_t loc = (tag - TEMPS_TAG_UP(0)) / 2;
+        int16_t diff = (tag == TEMPS_TAG_UP(loc)) ? 1 : -1;
 
-        case 2:
-            loc = DATA_LOC_LOCAL;
-            diff = -1;
-            publish_setting = true;
-            break;
+        data_dispatcher_get(DATA_TEMP_SETTING, loc, &data);
+        data.temp_setting += diff;
+        data_dispatcher_publish(&data);
+        return;
+    }
 
-        case 3:
-            loc = DATA_LOC_REMOTE;
-            diff = 1;
-            publish_setting = true;
+    switch (tag) {
+        case 251:
+            if (iteration) break;
+            if (curr_page < (TEMPS_NUM_PAGES - 1)) {
+                curr_page++;
+            }
+            k_sem_give(&display_update_sem);
             break;
 
-        case 4:
-            loc = DATA_LOC_REMOTE;
-            diff = -1;
-            publish_setting = true;
+        case 252:
+            if (iteration) break;
+            if (curr_page > 0) {
+                curr_page--;
+            }
+            k_sem_give(&display_update_sem);
             break;
 
         case 253:
+            curr_page = 0;
             curr_screen = SCREEN_MENU;
             k_sem_give(&display_update_sem);
             break;
@@ -535,14 +987,6 @@ static void process_touch_temps(uint8_t tag, uint32_t iteration)
             // TODO: Log error
             return;
     }
-
-    if (publish_setting) {
-        data_dispatcher_get(DATA_TEMP_SETTING, loc, &p_data);
-        data = *p_data;
-        data.temp_setting += diff;
-        data_dispatcher_publish(&data);
-    }
-
 }
 
 // This function is called in touch thread
@@ -595,19 +1039,27 @@ static void display_thread(void *arg1, void *arg2, void *arg3)
         return;
     }
 
-    data_dispatcher_subscribe(DATA_TEMP_MEASUREMENT, &temp_sbscr);
-    data_dispatcher_subscribe(DATA_TEMP_SETTING, &temp_sbscr);
+    data_dispatcher_subscribe(DATA_TEMP_MEASUREMENT, &temp_meas_sbscr);
+    data_dispatcher_subscribe(DATA_TEMP_SETTING, &temp_sett_sbscr);
     data_dispatcher_subscribe(DATA_VENT_CURR, &vent_sbscr);
     data_dispatcher_subscribe(DATA_LIGHT_CURR, &light_sbscr);
     data_dispatcher_subscribe(DATA_SHADES_CURR, &shades_sbscr);
 
+    copro_buf_init();
+    // Fragments refer to the assets in RAM_G
+    assets_init();
+    fragments_init();
+
+    stats_window.start = k_uptime_get();
+
     while (1) {
         k_timeout_t sem_timeout = K_FOREVER;
 
+        frame_drawn = false;
+
         switch (curr_screen) {
             case SCREEN_CLOCK:
-                display_clock();
-                sem_timeout = K_MSEC(CLOCK_REFRESH_MS);
+                sem_timeout = K_MSEC(display_clock());
                 break;
             case SCREEN_MENU:
                 display_menu();
@@ -631,13 +1083,31 @@ static void display_thread(void *arg1, void *arg2, void *arg3)
 #endif
         }
 
-        if (curr_screen != SCREEN_CLOCK) {
+        if (frame_drawn && curr_screen != SCREEN_CLOCK) {
             wr8(REG_PWM_DUTY, SCREEN_BRIGHTNESS);
         }
 
         k_sem_take(&display_update_sem, sem_timeout);
     }
 }
+// Latency to the next frame is measured for the first processed touch not drawn yet
+static void touch_latency_start(uint32_t irq_cycles)
+{
+    (void)atomic_cas(&touch_start, 0, irq_cycles | 1);
+}
+
+/*
+ * Touch is handled on interrupts. A change of the touched tag is signalled by INT_TAG. FT800 has
+ * no interrupt for changes of the tracker of a slider registered with CMD_TRACK, so while
+ * a tracked tag is touched INT_CONVCOMPLETE is enabled too. It is masked again after every
+ * reading of REG_TRACKER for CONFIG_TEMP_TOUCH_TRACK_INTERVAL, which limits SPI reads and
+ * published requests while a slider is moved. Slider handlers are called only if the tracker
+ * value changed.
+ *
+ * The ft8xx driver reads REG_INT_FLAGS, which clears them, before it calls touch_irq(). So on
+ * every interrupt the thread compares REG_TOUCH_TAG and REG_TRACKER with the last values instead
+ * of checking which flag is set.
+ */
 static void touch_thread_process(void *a1, void *a2, void *a3)
 {
     (void)a1;
@@ -652,328 +1122,397 @@ static void touch_thread_process(void *a1, void *a2, void *a3)
     const uint8_t no_touch = 0;
     uint8_t last_tag = no_touch;
     uint32_t iteration = 0;
+    bool tracking = false;
+    bool track_masked = false;
+    // Read the tag touched before the interrupt was registered
+    bool irq = true;
+    uint32_t irq_cycles = k_cycle_get_32();
 
     ft8xx_register_int(touch_irq);
+    wr8(REG_INT_MASK, INT_TAG);
 
     while (1) {
-        int tag = ft8xx_get_touch_tag();
+        uint8_t tag = irq ? rd8(REG_TOUCH_TAG) : last_tag;
 
-        if (tag < 0) {
-            // Error
-            break;
-        }
-
-        if (last_tag != tag) {
+        if (tag != last_tag) {
             last_tag = tag;
             iteration = 0;
+            tracking = false;
+
+            if (tag != no_touch) {
+                touch_tracker = ft8xx_get_tracker_value();
+                tracking = (touch_tracker & 0xff) == tag;
+
+                touch_latency_start(irq_cycles);
+                process_touch(tag, iteration);
+            }
+
+            track_masked = false;
+            wr8(REG_INT_MASK, tracking ? (INT_TAG | INT_CONVCOMPLETE) : INT_TAG);
+        } else if (irq && tracking && !track_masked) {
+            uint32_t tracker = ft8xx_get_tracker_value();
+
+            if ((tracker != touch_tracker) && ((tracker & 0xff) == last_tag)) {
+                touch_tracker = tracker;
+                iteration++;
+                touch_latency_start(irq_cycles);
+                process_touch(last_tag, iteration);
+            }
+
+            track_masked = true;
+            wr8(REG_INT_MASK, INT_TAG);
         }
-        else if (tag != no_touch) {
-            iteration++;
+
+        k_timeout_t timeout = K_FOREVER;
+
+        if (tracking) {
+            if (track_masked) {
+                timeout = K_MSEC(CONFIG_TEMP_TOUCH_TRACK_INTERVAL);
+            }
+        } else if (last_tag != no_touch) {
+            timeout = K_MSEC(TOUCH_REPEAT_MS);
+        }
+
+        if (k_sem_take(&touch_sem, timeout) == 0) {
+            irq_cycles = touch_irq_cycles;
+            irq = true;
+            continue;
         }
 
-        if (tag != no_touch) {
-            process_touch((uint8_t)tag, iteration);
+        irq = false;
 
-            k_sem_take(&touch_sem, K_MSEC(100));
+        if (tracking) {
+            // Conversions completed while masked set the flag, so the interrupt fires at once
+            track_masked = false;
+            wr8(REG_INT_MASK, INT_TAG | INT_CONVCOMPLETE);
         } else {
-            k_sem_take(&touch_sem, K_FOREVER);
+            iteration++;
+            process_touch(last_tag, iteration);
         }
-
     }
 }
 
 static void touch_irq(void)
 {
+    touch_irq_cycles = k_cycle_get_32();
     k_sem_give(&touch_sem);
 }
 
-static void display_temps(const data_dispatcher_publish_t *(*meas)[DATA_LOC_NUM],
-                          const data_dispatcher_publish_t *(*settings)[DATA_LOC_NUM])
+#ifdef CONFIG_TEMP_HISTORY_SPARKLINE
+#define SPARKLINE_POINTS 64
+#define SPARKLINE_X      120
+#define SPARKLINE_Y      215
+#define SPARKLINE_W      340
+#define SPARKLINE_H      50
+#define SPARKLINE_MIN_RANGE 10 // 1 C
+
+static int16_t sparkline_meas[TEMPS_ZONES_PER_PAGE][SPARKLINE_POINTS];
+static size_t sparkline_num[TEMPS_ZONES_PER_PAGE];
+
+static void display_sparkline(int row)
+{
+    const int16_t *meas = sparkline_meas[row];
+    size_t num = sparkline_num[row];
+    int16_t min = INT16_MAX;
+    int16_t max = INT16_MIN;
+    int range;
+
+    for (size_t i = 0; i < num; ++i) {
+        if (meas[i] < TEMP_MIN) continue;
+
+        min = MIN(min, meas[i]);
+        max = MAX(max, meas[i]);
+    }
+
+    if (min > max) {
+        return;
+    }
+
+    // Do not magnify noise of a stable temperature
+    range = MAX(max - min, SPARKLINE_MIN_RANGE);
+    min   = (min + max - range) / 2;
+
+    copro_buf_cmd(COLOR_RGB(row == 0 ? 0x00 : 0xf0, 0xa0, row == 0 ? 0xf0 : 0x00));
+    copro_buf_cmd(LINE_WIDTH(1 * 16));
+    copro_buf_cmd(BEGIN(LINE_STRIP));
+
+    // Newest sample at the right edge, intervals without measurement are skipped
+    for (size_t i = 0; i < num; ++i) {
+        int x = SPARKLINE_X + SPARKLINE_W - (num - 1 - i) * SPARKLINE_W / (SPARKLINE_POINTS - 1);
+        int y = SPARKLINE_Y + SPARKLINE_H - (meas[i] - min) * SPARKLINE_H / range;
+
+        if (meas[i] < TEMP_MIN) continue;
+
+        copro_buf_cmd(VERTEX2F(x * 16, y * 16));
+    }
+
+    copro_buf_cmd(END());
+    copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+}
+#endif
+
+static bool zone_has_output(data_loc_t zone)
+{
+    return (zone == OUTPUT_RELAY_ZONE) || strlen(prov_get_output_label(zone));
+}
+
+static void temps_static(void)
+{
+    copro_buf_cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
+    copro_buf_cmd(CLEAR(1, 1, 1));
+    copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+
+    copro_buf_cmd(TAG(253));
+    copro_buf_text(2, 20, 29, 0, "Back");
+    copro_buf_cmd(TAG(0));
+}
+
+static void display_temps(data_dispatcher_publish_t (*meas)[DATA_LOC_NUM],
+                          data_dispatcher_publish_t (*settings)[DATA_LOC_NUM],
+                          uint8_t page)
 {
-    const char *out_lbl = prov_get_loc_output_label();
+    render_begin();
+
+    for (int row = 0; row < TEMPS_ZONES_PER_PAGE; ++row) {
+        data_loc_t i = page * TEMPS_ZONES_PER_PAGE + row;
+
+        if (i >= DATA_LOC_NUM) {
+            break;
+        }
+
+        const char *label = prov_get_rsrc_label(i);
+        bool has_output = zone_has_output(i);
+
+        render_add(label, strlen(label) + 1);
+        render_add(&(*meas)[i].temp_measurement, sizeof((*meas)[i].temp_measurement));
+        render_add(&has_output, sizeof(has_output));
+        if (has_output) {
+            render_add(&(*settings)[i].temp_setting, sizeof((*settings)[i].temp_setting));
+        }
+
+#ifdef CONFIG_TEMP_HISTORY_SPARKLINE
+        sparkline_num[row] = history_recent(i, sparkline_meas[row], SPARKLINE_POINTS);
+        render_add(&sparkline_num[row], sizeof(sparkline_num[row]));
+        render_add(sparkline_meas[row], sparkline_num[row] * sizeof(sparkline_meas[row][0]));
+#endif
+    }
+
+    if (!render_needed()) {
+        return;
+    }
 
     k_sem_take(&spi_sem, K_FOREVER);
 
-    cmd_dlstart();
-    cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
-    cmd(CLEAR(1, 1, 1));
-    cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+    copro_buf_dlstart();
+    fragment_emit(FRAGMENT_TEMPS);
 
-    for (int i = 0; i < DATA_LOC_NUM; ++i) {
+    for (int row = 0; row < TEMPS_ZONES_PER_PAGE; ++row) {
         const int str_length = 20;
         char text[str_length];
+        data_loc_t i = page * TEMPS_ZONES_PER_PAGE + row;
+
+        if (i >= DATA_LOC_NUM) {
+            break;
+        }
 
         // Measurement display
-        int16_t dC = (*meas)[i]->temp_measurement;
+        int16_t dC = (*meas)[i].temp_measurement;
         uint16_t x = 120;
-        uint16_t y = 120 + i * 40;
+        uint16_t y = 120 + row * 40;
+
+        copro_buf_text(20, y + 10, 27, 0, prov_get_rsrc_label(i));
 
         if (dC < TEMP_MIN) {
-            cmd_text(x, y, 29, 0, "Sensor error");
+            copro_buf_text(x, y, 29, 0, "Sensor error");
         } else {
             snprintf(text, str_length, "%d.%d", dC / 10, abs(dC % 10));
-            cmd_text(x, y, 31, 0, text);
+            copro_buf_text(x, y, 31, 0, text);
         }
 
-        if ((i == DATA_LOC_REMOTE) || (out_lbl && strlen(out_lbl))) {
+        if (zone_has_output(i)) {
             // Setting display
-            dC = (*settings)[i]->temp_setting;
+            dC = (*settings)[i].temp_setting;
             x = 370;
             snprintf(text, str_length, "%d.%d", dC / 10, abs(dC % 10));
-            cmd_text(x, y, 27, 0, text);
+            copro_buf_text(x, y, 27, 0, text);
 
             // Buttons
             x = 300;
-            y = 100 + i * 40;
-            cmd(TAG(1 + i * 2));
-            cmd_text(x, y, 31, 0, "+");
+            y = 100 + row * 40;
+            copro_buf_cmd(TAG(TEMPS_TAG_UP(i)));
+            copro_buf_text(x, y, 31, 0, "+");
 
             x = 340;
-            cmd(TAG(2 + i * 2));
-            cmd_text(x, y, 31, 0, "-");
+            copro_buf_cmd(TAG(TEMPS_TAG_DOWN(i)));
+            copro_buf_text(x, y, 31, 0, "-");
 
-            cmd(TAG(0));
+            copro_buf_cmd(TAG(0));
         }
+
+#ifdef CONFIG_TEMP_HISTORY_SPARKLINE
+        display_sparkline(row);
+#endif
     }
 
-    cmd(TAG(253));
-    cmd_text(2, 20, 29, 0, "Back");
+    // Zone labels are on the left, so page buttons are on the top
+    if (page > 0) {
+        copro_buf_cmd(TAG(252));
+        copro_buf_text(380, 20, 29, 0, "<<");
+    }
+    if (page < (TEMPS_NUM_PAGES - 1)) {
+        copro_buf_cmd(TAG(251));
+        copro_buf_text(478, 20, 29, OPT_RIGHTX, ">>");
+    }
+    copro_buf_cmd(TAG(0));
 
-    cmd(DISPLAY());
-    cmd_swap();
+    copro_buf_cmd(DISPLAY());
+    copro_buf_swap();
+    render_done();
 
     k_sem_give(&spi_sem);
 }
 
-static void draw_segment(int x, int y, int segment)
+static void clock_digit(int x, int y, int val)
 {
-    const int seg_len = CLOCK_LINE_LENGTH * 16;
-
-    const int x_offset = seg_len / 2;
-    const int y_offset = seg_len;
-
-    x *= 16;
-    y *= 16;
-
-    switch (segment) {
-        case 0:
-            cmd(VERTEX2F(x - x_offset, y - y_offset));
-            cmd(VERTEX2F(x + x_offset, y - y_offset));
-            break;
-
-        case 1:
-            cmd(VERTEX2F(x + x_offset, y - y_offset));
-            cmd(VERTEX2F(x + x_offset, y));
-            break;
-
-        case 2:
-            cmd(VERTEX2F(x + x_offset, y));
-            cmd(VERTEX2F(x + x_offset, y + y_offset));
-            break;
+    const struct ft8xx_asset *digits = &ft8xx_assets[ASSET_CLOCK_DIGITS];
 
-        case 3:
-            cmd(VERTEX2F(x - x_offset, y + y_offset));
-            cmd(VERTEX2F(x + x_offset, y + y_offset));
-            break;
-
-        case 4:
-            cmd(VERTEX2F(x - x_offset, y));
-            cmd(VERTEX2F(x - x_offset, y + y_offset));
-            break;
+    copro_buf_cmd(VERTEX2II(x - digits->width / 2, y - digits->height / 2,
+                            ASSET_HANDLE(ASSET_CLOCK_DIGITS), val));
+}
 
-        case 5:
-            cmd(VERTEX2F(x - x_offset, y - y_offset));
-            cmd(VERTEX2F(x - x_offset, y));
-            break;
+static void iface_cb(struct net_if *iface, void *user_data)
+{
+    bool *if_up = user_data;
 
-        case 6:
-            cmd(VERTEX2F(x - x_offset, y));
-            cmd(VERTEX2F(x + x_offset, y));
-            break;
+    if (net_if_is_up(iface)) {
+        *if_up = true;
     }
 }
 
-static void seven_segment_digit(int x, int y, int val)
+// Offset of the EU timezone of given UTC time, in hours
+static int tz_diff(int64_t now_s)
 {
-    switch (val) {
-        case 0:
-            draw_segment(x, y, 0);
-            draw_segment(x, y, 1);
-            draw_segment(x, y, 2);
-            draw_segment(x, y, 3);
-            draw_segment(x, y, 4);
-            draw_segment(x, y, 5);
-            break;
-
-        case 1:
-            draw_segment(x, y, 1);
-            draw_segment(x, y, 2);
-            break;
-
-        case 2:
-            draw_segment(x, y, 0);
-            draw_segment(x, y, 1);
-            draw_segment(x, y, 3);
-            draw_segment(x, y, 4);
-            draw_segment(x, y, 6);
-            break;
-
-        case 3:
-            draw_segment(x, y, 0);
-            draw_segment(x, y, 1);
-            draw_segment(x, y, 2);
-            draw_segment(x, y, 3);
-            draw_segment(x, y, 6);
-            break;
-
-        case 4:
-            draw_segment(x, y, 1);
-            draw_segment(x, y, 2);
-            draw_segment(x, y, 5);
-            draw_segment(x, y, 6);
-            break;
+    struct tm *now = gmtime(&now_s);
+
+    if (now->tm_mon > 2 && now->tm_mon < 9) {
+        // April to September
+        return 2;
+    } else if (now->tm_mon == 2 && (now->tm_mday - now->tm_wday) >= 25 && now->tm_wday != 0) {
+        // After last March Sunday
+        return 2;
+    } else if (now->tm_mon == 2 && (now->tm_mday - now->tm_wday) >= 25 && now->tm_wday == 0 &&
+            now->tm_hour >= 1) {
+        // Last March Sunday after 01:00 UTC
+        return 2;
+    } else if (now->tm_mon == 9 && (now->tm_mday - now->tm_wday) < 25) {
+        // Before last October Sunday
+        return 2;
+    } else if (now->tm_mon == 9 && (now->tm_mday - now->tm_wday) >= 25 && now->tm_wday == 0 &&
+            now->tm_hour < 1) {
+        // Last October Sunday before 01:00 UTC
+        return 2;
+    }
 
-        case 5:
-            draw_segment(x, y, 0);
-            draw_segment(x, y, 2);
-            draw_segment(x, y, 3);
-            draw_segment(x, y, 5);
-            draw_segment(x, y, 6);
-            break;
+    return 1;
+}
 
-        case 6:
-            draw_segment(x, y, 0);
-            draw_segment(x, y, 2);
-            draw_segment(x, y, 3);
-            draw_segment(x, y, 4);
-            draw_segment(x, y, 5);
-            draw_segment(x, y, 6);
-            break;
+static void clock_static(void)
+{
+    copro_buf_cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
+    copro_buf_cmd(CLEAR(1, 1, 1));
 
-        case 7:
-            draw_segment(x, y, 0);
-            draw_segment(x, y, 1);
-            draw_segment(x, y, 2);
-            break;
+    // Draw black rectangle to capture touch events
+    copro_buf_cmd(COLOR_RGB(0x00, 0x00, 0x00));
+    copro_buf_cmd(LINE_WIDTH(1 * 16));
+    copro_buf_cmd(BEGIN(RECTS));
+    copro_buf_cmd(VERTEX2II(0, 0, 0, 0));
+    copro_buf_cmd(VERTEX2II(480, 272, 0, 0));
+    copro_buf_cmd(END());
 
-        case 8:
-            draw_segment(x, y, 0);
-            draw_segment(x, y, 1);
-            draw_segment(x, y, 2);
-            draw_segment(x, y, 3);
-            draw_segment(x, y, 4);
-            draw_segment(x, y, 5);
-            draw_segment(x, y, 6);
-            break;
+    copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
 
-        case 9:
-            draw_segment(x, y, 0);
-            draw_segment(x, y, 1);
-            draw_segment(x, y, 2);
-            draw_segment(x, y, 3);
-            draw_segment(x, y, 5);
-            draw_segment(x, y, 6);
-            break;
+    if (asset_loaded[ASSET_CLOCK_DIGITS]) {
+        asset_setup(ASSET_CLOCK_DIGITS);
     }
 }
 
-static void iface_cb(struct net_if *iface, void *user_data)
+// Returns time in ms to the next refresh of the clock
+static uint32_t display_clock(void)
 {
-    bool *if_up = user_data;
+    struct {
+        bool    known;
+        uint8_t hour;
+        uint8_t min;
+    } state;
+    uint32_t refresh_ms = CLOCK_REFRESH_MS;
+    int64_t now_ms;
 
-    if (net_if_is_up(iface)) {
-        *if_up = true;
-    }
-}
+    memset(&state, 0, sizeof(state));
 
-static void display_clock(void)
-{
-    int r;
-    int64_t now_ms;
-    bool refresh_time = false;
+    if (date_time_now(&now_ms) == 0) {
+        int64_t now_s = now_ms / 1000;
+        int64_t local_s = now_s + tz_diff(now_s) * 3600;
 
-    k_sem_take(&spi_sem, K_FOREVER);
+        state.known = true;
+        state.hour  = (local_s / 3600) % 24;
+        state.min   = (local_s / 60) % 60;
 
-    wr8(REG_PWM_DUTY, CLOCK_BRIGHTNESS);
+        // Timezone offsets are full hours, so the local minute changes with the UTC one
+        refresh_ms = MINUTE_MS - now_ms % MINUTE_MS;
+    }
 
-    cmd_dlstart();
-    cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
-    cmd(CLEAR(1, 1, 1));
+    render_begin();
+    render_add(&state, sizeof(state));
 
-    // Draw black rectangle to capture touch events
-    cmd(COLOR_RGB(0x00, 0x00, 0x00));
-    cmd(LINE_WIDTH(1 * 16));
-    cmd(BEGIN(RECTS));
-    cmd(VERTEX2II(0, 0, 0, 0));
-    cmd(VERTEX2II(480, 272, 0, 0));
-    cmd(END());
+    if (render_needed()) {
+        k_sem_take(&spi_sem, K_FOREVER);
 
-    cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+        wr8(REG_PWM_DUTY, CLOCK_BRIGHTNESS);
 
-    r = date_time_now(&now_ms);
+        copro_buf_dlstart();
+        fragment_emit(FRAGMENT_CLOCK);
 
 #if DISPLAY_DEBUG
-    char debug_str[12];
-    snprintf(debug_str, sizeof(debug_str), "0x%08x", test);
-    cmd_text(470, 30, 29, OPT_RIGHTX, debug_str);
-    //cmd_number(470, 30, 29, OPT_RIGHTX, test);
+        char debug_str[12];
+        snprintf(debug_str, sizeof(debug_str), "0x%08x", test);
+        copro_buf_text(470, 30, 29, OPT_RIGHTX, debug_str);
+        //copro_buf_number(470, 30, 29, OPT_RIGHTX, test);
 #endif
 
-    if (r) {
-        cmd_text(240, 120, 29, OPT_CENTERX, "Unknown time");
-        refresh_time = true;
-    }
-    else {
-        int64_t now_s = now_ms / 1000;
-
-        // Handling EU timezone
-        int tz_diff = 1;
-        struct tm *now = gmtime(&now_s);
-        if (now->tm_mon > 2 && now->tm_mon < 9) {
-            // April to September
-            tz_diff = 2;
-        } else if (now->tm_mon == 2 && (now->tm_mday - now->tm_wday) >= 25 && now->tm_wday != 0) {
-            // After last March Sunday
-            tz_diff = 2;
-        } else if (now->tm_mon == 2 && (now->tm_mday - now->tm_wday) >= 25 && now->tm_wday == 0 &&
-                now->tm_hour >= 1) {
-            // Last March Sunday after 01:00 UTC
-            tz_diff = 2;
-        } else if (now->tm_mon == 9 && (now->tm_mday - now->tm_wday) < 25) {
-            // Before last October Sunday
-            tz_diff = 2;
-        } else if (now->tm_mon == 9 && (now->tm_mday - now->tm_wday) >= 25 && now->tm_wday == 0 &&
-                now->tm_hour < 1) {
-            // Last October Sunday before 01:00 UTC
-            tz_diff = 2;
+        if (!state.known) {
+            copro_buf_text(240, 120, 29, OPT_CENTERX, "Unknown time");
         }
+        else if (asset_loaded[ASSET_CLOCK_DIGITS]) {
+            int hour = state.hour;
+            int min  = state.min;
 
-        now_s += tz_diff * 3600;
-        now = gmtime(&now_s);
-
-        int hour = now->tm_hour;
-        int min  = now->tm_min;
+            copro_buf_cmd(BEGIN(BITMAPS));
 
-        cmd(LINE_WIDTH(CLOCK_LINE_WIDTH * 16));
-        cmd(BEGIN(LINES));
+            clock_digit(240 - CLOCK_NUMBER_SPACE / 2 - CLOCK_LINE_LENGTH / 2 -
+                    CLOCK_DIGIT_SPACE - CLOCK_LINE_LENGTH, 130, hour / 10);
+            clock_digit(240 - CLOCK_NUMBER_SPACE / 2 - CLOCK_LINE_LENGTH / 2, 130, hour % 10);
 
-        seven_segment_digit(240 - CLOCK_NUMBER_SPACE / 2 - CLOCK_LINE_LENGTH / 2 -
-                CLOCK_DIGIT_SPACE - CLOCK_LINE_LENGTH, 130, hour / 10);
-        seven_segment_digit(240 - CLOCK_NUMBER_SPACE / 2 - CLOCK_LINE_LENGTH / 2, 130, hour % 10);
+            clock_digit(240 + CLOCK_NUMBER_SPACE / 2 + CLOCK_LINE_LENGTH / 2, 130, min / 10);
+            clock_digit(240 + CLOCK_NUMBER_SPACE / 2 + CLOCK_LINE_LENGTH / 2 +
+                    CLOCK_DIGIT_SPACE + CLOCK_LINE_LENGTH, 130, min % 10);
 
-        seven_segment_digit(240 + CLOCK_NUMBER_SPACE / 2 + CLOCK_LINE_LENGTH / 2, 130, min / 10);
-        seven_segment_digit(240 + CLOCK_NUMBER_SPACE / 2 + CLOCK_LINE_LENGTH / 2 +
-                CLOCK_DIGIT_SPACE + CLOCK_LINE_LENGTH, 130, min % 10);
+            copro_buf_cmd(END());
+        }
+        else {
+            char time_str[6];
 
-        cmd(END());
-    }
+            snprintf(time_str, sizeof(time_str), "%02u:%02u", state.hour, state.min);
+            copro_buf_text(240, 130, 31, OPT_CENTER, time_str);
+        }
 
-    cmd(DISPLAY());
-    cmd_swap();
+        copro_buf_cmd(DISPLAY());
+        copro_buf_swap();
+        render_done();
 
-    k_sem_give(&spi_sem);
+        k_sem_give(&spi_sem);
+    }
 
-    if (refresh_time) {
+    if (!state.known) {
         bool if_up = false;
 
         net_if_foreach(iface_cb, &if_up);
@@ -982,11 +1521,27 @@ static void display_clock(void)
             date_time_update_async(NULL);
         }
     }
+
+    return refresh_ms;
 }
 
 #define VENT_NAME "ap"
 #define VENT_TYPE "airpack"
 
+static void menu_static(void)
+{
+    copro_buf_cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
+    copro_buf_cmd(CLEAR(1, 1, 1));
+    copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+
+    copro_buf_cmd(TAG(1));
+    copro_buf_text(20, 40, 29, 0, "Lights");
+    copro_buf_cmd(TAG(2));
+    copro_buf_text(260, 40, 29, 0, "Heat");
+    copro_buf_cmd(TAG(3));
+    copro_buf_text(20, 100, 29, 0, "Shades");
+}
+
 static void display_updated_menu(const data_dispatcher_publish_t *vent)
 {
      // TODO: Replace it with a callback from continuous_sd, that would publish VENT_SM_UNAVAILABLE
@@ -995,88 +1550,119 @@ static void display_updated_menu(const data_dispatcher_publish_t *vent)
     data_vent_sm_t vent_sm = vent->vent_mode;
     if (r) vent_sm = VENT_SM_UNAVAILABLE;
 
-    k_sem_take(&spi_sem, K_FOREVER);
+    render_begin();
+    render_add(&vent_sm, sizeof(vent_sm));
+
+    if (!render_needed()) {
+        return;
+    }
 
-    cmd_dlstart();
-    cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
-    cmd(CLEAR(1, 1, 1));
-    cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+    k_sem_take(&spi_sem, K_FOREVER);
 
-    cmd(TAG(1));
-    cmd_text(20, 40, 29, 0, "Lights");
-    cmd(TAG(2));
-    cmd_text(260, 40, 29, 0, "Heat");
-    cmd(TAG(3));
-    cmd_text(20, 100, 29, 0, "Shades");
+    copro_buf_dlstart();
+    fragment_emit(FRAGMENT_MENU);
 
     switch (vent_sm) {
         case VENT_SM_UNAVAILABLE:
-            cmd(COLOR_RGB(0x70, 0x70, 0x70));
-	    cmd(TAG(0));
-            cmd_text(20, 220, 29, 0, "Airing");
+            copro_buf_cmd(COLOR_RGB(0x70, 0x70, 0x70));
+	    copro_buf_cmd(TAG(0));
+            copro_buf_text(20, 220, 29, 0, "Airing");
             break;
 
         case VENT_SM_NONE:
-            cmd(TAG(5));
-            cmd_text(20, 220, 29, 0, "Airing");
-            cmd(TAG(0));
+            copro_buf_cmd(TAG(5));
+            copro_buf_text(20, 220, 29, 0, "Airing");
+            copro_buf_cmd(TAG(0));
             break;
 
         case VENT_SM_AIRING:
-            cmd(COLOR_RGB(0xf0, 0x00, 0x00));
-            cmd(TAG(5));
-            cmd_text(20, 220, 29, 0, "Airing");
-            cmd(TAG(0));
+            copro_buf_cmd(COLOR_RGB(0xf0, 0x00, 0x00));
+            copro_buf_cmd(TAG(5));
+            copro_buf_text(20, 220, 29, 0, "Airing");
+            copro_buf_cmd(TAG(0));
             break;
     }
 
-    cmd(DISPLAY());
-    cmd_swap();
+    copro_buf_cmd(DISPLAY());
+    copro_buf_swap();
+    render_done();
 
     k_sem_give(&spi_sem);
 }
 
 static void display_menu(void)
 {
-    const data_dispatcher_publish_t *vent;
+    data_dispatcher_publish_t vent;
 
     data_dispatcher_get(DATA_VENT_CURR, 0, &vent);
 
-    display_updated_menu(vent);
+    display_updated_menu(&vent);
 }
 
 
-static void display_menu_entry(int16_t x, int16_t y, uint8_t tag,
-	       	const char *label, const char *srv_name,
-		const char *srv_type)
+static const struct {
+    int16_t     x;
+    int16_t     y;
+    uint8_t     tag;
+    const char *label;
+    const char *srv_name;
+} light_menu_entries[] = {
+    { 20, 80, 1, "Bedroom: bed", "bbl" },
+    { 260, 80, 2, "Living room", "ll" },
+    { 20, 140, 3, "Bedroom: wardrobe", "bwl" },
+    { 260, 140, 4, "Dining room", "drl" },
+};
+
+static bool srv_available(const char *srv_name, const char *srv_type)
 {
     struct in6_addr in6_addr = {0};
-    int r = continuous_sd_get_addr(srv_name, srv_type, &in6_addr);
 
-    if (r) {
-        cmd(TAG(0));
-        cmd(COLOR_RGB(0x70, 0x70, 0x70));
+    return continuous_sd_get_addr(srv_name, srv_type, &in6_addr) == 0;
+}
+
+static void display_menu_entry(int16_t x, int16_t y, uint8_t tag,
+	       	const char *label, bool available)
+{
+    if (!available) {
+        copro_buf_cmd(TAG(0));
+        copro_buf_cmd(COLOR_RGB(0x70, 0x70, 0x70));
     } else {
-        cmd(TAG(tag));
-        cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+        copro_buf_cmd(TAG(tag));
+        copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
     }
 
-    cmd_text(x, y, 29, 0, label);
+    copro_buf_text(x, y, 29, 0, label);
 }
 
-static void display_light_menu_entry(int16_t x, int16_t y, uint8_t tag,
-	       	const char *label, const char *srv_name)
+static void lights_menu_static(void)
 {
-	display_menu_entry(x, y, tag, label, srv_name, LIGHT_TYPE);
+    copro_buf_cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
+    copro_buf_cmd(CLEAR(1, 1, 1));
+
+    copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+    copro_buf_cmd(TAG(253));
+    copro_buf_text(2, 20, 29, 0, "Back");
 }
 
 static void display_lights_menu(void)
 {
+    bool available[ARRAY_SIZE(light_menu_entries)];
+
+    for (int i = 0; i < ARRAY_SIZE(light_menu_entries); i++) {
+        available[i] = srv_available(light_menu_entries[i].srv_name, LIGHT_TYPE);
+    }
+
+    render_begin();
+    render_add(available, sizeof(available));
+
+    if (!render_needed()) {
+        return;
+    }
+
     k_sem_take(&spi_sem, K_FOREVER);
 
-    cmd_dlstart();
-    cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
-    cmd(CLEAR(1, 1, 1));
+    copro_buf_dlstart();
+    fragment_emit(FRAGMENT_LIGHTS_MENU);
 
 #if 0
     static char addr[LIGHT_CONN_ITEM_NUM][64];
@@ -1089,30 +1675,46 @@ static void display_lights_menu(void)
 		     in6_addr.s6_addr[8], in6_addr.s6_addr[9], in6_addr.s6_addr[10], in6_addr.s6_addr[11],
 		     in6_addr.s6_addr[12], in6_addr.s6_addr[13], in6_addr.s6_addr[14], in6_addr.s6_addr[15]);
     }
-    cmd_text(20, 110, 27, 0, addr[0]);
-    cmd_text(20, 170, 27, 0, addr[1]);
-    cmd_text(20, 200, 27, 0, addr[2]);
-    cmd_text(20, 220, 27, 0, addr[3]);
+    copro_buf_text(20, 110, 27, 0, addr[0]);
+    copro_buf_text(20, 170, 27, 0, addr[1]);
+    copro_buf_text(20, 200, 27, 0, addr[2]);
+    copro_buf_text(20, 220, 27, 0, addr[3]);
 #endif
 
-    display_light_menu_entry(20, 80, 1, "Bedroom: bed", "bbl");
-    display_light_menu_entry(260, 80, 2, "Living room", "ll");
-    display_light_menu_entry(20, 140, 3, "Bedroom: wardrobe", "bwl");
-    display_light_menu_entry(260, 140, 4, "Dining room", "drl");
-
-    cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
-    cmd(TAG(253));
-    cmd_text(2, 20, 29, 0, "Back");
+    for (int i = 0; i < ARRAY_SIZE(light_menu_entries); i++) {
+        display_menu_entry(light_menu_entries[i].x, light_menu_entries[i].y,
+                           light_menu_entries[i].tag, light_menu_entries[i].label, available[i]);
+    }
 
-    cmd(DISPLAY());
-    cmd_swap();
+    copro_buf_cmd(DISPLAY());
+    copro_buf_swap();
+    render_done();
 
     k_sem_give(&spi_sem);
 }
 
+#define LIGHT_CHANNELS 4
+#define LIGHT_CHANNEL_X(i) (480 / LIGHT_CHANNELS * (2 * (i) + 1) / 2)
+
+static void light_control_static(void)
+{
+    const char *labels[LIGHT_CHANNELS] = { "R", "G", "B", "W" };
+
+    copro_buf_cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
+    copro_buf_cmd(CLEAR(1, 1, 1));
+
+    copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+    copro_buf_cmd(TAG(0));
+    for (int i = 0; i < LIGHT_CHANNELS; i++) {
+        copro_buf_text(LIGHT_CHANNEL_X(i), 60, 29, OPT_CENTER, labels[i]);
+    }
+
+    copro_buf_cmd(TAG(253));
+    copro_buf_text(2, 20, 29, 0, "Back");
+}
+
 static void update_light_control(const data_light_t *light)
 {
-    const char *labels[4] = { "R", "G", "B", "W" };
     bool on = light->r > 0 || light->g > 0 || light->b > 0 || light->w > 0;
     uint8_t vals[] = {
 	    light->r,
@@ -1121,39 +1723,41 @@ static void update_light_control(const data_light_t *light)
 	    light->w,
     };
 
+    render_begin();
+    render_add(light, sizeof(*light));
+
+    if (!render_needed()) {
+        return;
+    }
+
     k_sem_take(&spi_sem, K_FOREVER);
 
-    cmd_dlstart();
-    cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
-    cmd(CLEAR(1, 1, 1));
+    copro_buf_dlstart();
+    fragment_emit(FRAGMENT_LIGHT_CONTROL);
 
-    cmd_bgcolor(0xf0f0f0);
-    cmd_fgcolor(0x808080);
+    copro_buf_bgcolor(0xf0f0f0);
+    copro_buf_fgcolor(0x808080);
 
-    for (int i = 0; i < sizeof(labels) / sizeof(labels[0]); i++) {
-        int x = 480 / 4 * (2 * i + 1) / 2;
+    for (int i = 0; i < LIGHT_CHANNELS; i++) {
+        int x = LIGHT_CHANNEL_X(i);
 
-        cmd_track(x-20, 80, 40, 120, i+1);
+        copro_buf_track(x-20, 80, 40, 120, i+1);
 
-        cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
-        cmd(TAG(0));
-        cmd_text(x, 60, 29, OPT_CENTER, labels[i]);
-        cmd_number(x, 240, 29, OPT_CENTER, vals[i]);
+        copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+        copro_buf_cmd(TAG(0));
+        copro_buf_number(x, 240, 29, OPT_CENTER, vals[i]);
 
-        cmd(COLOR_RGB(0x40, 0x40, 0x40));
-        cmd(TAG(i+1));
-        cmd_slider(x - 6, 90, 12, 120, OPT_FLAT, 255 - vals[i], 255);
+        copro_buf_cmd(COLOR_RGB(0x40, 0x40, 0x40));
+        copro_buf_cmd(TAG(i+1));
+        copro_buf_slider(x - 6, 90, 12, 120, OPT_FLAT, 255 - vals[i], 255);
     }
 
-    cmd(TAG(10));
-    cmd_toggle(220, 20, 40, 27, OPT_FLAT, on ? 65535:0, "off" "\xff" "on");
+    copro_buf_cmd(TAG(10));
+    copro_buf_toggle(220, 20, 40, 27, OPT_FLAT, on ? 65535:0, "off" "\xff" "on");
 
-    cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
-    cmd(TAG(253));
-    cmd_text(2, 20, 29, 0, "Back");
-
-    cmd(DISPLAY());
-    cmd_swap();
+    copro_buf_cmd(DISPLAY());
+    copro_buf_swap();
+    render_done();
 
     k_sem_give(&spi_sem);
 }
@@ -1161,10 +1765,20 @@ static void update_light_control(const data_light_t *light)
 static void display_light_control(void)
 {
 	// TODO: loading display until get a new value?
-    const data_dispatcher_publish_t *p_data;
-    data_dispatcher_get(DATA_LIGHT_CURR, 0, &p_data);
+    data_dispatcher_publish_t data;
+    data_dispatcher_get(DATA_LIGHT_CURR, 0, &data);
+
+    update_light_control(&data.light);
+}
+
+static void shade_control_static(void)
+{
+    copro_buf_cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
+    copro_buf_cmd(CLEAR(1, 1, 1));
 
-    update_light_control(&p_data->light);
+    copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+    copro_buf_cmd(TAG(253));
+    copro_buf_text(2, 20, 29, 0, "Back");
 }
 
 static void update_shade_control(const data_shades_curr_t *shade, uint8_t page)
@@ -1174,14 +1788,39 @@ static void update_shade_control(const data_shades_curr_t *shade, uint8_t page)
 
     const char *labels[DATA_SHADE_ID_NUM] = { "Dining L", "Dining C", "Dining R", "Kitchen", "Living", "Bedroom" };
 
+    bool available[SHADES_PER_PAGE];
+
+    render_begin();
+
+    for (int i = 0; i < SHADES_PER_PAGE; i++) {
+        int item = page * SHADES_PER_PAGE + i;
+
+        if (item >= DATA_SHADE_ID_NUM) {
+            available[i] = false;
+            continue;
+        }
+
+        // Address found and value retrieved
+        available[i] = srv_available(shades_conn_ids[item], SHADES_TYPE) &&
+                       shade->values[item] != DATA_SHADES_VAL_UNKNOWN;
+
+        render_add(&available[i], sizeof(available[i]));
+        if (available[i]) {
+            render_add(&shade->values[item], sizeof(shade->values[item]));
+        }
+    }
+
+    if (!render_needed()) {
+        return;
+    }
+
     k_sem_take(&spi_sem, K_FOREVER);
 
-    cmd_dlstart();
-    cmd(CLEAR_COLOR_RGB(0x00, 0x00, 0x00));
-    cmd(CLEAR(1, 1, 1));
+    copro_buf_dlstart();
+    fragment_emit(FRAGMENT_SHADE_CONTROL);
 
-    cmd_bgcolor(0xf0f0f0);
-    cmd_fgcolor(0x808080);
+    copro_buf_bgcolor(0xf0f0f0);
+    copro_buf_fgcolor(0x808080);
 
     int x = 480 / SHADES_PER_PAGE / 2;
 
@@ -1192,62 +1831,58 @@ static void update_shade_control(const data_shades_curr_t *shade, uint8_t page)
             break;
         }
 
-        struct in6_addr in6_addr = {0};
-        int r = continuous_sd_get_addr(shades_conn_ids[item], SHADES_TYPE, &in6_addr);
-
-        if (r || shade->values[item] == DATA_SHADES_VAL_UNKNOWN) {
+        if (!available[i]) {
             // Address not found or value not retrieved yet
-            cmd(COLOR_RGB(0x70, 0x70, 0x70));
-            cmd(TAG(0));
-            cmd_text(x + 20, 90, 26, 0, labels[item]);
+            copro_buf_cmd(COLOR_RGB(0x70, 0x70, 0x70));
+            copro_buf_cmd(TAG(0));
+            copro_buf_text(x + 20, 90, 26, 0, labels[item]);
         } else {
             uint16_t value = shade->values[item];
             bool top = value == 0;
             bool bottom = value == 255;
 
-            cmd_track(x-20, 80, 40, 120, 1 + item);
+            copro_buf_track(x-20, 80, 40, 120, 1 + item);
 
-            cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
-            cmd(TAG(0));
-            cmd_number(x + 20, 150, 29, 0, value);
-            cmd_text(x + 20, 90, 26, 0, labels[item]);
+            copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
+            copro_buf_cmd(TAG(0));
+            copro_buf_number(x + 20, 150, 29, 0, value);
+            copro_buf_text(x + 20, 90, 26, 0, labels[item]);
 
-            cmd(COLOR_RGB(0x40, 0x40, 0x40));
-            cmd(TAG(1 + item));
-            cmd_slider(x - 6, 90, 12, 120, OPT_FLAT, value, 255);
+            copro_buf_cmd(COLOR_RGB(0x40, 0x40, 0x40));
+            copro_buf_cmd(TAG(1 + item));
+            copro_buf_slider(x - 6, 90, 12, 120, OPT_FLAT, value, 255);
 
-            cmd(TAG(11 + item));
-            cmd_toggle(x + 10, 40, 40, 27, OPT_FLAT, top ? 65535:0, "top" "\xff" "top");
+            copro_buf_cmd(TAG(11 + item));
+            copro_buf_toggle(x + 10, 40, 40, 27, OPT_FLAT, top ? 65535:0, "top" "\xff" "top");
 
-            cmd(TAG(21 + item));
-            cmd_toggle(x + 10, 240, 40, 27, OPT_FLAT, bottom ? 65535:0, "btm" "\xff" "btm");
+            copro_buf_cmd(TAG(21 + item));
+            copro_buf_toggle(x + 10, 240, 40, 27, OPT_FLAT, bottom ? 65535:0, "btm" "\xff" "btm");
         }
 
         x += (480 / SHADES_PER_PAGE);
     }
 
-    cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
-    cmd(TAG(253));
-    cmd_text(2, 20, 29, 0, "Back");
+    copro_buf_cmd(COLOR_RGB(0xf0, 0xf0, 0xf0));
 
     if (page > 0) {
-        cmd(TAG(252));
-        cmd_text(2, 120, 29, 0, "<<");
+        copro_buf_cmd(TAG(252));
+        copro_buf_text(2, 120, 29, 0, "<<");
     }
     if (page < (NUM_PAGES - 1)) {
-        cmd(TAG(251));
-        cmd_text(478, 120, 29, OPT_RIGHTX, ">>");
+        copro_buf_cmd(TAG(251));
+        copro_buf_text(478, 120, 29, OPT_RIGHTX, ">>");
     }
 
     #if DISPLAY_DEBUG
         char debug_str[12];
         snprintf(debug_str, sizeof(debug_str), "0x%08x", test);
-        cmd_text(470, 30, 29, OPT_RIGHTX, debug_str);
-        //cmd_number(470, 30, 29, OPT_RIGHTX, test);
+        copro_buf_text(470, 30, 29, OPT_RIGHTX, debug_str);
+        //copro_buf_number(470, 30, 29, OPT_RIGHTX, test);
     #endif
 
-    cmd(DISPLAY());
-    cmd_swap();
+    copro_buf_cmd(DISPLAY());
+    copro_buf_swap();
+    render_done();
 
     k_sem_give(&spi_sem);
 }
@@ -1255,23 +1890,23 @@ static void update_shade_control(const data_shades_curr_t *shade, uint8_t page)
 static void display_shade_control(uint8_t page)
 {
 	// TODO: loading display until get a new value?
-    const data_dispatcher_publish_t *p_data;
-    data_dispatcher_get(DATA_SHADES_CURR, 0, &p_data);
+    data_dispatcher_publish_t data;
+    data_dispatcher_get(DATA_SHADES_CURR, 0, &data);
 
-    update_shade_control(&p_data->shades_curr, page);
+    update_shade_control(&data.shades_curr, page);
 }
 
 static void display_curr_temps(void)
 {
-    const data_dispatcher_publish_t *meas[DATA_LOC_NUM];
-    const data_dispatcher_publish_t *setting[DATA_LOC_NUM];
+    data_dispatcher_publish_t meas[DATA_LOC_NUM];
+    data_dispatcher_publish_t setting[DATA_LOC_NUM];
 
     for (int i = 0; i < DATA_LOC_NUM; ++i) {
         data_dispatcher_get(DATA_TEMP_MEASUREMENT, i, &meas[i]);
         data_dispatcher_get(DATA_TEMP_SETTING, i, &setting[i]);
     }
 
-    display_temps(&meas, &setting);
+    display_temps(&meas, &setting, curr_page);
 }
 
 static void temp_changed(const data_dispatcher_publish_t *data)
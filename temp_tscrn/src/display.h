@@ -12,16 +12,59 @@
 #ifndef DISPLAY_H_
 #define DISPLAY_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct {
+    uint32_t redraws_per_min;  // Frames sent to the display
+    uint32_t skipped_per_min;  // Refreshes without visible change, not sent to the display
+    uint32_t cmd_bytes_per_s;  // Bytes written to the co-processor FIFO (RAM_CMD)
+    uint32_t build_us_avg;     // Time from the start of a frame until it is written to RAM_CMD
+    uint32_t build_us_max;
+} display_stats_t;
+
+// Counters of a screen since boot
+typedef struct {
+    uint32_t frames;         // Frames sent to the display
+    uint64_t build_us;       // Sum of times from the start of a frame until it is in RAM_CMD
+    uint32_t build_us_max;
+    uint64_t cmd_bytes;      // Bytes written to RAM_CMD
+    uint64_t copro_wait_us;  // Time spent waiting for free space in RAM_CMD
+    uint32_t touches;        // Touches followed by a frame
+    uint64_t touch_us;       // Sum of times from the touch interrupt to the swap of the frame
+    uint32_t touch_us_max;
+} display_screen_stats_t;
+
 void display_init(void);
 
 void display_debug(int32_t value);
 
+/**
+ * @brief Get display refresh statistics
+ *
+ * Rates are averaged over the last completed window of at least a minute.
+ */
+void display_stats_get(display_stats_t *stats);
+
+/**
+ * @brief Get number of screens with statistics
+ */
+size_t display_screens_num(void);
+
+/**
+ * @brief Get statistics of a screen
+ *
+ * @param screen Index of the screen, lower than display_screens_num()
+ * @param stats  Counters of the screen
+ *
+ * @return Name of the screen, NULL if the index is out of range
+ */
+const char *display_screen_stats_get(size_t screen, display_screen_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,502 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "history.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <coap_server.h>
+#include <date_time.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#define MAX_COAP_MSG_LEN 256
+
+#define BLOCK_SZX_MAX 2 // 64 B
+#define BLOCK_SIZE(szx) (16U << (szx))
+
+#define BLOCK2_NUM(opt) ((uint32_t)(opt) >> 4)
+#define BLOCK2_MORE_BIT 0x08
+#define BLOCK2_SZX(opt) ((opt) & 0x07)
+#define BLOCK2_OPT(num, szx) (((num) << 4) | (szx))
+
+#define COAP_CONTENT_FORMAT_OCTET_STREAM 42
+#define MAX_QUERY_NUM 2
+
+#define HIST_VERSION    1
+#define HIST_BLOCK_SIZE 256
+#define HIST_BLOCKS     CONFIG_TEMP_HISTORY_BLOCKS
+#define HIST_INTERVAL   CONFIG_TEMP_HISTORY_INTERVAL
+
+#define HDR_VERSION  0
+#define HDR_NUM_LOC  1
+#define HDR_INTERVAL 2
+#define HDR_SEQ      4
+#define HDR_TIME     8
+#define HDR_LOC      12
+#define HDR_LOC_LEN  5
+#define HDR_LEN      (HDR_LOC + DATA_LOC_NUM * HDR_LOC_LEN)
+
+// Time difference up to 5 B, temperature differences up to 3 B, output difference up to 2 B
+#define RECORD_MAX_LEN (5 + DATA_LOC_NUM * (3 + 3 + 2))
+#define BLOCK_END      0
+
+BUILD_ASSERT(HDR_LEN + RECORD_MAX_LEN + 1 <= HIST_BLOCK_SIZE, "History block too small");
+
+struct sample {
+    int16_t meas;
+    int16_t sett;
+    uint8_t out;
+};
+
+static uint8_t ring[HIST_BLOCKS][HIST_BLOCK_SIZE];
+static uint16_t used[HIST_BLOCKS];    // Bytes written to each block
+static uint8_t  records[HIST_BLOCKS]; // Records in each block, including the keyframe
+static size_t   head;                 // Newest block
+static size_t   num_blocks;
+static uint32_t next_seq;
+
+// Last recorded sample, base of the next difference
+static uint32_t      last_time;
+static struct sample last[DATA_LOC_NUM];
+
+K_MUTEX_DEFINE(hist_mutex);
+
+// Accessed only from the dispatcher work queue
+static int32_t  meas_sum[DATA_LOC_NUM];
+static uint16_t meas_cnt[DATA_LOC_NUM];
+
+static void sample_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sample_work, sample_work_handler);
+
+static void changed_temperature(const data_dispatcher_publish_t *data);
+
+static uint8_t temp_meas_buf[DATA_DISPATCHER_BUF_SIZE(int16_t, DATA_LOC_NUM, 1, 0)];
+static data_dispatcher_subscribe_t sbscr_temp_meas = {
+    .callback = changed_temperature,
+    .work_q   = &data_dispatcher_work_q,
+    .buf      = temp_meas_buf,
+    .buf_size = sizeof(temp_meas_buf),
+};
+
+static size_t block_idx(size_t age_order)
+{
+    return (head + HIST_BLOCKS + 1 - num_blocks + age_order) % HIST_BLOCKS;
+}
+
+static uint32_t block_time(size_t idx)
+{
+    return sys_get_le32(&ring[idx][HDR_TIME]);
+}
+
+static size_t put_varint(uint8_t *buf, uint32_t val)
+{
+    size_t len = 0;
+
+    do {
+        buf[len] = val & 0x7f;
+        val >>= 7;
+        if (val) buf[len] |= 0x80;
+        len++;
+    } while (val);
+
+    return len;
+}
+
+static size_t get_varint(const uint8_t *buf, size_t len, uint32_t *val)
+{
+    *val = 0;
+
+    for (size_t i = 0; (i < len) && (i < 5); ++i) {
+        *val |= (uint32_t)(buf[i] & 0x7f) << (7 * i);
+        if (!(buf[i] & 0x80)) return i + 1;
+    }
+
+    return 0;
+}
+
+static uint32_t zigzag(int32_t val)
+{
+    return ((uint32_t)val << 1) ^ (uint32_t)(val >> 31);
+}
+
+static int32_t unzigzag(uint32_t val)
+{
+    return (int32_t)(val >> 1) ^ -(int32_t)(val & 1);
+}
+
+static void block_start(uint32_t now, const struct sample *samples)
+{
+    uint8_t *block;
+
+    if (num_blocks) {
+        ring[head][used[head]++] = BLOCK_END;
+        head = (head + 1) % HIST_BLOCKS;
+    }
+    num_blocks = MIN(num_blocks + 1, HIST_BLOCKS);
+
+    block = ring[head];
+    memset(block, 0, HIST_BLOCK_SIZE);
+    block[HDR_VERSION] = HIST_VERSION;
+    block[HDR_NUM_LOC] = DATA_LOC_NUM;
+    sys_put_le16(HIST_INTERVAL, &block[HDR_INTERVAL]);
+    sys_put_le32(next_seq++, &block[HDR_SEQ]);
+    sys_put_le32(now, &block[HDR_TIME]);
+
+    for (int i = 0; i < DATA_LOC_NUM; ++i) {
+        uint8_t *loc_hdr = &block[HDR_LOC + i * HDR_LOC_LEN];
+
+        sys_put_le16(samples[i].meas, &loc_hdr[0]);
+        sys_put_le16(samples[i].sett, &loc_hdr[2]);
+        loc_hdr[4] = samples[i].out;
+    }
+
+    used[head]    = HDR_LEN;
+    records[head] = 1;
+}
+
+static void history_append(uint32_t now, const struct sample *samples)
+{
+    uint32_t dt;
+
+    k_mutex_lock(&hist_mutex, K_FOREVER);
+
+    // Start a new block also when the wall clock was set back
+    if (!num_blocks || (now < last_time) ||
+            (used[head] + RECORD_MAX_LEN + 1 > HIST_BLOCK_SIZE) || (records[head] == UINT8_MAX)) {
+        block_start(now, samples);
+        last_time = now;
+    } else {
+        uint8_t *rec = &ring[head][used[head]];
+        size_t len;
+
+        dt = MAX((now - last_time + HIST_INTERVAL / 2) / HIST_INTERVAL, 1);
+        len = put_varint(rec, dt);
+
+        for (int i = 0; i < DATA_LOC_NUM; ++i) {
+            len += put_varint(&rec[len], zigzag(samples[i].meas - last[i].meas));
+            len += put_varint(&rec[len], zigzag(samples[i].sett - last[i].sett));
+            len += put_varint(&rec[len], zigzag(samples[i].out - last[i].out));
+        }
+
+        used[head] += len;
+        records[head]++;
+        // Quantized, so the stored time does not drift from the decoded one
+        last_time += dt * HIST_INTERVAL;
+    }
+
+    memcpy(last, samples, sizeof(last));
+
+    k_mutex_unlock(&hist_mutex);
+}
+
+static void sample_work_handler(struct k_work *work)
+{
+    struct sample samples[DATA_LOC_NUM];
+    int64_t now_ms;
+    int r;
+
+    k_work_schedule_for_queue(&data_dispatcher_work_q, &sample_work, K_SECONDS(HIST_INTERVAL));
+
+    for (int i = 0; i < DATA_LOC_NUM; ++i) {
+        data_dispatcher_publish_t sett_data;
+        data_dispatcher_publish_t out_data;
+
+        data_dispatcher_get(DATA_TEMP_SETTING, i, &sett_data);
+        data_dispatcher_get(DATA_OUTPUT, i, &out_data);
+
+        samples[i].meas = meas_cnt[i] ? meas_sum[i] / meas_cnt[i] : HISTORY_TEMP_INVALID;
+        samples[i].sett = sett_data.temp_setting;
+        samples[i].out  = out_data.output ? MAX(out_data.output >> 8, 1) : 0;
+
+        meas_sum[i] = 0;
+        meas_cnt[i] = 0;
+    }
+
+    r = date_time_now(&now_ms);
+    if (r) {
+        // Samples without time are useless
+        return;
+    }
+
+    history_append((uint32_t)(now_ms / 1000), samples);
+}
+
+static void changed_temperature(const data_dispatcher_publish_t *data)
+{
+    if (data->temp_measurement < TEMP_MIN) {
+        return;
+    }
+
+    meas_sum[data->loc] += data->temp_measurement;
+    meas_cnt[data->loc]++;
+}
+
+void history_init(void)
+{
+    data_dispatcher_subscribe(DATA_TEMP_MEASUREMENT, &sbscr_temp_meas);
+    k_work_schedule_for_queue(&data_dispatcher_work_q, &sample_work, K_SECONDS(HIST_INTERVAL));
+}
+
+size_t history_recent(data_loc_t loc, int16_t *meas, size_t max)
+{
+    size_t first = 0;
+    size_t total = 0;
+    size_t num = 0;
+
+    if (!max) return 0;
+
+    k_mutex_lock(&hist_mutex, K_FOREVER);
+
+    // Find the oldest block needed to collect max records
+    for (size_t i = num_blocks; i > 0; --i) {
+        first = i - 1;
+        total += records[block_idx(first)];
+        if (total >= max) break;
+    }
+
+    for (size_t b = first; b < num_blocks; ++b) {
+        const uint8_t *block = ring[block_idx(b)];
+        size_t len = used[block_idx(b)];
+        size_t pos = HDR_LEN;
+        int32_t val = (int16_t)sys_get_le16(&block[HDR_LOC + loc * HDR_LOC_LEN]);
+
+        while (true) {
+            // Keep the newest max values, the oldest one is overwritten
+            if (num == max) {
+                memmove(meas, meas + 1, (max - 1) * sizeof(*meas));
+                num--;
+            }
+            meas[num++] = (int16_t)val;
+
+            if ((pos >= len) || (block[pos] == BLOCK_END)) break;
+
+            // Time difference is not needed
+            uint32_t field;
+            size_t field_len = get_varint(&block[pos], len - pos, &field);
+
+            if (!field_len) break;
+            pos += field_len;
+
+            for (int i = 0; i < DATA_LOC_NUM * 3; ++i) {
+                field_len = get_varint(&block[pos], len - pos, &field);
+                if (!field_len) break;
+                pos += field_len;
+
+                if (i == (int)loc * 3) {
+                    val += unzigzag(field);
+                }
+            }
+        }
+    }
+
+    k_mutex_unlock(&hist_mutex);
+
+    return num;
+}
+
+static int parse_query(struct coap_packet *request, uint32_t *from, uint32_t *to)
+{
+    struct coap_option options[MAX_QUERY_NUM];
+    int r;
+
+    *from = 0;
+    *to   = UINT32_MAX;
+
+    r = coap_find_options(request, COAP_OPTION_URI_QUERY, options, MAX_QUERY_NUM);
+    if (r < 0) return r;
+
+    for (int i = 0; i < r; ++i) {
+        char value[sizeof(options[i].value) + 1];
+        char *end;
+        uint32_t *dst;
+
+        if ((options[i].len < 3) || (options[i].value[1] != '=')) return -EINVAL;
+
+        if (options[i].value[0] == 'f') {
+            dst = from;
+        } else if (options[i].value[0] == 't') {
+            dst = to;
+        } else {
+            return -EINVAL;
+        }
+
+        memcpy(value, &options[i].value[2], options[i].len - 2);
+        value[options[i].len - 2] = '\0';
+
+        *dst = strtoul(value, &end, 10);
+        if (*end != '\0') return -EINVAL;
+    }
+
+    return 0;
+}
+
+// Select blocks overlapping the range. Returns number of the blocks, the first one in first.
+static size_t select_blocks(uint32_t from, uint32_t to, size_t *first)
+{
+    size_t num = 0;
+
+    for (size_t b = 0; b < num_blocks; ++b) {
+        uint32_t start = block_time(block_idx(b));
+        bool ends_before = (b + 1 < num_blocks) && (block_time(block_idx(b + 1)) <= from);
+
+        if (ends_before || (start > to)) {
+            if (num) break;
+            continue;
+        }
+
+        if (!num) *first = b;
+        num++;
+    }
+
+    return num;
+}
+
+int history_coap_get(struct coap_resource *resource,
+             struct coap_packet *request,
+             struct sockaddr *addr, socklen_t addr_len)
+{
+    int sock = *(int*)resource->user_data;
+    struct coap_packet response;
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    uint8_t payload[BLOCK_SIZE(BLOCK_SZX_MAX)];
+    uint8_t etag[8];
+    uint8_t *data;
+    uint16_t id;
+    uint8_t type;
+    uint8_t tkl;
+    uint32_t from;
+    uint32_t to;
+    uint32_t num = 0;
+    uint8_t szx = BLOCK_SZX_MAX;
+    size_t offset;
+    size_t first = 0;
+    size_t size = 0;
+    size_t len = 0;
+    bool more;
+    int block2;
+    int r;
+
+    type = coap_header_get_type(request);
+    id = coap_header_get_id(request);
+    tkl = coap_header_get_token(request, token);
+
+    if (type != COAP_TYPE_CON) {
+        return -EINVAL;
+    }
+
+    r = parse_query(request, &from, &to);
+    if (r < 0) {
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_REQUEST, token, tkl);
+        return r;
+    }
+
+    block2 = coap_get_option_int(request, COAP_OPTION_BLOCK2);
+    if (block2 >= 0) {
+        num = BLOCK2_NUM(block2);
+        // Larger blocks would be fragmented
+        szx = MIN(BLOCK2_SZX(block2), BLOCK_SZX_MAX);
+    }
+
+    offset = num * BLOCK_SIZE(szx);
+
+    k_mutex_lock(&hist_mutex, K_FOREVER);
+    size_t num_sel = select_blocks(from, to, &first);
+
+    if (num_sel) {
+        size_t pos = offset;
+        size_t last = block_idx(first + num_sel - 1);
+
+        // Sequence numbers of the blocks are consecutive, so the first one and the number of
+        // blocks identify them. Only the last block can grow
+        sys_put_le32(sys_get_le32(&ring[block_idx(first)][HDR_SEQ]), &etag[0]);
+        sys_put_le16(num_sel, &etag[4]);
+        sys_put_le16(used[last], &etag[6]);
+
+        for (size_t b = first; b < first + num_sel; ++b) {
+            size_t idx = block_idx(b);
+
+            size += used[idx];
+
+            // Copy the part of the requested block stored in this history block
+            if (pos >= used[idx]) {
+                pos -= used[idx];
+            } else if (len < BLOCK_SIZE(szx)) {
+                size_t chunk = MIN(used[idx] - pos, BLOCK_SIZE(szx) - len);
+
+                memcpy(&payload[len], &ring[idx][pos], chunk);
+                len += chunk;
+                pos = 0;
+            }
+        }
+    }
+    k_mutex_unlock(&hist_mutex);
+
+    if (!num_sel) {
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_NOT_FOUND, token, tkl);
+        return -ENOENT;
+    } else if (offset >= size) {
+        coap_server_send_ack(sock, addr, addr_len, id, COAP_RESPONSE_CODE_BAD_OPTION, token, tkl);
+        return -EINVAL;
+    }
+
+    more = (offset + len) < size;
+
+    data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
+    if (!data) {
+        return -ENOMEM;
+    }
+
+    r = coap_packet_init(&response, data, MAX_COAP_MSG_LEN,
+                 1, COAP_TYPE_ACK, tkl, token,
+                 COAP_RESPONSE_CODE_CONTENT, id);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_packet_append_option(&response, COAP_OPTION_ETAG, etag, sizeof(etag));
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT,
+            COAP_CONTENT_FORMAT_OCTET_STREAM);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_append_option_int(&response, COAP_OPTION_BLOCK2,
+            BLOCK2_OPT(num, szx) | (more ? BLOCK2_MORE_BIT : 0));
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_append_option_int(&response, COAP_OPTION_SIZE2, size);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_packet_append_payload_marker(&response);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_packet_append_payload(&response, payload, len);
+    if (r < 0) {
+        goto end;
+    }
+
+    r = coap_server_send_coap_reply(sock, &response, addr, addr_len);
+
+end:
+    k_free(data);
+
+    return r;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2024 Hubert Miś
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Temperature history
+ *
+ * Measurement averaged over CONFIG_TEMP_HISTORY_INTERVAL seconds, setting and output of every
+ * location are stored in a RAM ring of CONFIG_TEMP_HISTORY_BLOCKS blocks of 256 B. The oldest
+ * block is overwritten when the ring is full. Samples are recorded only when the wall clock time
+ * is known.
+ *
+ * Block format (little-endian), see also scripts/temp_history.py:
+ *  - header: version u8, number of locations u8, interval in seconds u16, sequence number u32,
+ *            unix time of the first record u32,
+ *            per location: measurement i16, setting i16, output u8
+ *  - records: time since the previous record in intervals (varint, at least 1),
+ *             per location: zigzag varint differences of measurement, setting and output
+ *  - 0 byte terminating a full block
+ *
+ * Temperatures are in 0.1 C, HISTORY_TEMP_INVALID marks interval without valid measurement.
+ * Output is scaled to 0-255 and a non-zero output is never stored as 0.
+ */
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <data_dispatcher.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTORY_TEMP_INVALID INT16_MIN
+
+void history_init(void);
+
+/** @brief Get the most recent measurements of a location
+ *
+ * @param[in]  loc   Location of the measurements
+ * @param[out] meas  Measurements, the oldest first
+ * @param[in]  max   Capacity of @p meas
+ *
+ * @return Number of measurements stored in @p meas
+ */
+size_t history_recent(data_loc_t loc, int16_t *meas, size_t max);
+
+/** @brief Serve the history with CoAP Block2 transfer
+ *
+ * Responds with the blocks overlapping the time range given by uri-query options
+ * f=<unix time> and t=<unix time>, both optional. Blocks are concatenated without unused space,
+ * so the response only grows while new samples are being recorded. The ETag is made of the
+ * sequence number of the first block, the number of blocks and the length of the last one, so it
+ * changes with every change of the response, also when the first block is overwritten during the
+ * transfer.
+ */
+int history_coap_get(struct coap_resource *resource,
+		struct coap_packet *request,
+		struct sockaddr *addr, socklen_t addr_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_H_
@@ -13,8 +13,10 @@
 #include <zephyr/net/coap.h>
 #include <zephyr/net/socket.h>
 
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 
+#include <cbor_utils.h>
+#include <coap_server.h>
 #include <continuous_sd.h>
 
 #define LIGHT_TYPE "rgbw"
@@ -27,10 +29,15 @@
 #define COAP_CONTENT_FORMAT_CBOR 60
 
 #define LIGHT_R_KEY "r"
+#define LIGHT_R_KEY_ID 1
 #define LIGHT_G_KEY "g"
+#define LIGHT_G_KEY_ID 2
 #define LIGHT_B_KEY "b"
+#define LIGHT_B_KEY_ID 3
 #define LIGHT_W_KEY "w"
+#define LIGHT_W_KEY_ID 4
 #define DURATION_KEY "d"
+#define DURATION_KEY_ID 5
 
 K_SEM_DEFINE(light_out_sem, 0, 1);
 K_SEM_DEFINE(light_state_sem, 0, 1);
@@ -62,19 +69,19 @@ static int prepare_req_payload(uint8_t *payload, size_t len, data_light_t *data)
 
     if (!zcbor_map_start_encode(ce, 5)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, LIGHT_R_KEY)) return -EINVAL;
+    if (cbor_encode_key(ce, LIGHT_R_KEY, LIGHT_R_KEY_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
     if (!zcbor_uint32_put(ce, data->r)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, LIGHT_G_KEY)) return -EINVAL;
+    if (cbor_encode_key(ce, LIGHT_G_KEY, LIGHT_G_KEY_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
     if (!zcbor_uint32_put(ce, data->g)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, LIGHT_B_KEY)) return -EINVAL;
+    if (cbor_encode_key(ce, LIGHT_B_KEY, LIGHT_B_KEY_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
     if (!zcbor_uint32_put(ce, data->b)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, LIGHT_W_KEY)) return -EINVAL;
+    if (cbor_encode_key(ce, LIGHT_W_KEY, LIGHT_W_KEY_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
     if (!zcbor_uint32_put(ce, data->w)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, DURATION_KEY)) return -EINVAL;
+    if (cbor_encode_key(ce, DURATION_KEY, DURATION_KEY_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
     if (!zcbor_uint32_put(ce, 250)) return -EINVAL;
 
     if (!zcbor_map_end_encode(ce, 5)) return -EINVAL;
@@ -106,8 +113,7 @@ static int send_req(int sock, struct sockaddr_in6 *addr, const char *name, data_
         goto end;
     }
 
-    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_CBOR);
+    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT, COAP_CONTENT_FORMAT_REQ);
     if (r < 0) {
         goto end;
     }
@@ -234,6 +240,13 @@ static int send_state_req(int sock, struct sockaddr_in6 *addr, const char *name)
         goto end;
     }
 
+#ifdef COAP_COMPACT
+    r = coap_append_option_int(&cpkt, COAP_OPTION_ACCEPT, COAP_CONTENT_FORMAT_APP_CBOR_COMPACT);
+    if (r < 0) {
+        goto end;
+    }
+#endif
+
     r = sendto(sock, cpkt.data, cpkt.offset, 0, (struct sockaddr *)addr, sizeof(*addr));
     if (r < 0) {
         r = -errno;
@@ -246,18 +259,38 @@ end:
     return r;
 }
 
-static int parse_color_key(zcbor_state_t *top_map, const char *key, uint8_t *result)
+enum {
+    COLOR_R,
+    COLOR_G,
+    COLOR_B,
+    COLOR_W,
+    COLOR_NUM,
+};
+
+static int parse_colors(zcbor_state_t *top_map, data_light_t *light)
 {
-    uint32_t val;
+    uint32_t val[COLOR_NUM];
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        [COLOR_R] = CBOR_MAP_FIELD_ID(LIGHT_R_KEY, LIGHT_R_KEY_ID, CBOR_MAP_FIELD_UINT, &val[COLOR_R], 0),
+        [COLOR_G] = CBOR_MAP_FIELD_ID(LIGHT_G_KEY, LIGHT_G_KEY_ID, CBOR_MAP_FIELD_UINT, &val[COLOR_G], 0),
+        [COLOR_B] = CBOR_MAP_FIELD_ID(LIGHT_B_KEY, LIGHT_B_KEY_ID, CBOR_MAP_FIELD_UINT, &val[COLOR_B], 0),
+        [COLOR_W] = CBOR_MAP_FIELD_ID(LIGHT_W_KEY, LIGHT_W_KEY_ID, CBOR_MAP_FIELD_UINT, &val[COLOR_W], 0),
+    };
 
-    if (!zcbor_search_key_tstr_term(top_map, key, 16)) return -EINVAL;
-    if (!zcbor_uint32_decode(top_map, &val)) return -EINVAL;
+    if (cbor_decode_map(top_map, fields, ARRAY_SIZE(fields), &present)) return -EINVAL;
+    if (present != (1UL << COLOR_NUM) - 1) return -EINVAL;
 
-    if (val > UINT8_MAX) {
-        return -EINVAL;
+    for (int i = 0; i < COLOR_NUM; i++) {
+        if (val[i] > UINT8_MAX) {
+            return -EINVAL;
+        }
     }
 
-    *result = val;
+    light->r = val[COLOR_R];
+    light->g = val[COLOR_G];
+    light->b = val[COLOR_B];
+    light->w = val[COLOR_W];
     return 0;
 }
 
@@ -297,7 +330,8 @@ static int rcv_state_rsp(int sock)
         return -EINVAL;
     }
 
-    if (coap_option_value_to_int(&option) != COAP_CONTENT_FORMAT_CBOR) {
+    r = coap_option_value_to_int(&option);
+    if ((r != COAP_CONTENT_FORMAT_CBOR) && (r != COAP_CONTENT_FORMAT_APP_CBOR_COMPACT)) {
         return -EINVAL;
     }
 
@@ -313,13 +347,7 @@ static int rcv_state_rsp(int sock)
     ZCBOR_STATE_D(cd, 2, payload, payload_len, 1, 0);
     if (!zcbor_unordered_map_start_decode(cd)) return -EINVAL;
 
-    r = parse_color_key(cd, LIGHT_R_KEY, &data.light.r);
-    if (r < 0) return r;
-    r = parse_color_key(cd, LIGHT_G_KEY, &data.light.g);
-    if (r < 0) return r;
-    r = parse_color_key(cd, LIGHT_B_KEY, &data.light.b);
-    if (r < 0) return r;
-    r = parse_color_key(cd, LIGHT_W_KEY, &data.light.w);
+    r = parse_colors(cd, &data.light);
     if (r < 0) return r;
 
     if (!zcbor_list_map_end_force_decode(cd)) return -EINVAL;
@@ -389,8 +417,12 @@ static void light_requested(const data_dispatcher_publish_t *data) {
     k_sem_give(&light_out_sem);
 }
 
+static uint8_t light_req_buf[DATA_DISPATCHER_BUF_SIZE(data_light_t, 1, 1, 0)];
 static data_dispatcher_subscribe_t light_req_sbscr = {
     .callback = light_requested,
+    .work_q   = &data_dispatcher_work_q,
+    .buf      = light_req_buf,
+    .buf_size = sizeof(light_req_buf),
 };
 
 void light_conn_init(void)
@@ -6,13 +6,15 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "coap.h"
 #include "conn.h"
 #include "ctlr.h"
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 #include "dfu_utils.h"
 #include "display.h"
+#include "history.h"
 #include "light_conn.h"
 #include "output.h"
 #include "prj_timeout.h"
@@ -22,7 +24,9 @@
 #include "shades_conn.h"
 #include "vent_conn.h"
 
-#include <net/fota_download.h>
+#include <coap_fota.h>
+#include <coap_server.h>
+#include <continuous_sd.h>
 #include <openthread/thread.h>
 #include <zephyr/drivers/misc/ft8xx/ft8xx.h>
 #include <zephyr/dfu/mcuboot.h>
@@ -32,6 +36,10 @@
 
 #define TX_POWER 8
 
+#define CHECK_THREAD_TIMEOUT_MS (30UL * 1000UL)
+#define CHECK_COAP_TIMEOUT_MS   (5UL * 1000UL)
+#define CHECK_SD_TIMEOUT_MS     (60UL * 1000UL)
+
 static struct ft8xx_touch_transform tt;
 static bool tt_known = false;
 
@@ -63,11 +71,23 @@ struct settings_handler sett_app_conf = {
     .h_set = app_settings_set,
 };
 
-void fota_callback(const struct fota_download_evt *evt)
+// Remote outputs are discovered only on nodes provisioned with their labels
+static bool prov_has_rmt_outputs(void)
 {
-    if (evt->id == FOTA_DOWNLOAD_EVT_FINISHED) {
-        sys_reboot(SYS_REBOOT_COLD);
+    for (data_loc_t zone = 0; zone < DATA_LOC_NUM; zone++) {
+        if ((zone != OUTPUT_RELAY_ZONE) && strlen(prov_get_output_label(zone))) {
+            return true;
+        }
     }
+
+    return false;
+}
+
+static bool check_sd_resolves_peer(void)
+{
+    struct in6_addr addr;
+
+    return continuous_sd_get_any_addr(&addr) == 0;
 }
 
 int main(void)
@@ -78,6 +98,7 @@ int main(void)
     r = settings_subsys_init();
     r = settings_register(&sett_app_conf);
     r = settings_register(prov_get_settings_handler());
+    r = settings_register(coap_fota_get_settings_handler());
     r = settings_load();
 
     otError error;
@@ -105,13 +126,16 @@ int main(void)
     }
 #endif
 
-    fota_download_init(fota_callback);
+    coap_fota_init();
     data_dispatcher_init();
     conn_init();
     display_init();
     sensor_init();
     output_init();
     ctlr_init();
+#ifdef CONFIG_TEMP_HISTORY
+    history_init();
+#endif
     coap_init();
     rmt_out_init();
     vent_conn_init();
@@ -119,15 +143,13 @@ int main(void)
     shades_conn_init();
     prj_timeout_init();
 
-
-#if 0
-    if (dfu_utils_keep_checking_conectivity_until(k_uptime_get() + 1000UL * 60UL * 5UL))
-#else
-    k_sleep(K_MSEC(1000UL * 60UL * 2UL)); // Wait two minutes to allow forcing rollback by power cycle
-#endif
-    {
-        boot_write_img_confirmed();
+    dfu_utils_register_check(dfu_utils_check_thread_attached, CHECK_THREAD_TIMEOUT_MS);
+    dfu_utils_register_check(coap_server_is_running, CHECK_COAP_TIMEOUT_MS);
+    // Unprovisioned nodes have no peer to resolve, so they do not revert healthy images
+    if (prov_has_rmt_outputs()) {
+        dfu_utils_register_check(check_sd_resolves_peer, CHECK_SD_TIMEOUT_MS);
     }
+    dfu_utils_confirm_when_healthy();
 
     return 0;
 }
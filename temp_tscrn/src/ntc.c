@@ -7,42 +7,50 @@
 #define DT_DRV_COMPAT ntc,temperature
 
 #include "ntc.h"
+#include "ntc_lut.h"
 
 #include <zephyr/drivers/sensor.h>
 
-#include <math.h>
-
 #include <zephyr/drivers/adc.h>
 #include <zephyr/device.h>
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_REGISTER(ntc_temp, CONFIG_SENSOR_LOG_LEVEL);
 
-#define C_OFFSET 273.15
-
 #define ADC_RESOLUTION 12
 #define NUM_SENSORS DT_INST_PROP_LEN(0, io_channels)
 
-#define AVG_BASE_BITS 9UL
+#define AVG_BASE_BITS ((uint32_t)CONFIG_NTC_FILTER_BITS)
 #define AVG_FRACT_BITS 16UL
 
+BUILD_ASSERT(NTC_LUT_CODE_BITS - ADC_RESOLUTION <= AVG_FRACT_BITS,
+             "NTC table is more precise than the filter");
+
+#define REPORT_SAMPLES (CONFIG_NTC_REPORT_INTERVAL / CONFIG_NTC_SAMPLE_INTERVAL)
+
+BUILD_ASSERT(REPORT_SAMPLES > 0, "NTC report interval shorter than sample interval");
+
 struct ntc_data {
 	const struct device *adc;
 	uint16_t raw[NUM_SENSORS];
     uint32_t avg[NUM_SENSORS];
+    uint32_t fetched[NUM_SENSORS];
+    uint32_t num_samples;
+    struct k_spinlock lock;
+    sensor_trigger_handler_t handler;
+    const struct sensor_trigger *trigger;
+    const struct device *dev;
 };
 
-struct ntc_config {
-	int16_t b_const;
-    uint16_t r_ref;
-    uint16_t r_nom;
-    int8_t t_nom;
-    bool ntc_before_r_ref;
-};
+static enum adc_action ntc_sampling_done(const struct device *adc,
+                                         const struct adc_sequence *sequence,
+                                         uint16_t sampling_index);
 
+// The sequence is repeated forever by the ADC driver timer, filtering runs in the ADC interrupt
 static struct adc_sequence_options options = {
 	.extra_samplings = 0,
-	.interval_us = 15,
+	.interval_us = CONFIG_NTC_SAMPLE_INTERVAL * USEC_PER_MSEC,
+	.callback = ntc_sampling_done,
 };
 
 static struct adc_sequence adc_table = {
@@ -50,15 +58,7 @@ static struct adc_sequence adc_table = {
     .resolution = ADC_RESOLUTION,
 };
 
-static int ntc_sample_fetch(const struct device *dev,
-			    enum sensor_channel chan)
-{
-	struct ntc_data *drv_data = dev->data;
-
-	return adc_read(drv_data->adc, &adc_table);
-}
-
-static uint16_t avg(struct ntc_data *data, int idx)
+static void avg(struct ntc_data *data, int idx)
 {
     uint32_t raw = (uint32_t)data->raw[idx] << AVG_FRACT_BITS;
 
@@ -70,19 +70,84 @@ static uint16_t avg(struct ntc_data *data, int idx)
         uint64_t sum = (avg_base - 1ULL) * data->avg[idx] + raw;
         data->avg[idx] = sum / avg_base;
     }
+}
+
+static enum adc_action ntc_sampling_done(const struct device *adc,
+                                         const struct adc_sequence *sequence,
+                                         uint16_t sampling_index)
+{
+    struct ntc_data *drv_data = sequence->options->user_data;
+    k_spinlock_key_t key = k_spin_lock(&drv_data->lock);
+
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        avg(drv_data, i);
+    }
+
+    k_spin_unlock(&drv_data->lock, key);
+
+    if (++drv_data->num_samples >= REPORT_SAMPLES) {
+        drv_data->num_samples = 0;
+
+        if (drv_data->handler) {
+            drv_data->handler(drv_data->dev, drv_data->trigger);
+        }
+    }
 
-    return (uint16_t)(data->avg[idx] >> AVG_FRACT_BITS);
+    return ADC_ACTION_REPEAT;
 }
 
+static int ntc_sample_fetch(const struct device *dev,
+			    enum sensor_channel chan)
+{
+	struct ntc_data *drv_data = dev->data;
+    k_spinlock_key_t key = k_spin_lock(&drv_data->lock);
+    int r = 0;
+
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        if (drv_data->avg[i] == UINT32_MAX) {
+            r = -EAGAIN;
+            break;
+        }
+
+        drv_data->fetched[i] = drv_data->avg[i];
+    }
+
+    k_spin_unlock(&drv_data->lock, key);
+
+	return r;
+}
+
+// Handler is called from the ADC interrupt every CONFIG_NTC_REPORT_INTERVAL ms
+static int ntc_trigger_set(const struct device *dev,
+                           const struct sensor_trigger *trig,
+                           sensor_trigger_handler_t handler)
+{
+	struct ntc_data *drv_data = dev->data;
+
+    if (trig->type != SENSOR_TRIG_DATA_READY) {
+        return -ENOTSUP;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&drv_data->lock);
+
+    drv_data->trigger = trig;
+    drv_data->handler = handler;
+
+    k_spin_unlock(&drv_data->lock, key);
+
+    return 0;
+}
+
+// Conversion is interpolated from the table generated from devicetree by scripts/ntc_lut.py
 static int ntc_channel_get(const struct device *dev,
 			   enum sensor_channel chan,
 			   struct sensor_value *val)
 {
 	struct ntc_data *drv_data = dev->data;
-	const struct ntc_config *cfg = dev->config;
-    uint32_t adc_max;
-    double r;
-	double dval;
+    uint32_t code;
+    uint32_t lut_idx;
+    int32_t frac;
+    int32_t cC;
     int idx;
 
     if (chan == SENSOR_CHAN_AMBIENT_TEMP) {
@@ -95,21 +160,20 @@ static int ntc_channel_get(const struct device *dev,
         return -EINVAL;
     }
 
-    uint16_t avg_raw = avg(drv_data, idx);
-
-    adc_max = BIT(ADC_RESOLUTION) - 1;
-    r = (double)adc_max / avg_raw - 1.0;
+    code = drv_data->fetched[idx] >> (AVG_FRACT_BITS - (NTC_LUT_CODE_BITS - ADC_RESOLUTION));
+    lut_idx = code >> NTC_LUT_STEP_BITS;
 
-    if (!cfg->ntc_before_r_ref) {
-        r = 1/r;
+    if (lut_idx >= ARRAY_SIZE(ntc_lut) - 1) {
+        cC = ntc_lut[ARRAY_SIZE(ntc_lut) - 1];
+    }
+    else {
+        frac = code & BIT_MASK(NTC_LUT_STEP_BITS);
+        cC = ntc_lut[lut_idx]
+            + (ntc_lut[lut_idx + 1] - ntc_lut[lut_idx]) * frac / (int32_t)BIT(NTC_LUT_STEP_BITS);
     }
 
-    r = cfg->r_ref * r;
-
-	dval = (1.0 / (log(r / cfg->r_nom) / cfg->b_const
-		     + (1 / (C_OFFSET + cfg->t_nom)))) - C_OFFSET;
-	val->val1 = (int32_t)dval;
-	val->val2 = ((int32_t)(dval * 1000000)) % 1000000;
+	val->val1 = cC / 100;
+	val->val2 = (cC % 100) * 10000;
 
 	return 0;
 }
@@ -117,6 +181,7 @@ static int ntc_channel_get(const struct device *dev,
 static const struct sensor_driver_api ntc_api = {
 	.sample_fetch = &ntc_sample_fetch,
 	.channel_get = &ntc_channel_get,
+	.trigger_set = &ntc_trigger_set,
 };
 
 #ifdef CONFIG_ADC_NRFX_SAADC
@@ -155,10 +220,14 @@ static int ntc_init(const struct device *dev)
 		return -EINVAL;
 	}
 
+    drv_data->dev = dev;
+
     for (int i = 0; i < NUM_SENSORS; i++) {
         drv_data->avg[i] = UINT32_MAX;
     }
 
+    options.user_data = drv_data;
+
 	adc_table.buffer = &drv_data->raw;
 	adc_table.buffer_size = sizeof(drv_data->raw);
 	adc_table.resolution = ADC_RESOLUTION;
@@ -168,18 +237,17 @@ static int ntc_init(const struct device *dev)
     SENSOR_INPUT_DEFINE(0);
     SENSOR_INPUT_DEFINE(1);
 
+    // Without a signal nobody is notified if the sequence is aborted by an error
+	int r = adc_read_async(drv_data->adc, &adc_table, NULL);
+	if (r) {
+		LOG_ERR("Failed to start sampling: %d", r);
+		return r;
+	}
+
 	return 0;
 }
 
 static struct ntc_data ntc_data;
-static const struct ntc_config ntc_cfg = {
-    .ntc_before_r_ref = DT_INST_PROP(0, ntc_before_r_ref),
-    .r_ref = DT_INST_PROP(0, r_ref),
-    .r_nom = 10000,
-    .t_nom = 25,
-	.b_const = 3380.0,
-};
-
 
-DEVICE_DT_INST_DEFINE(0, &ntc_init, NULL, &ntc_data, &ntc_cfg,
+DEVICE_DT_INST_DEFINE(0, &ntc_init, NULL, &ntc_data, NULL,
 		POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY, &ntc_api);
@@ -11,7 +11,7 @@
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
 
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 
 // DEBUG:
 #include "display.h"
@@ -24,116 +24,156 @@
 
 static const struct gpio_dt_spec rly_gpio_spec = GPIO_DT_SPEC_GET(RLY_NODE, gpios);
 
-static void forced_switch(struct k_work *item);
-K_WORK_DELAYABLE_DEFINE(forced_switching_dwork, forced_switch);
+#define CTLR_LOC OUTPUT_RELAY_ZONE
+
+// Kconfig can't limit the zone to DATA_ZONES - 1
+BUILD_ASSERT(CONFIG_TEMP_RELAY_ZONE < DATA_LOC_NUM, "Relay zone out of CONFIG_DATA_ZONES");
+
+#define PWM_INTERVAL (1000UL * 60UL * 2UL)
+#define FRC_SW_INTERVAL 500
+
+/*
+ * Relay is driven by a state machine running in the dispatcher work queue, the same queue which
+ * delivers the subscriptions below, so that its state is never accessed concurrently.
+ * relay_dwork is scheduled for the next relay edge of the PWM cycle or the next step of forced
+ * switching. Every update of the data recomputes the relay state, so a new PID output is applied
+ * in the current PWM cycle.
+ */
+static void relay_work(struct k_work *item);
+K_WORK_DELAYABLE_DEFINE(relay_dwork, relay_work);
 
 static void out_changed(const data_dispatcher_publish_t *data);
 static void ctlr_changed(const data_dispatcher_publish_t *data);
+static void prj_changed(const data_dispatcher_publish_t *data);
 static void frc_sw_changed(const data_dispatcher_publish_t *data);
 
+// Relay is driven from the dispatcher work queue instead of the publishing threads
+static uint8_t out_buf[DATA_DISPATCHER_BUF_SIZE(uint16_t, 1, 1, 0)];
 static data_dispatcher_subscribe_t out_sbscr = {
     .callback = out_changed,
+    .work_q   = &data_dispatcher_work_q,
+    .loc_mask = BIT(CTLR_LOC),
+    .buf      = out_buf,
+    .buf_size = sizeof(out_buf),
 };
+static uint8_t ctlr_buf[DATA_DISPATCHER_BUF_SIZE(data_controller_t, 1, 1, 0)];
 static data_dispatcher_subscribe_t ctlr_sbscr = {
     .callback = ctlr_changed,
+    .work_q   = &data_dispatcher_work_q,
+    .loc_mask = BIT(CTLR_LOC),
+    .buf      = ctlr_buf,
+    .buf_size = sizeof(ctlr_buf),
 };
+static uint8_t prj_buf[DATA_DISPATCHER_BUF_SIZE(uint32_t, 1, 1, 1)];
+static data_dispatcher_subscribe_t prj_sbscr = {
+    .callback  = prj_changed,
+    .work_q    = &data_dispatcher_work_q,
+    .loc_mask  = BIT(CTLR_LOC),
+    .on_change = true,
+    .buf       = prj_buf,
+    .buf_size  = sizeof(prj_buf),
+};
+static uint8_t frc_sw_buf[DATA_DISPATCHER_BUF_SIZE(uint16_t, 1, 1, 0)];
 static data_dispatcher_subscribe_t frc_sw_sbscr = {
     .callback = frc_sw_changed,
+    .work_q   = &data_dispatcher_work_q,
+    .loc_mask = BIT(CTLR_LOC),
+    .buf      = frc_sw_buf,
+    .buf_size = sizeof(frc_sw_buf),
 };
 
-#define PWM_THREAD_STACK_SIZE 1024
-#define PWM_THREAD_PRIO       1
-static void pwm_thread_process(void *a1, void *a2, void *a3);
+static data_ctlr_mode_t ctlr_mode;
+static int64_t pwm_cycle_start;
+static uint16_t frc_sw_applied;
 
-K_THREAD_DEFINE(pwm_thread_id, PWM_THREAD_STACK_SIZE,
-                pwm_thread_process, NULL, NULL, NULL,
-                PWM_THREAD_PRIO, K_ESSENTIAL, K_TICKS_FOREVER);
+static void relay_schedule(uint32_t delay_ms)
+{
+    k_work_reschedule_for_queue(&data_dispatcher_work_q, &relay_dwork, K_MSEC(delay_ms));
+}
 
-#define PWM_INTERVAL (1000UL * 60UL * 2UL)
+static void pwm_process(uint16_t output)
+{
+    int64_t now = k_uptime_get();
+    int64_t elapsed = now - pwm_cycle_start;
+    uint32_t time_on = (uint64_t)output * PWM_INTERVAL / UINT16_MAX;
 
-#define CTLR_LOC DATA_LOC_REMOTE
+    if (elapsed >= PWM_INTERVAL || elapsed < 0) {
+        pwm_cycle_start = now;
+        elapsed = 0;
+    }
 
-static volatile data_ctlr_mode_t ctlr_mode;
+    if (elapsed < time_on) {
+        gpio_pin_set_dt(&rly_gpio_spec, 1);
+        relay_schedule(time_on - elapsed);
+    } else {
+        gpio_pin_set_dt(&rly_gpio_spec, 0);
+        relay_schedule(PWM_INTERVAL - elapsed);
+    }
+}
 
-static void onoff_process(const data_dispatcher_publish_t *out_data)
+static void relay_process(void)
 {
-    int val = 0;
-    const data_dispatcher_publish_t *prj_data;
-    const data_dispatcher_publish_t *frc_sw_data;
+    data_dispatcher_publish_t out_data;
+    data_dispatcher_publish_t prj_data;
+    data_dispatcher_publish_t frc_sw_data;
 
-    if (out_data == NULL) {
-        data_dispatcher_get(DATA_OUTPUT, CTLR_LOC, &out_data);
-    }
+    data_dispatcher_get(DATA_OUTPUT, CTLR_LOC, &out_data);
     data_dispatcher_get(DATA_PRJ_ENABLED, CTLR_LOC, &prj_data);
     data_dispatcher_get(DATA_FORCED_SWITCHING, CTLR_LOC, &frc_sw_data);
 
-    if (frc_sw_data->forced_switches > 0) {
-        // Relay is already set by forced switching handling
+    if (frc_sw_data.forced_switches > 0) {
+        // Relay toggles at every step of forced switching, other updates do not affect it
+        if (frc_sw_data.forced_switches != frc_sw_applied) {
+            frc_sw_applied = frc_sw_data.forced_switches;
+            gpio_pin_set_dt(&rly_gpio_spec, frc_sw_applied % 2);
+            relay_schedule(FRC_SW_INTERVAL);
+        }
         return;
-    } else  if (prj_data->prj_validity > 0) {
-        // Disable relay if the projector is enabled
-        val = 0;
-    } else if (out_data->output) {
-        val = 1;
     }
-    else {
-        val = 0;
+
+    frc_sw_applied = 0;
+
+    if (prj_data.prj_validity > 0) {
+        // Disable relay if the projector is enabled
+        k_work_cancel_delayable(&relay_dwork);
+        gpio_pin_set_dt(&rly_gpio_spec, 0);
+        return;
     }
 
-    gpio_pin_set_dt(&rly_gpio_spec, val);
+    switch (ctlr_mode) {
+        case DATA_CTLR_ONOFF:
+            k_work_cancel_delayable(&relay_dwork);
+            gpio_pin_set_dt(&rly_gpio_spec, out_data.output ? 1 : 0);
+            break;
+
+        case DATA_CTLR_PID:
+            pwm_process(out_data.output);
+            break;
+    }
 }
 
-static void pwm_thread_process(void *a1, void *a2, void *a3)
+static void relay_work(struct k_work *item)
 {
-    (void)a1;
-    (void)a2;
-    (void)a3;
-
-    while (1) {
-        if (ctlr_mode != DATA_CTLR_PID) {
-            gpio_pin_set_dt(&rly_gpio_spec, 0);
-            k_sleep(K_FOREVER);
-            continue;
-        }
-
-        const data_dispatcher_publish_t *out_data;
-        const data_dispatcher_publish_t *prj_data;
-        const data_dispatcher_publish_t *frc_sw_data;
-        data_dispatcher_get(DATA_OUTPUT, CTLR_LOC, &out_data);
-        data_dispatcher_get(DATA_PRJ_ENABLED, CTLR_LOC, &prj_data);
-        data_dispatcher_get(DATA_FORCED_SWITCHING, CTLR_LOC, &frc_sw_data);
-
-        if (frc_sw_data->forced_switches) {
-            // Relay is already set by forced switching handling
-            k_sleep(K_MSEC(PWM_INTERVAL));
-            continue;
-        }
-
-        if (prj_data->prj_validity) {
-            // Disable relay if the projector is enabled
-            gpio_pin_set_dt(&rly_gpio_spec, 0);
-            k_sleep(K_MSEC(PWM_INTERVAL));
-            continue;
-        }
+    (void)item;
 
-        uint32_t time_on  = (uint64_t)(out_data->output) * PWM_INTERVAL / UINT16_MAX;
-        uint32_t time_off = PWM_INTERVAL - time_on;
+    data_dispatcher_publish_t current_frc_sw;
+    data_dispatcher_get(DATA_FORCED_SWITCHING, CTLR_LOC, &current_frc_sw);
 
-        if (time_on > PWM_INTERVAL) {
-            time_on = PWM_INTERVAL;
-            time_off = 0;
-        }
+    uint16_t remaining_frc_sw = current_frc_sw.forced_switches;
 
-        if (time_on > 0) {
-            gpio_pin_set_dt(&rly_gpio_spec, 1);
-            k_sleep(K_MSEC(time_on));
-        }
+    if (remaining_frc_sw > 0) {
+        // Next step is applied when the publication is delivered to frc_sw_changed()
+        data_dispatcher_publish_t new_frc_sw = {
+            .type = DATA_FORCED_SWITCHING,
+            .loc = CTLR_LOC,
+            .forced_switches = remaining_frc_sw - 1,
+        };
 
-        if (time_off > 0) {
-            gpio_pin_set_dt(&rly_gpio_spec, 0);
-            k_sleep(K_MSEC(time_off));
-        }
+        data_dispatcher_publish(&new_frc_sw);
+        return;
     }
+
+    relay_process();
 }
 
 void output_init(void)
@@ -153,16 +193,17 @@ void output_init(void)
         return;
     }
 
-    const data_dispatcher_publish_t *ctlr_data;
+    data_dispatcher_publish_t ctlr_data;
     data_dispatcher_get(DATA_CONTROLLER, CTLR_LOC, &ctlr_data);
-    ctlr_mode = ctlr_data->controller.mode;
-    k_thread_start(pwm_thread_id);
-
-    k_work_init_delayable(&forced_switching_dwork, forced_switch);
+    ctlr_mode = ctlr_data.controller.mode;
+    pwm_cycle_start = k_uptime_get();
 
     data_dispatcher_subscribe(DATA_OUTPUT, &out_sbscr);
     data_dispatcher_subscribe(DATA_CONTROLLER, &ctlr_sbscr);
+    data_dispatcher_subscribe(DATA_PRJ_ENABLED, &prj_sbscr);
     data_dispatcher_subscribe(DATA_FORCED_SWITCHING, &frc_sw_sbscr);
+
+    relay_schedule(0);
 }
 
 void output_relay_toggle(void)
@@ -172,96 +213,33 @@ void output_relay_toggle(void)
 
 static void out_changed(const data_dispatcher_publish_t *data)
 {
-    if (ctlr_mode != DATA_CTLR_ONOFF) {
-        return;
-    }
-    if (data->loc != CTLR_LOC) {
-        return;
-    }
+    (void)data;
 
-    onoff_process(data);
+    relay_process();
 }
 
 static void ctlr_changed(const data_dispatcher_publish_t *data)
 {
-    if (data->loc != CTLR_LOC) {
-        return;
-    }
-
-    if (data->controller.mode == ctlr_mode) {
-        if (ctlr_mode == DATA_CTLR_ONOFF) {
-            onoff_process(NULL);
-        }
+    if (data->controller.mode != ctlr_mode) {
+        ctlr_mode = data->controller.mode;
 
-        return;
+        // PWM cycle starts again when PID controller is enabled
+        pwm_cycle_start = k_uptime_get();
     }
 
-    data_ctlr_mode_t prev_mode = ctlr_mode;
-    ctlr_mode = data->controller.mode;
-
-    // Stop previous output controller
-    switch (prev_mode) {
-        case DATA_CTLR_ONOFF:
-            // Intentionally empty
-            break;
-
-        case DATA_CTLR_PID:
-            // Wakeup PWM thread to stop its execution and sleep forever
-            k_wakeup(pwm_thread_id);
-            break;
-    }
-
-    // Start new output controller
-    switch (ctlr_mode) {
-        case DATA_CTLR_ONOFF:
-            onoff_process(NULL);
-            break;
-
-        case DATA_CTLR_PID:
-            // Wakeup PWM thread to start its execution
-            k_wakeup(pwm_thread_id);
-            break;
-    }
+    relay_process();
 }
 
-static void forced_switch(struct k_work *item)
+static void prj_changed(const data_dispatcher_publish_t *data)
 {
-    (void)item;
+    (void)data;
 
-    const data_dispatcher_publish_t *current_frc_sw;
-    data_dispatcher_get(DATA_FORCED_SWITCHING, CTLR_LOC, &current_frc_sw);
-
-    uint16_t remaining_frc_sw = current_frc_sw->forced_switches;
-
-    if (remaining_frc_sw > 0) {
-        data_dispatcher_publish_t new_frc_sw = {
-            .type = DATA_FORCED_SWITCHING,
-            .loc = CTLR_LOC,
-            .forced_switches = remaining_frc_sw - 1,
-        };
-
-        data_dispatcher_publish(&new_frc_sw);
-    }
+    relay_process();
 }
 
 static void frc_sw_changed(const data_dispatcher_publish_t *data)
 {
-    uint16_t num_switches = data->forced_switches;
+    (void)data;
 
-    if (data->loc != CTLR_LOC) return;
-
-    if (num_switches) {
-        gpio_pin_set_dt(&rly_gpio_spec, num_switches % 2);
-
-        k_work_schedule(&forced_switching_dwork, K_MSEC(500));
-    } else {
-        if (ctlr_mode == DATA_CTLR_ONOFF) {
-            const data_dispatcher_publish_t *out_data;
-            data_dispatcher_get(DATA_OUTPUT, CTLR_LOC, &out_data);
-            onoff_process(out_data);
-        } else {
-            // Disable the relay and wait. PWM thread is still iterating. It will pick up controlling the relay.
-            gpio_pin_set_dt(&rly_gpio_spec, 0);
-        }
-    }
+    relay_process();
 }
@@ -16,6 +16,9 @@
 extern "C" {
 #endif
 
+// Zone driven by the relay of the board. Other zones are driven by remote outputs.
+#define OUTPUT_RELAY_ZONE CONFIG_TEMP_RELAY_ZONE
+
 void output_init(void);
 void output_relay_toggle(void);
 
@@ -8,35 +8,25 @@
 #include "prj_timeout.h"
 
 #include <zephyr/kernel.h>
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 
 static struct k_timer projector_timers[DATA_LOC_NUM];
 static struct k_work projector_invalidators[DATA_LOC_NUM];
 
 static void timer_handler_prj(struct k_timer *timer_id)
 {
-	for (int i = 0; i < DATA_LOC_NUM; i++) {
-		if (timer_id == &projector_timers[i]) {
-			k_work_submit(&projector_invalidators[i]);
-			break;
-		}
-	}
+	k_work_submit(&projector_invalidators[timer_id - projector_timers]);
 }
 
 static void work_handler_prj(struct k_work *work)
 {
-	for (int i = 0; i < DATA_LOC_NUM; i++) {
-		if (work == &projector_invalidators[i]) {
-			data_dispatcher_publish_t out_data = {
-				.type         = DATA_PRJ_ENABLED,
-				.loc          = i,
-				.prj_validity = 0,
-			};
+	data_dispatcher_publish_t out_data = {
+		.type         = DATA_PRJ_ENABLED,
+		.loc          = work - projector_invalidators,
+		.prj_validity = 0,
+	};
 
-			data_dispatcher_publish(&out_data);
-			break;
-		}
-	}
+	data_dispatcher_publish(&out_data);
 }
 
 static void changed_prj(const data_dispatcher_publish_t *data)
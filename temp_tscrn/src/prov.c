@@ -7,45 +7,52 @@
 #include "prov.h"
 
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
 #include <zephyr/settings/settings.h>
 
 #include <coap_sd.h>
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 
 #define SETT_NAME "prov"
-#define RSRC0_NAME "r0"
-#define RSRC1_NAME "r1"
+#define RSRC_PREFIX 'r'
 #define RSRC_TYPE "tempcnt"
-#define OUT0_NAME "o0"
+#define OUT_PREFIX 'o'
+
+// Setting names are r<zone> and o<zone>, the longest is "o7"
+#define NAME_MAX_LEN 3
 
 static const char rsrc_type[] = RSRC_TYPE;
 static char rsrc_labels[DATA_LOC_NUM][PROV_LBL_MAX_LEN];
-static char loc_output_label[PROV_LBL_MAX_LEN];
+static char output_labels[DATA_LOC_NUM][PROV_LBL_MAX_LEN];
 
 void prov_init(void)
 {
     for (int i = 0; i < DATA_LOC_NUM; ++i) {
         rsrc_labels[i][0] = '\0';
+        output_labels[i][0] = '\0';
     }
-
-    loc_output_label[0] = '\0';
 }
 
-int prov_set_rsrc_label(data_loc_t loc, const char *rsrc_label)
+static int set_label(char (*labels)[PROV_LBL_MAX_LEN], data_loc_t loc, const char *label)
 {
     if (loc >= DATA_LOC_NUM) {
         return -1;
     }
 
-    if (strlen(rsrc_label) >= PROV_LBL_MAX_LEN) {
+    if (strlen(label) >= PROV_LBL_MAX_LEN) {
         return -2;
     }
 
-    strncpy(rsrc_labels[loc], rsrc_label, PROV_LBL_MAX_LEN);
+    strncpy(labels[loc], label, PROV_LBL_MAX_LEN);
     return 0;
 }
 
+int prov_set_rsrc_label(data_loc_t loc, const char *rsrc_label)
+{
+    return set_label(rsrc_labels, loc, rsrc_label);
+}
+
 const char *prov_get_rsrc_label(data_loc_t loc)
 {
     if (loc < DATA_LOC_NUM) {
@@ -55,77 +62,76 @@ const char *prov_get_rsrc_label(data_loc_t loc)
     return NULL;
 }
 
-int prov_set_loc_output_label(const char *label)
+int prov_set_output_label(data_loc_t loc, const char *label)
 {
-    if (strlen(label) >= PROV_LBL_MAX_LEN) {
-        return -2;
+    return set_label(output_labels, loc, label);
+}
+
+const char *prov_get_output_label(data_loc_t loc)
+{
+    if (loc < DATA_LOC_NUM) {
+        return output_labels[loc];
     }
 
-    strncpy(loc_output_label, label, PROV_LBL_MAX_LEN);
-    return 0;
+    return NULL;
 }
 
-const char *prov_get_loc_output_label(void)
+static void register_rsrcs(void)
 {
-    return loc_output_label;
+    for (int i = 0; i < DATA_LOC_NUM; ++i) {
+        if (strlen(rsrc_labels[i])) coap_sd_server_register_rsrc(rsrc_labels[i], rsrc_type);
+    }
 }
 
-static int prov_set_from_nvm(const char *name, size_t len,
-                             settings_read_cb read_cb, void *cb_arg)
+// Zone of setting name like r0 or o1, -ENOENT if the name does not match the prefix
+static int name_zone(const char *name, char prefix)
 {
     const char *next;
-    int rc;
+    int len = settings_name_next(name, &next);
 
-    if (settings_name_steq(name, RSRC0_NAME, &next) && !next) {
-        if (len >= PROV_LBL_MAX_LEN) {
-            return -EINVAL;
-        }
-
-        rc = read_cb(cb_arg, rsrc_labels[0], PROV_LBL_MAX_LEN);
-
-        if (rc < 0) {
-            return rc;
-        }
-
-        rsrc_labels[0][rc] = '\0';
-	if (strlen(rsrc_labels[0])) coap_sd_server_register_rsrc(rsrc_labels[0], rsrc_type);
-
-        return 0;
+    if (next || (len != 2) || (name[0] != prefix) || (name[1] < '0') ||
+            (name[1] >= '0' + DATA_LOC_NUM)) {
+        return -ENOENT;
     }
 
-    if (settings_name_steq(name, RSRC1_NAME, &next) && !next) {
-        if (len >= PROV_LBL_MAX_LEN) {
-            return -EINVAL;
-        }
+    return name[1] - '0';
+}
 
-        rc = read_cb(cb_arg, rsrc_labels[1], PROV_LBL_MAX_LEN);
+static int prov_set_from_nvm(const char *name, size_t len,
+                             settings_read_cb read_cb, void *cb_arg)
+{
+    char *label;
+    int zone;
+    int rc;
 
-        if (rc < 0) {
-            return rc;
+    zone = name_zone(name, RSRC_PREFIX);
+    if (zone >= 0) {
+        label = rsrc_labels[zone];
+    } else {
+        zone = name_zone(name, OUT_PREFIX);
+        if (zone < 0) {
+            return -ENOENT;
         }
+        label = output_labels[zone];
+    }
 
-        rsrc_labels[1][rc] = '\0';
-	if (strlen(rsrc_labels[1])) coap_sd_server_register_rsrc(rsrc_labels[1], rsrc_type);
-
-        return 0;
+    if (len >= PROV_LBL_MAX_LEN) {
+        return -EINVAL;
     }
 
-    if (settings_name_steq(name, OUT0_NAME, &next) && !next) {
-        if (len >= PROV_LBL_MAX_LEN) {
-            return -EINVAL;
-        }
+    rc = read_cb(cb_arg, label, PROV_LBL_MAX_LEN);
 
-        rc = read_cb(cb_arg, loc_output_label, PROV_LBL_MAX_LEN);
-        loc_output_label[rc] = '\0';
+    if (rc < 0) {
+        return rc;
+    }
 
-        if (rc < 0) {
-            return rc;
-        }
+    label[rc] = '\0';
 
-        return 0;
+    if ((label == rsrc_labels[zone]) && strlen(label)) {
+        coap_sd_server_register_rsrc(label, rsrc_type);
     }
 
-    return -ENOENT;
+    return 0;
 }
 
 static struct settings_handler sett_conf = {
@@ -135,13 +141,18 @@ static struct settings_handler sett_conf = {
 
 void prov_store(void)
 {
-    settings_save_one(SETT_NAME "/" RSRC0_NAME, rsrc_labels[0], strlen(rsrc_labels[0]));
-    settings_save_one(SETT_NAME "/" RSRC1_NAME, rsrc_labels[1], strlen(rsrc_labels[1]));
-    settings_save_one(SETT_NAME "/" OUT0_NAME, loc_output_label, strlen(loc_output_label));
+    char name[sizeof(SETT_NAME "/") + NAME_MAX_LEN];
+
+    for (int i = 0; i < DATA_LOC_NUM; ++i) {
+        snprintf(name, sizeof(name), SETT_NAME "/%c%d", RSRC_PREFIX, i);
+        settings_save_one(name, rsrc_labels[i], strlen(rsrc_labels[i]));
+
+        snprintf(name, sizeof(name), SETT_NAME "/%c%d", OUT_PREFIX, i);
+        settings_save_one(name, output_labels[i], strlen(output_labels[i]));
+    }
 
     coap_sd_server_clear_all_rsrcs();
-    if (strlen(rsrc_labels[0])) coap_sd_server_register_rsrc(rsrc_labels[0], rsrc_type);
-    if (strlen(rsrc_labels[1])) coap_sd_server_register_rsrc(rsrc_labels[1], rsrc_type);
+    register_rsrcs();
 }
 
 struct settings_handler *prov_get_settings_handler(void)
@@ -12,7 +12,7 @@
 #ifndef PROV_H_
 #define PROV_H_
 
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,8 +23,8 @@ extern "C" {
 void prov_init(void);
 int prov_set_rsrc_label(data_loc_t loc, const char *rsrc_label);
 const char *prov_get_rsrc_label(data_loc_t loc);
-int prov_set_loc_output_label(const char *label);
-const char *prov_get_loc_output_label(void);
+int prov_set_output_label(data_loc_t loc, const char *label);
+const char *prov_get_output_label(data_loc_t loc);
 void prov_store(void);
 struct settings_handler *prov_get_settings_handler(void);
 
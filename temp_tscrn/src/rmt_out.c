@@ -12,13 +12,16 @@
 #include <zcbor_encode.h>
 
 #include "coap.h"
+#include "output.h"
 #include "prov.h"
 
+#include <cbor_utils.h>
+#include <coap_server.h>
 #include <continuous_sd.h>
 
-#define RMT_OUT_LOC DATA_LOC_LOCAL
 #define OUT_MAX 256UL
 #define OUT_KEY "val"
+#define OUT_KEY_ID 1
 #define OUT_TYPE "shcnt"
 
 #define OUT_INTERVAL (1000UL * 60UL * 2UL)
@@ -33,7 +36,7 @@
 #define MAX_COAP_PAYLOAD_LEN 64
 #define COAP_CONTENT_FORMAT_CBOR 60
 
-static char rsrc_name[PROV_LBL_MAX_LEN];
+static char rsrc_names[DATA_LOC_NUM][PROV_LBL_MAX_LEN];
 
 #define OUT_THREAD_STACK_SIZE 2048
 #define OUT_THREAD_PRIO       1
@@ -51,7 +54,7 @@ static int prepare_req_payload(uint8_t *payload, size_t len, int val)
 
 	if (!zcbor_map_start_encode(ce, 1)) return -EINVAL;
 
-	if (!zcbor_tstr_encode_ptr(ce, OUT_KEY, strlen(OUT_KEY))) return -EINVAL;
+	if (cbor_encode_key(ce, OUT_KEY, OUT_KEY_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
 	if (!zcbor_int32_put(ce, val)) return -EINVAL;
 
 	if (!zcbor_map_end_encode(ce, 1)) return -EINVAL;
@@ -59,13 +62,13 @@ static int prepare_req_payload(uint8_t *payload, size_t len, int val)
 	return (size_t)(ce->payload - payload);
 }
 
-static int send_req(int sock, struct sockaddr_in6 *addr, int out_val)
+static int send_req(int sock, struct sockaddr_in6 *addr, data_loc_t zone, int out_val)
 {
     int r;
     struct coap_packet cpkt;
     uint8_t *data;
     uint8_t payload[MAX_COAP_PAYLOAD_LEN];
-    const char *rsrc = prov_get_loc_output_label();
+    const char *rsrc = prov_get_output_label(zone);
 
     if (!rsrc || !strlen(rsrc)) {
         // TODO: Here is a race condition. Actually resource may be removed before
@@ -90,8 +93,7 @@ static int send_req(int sock, struct sockaddr_in6 *addr, int out_val)
         goto end;
     }
 
-    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_CBOR);
+    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT, COAP_CONTENT_FORMAT_REQ);
     if (r < 0) {
         goto end;
     }
@@ -139,6 +141,45 @@ static int rcv_rsp(int sock)
     return 0;
 }
 
+static void update_zone(int sock, struct sockaddr_in6 *rmt_addr, data_loc_t zone)
+{
+    int r;
+    int cnt = 0;
+    data_dispatcher_publish_t out_data;
+    int out_val;
+    struct in6_addr *addr = &rmt_addr->sin6_addr;
+    const char *expected_name = prov_get_output_label(zone);
+
+    if (!strlen(expected_name) && !strlen(rsrc_names[zone])) {
+        // Zone without remote output
+        return;
+    }
+
+    r = continuous_sd_get_addr(expected_name, OUT_TYPE, addr);
+    if (r == -ENOENT) {
+        r = continuous_sd_unregister(rsrc_names[zone], OUT_TYPE);
+        strncpy(rsrc_names[zone], expected_name, sizeof(rsrc_names[zone]));
+        if (strlen(rsrc_names[zone])) {
+            continuous_sd_register(rsrc_names[zone], OUT_TYPE, true);
+        }
+        return;
+    }
+
+    if (!r && !net_ipv6_is_addr_unspecified(addr))
+    {
+        data_dispatcher_get(DATA_OUTPUT, zone, &out_data);
+
+        out_val = out_data.output * OUT_MAX / UINT16_MAX;
+
+        do {
+            send_req(sock, rmt_addr, zone, out_val);
+
+            r = rcv_rsp(sock);
+            cnt++;
+        } while ((r != 0) && (cnt < 5));
+    }
+}
+
 static void out_thread_process(void *a1, void *a2, void *a3)
 {
     (void)a1;
@@ -155,7 +196,6 @@ static void out_thread_process(void *a1, void *a2, void *a3)
         .sin6_family = AF_INET6,
         .sin6_port = htons(COAP_PORT),
     };
-    struct in6_addr *addr = &rmt_addr.sin6_addr;
 
     sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
     if (sock < 0) {
@@ -169,33 +209,12 @@ static void out_thread_process(void *a1, void *a2, void *a3)
     }
 
     while (1) {
-        int cnt = 0;
-        const data_dispatcher_publish_t *out_data;
-        int out_val;
-
         k_sleep(K_MSEC(OUT_INTERVAL));
 
-        const char *expected_name = prov_get_loc_output_label();
-	r = continuous_sd_get_addr(expected_name, OUT_TYPE, addr);
-	if (r == -ENOENT) {
-            r = continuous_sd_unregister(rsrc_name, OUT_TYPE);
-            strncpy(rsrc_name, expected_name, sizeof(rsrc_name));
-            continuous_sd_register(rsrc_name, OUT_TYPE, true);
-	    continue;
-	}
-
-        if (!r && !net_ipv6_is_addr_unspecified(addr))
-        {
-            data_dispatcher_get(DATA_OUTPUT, RMT_OUT_LOC, &out_data);
-
-            out_val = out_data->output * OUT_MAX / UINT16_MAX;
-
-            do {
-                send_req(sock, &rmt_addr, out_val);
-
-                r = rcv_rsp(sock);
-                cnt++;
-            } while ((r != 0) && (cnt < 5));
+        for (data_loc_t zone = 0; zone < DATA_LOC_NUM; zone++) {
+            if (zone != OUTPUT_RELAY_ZONE) {
+                update_zone(sock, &rmt_addr, zone);
+            }
         }
     }
 
@@ -207,10 +226,13 @@ void rmt_out_init(void)
 {
     k_sleep(K_SECONDS(10));
 
-    const char *expected_name = prov_get_loc_output_label();
-    if (expected_name && strlen(expected_name)) {
-        strncpy(rsrc_name, expected_name, sizeof(rsrc_name));
-        continuous_sd_register(rsrc_name, OUT_TYPE, true);
+    for (data_loc_t zone = 0; zone < DATA_LOC_NUM; zone++) {
+        const char *expected_name = prov_get_output_label(zone);
+
+        if ((zone != OUTPUT_RELAY_ZONE) && strlen(expected_name)) {
+            strncpy(rsrc_names[zone], expected_name, sizeof(rsrc_names[zone]));
+            continuous_sd_register(rsrc_names[zone], OUT_TYPE, true);
+        }
     }
 
     k_sleep(K_SECONDS(1));
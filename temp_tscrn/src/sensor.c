@@ -6,29 +6,45 @@
 
 #include "sensor.h"
 
-#include <math.h>
-
 #include <zephyr/drivers/sensor.h>
+#include <stdlib.h>
+
 #include <zephyr/kernel.h>
 
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 #include "ntc.h"
 
-#define NUM_SENSORS 2
-
 #define SENSOR_THREAD_STACK_SIZE 1024
 #define SENSOR_THREAD_PRIO       14
 static void sensor_thread_process(void *a1, void *a2, void *a3);
 
 K_THREAD_DEFINE(sensor_thread_id, SENSOR_THREAD_STACK_SIZE,
                 sensor_thread_process, NULL, NULL, NULL,
-                SENSOR_THREAD_PRIO, K_ESSENTIAL | K_FP_REGS, K_TICKS_FOREVER);
+                SENSOR_THREAD_PRIO, K_ESSENTIAL, K_TICKS_FOREVER);
+
+BUILD_ASSERT(SENSOR_NUM <= DATA_LOC_NUM, "Every sensor needs a zone");
+
+K_SEM_DEFINE(data_ready_sem, 0, 1);
+
+static const struct sensor_trigger data_ready_trig = {
+    .type = SENSOR_TRIG_DATA_READY,
+    .chan = SENSOR_CHAN_ALL,
+};
 
 void sensor_init(void)
 {
     k_thread_start(sensor_thread_id);
 }
 
+// Called from the ADC interrupt when a new filtered value is ready
+static void data_ready(const struct device *dev, const struct sensor_trigger *trigger)
+{
+    (void)dev;
+    (void)trigger;
+
+    k_sem_give(&data_ready_sem);
+}
+
 static void sensor_thread_process(void *a1, void *a2, void *a3)
 {
     (void)a1;
@@ -43,28 +59,34 @@ static void sensor_thread_process(void *a1, void *a2, void *a3)
         return;
     }
 
-    struct sensor_value store[NUM_SENSORS];
-    sensor_sample_fetch(sensor);
+    if (sensor_trigger_set(sensor, &data_ready_trig, data_ready)) {
+        return;
+    }
 
-    for (int i = 0; i < NUM_SENSORS; i++) {
-        sensor_channel_get(sensor, NTC_SENSOR(i), &val);
-        store[i] = val;
+    // Out of the sensor range, so that the first value is published
+    int32_t store[SENSOR_NUM];
+
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        store[i] = INT32_MIN / 2;
     }
 
     while (1) {
-        sensor_sample_fetch(sensor);
+        k_sem_take(&data_ready_sem, K_FOREVER);
+
+        if (sensor_sample_fetch(sensor) != 0) {
+            continue;
+        }
 
-        for (int i = 0; i < NUM_SENSORS; i++) {
+        for (int i = 0; i < SENSOR_NUM; i++) {
             sensor_channel_get(sensor, NTC_SENSOR(i), &val);
 
-            double dval = val.val1 + 0.000001 * val.val2;
-            double prev_dval = store[i].val1 + 0.000001 * store[i].val2;
+            int32_t mC = val.val1 * 1000 + val.val2 / 1000;
 
-            if (fabs(dval - prev_dval) < 0.07) {
+            if (abs(mC - store[i]) < 70) {
                 continue;
             }
 
-            store[i] = val;
+            store[i] = mC;
             dC = val.val1 * 10 + val.val2 / 100000;
 
             data_dispatcher_publish_t data = {
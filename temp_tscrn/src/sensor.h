@@ -16,6 +16,9 @@
 extern "C" {
 #endif
 
+// Zones from 0 to SENSOR_NUM - 1 are measured by the sensors of the board
+#define SENSOR_NUM 2
+
 void sensor_init(void);
 
 #ifdef __cplusplus
@@ -15,8 +15,10 @@
 #include <zephyr/net/coap.h>
 #include <zephyr/net/socket.h>
 
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 
+#include <cbor_utils.h>
+#include <coap_server.h>
 #include <continuous_sd.h>
 
 #define SHADES_TYPE "shcnt"
@@ -29,7 +31,9 @@
 #define COAP_CONTENT_FORMAT_CBOR 60
 
 #define SHADES_KEY "val"
+#define SHADES_KEY_ID 1
 #define SHADES_REQ_KEY "r"
+#define SHADES_REQ_KEY_ID 2
 
 K_SEM_DEFINE(shades_out_sem, 0, 1);
 K_SEM_DEFINE(shades_state_sem, 0, 1);
@@ -64,7 +68,7 @@ static int prepare_req_payload(uint8_t *payload, size_t len, uint16_t val)
 
     if (!zcbor_map_start_encode(ce, 1)) return -EINVAL;
 
-    if (!zcbor_tstr_put_lit(ce, SHADES_KEY)) return -EINVAL;
+    if (cbor_encode_key(ce, SHADES_KEY, SHADES_KEY_ID, IS_ENABLED(COAP_COMPACT))) return -EINVAL;
     if (!zcbor_uint32_put(ce, val)) return -EINVAL;
 
     if (!zcbor_map_end_encode(ce, 1)) return -EINVAL;
@@ -96,8 +100,7 @@ static int send_req(int sock, struct sockaddr_in6 *addr, const char *name, uint1
         goto end;
     }
 
-    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT,
-            COAP_CONTENT_FORMAT_CBOR);
+    r = coap_append_option_int(&cpkt, COAP_OPTION_CONTENT_FORMAT, COAP_CONTENT_FORMAT_REQ);
     if (r < 0) {
         goto end;
     }
@@ -222,6 +225,13 @@ static int send_state_req(int sock, struct sockaddr_in6 *addr, const char *name)
         goto end;
     }
 
+#ifdef COAP_COMPACT
+    r = coap_append_option_int(&cpkt, COAP_OPTION_ACCEPT, COAP_CONTENT_FORMAT_APP_CBOR_COMPACT);
+    if (r < 0) {
+        goto end;
+    }
+#endif
+
     r = sendto(sock, cpkt.data, cpkt.offset, 0, (struct sockaddr *)addr, sizeof(*addr));
     if (r < 0) {
         r = -errno;
@@ -234,12 +244,16 @@ end:
     return r;
 }
 
-static int parse_val(zcbor_state_t *top_map, const char *key, uint16_t *result)
+static int parse_val(zcbor_state_t *top_map, uint16_t *result)
 {
     uint32_t val;
+    uint32_t present;
+    const struct cbor_map_field fields[] = {
+        CBOR_MAP_FIELD_ID(SHADES_REQ_KEY, SHADES_REQ_KEY_ID, CBOR_MAP_FIELD_UINT, &val, 0),
+    };
 
-    if (!zcbor_search_key_tstr_term(top_map, key, 16)) return -EINVAL;
-    if (!zcbor_uint32_decode(top_map, &val)) return -EINVAL;
+    if (cbor_decode_map(top_map, fields, ARRAY_SIZE(fields), &present)) return -EINVAL;
+    if (!present) return -EINVAL;
 
     if (val > UINT16_MAX) {
         return -EINVAL;
@@ -285,7 +299,8 @@ static int rcv_state_rsp(int sock)
         return -EINVAL;
     }
 
-    if (coap_option_value_to_int(&option) != COAP_CONTENT_FORMAT_CBOR) {
+    r = coap_option_value_to_int(&option);
+    if ((r != COAP_CONTENT_FORMAT_CBOR) && (r != COAP_CONTENT_FORMAT_APP_CBOR_COMPACT)) {
         return -EINVAL;
     }
 
@@ -299,7 +314,7 @@ static int rcv_state_rsp(int sock)
 
     if (!zcbor_unordered_map_start_decode(parser)) return -EINVAL;
 
-    r = parse_val(parser, SHADES_REQ_KEY, &val);
+    r = parse_val(parser, &val);
     if (r < 0) return r;
 
     if (!zcbor_list_map_end_force_decode(parser)) return -EINVAL;
@@ -374,8 +389,12 @@ static void shades_requested(const data_dispatcher_publish_t *data) {
     k_sem_give(&shades_out_sem);
 }
 
+static uint8_t shades_req_buf[DATA_DISPATCHER_BUF_SIZE(data_shades_req_t, 1, 1, 0)];
 static data_dispatcher_subscribe_t shades_req_sbscr = {
     .callback = shades_requested,
+    .work_q   = &data_dispatcher_work_q,
+    .buf      = shades_req_buf,
+    .buf_size = sizeof(shades_req_buf),
 };
 
 void shades_conn_init(void)
@@ -12,7 +12,7 @@
 #ifndef SHADES_CONN_H_
 #define SHADES_CONN_H_
 
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,7 +13,7 @@
 #include <zephyr/net/socket.h>
 
 #include "coap.h"
-#include "data_dispatcher.h"
+#include <data_dispatcher.h>
 
 #include <continuous_sd.h>
 
@@ -369,8 +369,12 @@ static void vent_requested(const data_dispatcher_publish_t *data) {
     k_sem_give(&vent_out_sem);
 }
 
+static uint8_t vent_req_buf[DATA_DISPATCHER_BUF_SIZE(data_vent_sm_t, 1, 1, 0)];
 static data_dispatcher_subscribe_t vent_req_sbscr = {
     .callback = vent_requested,
+    .work_q   = &data_dispatcher_work_q,
+    .buf      = vent_req_buf,
+    .buf_size = sizeof(vent_req_buf),
 };
 
 void vent_conn_init(void)